@@ -24,6 +24,19 @@ enum ofp_extension_commands { /* Queue configuration commands */
     OFP_EXT_QUEUE_DELETE,  /* Remove a queue */
     OFP_EXT_SET_DESC,      /* Set ofp_desc_stat->dp_desc */
 
+    /* Packet-in rate limiting */
+    OFP_EXT_SET_PKTIN_LIMIT,     /* Set packet-in limits */
+    OFP_EXT_PKTIN_LIMIT_REQUEST, /* Query packet-in limits and counters */
+    OFP_EXT_PKTIN_LIMIT_REPLY,   /* Reply to OFP_EXT_PKTIN_LIMIT_REQUEST */
+
+    /* Packet buffers */
+    OFP_EXT_BUFFER_STATS_REQUEST, /* Query packet buffer counters */
+    OFP_EXT_BUFFER_STATS_REPLY,   /* Reply to OFP_EXT_BUFFER_STATS_REQUEST */
+
+    /* Bundles */
+    OFP_EXT_BUNDLE_CONTROL,      /* Open, close, commit or discard a bundle */
+    OFP_EXT_BUNDLE_ADD,          /* Add a message to a bundle */
+
     OFP_EXT_COUNT
 };
 
@@ -87,6 +100,260 @@ struct openflow_ext_set_dp_desc {
 };
 OFP_ASSERT(sizeof(struct openflow_ext_set_dp_desc) == 272);
 
+/* Wildcard for the reason of packet-in limits. */
+#define OFPR_EXT_ALL 0xff
+
+/* Limits the rate of packet-in messages sent for the given reason (OFPR_*, or
+ * OFPR_EXT_ALL) from the given table (or OFPTT_ALL).  Packet-ins over the
+ * limit are dropped, without buffering the packet, except one in every
+ * 'sample' of them if 'sample' is not 0. */
+struct openflow_ext_set_pktin_limit {
+    struct ofp_extension_header header;
+    uint8_t reason;             /* OFPR_* or OFPR_EXT_ALL. */
+    uint8_t table_id;           /* Table or OFPTT_ALL. */
+    uint8_t pad[2];
+    uint32_t rate;              /* Packets per second, 0 for no limit. */
+    uint32_t burst;             /* Bucket size, in packets. */
+    uint32_t sample;            /* Send 1 in 'sample' packet-ins over the
+                                   limit, 0 for none. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_set_pktin_limit) == 32);
+
+/* Limit and counters of one (reason, table) pair. */
+struct openflow_ext_pktin_stats {
+    uint8_t reason;             /* OFPR_*. */
+    uint8_t table_id;
+    uint8_t pad[2];
+    uint32_t rate;              /* Packets per second, 0 for no limit. */
+    uint32_t burst;             /* Bucket size, in packets. */
+    uint32_t sample;            /* 1 in 'sample' sent over the limit. */
+    uint64_t n_sent;            /* Packet-ins sent within the limit. */
+    uint64_t n_dropped;         /* Packet-ins dropped over the limit. */
+    uint64_t n_sampled;         /* Packet-ins sent over the limit. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_pktin_stats) == 40);
+
+/* Lists the (reason, table) pairs that have a limit set or have sent any
+ * packet-in. */
+struct openflow_ext_pktin_limit_reply {
+    struct ofp_extension_header header;
+    struct openflow_ext_pktin_stats stats[0];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_pktin_limit_reply) == 16);
+
+/* Occupancy and counters of the buffers holding packets sent to the
+ * controller. */
+struct openflow_ext_buffer_stats_reply {
+    struct ofp_extension_header header;
+    uint64_t capacity;          /* Maximum bytes to buffer. */
+    uint64_t bytes;             /* Bytes buffered. */
+    uint32_t n_packets;         /* Packets buffered. */
+    uint8_t pad[4];
+    uint64_t n_saved;           /* Packets saved. */
+    uint64_t n_hits;            /* Packets retrieved. */
+    uint64_t n_misses;          /* Retrievals of unknown or expired buffers. */
+    uint64_t n_expired;         /* Packets expired before being retrieved. */
+    uint64_t n_evicted;         /* Packets evicted to make room for others. */
+    uint64_t n_failed;          /* Packets too large to be saved. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_buffer_stats_reply) == 88);
+
+/****************************************************************
+ *
+ * Bundles, after OpenFlow 1.4.  A bundle collects flow, group and meter
+ * mods sent by one connection, which are then committed together: they are
+ * all checked before any of them is applied, and packets never see the
+ * tables with only part of the bundle applied.
+ *
+ ****************************************************************/
+
+enum openflow_ext_bundle_ctrl_type {
+    OFPBCT_EXT_OPEN_REQUEST    = 0,
+    OFPBCT_EXT_OPEN_REPLY      = 1,
+    OFPBCT_EXT_CLOSE_REQUEST   = 2,
+    OFPBCT_EXT_CLOSE_REPLY     = 3,
+    OFPBCT_EXT_COMMIT_REQUEST  = 4,
+    OFPBCT_EXT_COMMIT_REPLY    = 5,
+    OFPBCT_EXT_DISCARD_REQUEST = 6,
+    OFPBCT_EXT_DISCARD_REPLY   = 7
+};
+
+enum openflow_ext_bundle_flags {
+    OFPBF_EXT_ATOMIC  = 1 << 0, /* Apply all or none of the messages. */
+    OFPBF_EXT_ORDERED = 1 << 1  /* Apply the messages in order. */
+};
+
+/* Codes of OFPET_EXPERIMENTER errors about bundles. */
+enum openflow_ext_bundle_failed_code {
+    OFPBFC_EXT_UNKNOWN            = 0,  /* Unspecified error. */
+    OFPBFC_EXT_EPERM              = 1,  /* Permissions error. */
+    OFPBFC_EXT_BAD_ID             = 2,  /* Bundle ID doesn't exist. */
+    OFPBFC_EXT_BUNDLE_EXIST       = 3,  /* Bundle ID already exists. */
+    OFPBFC_EXT_BUNDLE_CLOSED      = 4,  /* Bundle ID is closed. */
+    OFPBFC_EXT_OUT_OF_BUNDLES     = 5,  /* Too many bundles IDs. */
+    OFPBFC_EXT_BAD_TYPE           = 6,  /* Unsupported or unknown type. */
+    OFPBFC_EXT_BAD_FLAGS          = 7,  /* Unsupported or inconsistent flags. */
+    OFPBFC_EXT_MSG_BAD_LEN        = 8,  /* Length in the message is wrong. */
+    OFPBFC_EXT_MSG_BAD_XID        = 9,  /* Inconsistent or duplicate XID. */
+    OFPBFC_EXT_MSG_UNSUP          = 10, /* Unsupported message in bundle. */
+    OFPBFC_EXT_MSG_CONFLICT       = 11, /* Unsupported message combination. */
+    OFPBFC_EXT_MSG_TOO_MANY       = 12, /* Cannot handle that many messages. */
+    OFPBFC_EXT_MSG_FAILED         = 13, /* One message in bundle failed. */
+    OFPBFC_EXT_TIMEOUT            = 14, /* Bundle is taking too long. */
+    OFPBFC_EXT_BUNDLE_IN_PROGRESS = 15  /* Bundle is locking the resource. */
+};
+
+struct openflow_ext_bundle_ctrl {
+    struct ofp_extension_header header;
+    uint32_t bundle_id;         /* Identifies the bundle. */
+    uint16_t type;              /* OFPBCT_EXT_*. */
+    uint16_t flags;             /* Bitmap of OFPBF_EXT_* flags. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_bundle_ctrl) == 24);
+
+/* Adds a message to a bundle, opening it if needed.  The message must have
+ * the same xid as this one. */
+struct openflow_ext_bundle_add {
+    struct ofp_extension_header header;
+    uint32_t bundle_id;         /* Identifies the bundle. */
+    uint8_t pad[2];
+    uint16_t flags;             /* Bitmap of OFPBF_EXT_* flags. */
+    struct ofp_header message[0]; /* Message added to the bundle. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_bundle_add) == 24);
+
+/****************************************************************
+ *
+ * Flow counter deltas.  An OFPMP_EXPERIMENTER multipart listing, in fixed
+ * size records, only the flow entries whose counters changed since the
+ * previous request of the same connection.  Matches and instructions are
+ * left out; entries are told apart by an id unique to the switch.
+ *
+ ****************************************************************/
+
+enum openflow_ext_stats_types {
+    OFPMP_EXT_FLOW_DELTA   = 0, /* Flow counters changed since last asked. */
+    OFPMP_EXT_FLOW_MONITOR = 1  /* Flow monitors, see below. */
+};
+
+struct openflow_ext_flow_delta_request {
+    struct ofp_experimenter_stats_header header; /* exp_type is
+                                                    OFPMP_EXT_FLOW_DELTA. */
+    uint8_t table_id;           /* Table or OFPTT_ALL. */
+    uint8_t pad[7];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_flow_delta_request) == 16);
+
+enum openflow_ext_flow_delta_flags {
+    OFPFDF_EXT_NEW     = 1 << 0, /* Entry not reported to the connection
+                                    before. */
+    OFPFDF_EXT_REMOVED = 1 << 1  /* Entry removed since the last request;
+                                    the counters are those last reported. */
+};
+
+/* The reply body is an array of these. */
+struct openflow_ext_flow_delta {
+    uint64_t entry_id;          /* Identifies the entry in the switch. */
+    uint64_t cookie;
+    uint64_t packet_count;
+    uint64_t byte_count;
+    uint32_t duration_sec;      /* Time the entry has been alive. */
+    uint16_t priority;
+    uint8_t table_id;
+    uint8_t flags;              /* Bitmap of OFPFDF_EXT_* flags. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_flow_delta) == 40);
+
+/****************************************************************
+ *
+ * Flow monitors, after OpenFlow 1.4.  A connection sets filters on the flow
+ * tables with OFPMP_EXT_FLOW_MONITOR requests, and the switch then tells it
+ * of the flow entries added, modified and removed that pass any of them, in
+ * OFPMP_EXT_FLOW_MONITOR replies of xid 0.  The reply to a request lists
+ * the entries passing the filter, if asked for with OFPFMF_EXT_INITIAL.
+ *
+ * When the connection falls behind, the switch sends OFPFME_EXT_PAUSED and
+ * stops telling it of changes.  Once the connection caught up, it lists the
+ * entries passing the filters as OFPFME_EXT_INITIAL updates, followed by
+ * OFPFME_EXT_RESUMED; the entries not listed have been removed.
+ *
+ ****************************************************************/
+
+enum openflow_ext_flow_monitor_command {
+    OFPFMC_EXT_ADD    = 0,      /* New monitor. */
+    OFPFMC_EXT_MODIFY = 1,      /* Modify existing monitor. */
+    OFPFMC_EXT_DELETE = 2       /* Delete monitor. */
+};
+
+enum openflow_ext_flow_monitor_flags {
+    OFPFMF_EXT_INITIAL      = 1 << 0, /* List the entries in the reply. */
+    OFPFMF_EXT_ADD          = 1 << 1, /* Tell of entries added. */
+    OFPFMF_EXT_REMOVED      = 1 << 2, /* Tell of entries removed. */
+    OFPFMF_EXT_MODIFY       = 1 << 3, /* Tell of entries modified. */
+    OFPFMF_EXT_INSTRUCTIONS = 1 << 4  /* Include the instructions. */
+};
+
+struct openflow_ext_flow_monitor_request {
+    struct ofp_experimenter_stats_header header; /* exp_type is
+                                                    OFPMP_EXT_FLOW_MONITOR. */
+    uint32_t monitor_id;        /* Chosen by the connection. */
+    uint32_t out_port;          /* Required output port, or OFPP_ANY. */
+    uint32_t out_group;         /* Required output group, or OFPG_ANY. */
+    uint16_t flags;             /* Bitmap of OFPFMF_EXT_* flags. */
+    uint8_t table_id;           /* Table or OFPTT_ALL. */
+    uint8_t command;            /* One of OFPFMC_EXT_*. */
+    struct ofp_match match;     /* Fields to match, variable size. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_flow_monitor_request) == 32);
+
+enum openflow_ext_flow_update_event {
+    OFPFME_EXT_INITIAL  = 0,    /* Entry present when the monitor was set,
+                                   or when updates resumed. */
+    OFPFME_EXT_ADDED    = 1,    /* Entry added. */
+    OFPFME_EXT_REMOVED  = 2,    /* Entry removed. */
+    OFPFME_EXT_MODIFIED = 3,    /* Entry instructions changed. */
+    OFPFME_EXT_PAUSED   = 5,    /* Updates stopped, the connection is busy. */
+    OFPFME_EXT_RESUMED  = 6     /* Updates restarted. */
+};
+
+/* The reply body is a sequence of these, for all events but
+ * OFPFME_EXT_PAUSED and OFPFME_EXT_RESUMED. */
+struct openflow_ext_flow_update_full {
+    uint16_t length;            /* Length of this entry. */
+    uint16_t event;             /* One of OFPFME_EXT_*. */
+    uint8_t table_id;
+    uint8_t reason;             /* OFPRR_* for OFPFME_EXT_REMOVED. */
+    uint16_t idle_timeout;
+    uint16_t hard_timeout;
+    uint16_t priority;
+    uint8_t zeros[4];
+    uint64_t cookie;
+    struct ofp_match match;     /* Fields to match, variable size. */
+    /* Followed by the instructions, if OFPFMF_EXT_INSTRUCTIONS was set. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_flow_update_full) == 32);
+
+/* OFPFME_EXT_PAUSED and OFPFME_EXT_RESUMED. */
+struct openflow_ext_flow_update_paused {
+    uint16_t length;            /* Length of this entry. */
+    uint16_t event;             /* One of OFPFME_EXT_*. */
+    uint8_t zeros[4];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_flow_update_paused) == 8);
+
+/* Codes of OFPET_EXPERIMENTER errors about flow monitors, after those of
+ * bundles. */
+enum openflow_ext_flow_monitor_failed_code {
+    OFPMOFC_EXT_UNKNOWN         = 0x100, /* Unspecified error. */
+    OFPMOFC_EXT_MONITOR_EXISTS  = 0x101, /* Monitor id already exists. */
+    OFPMOFC_EXT_INVALID_MONITOR = 0x102, /* Invalid monitor, or too many. */
+    OFPMOFC_EXT_UNKNOWN_MONITOR = 0x103, /* Monitor id doesn't exist. */
+    OFPMOFC_EXT_BAD_COMMAND     = 0x104, /* Unsupported or unknown command. */
+    OFPMOFC_EXT_BAD_FLAGS       = 0x105, /* Flag configuration unsupported. */
+    OFPMOFC_EXT_BAD_TABLE_ID    = 0x106, /* Table id doesn't exist. */
+    OFPMOFC_EXT_BAD_OUT         = 0x107  /* Error in output port or group. */
+};
+
 #define ofq_error_string(rv) (((rv) < OFQ_ERR_COUNT) && ((rv) >= 0) ? \
     openflow_queue_error_strings[rv] : "Unknown error code")
 
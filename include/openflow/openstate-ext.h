@@ -42,7 +42,10 @@ OFP_ASSERT(sizeof(struct ofp_openstate_instruction_experimenter_header) == 16);
  ****************************************************************/
 enum ofp_exp_actions {
     OFPAT_EXP_SET_STATE,
-    OFPAT_EXP_SET_GLOBAL_STATE
+    OFPAT_EXP_SET_GLOBAL_STATE,
+    OFPAT_EXP_INC_STATE_REG,
+    OFPAT_EXP_SET_STATE_REG,
+    OFPAT_EXP_CMP_SET_STATE
 };
 
 struct ofp_openstate_action_experimenter_header {
@@ -76,6 +79,66 @@ struct ofp_exp_action_set_global_state {
 };
 OFP_ASSERT(sizeof(struct ofp_exp_action_set_global_state) == 24);
 
+/* Registers of a state entry, which the actions below update.  An entry is
+ * created in the default state for a key without one, with all its
+ * registers at 0; they go with the entry, which a state mod or set state
+ * action back to the default state without timeouts removes. */
+#define OFPSC_MAX_REGISTERS 4
+
+enum ofp_exp_state_reg_flags {
+    OFPSRF_PKT_LEN = 1 << 0     /* Add the length of the packet instead of
+                                   'value'. */
+};
+
+/* Action structure for OFPAT_EXP_INC_STATE_REG: adds 'value' to register
+ * 'reg' of the state entry of the packet's update-scope key in stage
+ * 'table_id'. */
+struct ofp_exp_action_inc_state_reg {
+    struct ofp_openstate_action_experimenter_header header;
+    uint8_t table_id;
+    uint8_t reg;
+    uint8_t flags;      /* OFPSRF_* */
+    uint8_t pad[5];
+    uint64_t value;
+};
+OFP_ASSERT(sizeof(struct ofp_exp_action_inc_state_reg) == 32);
+
+/* Action structure for OFPAT_EXP_SET_STATE_REG: sets register 'reg' of the
+ * state entry of the packet to 'value'. */
+struct ofp_exp_action_set_state_reg {
+    struct ofp_openstate_action_experimenter_header header;
+    uint8_t table_id;
+    uint8_t reg;
+    uint8_t pad[6];
+    uint64_t value;
+};
+OFP_ASSERT(sizeof(struct ofp_exp_action_set_state_reg) == 32);
+
+enum ofp_exp_state_reg_cmp {
+    OFPSRC_EQ,
+    OFPSRC_NE,
+    OFPSRC_LT,
+    OFPSRC_LE,
+    OFPSRC_GT,
+    OFPSRC_GE
+};
+
+/* Action structure for OFPAT_EXP_CMP_SET_STATE: sets the state of the
+ * state entry of the packet to 'state' under 'state_mask', as a set state
+ * action without timeouts would, if register 'reg' compares to 'value' as
+ * 'cmp' says.  A key without entry has its registers at 0. */
+struct ofp_exp_action_cmp_set_state {
+    struct ofp_openstate_action_experimenter_header header;
+    uint8_t table_id;
+    uint8_t reg;
+    uint8_t cmp;        /* OFPSRC_* */
+    uint8_t pad[5];
+    uint64_t value;
+    uint32_t state;
+    uint32_t state_mask;
+};
+OFP_ASSERT(sizeof(struct ofp_exp_action_cmp_set_state) == 40);
+
 
 /*EXPERIMENTER MESSAGES*/
 enum ofp_exp_messages {
@@ -144,11 +207,80 @@ struct ofp_exp_del_flow_state {
     uint8_t key[OFPSC_MAX_KEY_LEN];
 };
 
+/* Body of OFPSC_EXP_SET_FLOW_STATES: 'n_entries' ofp_exp_flow_state_entry
+ * records follow, each with a key of 'key_len' bytes. */
+struct ofp_exp_set_flow_states {
+    uint8_t table_id;
+    uint8_t pad[3];
+    uint32_t key_len;
+    uint32_t n_entries;
+    uint8_t pad2[4];
+    uint8_t entries[];
+};
+OFP_ASSERT(sizeof(struct ofp_exp_set_flow_states) == 16);
+
+struct ofp_exp_flow_state_entry {
+    uint32_t state;
+    uint32_t state_mask;
+    uint32_t hard_rollback;
+    uint32_t idle_rollback;
+    uint32_t hard_timeout;
+    uint32_t idle_timeout;
+    uint8_t key[];      /* 'key_len' bytes, zero padded to 64 bits. */
+};
+OFP_ASSERT(sizeof(struct ofp_exp_flow_state_entry) == 24);
+
+/* Body of OFPSC_EXP_DEL_FLOW_STATES: 'n_keys' keys of 'key_len' bytes follow,
+ * each zero padded to 64 bits. */
+struct ofp_exp_del_flow_states {
+    uint8_t table_id;
+    uint8_t pad[3];
+    uint32_t key_len;
+    uint32_t n_keys;
+    uint8_t pad2[4];
+    uint8_t keys[];
+};
+OFP_ASSERT(sizeof(struct ofp_exp_del_flow_states) == 16);
+
+/* Body of OFPSC_EXP_DEL_FLOW_STATES_BY_STATE, dropping the entries whose state
+ * matches 'state' under 'state_mask'. */
+struct ofp_exp_del_flow_states_by_state {
+    uint8_t table_id;   /* OFPTT_ALL for all the stages. */
+    uint8_t pad[3];
+    uint32_t state;
+    uint32_t state_mask;
+    uint8_t pad2[4];
+};
+OFP_ASSERT(sizeof(struct ofp_exp_del_flow_states_by_state) == 16);
+
+/* Body of OFPSC_EXP_FLUSH_STATE_TABLE. */
+struct ofp_exp_flush_state_table {
+    uint8_t table_id;   /* OFPTT_ALL for all the stages. */
+    uint8_t pad[7];
+};
+OFP_ASSERT(sizeof(struct ofp_exp_flush_state_table) == 8);
+
 struct ofp_exp_set_global_state {
     uint32_t global_state;
     uint32_t global_state_mask;
 };
 
+/* Which entry a full state table drops to make room for a new one. */
+enum ofp_exp_state_eviction {
+    OFPSE_LRU,          /* Least recently matched or set. */
+    OFPSE_OLDEST,       /* Least recently set. */
+    OFPSE_RANDOM        /* Least recently matched of a few random ones. */
+};
+
+struct ofp_exp_set_table_limits {
+    uint8_t table_id;
+    uint8_t eviction;       /* One of OFPSE_*. */
+    uint8_t pad[2];
+    uint32_t max_entries;   /* 0 for no limit. */
+    uint64_t max_bytes;     /* Memory of the entries, 0 for no limit. */
+};
+OFP_ASSERT(sizeof(struct ofp_exp_set_table_limits) == 16);
+
 enum ofp_exp_msg_state_mod_commands {
     OFPSC_STATEFUL_TABLE_CONFIG = 0,
     OFPSC_EXP_SET_L_EXTRACTOR,
@@ -156,7 +288,12 @@ enum ofp_exp_msg_state_mod_commands {
     OFPSC_EXP_SET_FLOW_STATE,   
     OFPSC_EXP_DEL_FLOW_STATE,
     OFPSC_EXP_SET_GLOBAL_STATE,
-    OFPSC_EXP_RESET_GLOBAL_STATE   
+    OFPSC_EXP_RESET_GLOBAL_STATE,
+    OFPSC_EXP_SET_TABLE_LIMITS,
+    OFPSC_EXP_SET_FLOW_STATES,
+    OFPSC_EXP_DEL_FLOW_STATES,
+    OFPSC_EXP_DEL_FLOW_STATES_BY_STATE,
+    OFPSC_EXP_FLUSH_STATE_TABLE
 };
 
 /****************************************************************
@@ -167,7 +304,8 @@ enum ofp_exp_msg_state_mod_commands {
 enum ofp_stats_extension_commands {
     OFPMP_EXP_STATE_STATS,      
     OFPMP_EXP_STATE_STATS_NUM,
-    OFPMP_EXP_GLOBAL_STATE_STATS
+    OFPMP_EXP_GLOBAL_STATE_STATS,
+    OFPMP_EXP_STATE_TABLE_STATS
 };
 
 struct ofp_exp_state_entry{
@@ -208,15 +346,18 @@ struct ofp_exp_state_stats {
     uint32_t idle_rollback;
     uint32_t hard_timeout; // [us]
     uint32_t idle_timeout; // [us]
+    uint64_t registers[OFPSC_MAX_REGISTERS];
 };
-OFP_ASSERT(sizeof(struct ofp_exp_state_stats) == 112);
+OFP_ASSERT(sizeof(struct ofp_exp_state_stats) == 144);
 
 /* Body for ofp_multipart_request of type OFPMP_EXP_STATE_STATS_NUM. */
 struct ofp_exp_state_stats_num_request {
     struct ofp_experimenter_stats_header header;
     uint8_t                 table_id;       /* ID of table to read (from ofp_table_stats),
                                OFPTT_ALL for all tables. */
-    uint8_t                 pad[7];         /* Align to 64 bits. */
+    uint8_t                 get_from_state; /* Count only the entries in 'state'. */
+    uint8_t                 pad[2];
+    uint32_t                state;
 };
 OFP_ASSERT(sizeof(struct ofp_exp_state_stats_num_request) == 16);
 
@@ -228,6 +369,35 @@ struct ofp_exp_state_stats_num {
 };
 OFP_ASSERT(sizeof(struct ofp_exp_state_stats_num) == 16);
 
+/****************************************************************
+ *
+ *   MULTIPART MESSAGE: OFPMP_EXP_STATE_TABLE_STATS
+ *
+****************************************************************/
+
+/* Body for ofp_multipart_request of type OFPMP_EXP_STATE_TABLE_STATS. */
+struct ofp_exp_state_table_stats_request {
+    struct ofp_experimenter_stats_header header;
+    uint8_t                 table_id;       /* ID of table to read. */
+    uint8_t                 pad[7];         /* Align to 64 bits. */
+};
+OFP_ASSERT(sizeof(struct ofp_exp_state_table_stats_request) == 16);
+
+/* Body of reply to OFPMP_EXP_STATE_TABLE_STATS request. */
+struct ofp_exp_state_table_stats {
+    struct ofp_experimenter_stats_header header;
+    uint8_t table_id;
+    uint8_t eviction;       /* One of OFPSE_*. */
+    uint8_t pad[2];
+    uint32_t count;         /* Number of state entries. */
+    uint32_t max_entries;   /* 0 for no limit. */
+    uint8_t pad2[4];
+    uint64_t bytes;         /* Memory of the entries. */
+    uint64_t max_bytes;     /* 0 for no limit. */
+    uint64_t evictions;     /* Entries evicted to make room. */
+};
+OFP_ASSERT(sizeof(struct ofp_exp_state_table_stats) == 48);
+
 /****************************************************************
  *
  *   MULTIPART MESSAGE: OFPMP_EXP_GLOBAL_STATE_STATS
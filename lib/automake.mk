@@ -31,6 +31,8 @@ lib_libopenflow_a_SOURCES = \
 	lib/hmap.h \
 	lib/ipv6_util.c \
 	lib/ipv6_util.h \
+	lib/latch.c \
+	lib/latch.h \
 	lib/leak-checker.c \
 	lib/leak-checker.h \
 	lib/list.c \
@@ -66,6 +68,8 @@ lib_libopenflow_a_SOURCES = \
 	lib/signals.h \
 	lib/socket-util.c \
 	lib/socket-util.h \
+	lib/spsc-ring.c \
+	lib/spsc-ring.h \
 	lib/stp.c \
 	lib/stp.h \
 	lib/svec.c \
@@ -96,6 +100,7 @@ lib_libopenflow_a_LIBADD = oflib/ofl-actions.o \
                            oflib/ofl-actions-pack.o \
                            oflib/ofl-actions-print.o \
                            oflib/ofl-actions-unpack.o \
+                           oflib/ofl-arena.o \
                            oflib/ofl-messages.o \
                            oflib/ofl-messages-pack.o \
                            oflib/ofl-messages-print.o \
@@ -83,7 +83,10 @@ csum_continue(uint32_t partial, const void *data_, size_t n)
 uint16_t
 csum_finish(uint32_t partial)
 {
-    return ~((partial & 0xffff) + (partial >> 16));
+    while (partial >> 16) {
+        partial = (partial & 0xffff) + (partial >> 16);
+    }
+    return ~partial;
 }
 
 /* Returns the new checksum for a packet in which the checksum field previously
@@ -140,3 +143,44 @@ recalc_csum128(uint16_t old_csum, uint8_t const old_u128[16], uint8_t const new_
     return recalc_csum64(recalc_csum64(old_csum, old_right, new_right),
                          old_left, new_left);
 }
+
+/* Adds to 'partial' the change of a 16-bit field from 'old_u16' to 'new_u16'
+ * and returns the updated value.  Changes accumulated this way starting from
+ * 0 may later be applied to a checksum at once with recalc_csum_delta(). */
+uint32_t
+csum_delta16(uint32_t partial, uint16_t old_u16, uint16_t new_u16)
+{
+    return csum_add16(csum_add16(partial, ~old_u16), new_u16);
+}
+
+/* Same as csum_delta16(), for a 32-bit field. */
+uint32_t
+csum_delta32(uint32_t partial, uint32_t old_u32, uint32_t new_u32)
+{
+    return csum_delta16(csum_delta16(partial, old_u32, new_u32),
+                        old_u32 >> 16, new_u32 >> 16);
+}
+
+/* Same as csum_delta16(), for a 128-bit field. */
+uint32_t
+csum_delta128(uint32_t partial, uint8_t const old_u128[16],
+              uint8_t const new_u128[16])
+{
+    const uint16_t *old = (const uint16_t *) old_u128;
+    const uint16_t *new = (const uint16_t *) new_u128;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        partial = csum_delta16(partial, old[i], new[i]);
+    }
+    return partial;
+}
+
+/* Returns the new checksum for a packet in which the checksum field previously
+ * contained 'old_csum' and whose covered fields changed as accumulated in
+ * 'delta' by csum_delta16() and friends. */
+uint16_t
+recalc_csum_delta(uint16_t old_csum, uint32_t delta)
+{
+    return csum_finish(csum_add16(delta, ~old_csum));
+}
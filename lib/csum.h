@@ -46,5 +46,10 @@ uint16_t recalc_csum16(uint16_t old_csum, uint16_t old_u16, uint16_t new_u16);
 uint16_t recalc_csum32(uint16_t old_csum, uint32_t old_u32, uint32_t new_u32);
 uint16_t recalc_csum64(uint16_t old_csum, uint64_t old_u64, uint64_t new_u64);
 uint16_t recalc_csum128(uint16_t old_csum, uint8_t const old_u128[16], uint8_t const new_u128[16]);
+uint32_t csum_delta16(uint32_t partial, uint16_t old_u16, uint16_t new_u16);
+uint32_t csum_delta32(uint32_t partial, uint32_t old_u32, uint32_t new_u32);
+uint32_t csum_delta128(uint32_t partial, uint8_t const old_u128[16],
+                       uint8_t const new_u128[16]);
+uint16_t recalc_csum_delta(uint16_t old_csum, uint32_t delta);
 
 #endif /* csum.h */
@@ -74,12 +74,17 @@
 #include <linux/rtnetlink.h>
 #include <linux/if_tun.h>
 #include <linux/if_packet.h>
+#include <linux/virtio_net.h>
 
 
 #ifdef PACKET_AUXDATA
 #   define HAVE_PACKET_AUXDATA
 #endif
 
+#if defined(PACKET_VNET_HDR) && defined(IFF_VNET_HDR)
+#   define HAVE_VNET_HDR
+#endif
+
 /* Fix for some compile issues we were experiencing when setting up openwrt
  * with the 2.4 kernel. linux/ethtool.h seems to use kernel-style inttypes,
  * which breaks in userspace.
@@ -102,6 +107,7 @@
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <net/ethernet.h>
 #include <net/if.h>
 #include <net/if_arp.h>
@@ -111,6 +117,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "csum.h"
 #include "fatal-signal.h"
 #include "list.h"
 #include "netlink.h"
@@ -141,8 +148,6 @@ struct netdev {
     int tap_fd;                 /* TAP character device, if any, otherwise the
                                  * network device. */
 
-    int netlink_fd;
-
     /* one socket per queue.These are valid only for ordinary network devices*/
     int queue_fd[NETDEV_MAX_QUEUES + 1];
     uint16_t num_queues;
@@ -165,6 +170,8 @@ struct netdev {
 
     int save_flags;             /* Initial device flags. */
     int changed_flags;          /* Flags that we changed. */
+
+    bool offload;               /* Segmentation and checksum offloading? */
 };
 
 /* All open network devices. */
@@ -183,6 +190,7 @@ static int do_open_netdev(const char *name, int ethertype, int tap_fd,
 static int restore_flags(struct netdev *netdev);
 static int get_flags(const char *netdev_name, int *flagsp);
 static int set_flags(const char *netdev_name, int flags);
+static int set_vnet_hdr(int fd, bool enable);
 
 /* Obtains the IPv6 address for 'name' into 'in6'. */
 static void
@@ -516,6 +524,9 @@ netdev_setup_slicing(struct netdev *netdev, uint16_t num_queues)
     for (i=1; i <= netdev->num_queues; i++) {
         fd = &netdev->queue_fd[i];
         error = open_queue_socket(netdev->name,i,fd);
+        if (!error && netdev->offload) {
+            error = set_vnet_hdr(*fd, true);
+        }
         if (error) {
             return error;
         }
@@ -693,6 +704,12 @@ netdev_open_tap(const char *name, struct netdev **netdevp)
 
     memset(&ifr, 0, sizeof ifr);
     ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+#ifdef HAVE_VNET_HDR
+    /* Whether the kernel may pass super-packets and partial checksums is
+     * decided later by netdev_enable_offload(), but the header can only be
+     * requested here. */
+    ifr.ifr_flags |= IFF_VNET_HDR;
+#endif
     if (name) {
         strncpy(ifr.ifr_name, name, sizeof ifr.ifr_name);
     }
@@ -723,9 +740,7 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
                struct netdev **netdev_)
 {
     int netdev_fd = 0;
-    int netlink_fd;
     struct sockaddr_ll sll;
-    struct sockaddr_nl snl;
     struct ifreq ifr;
     unsigned int ifindex;
     uint8_t etheraddr[ETH_ADDR_LEN];
@@ -740,18 +755,6 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
     init_netdev();
     *netdev_ = NULL;
 
-    netlink_fd = socket(PF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-
-    if (netlink_fd < 0) {
-        return errno;
-    }
-
-    /* Set non-blocking mode. */
-    error = set_nonblocking(netlink_fd);
-    if (error) {
-        goto error_already_set;
-    }
-
     /* Create raw socket. */
     netdev_fd = socket(PF_PACKET, SOCK_RAW,
                        htons(ethertype == NETDEV_ETH_TYPE_NONE ? 0
@@ -775,14 +778,6 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
         goto error_already_set;
     }
 
-    memset (&snl,0,sizeof(snl));
-    snl.nl_family = AF_NETLINK;
-    snl.nl_groups =  RTMGRP_LINK;
-
-    if (bind(netlink_fd, (struct sockaddr *)&snl, sizeof(snl)) < 0){
-        VLOG_ERR(LOG_MODULE, "netlink bind to %s failed: %s", name, strerror(errno));
-        goto error;
-    }
     /* Get ethernet device index. */
     strncpy(ifr.ifr_name, name, sizeof ifr.ifr_name);
     if (ioctl(netdev_fd, SIOCGIFINDEX, &ifr) < 0) {
@@ -850,13 +845,13 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
     netdev->txqlen = txqlen;
     netdev->hwaddr_family = hwaddr_family;
     netdev->netdev_fd = netdev_fd;
-    netdev->netlink_fd = netlink_fd;
     netdev->tap_fd = tap_fd < 0 ? netdev_fd : tap_fd;
     netdev->queue_fd[0] = netdev->tap_fd;
     memcpy(netdev->etheraddr, etheraddr, sizeof etheraddr);
     netdev->mtu = mtu;
     netdev->in6 = in6;
     netdev->num_queues = 0;
+    netdev->offload = false;
 
     /* Get speed, features. */
     do_ethtool(netdev);
@@ -908,8 +903,10 @@ netdev_close(struct netdev *netdev)
 
         /* Free. */
         free(netdev->name);
+        poll_fd_forget(netdev->netdev_fd);
         close(netdev->netdev_fd);
         if (netdev->netdev_fd != netdev->tap_fd) {
+            poll_fd_forget(netdev->tap_fd);
             close(netdev->tap_fd);
         }
 
@@ -930,38 +927,270 @@ pad_to_minimum_length(struct ofpbuf *buffer)
     }
 }
 
+/* Enables or disables the virtio-net header in front of each packet sent or
+ * received on packet socket 'fd'.  Returns 0 if successful, otherwise a
+ * positive errno value. */
+static int
+set_vnet_hdr(int fd, bool enable)
+{
+#ifdef HAVE_VNET_HDR
+    int val = enable;
+
+    if (setsockopt(fd, SOL_PACKET, PACKET_VNET_HDR, &val, sizeof val) < 0) {
+        return errno;
+    }
+    return 0;
+#else
+    return enable ? EOPNOTSUPP : 0;
+#endif
+}
+
+/* Returns true if packets read from or written to 'fd', one of the file
+ * descriptors of 'netdev', are preceded by a virtio-net header. */
+static bool
+fd_has_vnet_hdr(const struct netdev *netdev, int fd)
+{
+#ifdef HAVE_VNET_HDR
+    /* TAP devices are always opened with IFF_VNET_HDR, whereas packet sockets
+     * only get PACKET_VNET_HDR along with offloading. */
+    return netdev->offload
+           || (fd == netdev->tap_fd && fd != netdev->netdev_fd);
+#else
+    return false;
+#endif
+}
+
+/* Enables segmentation and checksum offloading on 'netdev'.  Afterwards,
+ * netdev_recv_offload() may return TCP and UDP super-packets of up to
+ * NETDEV_GSO_MAX_LEN bytes plus Ethernet and VLAN headers, along with the
+ * offload state that describes them, and netdev_send_offload() hands such
+ * packets to the kernel, which segments them itself if the hardware cannot.
+ *
+ * Returns 0 if successful, otherwise a positive errno value, in which case
+ * 'netdev' keeps receiving complete packets only. */
 int
-netdev_link_state(struct netdev *netdev)
-{
-     int len;
-     char buff[4096];
-     struct nlmsghdr *nlm;
-     struct ifinfomsg *ifa;
-     enum netdev_flags flags;
-     nlm = (struct nlmsghdr *)buff;
-     do
-     {
-        len = recv (netdev->netlink_fd,nlm,4096,0);
-        for (;(NLMSG_OK (nlm, len)) && (nlm->nlmsg_type != NLMSG_DONE); nlm = NLMSG_NEXT(nlm, len))
-         {
-             if (nlm->nlmsg_type != RTM_NEWLINK)
-                continue;
-             ifa = (struct ifinfomsg *) NLMSG_DATA (nlm);
-             if (ifa->ifi_index == netdev->ifindex){
-                 if (ifa->ifi_flags & IFF_UP){
-                     netdev_nodev_get_flags(netdev->name, &flags);
-                     netdev_set_flags(netdev, flags, false);
-                     return NETDEV_LINK_UP;
-                 }
-                 else {
-                     netdev_nodev_get_flags(netdev->name, &flags);
-                     netdev_set_flags(netdev, flags, false);
-                     return NETDEV_LINK_DOWN;
-                 }
-	     }
-         }
-     } while (len < 0 && errno == EINTR);
-     return NETDEV_LINK_NO_CHANGE;
+netdev_enable_offload(struct netdev *netdev)
+{
+#ifdef HAVE_VNET_HDR
+    int error = 0;
+    int i;
+
+    if (netdev->offload) {
+        return 0;
+    }
+
+    for (i = 1; i <= netdev->num_queues && !error; i++) {
+        error = set_vnet_hdr(netdev->queue_fd[i], true);
+    }
+    if (!error) {
+        if (netdev->tap_fd != netdev->netdev_fd) {
+            unsigned int offloads = TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6;
+            if (ioctl(netdev->tap_fd, TUNSETOFFLOAD, offloads) < 0) {
+                error = errno;
+            }
+        } else {
+            error = set_vnet_hdr(netdev->netdev_fd, true);
+        }
+    }
+    if (error) {
+        for (i--; i >= 1; i--) {
+            set_vnet_hdr(netdev->queue_fd[i], false);
+        }
+        return error;
+    }
+
+    netdev->offload = true;
+    return 0;
+#else
+    return EOPNOTSUPP;
+#endif
+}
+
+/* Returns true if segmentation and checksum offloading is enabled on
+ * 'netdev'. */
+bool
+netdev_has_offload(const struct netdev *netdev)
+{
+    return netdev->offload;
+}
+
+#ifdef HAVE_VNET_HDR
+static void
+vnet_to_offload(const struct virtio_net_hdr *vnet,
+                struct netdev_offload *offload)
+{
+    /* VIRTIO_NET_HDR_F_DATA_VALID is not kept, since the packet may be
+     * modified, and the ECN bit of the GSO type only matters to hardware. */
+    offload->flags = (vnet->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM
+                      ? NETDEV_OFFLOAD_NEEDS_CSUM : 0);
+    offload->gso_type = vnet->gso_type & ~VIRTIO_NET_HDR_GSO_ECN;
+    offload->hdr_len = vnet->hdr_len;
+    offload->gso_size = vnet->gso_size;
+    offload->csum_start = vnet->csum_start;
+    offload->csum_offset = vnet->csum_offset;
+}
+
+static void
+offload_to_vnet(const struct netdev_offload *offload,
+                struct virtio_net_hdr *vnet)
+{
+    memset(vnet, 0, sizeof *vnet);
+    if (offload != NULL) {
+        vnet->flags = (offload->flags & NETDEV_OFFLOAD_NEEDS_CSUM
+                       ? VIRTIO_NET_HDR_F_NEEDS_CSUM : 0);
+        vnet->gso_type = offload->gso_type;
+        vnet->hdr_len = offload->hdr_len;
+        vnet->gso_size = offload->gso_size;
+        vnet->csum_start = offload->csum_start;
+        vnet->csum_offset = offload->csum_offset;
+    }
+}
+#endif
+
+/* Returns the offset of the IP header of the Ethernet frame in 'buffer',
+ * skipping VLAN tags and MPLS labels, or 0 if the frame does not carry IP. */
+static size_t
+find_l3_header(const struct ofpbuf *buffer)
+{
+    const uint8_t *data = buffer->data;
+    size_t ofs = ETH_ADDR_LEN * 2;
+    uint16_t type;
+
+    for (;;) {
+        if (ofs + sizeof type > buffer->size) {
+            return 0;
+        }
+        memcpy(&type, data + ofs, sizeof type);
+        type = ntohs(type);
+        if (type != ETH_TYPE_VLAN && type != ETH_TYPE_VLAN_QinQ
+            && type != ETH_TYPE_VLAN_PBB_B) {
+            ofs += sizeof type;
+            break;
+        }
+        ofs += VLAN_HEADER_LEN;
+    }
+
+    if (type == ETH_TYPE_MPLS || type == ETH_TYPE_MPLS_MCAST) {
+        uint32_t label;
+        do {
+            if (ofs + sizeof label > buffer->size) {
+                return 0;
+            }
+            memcpy(&label, data + ofs, sizeof label);
+            ofs += sizeof label;
+        } while (!(label & htonl(MPLS_S_MASK)));
+        type = (ofs < buffer->size && IP_VER(data[ofs]) == IPV6_VERSION
+                ? ETH_TYPE_IPV6 : ETH_TYPE_IP);
+    }
+
+    if (type == ETH_TYPE_IP) {
+        return ofs + IP_HEADER_LEN <= buffer->size ? ofs : 0;
+    } else if (type == ETH_TYPE_IPV6) {
+        return ofs + IPV6_HEADER_LEN <= buffer->size ? ofs : 0;
+    }
+    return 0;
+}
+
+/* Returns the partial checksum of the IPv4 or IPv6 pseudo-header for 'l4_len'
+ * bytes of protocol 'proto' following the IP header at 'l3'. */
+static uint32_t
+pseudo_header_csum(const uint8_t *l3, uint8_t proto, size_t l4_len)
+{
+    uint32_t partial = 0;
+
+    if (IP_VER(l3[0]) == IPV6_VERSION) {
+        const struct ipv6_header *ipv6 = (const struct ipv6_header *) l3;
+        partial = csum_continue(partial, &ipv6->ipv6_src,
+                                2 * sizeof ipv6->ipv6_src);
+    } else {
+        const struct ip_header *ip = (const struct ip_header *) l3;
+        partial = csum_add32(partial, ip->ip_src);
+        partial = csum_add32(partial, ip->ip_dst);
+    }
+    partial = csum_add16(partial, htons(proto));
+    return csum_add32(partial, htonl(l4_len));
+}
+
+static uint8_t
+gso_l4_proto(uint8_t gso_type)
+{
+    return (gso_type == NETDEV_GSO_TCPV4 || gso_type == NETDEV_GSO_TCPV6
+            ? IP_TYPE_TCP : IP_TYPE_UDP);
+}
+
+/* The kernel passes super-packets whose checksums it has verified without
+ * NETDEV_OFFLOAD_NEEDS_CSUM, but segmenting them requires the checksum field
+ * to hold the pseudo-header sum.  Sets up 'offload' and the packet in
+ * 'buffer' that way.  Returns false if 'buffer' does not hold a TCP or UDP
+ * packet of the type that 'offload' claims. */
+static bool
+offload_prepare_gso(struct ofpbuf *buffer, struct netdev_offload *offload)
+{
+    uint8_t *data = buffer->data;
+    uint8_t proto = gso_l4_proto(offload->gso_type);
+    size_t l3_ofs, l4_ofs;
+    uint16_t csum_value;
+
+    l3_ofs = find_l3_header(buffer);
+    if (!l3_ofs) {
+        return false;
+    }
+    if (IP_VER(data[l3_ofs]) == IPV6_VERSION) {
+        const struct ipv6_header *ipv6 = (struct ipv6_header *) &data[l3_ofs];
+        if (ipv6->ipv6_next_hd != proto) {
+            return false;
+        }
+        l4_ofs = l3_ofs + IPV6_HEADER_LEN;
+    } else {
+        const struct ip_header *ip = (struct ip_header *) &data[l3_ofs];
+        if (ip->ip_proto != proto) {
+            return false;
+        }
+        l4_ofs = l3_ofs + IP_IHL(ip->ip_ihl_ver) * 4;
+    }
+
+    offload->flags |= NETDEV_OFFLOAD_NEEDS_CSUM;
+    offload->csum_start = l4_ofs;
+    offload->csum_offset = (proto == IP_TYPE_TCP
+                            ? offsetof(struct tcp_header, tcp_csum)
+                            : offsetof(struct udp_header, udp_csum));
+    if (offload->csum_start + offload->csum_offset + sizeof csum_value
+        > buffer->size) {
+        return false;
+    }
+    csum_value = ~csum_finish(pseudo_header_csum(&data[l3_ofs], proto,
+                                                 buffer->size - l4_ofs));
+    memcpy(&data[offload->csum_start + offload->csum_offset], &csum_value,
+           sizeof csum_value);
+    return true;
+}
+
+/* Computes in software the L4 checksum that 'offload' leaves to the device,
+ * if any, and updates 'offload' to reflect that the packet in 'buffer' is now
+ * complete.  Super-packets are left alone, since each segment needs its own
+ * checksum. */
+void
+netdev_offload_complete_csum(struct ofpbuf *buffer,
+                             struct netdev_offload *offload)
+{
+    size_t field_ofs = offload->csum_start + offload->csum_offset;
+    uint16_t csum_value;
+
+    if (!(offload->flags & NETDEV_OFFLOAD_NEEDS_CSUM)
+        || offload->gso_type != NETDEV_GSO_NONE) {
+        return;
+    }
+    if (field_ofs + sizeof csum_value <= buffer->size) {
+        /* The checksum field already holds the pseudo-header sum. */
+        uint8_t *data = buffer->data;
+        csum_value = csum(&data[offload->csum_start],
+                          buffer->size - offload->csum_start);
+        if (!csum_value) {
+            csum_value = 0xffff;
+        }
+        memcpy(&data[field_ofs], &csum_value, sizeof csum_value);
+    }
+    offload->flags &= ~NETDEV_OFFLOAD_NEEDS_CSUM;
 }
 
 /* Attempts to receive a packet from 'netdev' into 'buffer', which the caller
@@ -969,74 +1198,103 @@ netdev_link_state(struct netdev *netdev)
  * required to receive any packet is ETH_HEADER_LEN bytes, plus VLAN_HEADER_LEN
  * bytes, plus the device's MTU (which may be retrieved via netdev_get_mtu()).
  * (Some devices do not allow for a VLAN header, in which case VLAN_HEADER_LEN
- * need not be included.)
+ * need not be included.)  'buffer' is expanded, if necessary, to make room for
+ * 'max_mtu' bytes.
  *
  * If a packet is successfully retrieved, returns 0.  In this case 'buffer' is
  * guaranteed to contain at least ETH_TOTAL_MIN bytes.  Otherwise, returns a
  * positive errno value.  Returns EAGAIN immediately if no packet is ready to
  * be returned.
+ *
+ * Must not be used on devices with offloading enabled, which may return
+ * super-packets; use netdev_recv_offload() instead.
  */
 int
 netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
+{
+    struct netdev_offload offload;
+
+    return netdev_recv_offload(netdev, buffer, max_mtu, &offload);
+}
+
+/* Same as netdev_recv(), but also stores the offload state of the received
+ * packet in '*offload'.  On devices without offloading enabled, the packet is
+ * always complete and '*offload' is zeroed. */
+int
+netdev_recv_offload(struct netdev *netdev, struct ofpbuf *buffer,
+                    size_t max_mtu, struct netdev_offload *offload)
 {
 #ifdef HAVE_PACKET_AUXDATA
     /* Code from libpcap to reconstruct VLAN header */
-    struct iovec    iov;
     struct cmsghdr    *cmsg;
-    struct msghdr     msg;
-    struct sockaddr   from;
     union {
       struct cmsghdr  cmsg;
       char    buf[CMSG_SPACE(sizeof(struct tpacket_auxdata))];
     } cmsg_buf;
-#else
-    struct sockaddr_ll sll;
-    socklen_t sll_len;
 #endif
+#ifdef HAVE_VNET_HDR
+    /* Tail of super-packets that do not fit 'buffer'.  Packets are received
+     * by a single thread, so one area serves all the devices. */
+    static uint8_t *gso_tail;
+    struct virtio_net_hdr vnet;
+#endif
+    struct sockaddr_ll sll;
+    struct iovec iov[3];
+    struct msghdr msg;
+    size_t vnet_len = 0;
+    size_t room;
     ssize_t n_bytes;
 
     assert(buffer->size == 0);
+    ofpbuf_prealloc_tailroom(buffer, max_mtu);
     assert(ofpbuf_tailroom(buffer) >= ETH_TOTAL_MIN);
+    memset(offload, 0, sizeof *offload);
 
-#ifdef HAVE_PACKET_AUXDATA
-    /* Code from libpcap to reconstruct VLAN header */
-    memset(&msg, 0, sizeof(struct msghdr));
-    memset(cmsg_buf.buf, 0, CMSG_SPACE(sizeof(struct tpacket_auxdata)));
-
-    msg.msg_name    = &from;
-    msg.msg_namelen   = sizeof(from);
-    msg.msg_iov   = &iov;
-    msg.msg_iovlen    = 1;
-    msg.msg_control   = &cmsg_buf;
-    msg.msg_controllen  = sizeof(cmsg_buf);
-    msg.msg_flags   = 0;
-
-    iov.iov_len   = max_mtu;
-    iov.iov_base    = buffer->data;
-
-#else
-    /* prepare to call recvfrom */
-    memset(&sll,0,sizeof sll);
-    sll_len = sizeof sll;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = iov;
+#ifdef HAVE_VNET_HDR
+    if (fd_has_vnet_hdr(netdev, netdev->tap_fd)) {
+        vnet_len = sizeof vnet;
+        iov[msg.msg_iovlen].iov_base = &vnet;
+        iov[msg.msg_iovlen].iov_len = vnet_len;
+        msg.msg_iovlen++;
+    }
+#endif
+    room = ofpbuf_tailroom(buffer);
+    iov[msg.msg_iovlen].iov_base = ofpbuf_tail(buffer);
+    iov[msg.msg_iovlen].iov_len = room;
+    msg.msg_iovlen++;
+#ifdef HAVE_VNET_HDR
+    /* 'buffer' is sized for the MTU; only super-packets spill over, and are
+     * then copied into a grown 'buffer'. */
+    if (vnet_len) {
+        if (gso_tail == NULL) {
+            gso_tail = xmalloc(VLAN_ETH_HEADER_LEN + NETDEV_GSO_MAX_LEN);
+        }
+        iov[msg.msg_iovlen].iov_base = gso_tail;
+        iov[msg.msg_iovlen].iov_len = VLAN_ETH_HEADER_LEN + NETDEV_GSO_MAX_LEN;
+        msg.msg_iovlen++;
+    }
 #endif
 
     /* cannot execute recvfrom over a tap device */
     if (!strncmp(netdev->name, "tap", 3)) {
         do {
-            n_bytes = read(netdev->tap_fd, ofpbuf_tail(buffer),
-                           (ssize_t)ofpbuf_tailroom(buffer));
+            n_bytes = readv(netdev->tap_fd, iov, msg.msg_iovlen);
         } while (n_bytes < 0 && errno == EINTR);
     }
     else {
-        do {
+        memset(&sll, 0, sizeof sll);
+        msg.msg_name = &sll;
+        msg.msg_namelen = sizeof sll;
 #ifdef HAVE_PACKET_AUXDATA
-            /* Code from libpcap to reconstruct VLAN header */
+        /* Code from libpcap to reconstruct VLAN header */
+        memset(cmsg_buf.buf, 0, CMSG_SPACE(sizeof(struct tpacket_auxdata)));
+        msg.msg_control = &cmsg_buf;
+        msg.msg_controllen = sizeof(cmsg_buf);
+#endif
+        do {
             n_bytes = recvmsg(netdev->tap_fd, &msg, 0);
-#else
-            n_bytes = recvfrom(netdev->tap_fd, ofpbuf_tail(buffer),
-                               (ssize_t)ofpbuf_tailroom(buffer), 0,
-                               (struct sockaddr *)&sll, &sll_len);
-#endif /* ifdef HAVE_PACKET_AUXDATA  */
         } while (n_bytes < 0 && errno == EINTR);
     }
     if (n_bytes < 0) {
@@ -1045,7 +1303,40 @@ netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
                          strerror(errno), netdev->name);
         }
         return errno;
+    } else if (n_bytes < vnet_len) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "short packet received on %s",
+                     netdev->name);
+        return EAGAIN;
     } else {
+        n_bytes -= vnet_len;
+#ifdef HAVE_VNET_HDR
+        if (vnet_len) {
+            vnet_to_offload(&vnet, offload);
+        }
+#endif
+
+#ifndef HAVE_PACKET_AUXDATA
+        /* we have multiple raw sockets at the same interface, so we also
+         * receive what others send, and need to filter them out.
+         * TODO(yiannisy): can we install this as a BPF at kernel?*/
+        if (msg.msg_name != NULL && sll.sll_pkttype == PACKET_OUTGOING) {
+            return EAGAIN;
+        }
+#endif
+        buffer->size += MIN(n_bytes, room);
+#ifdef HAVE_VNET_HDR
+        if (n_bytes > room) {
+            ofpbuf_put(buffer, gso_tail, n_bytes - room);
+        }
+#endif
+        if (offload->gso_type != NETDEV_GSO_NONE
+            && !(offload->flags & NETDEV_OFFLOAD_NEEDS_CSUM)
+            && !offload_prepare_gso(buffer, offload)) {
+            VLOG_WARN_RL(LOG_MODULE, &rl, "dropping malformed super-packet "
+                         "received on %s", netdev->name);
+            buffer->size = 0;
+            return EAGAIN;
+        }
 
 #ifdef HAVE_PACKET_AUXDATA
             /* Code from libpcap to reconstruct VLAN header */
@@ -1053,7 +1344,6 @@ netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
                 struct tpacket_auxdata *aux;
                 struct vlan_tag *tag;
                 uint16_t eth_type;
-                buffer->size += n_bytes;
 
                 if (cmsg->cmsg_len < CMSG_LEN(sizeof(struct tpacket_auxdata)) ||
                     cmsg->cmsg_level != SOL_PACKET ||
@@ -1079,16 +1369,17 @@ netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
                     tag->vlan_tp_id = htons(ETH_P_8021Q);
                 }
                 tag->vlan_tci = htons(aux->tp_vlan_tci);
+
+                /* The kernel reports offsets without the stripped tag. */
+                if (offload->flags & NETDEV_OFFLOAD_NEEDS_CSUM) {
+                    offload->csum_start += VLAN_HEADER_LEN;
+                }
+                if (offload->hdr_len) {
+                    offload->hdr_len += VLAN_HEADER_LEN;
+                }
             }
-#else
-        /* we have multiple raw sockets at the same interface, so we also
-         * receive what others send, and need to filter them out.
-         * TODO(yiannisy): can we install this as a BPF at kernel?*/
-        if (sll.sll_pkttype == PACKET_OUTGOING) {
-            return EAGAIN;
-        }
-        buffer->size += n_bytes;
 #endif
+
         /* When the kernel internally sends out an Ethernet frame on an
          * interface, it gives us a copy *before* padding the frame to the
          * minimum length.  Thus, when it sends out something like an ARP
@@ -1120,29 +1411,37 @@ netdev_drain(struct netdev *netdev)
     }
 }
 
-/* Sends 'buffer' on 'netdev'.  Returns 0 if successful, otherwise a positive
- * errno value.  Returns EAGAIN without blocking if the packet cannot be queued
- * immediately.  Returns EMSGSIZE if a partial packet was transmitted or if
- * the packet is too big or too small to transmit on the device.
- *
- * class_id denotes the queue to send the packet. If 0, it goes to the
- * default,best-effort queue.
- *
- * The caller retains ownership of 'buffer' in all cases.
- *
- * The kernel maintains a packet transmission queue, so the caller is not
- * expected to do additional queuing of packets.
- */
-int
-netdev_send(struct netdev *netdev, const struct ofpbuf *buffer,
-            uint16_t class_id)
+/* Writes the 'size' bytes at 'data' as one packet on 'fd' of 'netdev',
+ * preceded by a virtio-net header built from 'offload' if 'fd' expects one.
+ * Returns 0 if successful, otherwise a positive errno value as described for
+ * netdev_send(). */
+static int
+do_send(struct netdev *netdev, int fd, const void *data, size_t size,
+        const struct netdev_offload *offload)
 {
+#ifdef HAVE_VNET_HDR
+    struct virtio_net_hdr vnet;
+#endif
+    struct iovec iov[2];
+    size_t n_iov = 0;
+    size_t vnet_len = 0;
     ssize_t n_bytes;
 
-    assert(class_id <= NETDEV_MAX_QUEUES);
+#ifdef HAVE_VNET_HDR
+    if (fd_has_vnet_hdr(netdev, fd)) {
+        offload_to_vnet(offload, &vnet);
+        vnet_len = sizeof vnet;
+        iov[n_iov].iov_base = &vnet;
+        iov[n_iov].iov_len = vnet_len;
+        n_iov++;
+    }
+#endif
+    iov[n_iov].iov_base = CONST_CAST(void *, data);
+    iov[n_iov].iov_len = size;
+    n_iov++;
 
     do {
-        n_bytes = write(netdev->queue_fd[class_id], buffer->data, buffer->size);
+        n_bytes = writev(fd, iov, n_iov);
     } while (n_bytes < 0 && errno == EINTR);
     if (n_bytes < 0) {
         /* The Linux AF_PACKET implementation never blocks waiting for room
@@ -1155,16 +1454,210 @@ netdev_send(struct netdev *netdev, const struct ofpbuf *buffer,
                          netdev->name, strerror(errno));
         }
         return errno;
-    } else if (n_bytes != buffer->size) {
+    } else if (n_bytes != vnet_len + size) {
         VLOG_WARN_RL(LOG_MODULE, &rl,
                      "send partial Ethernet packet (%d bytes of %zu) on %s",
-                     (int) n_bytes, buffer->size, netdev->name);
+                     (int) n_bytes, vnet_len + size, netdev->name);
         return EMSGSIZE;
     } else {
         return 0;
     }
 }
 
+/* Fixes up the headers of 'segment', which holds the 'hdr_len' bytes of
+ * headers of a super-packet followed by the part of its payload that starts
+ * 'payload_ofs' bytes into it, so that it becomes a complete packet. */
+static void
+fix_segment(struct ofpbuf *segment, size_t l3_ofs, size_t l4_ofs,
+            size_t payload_ofs, bool last, uint8_t proto)
+{
+    uint8_t *data = segment->data;
+    size_t l4_len = segment->size - l4_ofs;
+    uint32_t partial;
+    uint16_t csum_value;
+
+    if (IP_VER(data[l3_ofs]) == IPV6_VERSION) {
+        struct ipv6_header *ipv6 = (struct ipv6_header *) &data[l3_ofs];
+        ipv6->ipv6_pay_len = htons(segment->size - l3_ofs - IPV6_HEADER_LEN);
+    } else {
+        struct ip_header *ip = (struct ip_header *) &data[l3_ofs];
+        ip->ip_tot_len = htons(segment->size - l3_ofs);
+        ip->ip_csum = 0;
+        ip->ip_csum = csum(ip, IP_IHL(ip->ip_ihl_ver) * 4);
+    }
+
+    if (proto == IP_TYPE_TCP) {
+        struct tcp_header *tcp = (struct tcp_header *) &data[l4_ofs];
+        tcp->tcp_seq = htonl(ntohl(tcp->tcp_seq) + payload_ofs);
+        if (payload_ofs) {
+            tcp->tcp_ctl &= ~htons(TCP_CWR);
+        }
+        if (!last) {
+            tcp->tcp_ctl &= ~htons(TCP_FIN | TCP_PSH);
+        }
+        tcp->tcp_csum = 0;
+    } else {
+        struct udp_header *udp = (struct udp_header *) &data[l4_ofs];
+        udp->udp_len = htons(l4_len);
+        udp->udp_csum = 0;
+    }
+
+    partial = pseudo_header_csum(&data[l3_ofs], proto, l4_len);
+    csum_value = csum_finish(csum_continue(partial, &data[l4_ofs], l4_len));
+    if (proto == IP_TYPE_UDP && !csum_value) {
+        csum_value = 0xffff;
+    }
+    if (proto == IP_TYPE_TCP) {
+        ((struct tcp_header *) &data[l4_ofs])->tcp_csum = csum_value;
+    } else {
+        ((struct udp_header *) &data[l4_ofs])->udp_csum = csum_value;
+    }
+}
+
+/* Segments the super-packet in 'buffer', described by 'offload', in
+ * software, and calls 'cb' with each complete segment in turn, stopping at
+ * the first nonzero value 'cb' returns.  The segment is only valid during the
+ * call.  Returns EINVAL if the super-packet cannot be segmented, otherwise
+ * the last value returned by 'cb'. */
+int
+netdev_offload_segment(const struct ofpbuf *buffer,
+                       const struct netdev_offload *offload,
+                       int (*cb)(const struct ofpbuf *segment, void *aux),
+                       void *aux)
+{
+    const uint8_t *data = buffer->data;
+    uint8_t proto = gso_l4_proto(offload->gso_type);
+    size_t l3_ofs, l4_ofs, hdr_len, ofs;
+    struct ofpbuf segment;
+    uint16_t ip_id = 0;
+    int error = 0;
+
+    l3_ofs = find_l3_header(buffer);
+    l4_ofs = offload->csum_start;
+    if (offload->gso_type == NETDEV_GSO_UDP
+        || !(offload->flags & NETDEV_OFFLOAD_NEEDS_CSUM)
+        || !offload->gso_size || !l3_ofs || l4_ofs <= l3_ofs
+        || l4_ofs + (proto == IP_TYPE_TCP ? TCP_HEADER_LEN : UDP_HEADER_LEN)
+           > buffer->size) {
+        return EINVAL;
+    }
+    if (proto == IP_TYPE_TCP) {
+        const struct tcp_header *tcp;
+        tcp = (const struct tcp_header *) &data[l4_ofs];
+        hdr_len = l4_ofs + TCP_OFFSET(tcp->tcp_ctl) * 4;
+    } else {
+        hdr_len = l4_ofs + UDP_HEADER_LEN;
+    }
+    if (hdr_len > buffer->size) {
+        return EINVAL;
+    }
+    if (IP_VER(data[l3_ofs]) != IPV6_VERSION) {
+        memcpy(&ip_id, &data[l3_ofs + offsetof(struct ip_header, ip_id)],
+               sizeof ip_id);
+        ip_id = ntohs(ip_id);
+    }
+
+    ofpbuf_init(&segment, hdr_len + offload->gso_size);
+    for (ofs = hdr_len; ofs < buffer->size && !error;
+         ofs += offload->gso_size) {
+        size_t len = MIN(offload->gso_size, buffer->size - ofs);
+
+        ofpbuf_clear(&segment);
+        ofpbuf_put(&segment, data, hdr_len);
+        ofpbuf_put(&segment, &data[ofs], len);
+        if (IP_VER(data[l3_ofs]) != IPV6_VERSION) {
+            struct ip_header *ip = ofpbuf_at_assert(&segment, l3_ofs,
+                                                    sizeof *ip);
+            ip->ip_id = htons(ip_id++);
+        }
+        fix_segment(&segment, l3_ofs, l4_ofs, ofs - hdr_len,
+                    ofs + len == buffer->size, proto);
+        error = cb(&segment, aux);
+    }
+    ofpbuf_uninit(&segment);
+    return error;
+}
+
+struct send_segment_aux {
+    struct netdev *netdev;
+    int fd;
+};
+
+static int
+send_segment(const struct ofpbuf *segment, void *aux_)
+{
+    struct send_segment_aux *aux = aux_;
+
+    return do_send(aux->netdev, aux->fd, segment->data, segment->size, NULL);
+}
+
+/* Sends the super-packet in 'buffer', described by 'offload', on 'fd' of
+ * 'netdev', which does not take super-packets, by segmenting it in
+ * software. */
+static int
+send_segments(struct netdev *netdev, int fd, const struct ofpbuf *buffer,
+              const struct netdev_offload *offload)
+{
+    struct send_segment_aux aux = { netdev, fd };
+    int error;
+
+    error = netdev_offload_segment(buffer, offload, send_segment, &aux);
+    if (error == EINVAL) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "cannot segment super-packet of GSO "
+                     "type %"PRIu8" for %s", offload->gso_type, netdev->name);
+    }
+    return error;
+}
+
+/* Sends 'buffer' on 'netdev'.  Returns 0 if successful, otherwise a positive
+ * errno value.  Returns EAGAIN without blocking if the packet cannot be queued
+ * immediately.  Returns EMSGSIZE if a partial packet was transmitted or if
+ * the packet is too big or too small to transmit on the device.
+ *
+ * class_id denotes the queue to send the packet. If 0, it goes to the
+ * default,best-effort queue.
+ *
+ * The caller retains ownership of 'buffer' in all cases.
+ *
+ * The kernel maintains a packet transmission queue, so the caller is not
+ * expected to do additional queuing of packets.
+ */
+int
+netdev_send(struct netdev *netdev, const struct ofpbuf *buffer,
+            uint16_t class_id)
+{
+    return netdev_send_offload(netdev, buffer, class_id, NULL);
+}
+
+/* Same as netdev_send(), for a packet with the offload state in 'offload' (if
+ * nonnull).  If 'netdev' does not have offloading enabled, the checksum is
+ * completed and super-packets are segmented in software. */
+int
+netdev_send_offload(struct netdev *netdev, const struct ofpbuf *buffer,
+                    uint16_t class_id, const struct netdev_offload *offload)
+{
+    int fd;
+
+    assert(class_id <= NETDEV_MAX_QUEUES);
+    fd = netdev->queue_fd[class_id];
+
+    if (offload != NULL && !fd_has_vnet_hdr(netdev, fd)) {
+        if (offload->gso_type != NETDEV_GSO_NONE) {
+            return send_segments(netdev, fd, buffer, offload);
+        } else if (offload->flags & NETDEV_OFFLOAD_NEEDS_CSUM) {
+            struct netdev_offload complete = *offload;
+            struct ofpbuf *copy = ofpbuf_clone(buffer);
+            int error;
+
+            netdev_offload_complete_csum(copy, &complete);
+            error = do_send(netdev, fd, copy->data, copy->size, NULL);
+            ofpbuf_delete(copy);
+            return error;
+        }
+    }
+    return do_send(netdev, fd, buffer->data, buffer->size, offload);
+}
+
 /* Registers with the poll loop to wake up from the next call to poll_block()
  * when the packet transmission queue has sufficient room to transmit a packet
  * with netdev_send().
@@ -68,13 +68,37 @@ enum netdev_pseudo_ethertype {
     NETDEV_ETH_TYPE_802_2        /* Receive all IEEE 802.2 frames. */
 };
 
-enum netdev_link_state {
-    NETDEV_LINK_UP = 1,
-    NETDEV_LINK_DOWN = 2,
-    NETDEV_LINK_NO_CHANGE = 3
+#define NETDEV_MAX_QUEUES 8
+
+/* Segmentation and checksum offload state of a packet, as exchanged with the
+ * kernel in a virtio-net header on devices that have offloading enabled with
+ * netdev_enable_offload().  Offsets are relative to the start of the Ethernet
+ * frame. */
+struct netdev_offload {
+    uint8_t flags;              /* NETDEV_OFFLOAD_* flags. */
+    uint8_t gso_type;           /* One of NETDEV_GSO_*. */
+    uint16_t hdr_len;           /* Length of the headers of each segment. */
+    uint16_t gso_size;          /* Maximum payload of each segment. */
+    uint16_t csum_start;        /* Start of the checksummed data. */
+    uint16_t csum_offset;       /* Checksum field, relative to csum_start. */
 };
 
-#define NETDEV_MAX_QUEUES 8
+/* The L4 checksum is left to the device: the checksum field holds the sum of
+ * the pseudo-header only, and the device adds the data from csum_start up to
+ * the end of the packet. */
+#define NETDEV_OFFLOAD_NEEDS_CSUM 0x01
+
+enum netdev_gso_type {
+    NETDEV_GSO_NONE = 0,        /* Not a super-packet. */
+    NETDEV_GSO_TCPV4 = 1,       /* TCP over IPv4, to be segmented. */
+    NETDEV_GSO_UDP = 3,         /* UDP, to be fragmented (not supported). */
+    NETDEV_GSO_TCPV6 = 4,       /* TCP over IPv6, to be segmented. */
+    NETDEV_GSO_UDP_L4 = 5       /* UDP, to be segmented. */
+};
+
+/* Largest super-packet received from a device with offloading enabled,
+ * excluding the Ethernet and VLAN headers. */
+#define NETDEV_GSO_MAX_LEN 65535
 
 
 
@@ -84,11 +108,22 @@ int netdev_open(const char *name, int ethertype, struct netdev **);
 int netdev_open_tap(const char *name, struct netdev **);
 void netdev_close(struct netdev *);
 
+int netdev_enable_offload(struct netdev *);
+bool netdev_has_offload(const struct netdev *);
+void netdev_offload_complete_csum(struct ofpbuf *, struct netdev_offload *);
+int netdev_offload_segment(const struct ofpbuf *,
+                           const struct netdev_offload *,
+                           int (*cb)(const struct ofpbuf *segment, void *aux),
+                           void *aux);
+
 int netdev_recv(struct netdev *, struct ofpbuf *, size_t);
+int netdev_recv_offload(struct netdev *, struct ofpbuf *, size_t,
+                        struct netdev_offload *);
 void netdev_recv_wait(struct netdev *);
-int netdev_link_state(struct netdev *netdev);
 int netdev_drain(struct netdev *);
 int netdev_send(struct netdev *, const struct ofpbuf *, uint16_t class_id);
+int netdev_send_offload(struct netdev *, const struct ofpbuf *,
+                        uint16_t class_id, const struct netdev_offload *);
 void netdev_send_wait(struct netdev *);
 int netdev_set_etheraddr(struct netdev *, const uint8_t mac[6]);
 const uint8_t *netdev_get_etheraddr(const struct netdev *);
@@ -54,6 +54,16 @@ ofpbuf_use(struct ofpbuf *b, void *base, size_t allocated)
     b->l2 = b->l3 = b->l4 = b->l7 = NULL;
     b->next = NULL;
     b->private_p = NULL;
+    b->n_refs = NULL;
+}
+
+/* Initializes 'b' as a read-only view of the 'size' bytes at 'data'.  'b'
+ * may be read and pulled from, but never expanded, modified or freed. */
+void
+ofpbuf_use_const(struct ofpbuf *b, const void *data, size_t size)
+{
+    ofpbuf_use(b, (void *) data, size);
+    b->size = size;
 }
 
 /* Initializes 'b' as an empty ofpbuf with an initial capacity of 'size'
@@ -64,12 +74,25 @@ ofpbuf_init(struct ofpbuf *b, size_t size)
     ofpbuf_use(b, size ? xmalloc(size) : NULL, size);
 }
 
+/* Drops 'b''s reference to its data, freeing the data if 'b' was the last
+ * ofpbuf referring to it. */
+static void
+ofpbuf_release__(struct ofpbuf *b)
+{
+    if (!b->n_refs) {
+        free(b->base);
+    } else if (!__atomic_sub_fetch(b->n_refs, 1, __ATOMIC_ACQ_REL)) {
+        free(b->n_refs);
+        free(b->base);
+    }
+}
+
 /* Frees memory that 'b' points to. */
 void
 ofpbuf_uninit(struct ofpbuf *b)
 {
     if (b) {
-        free(b->base);
+        ofpbuf_release__(b);
     }
 }
 
@@ -125,6 +148,32 @@ ofpbuf_clone_data(const void *data, size_t size)
     return b;
 }
 
+/* Creates and returns a new ofpbuf that refers to the same data as 'buffer',
+ * without copying it.  The data is freed along with the last ofpbuf referring
+ * to it; as the count of references is atomic, the ofpbufs may be deleted from
+ * different threads.
+ *
+ * Shared data is read-only.  Any ofpbuf that is grown, trimmed or cleared
+ * takes a private copy of its data first; pushing to its head is not
+ * allowed. */
+struct ofpbuf *
+ofpbuf_share(struct ofpbuf *buffer)
+{
+    struct ofpbuf *b = xmalloc(sizeof *b);
+
+    if (!buffer->n_refs) {
+        buffer->n_refs = xmalloc(sizeof *buffer->n_refs);
+        *buffer->n_refs = 1;
+        /* Hide the tailroom, so that appending to any sharer reallocates. */
+        buffer->allocated = ofpbuf_headroom(buffer) + buffer->size;
+    }
+    __atomic_add_fetch(buffer->n_refs, 1, __ATOMIC_RELAXED);
+    *b = *buffer;
+    b->next = NULL;
+    b->private_p = NULL;
+    return b;
+}
+
 /* Frees memory that 'b' points to, as well as 'b' itself. */
 void
 ofpbuf_delete(struct ofpbuf *b) 
@@ -181,8 +230,19 @@ ofpbuf_rebase__(struct ofpbuf *b, void *new_base)
 static void
 ofpbuf_resize_tailroom__(struct ofpbuf *b, size_t new_tailroom)
 {
-    b->allocated = ofpbuf_headroom(b) + b->size + new_tailroom;
-    ofpbuf_rebase__(b, xrealloc(b->base, b->allocated));
+    size_t headroom = ofpbuf_headroom(b);
+    void *new_base;
+
+    b->allocated = headroom + b->size + new_tailroom;
+    if (b->n_refs) {
+        new_base = xmalloc(b->allocated);
+        memcpy((char *) new_base + headroom, b->data, b->size);
+        ofpbuf_release__(b);
+        b->n_refs = NULL;
+    } else {
+        new_base = xrealloc(b->base, b->allocated);
+    }
+    ofpbuf_rebase__(b, new_base);
 }
 
 /* Ensures that 'b' has room for at least 'size' bytes at its tail end,
@@ -199,6 +259,7 @@ ofpbuf_prealloc_tailroom(struct ofpbuf *b, size_t size)
 void
 ofpbuf_prealloc_headroom(struct ofpbuf *b, size_t size) 
 {
+    assert(!b->n_refs);
     assert(size <= ofpbuf_headroom(b));
 }
 
@@ -321,6 +382,12 @@ ofpbuf_end(const struct ofpbuf *b)
 void
 ofpbuf_clear(struct ofpbuf *b) 
 {
+    if (b->n_refs) {
+        ofpbuf_release__(b);
+        b->base = NULL;
+        b->allocated = 0;
+        b->n_refs = NULL;
+    }
     b->data = b->base;
     b->size = 0;
 }
@@ -56,9 +56,13 @@ struct ofpbuf {
 
     struct ofpbuf *next;        /* Next in a list of ofpbufs. */
     void *private_p;            /* Private pointer for use by owner. */
+
+    unsigned int *n_refs;       /* Number of ofpbufs sharing 'base', see
+                                   ofpbuf_share(), or NULL if not shared. */
 };
 
 void ofpbuf_use(struct ofpbuf *, void *, size_t);
+void ofpbuf_use_const(struct ofpbuf *, const void *, size_t);
 
 void ofpbuf_init(struct ofpbuf *, size_t);
 void ofpbuf_uninit(struct ofpbuf *);
@@ -70,6 +74,7 @@ struct ofpbuf *ofpbuf_clone(const struct ofpbuf *);
 struct ofpbuf *ofpbuf_clone_with_headroom(const struct ofpbuf *,
                                           size_t headroom);
 struct ofpbuf *ofpbuf_clone_data(const void *, size_t);
+struct ofpbuf *ofpbuf_share(struct ofpbuf *);
 void ofpbuf_delete(struct ofpbuf *);
 
 void *ofpbuf_at(const struct ofpbuf *, size_t offset, size_t size);
@@ -329,6 +329,8 @@ BUILD_ASSERT_DECL(UDP_HEADER_LEN == sizeof(struct udp_header));
 #define TCP_PSH 0x08
 #define TCP_ACK 0x10
 #define TCP_URG 0x20
+#define TCP_ECE 0x40
+#define TCP_CWR 0x80
 
 #define TCP_FLAGS(tcp_ctl) (htons(tcp_ctl) & 0x003f)
 #define TCP_OFFSET(tcp_ctl) (htons(tcp_ctl) >> 12)
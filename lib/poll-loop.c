@@ -39,6 +39,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 #include "backtrace.h"
 #include "dynamic-string.h"
 #include "list.h"
@@ -50,7 +53,7 @@
 /* An event that will wake the following call to poll_block(). */
 struct poll_waiter {
     /* Set when the waiter is created. */
-    struct list node;           /* Element in global waiters list. */
+    struct list node;           /* Element in waiters list. */
     int fd;                     /* File descriptor. */
     short int events;           /* Events to wait for (POLLIN, POLLOUT). */
     poll_fd_func *function;     /* Callback function, if any, or null. */
@@ -58,30 +61,34 @@ struct poll_waiter {
     struct backtrace_info *bt_info; /* Optionally, event that created waiter. */
 
     /* Set only when poll_block() is called. */
-    struct pollfd *pollfd;      /* Pointer to element of the pollfds array
-                                   (null if added from a callback). */
+    short int revents;          /* Events that occurred on 'fd' (zero if added
+                                   from a callback). */
 };
 
-/* All active poll waiters. */
-static struct list waiters = LIST_INITIALIZER(&waiters);
+/* The state below is per thread, so that each thread runs a poll loop of its
+ * own. */
+
+/* All active poll waiters.  Initialized on first use. */
+static __thread struct list waiters;
 
 /* Number of elements in the waiters list. */
-static size_t n_waiters;
+static __thread size_t n_waiters;
 
 /* Max time to wait in next call to poll_block(), in milliseconds, or -1 to
  * wait forever. */
-static int timeout = -1;
+static __thread int timeout = -1;
 
 /* Backtrace of 'timeout''s registration, if debugging is enabled. */
-static struct backtrace_info timeout_backtrace;
+static __thread struct backtrace_info timeout_backtrace;
 
 /* Callback currently running, to allow verifying that poll_cancel() is not
  * being called on a running callback. */
 #ifndef NDEBUG
-static struct poll_waiter *running_cb;
+static __thread struct poll_waiter *running_cb;
 #endif
 
 static struct poll_waiter *new_waiter(int fd, short int events);
+static int wait_for_events(void);
 
 /* Registers 'fd' as waiting for the specified 'events' (which should be POLLIN
  * or POLLOUT or POLLIN | POLLOUT).  The following call to poll_block() will
@@ -154,30 +161,15 @@ log_wakeup(const struct backtrace_info *info, const char *format, ...)
 void
 poll_block(void)
 {
-    static struct pollfd *pollfds;
-    static size_t max_pollfds;
-
     struct poll_waiter *pw;
     struct list *node;
-    int n_pollfds;
     int retval;
 
     assert(!running_cb);
-    if (max_pollfds < n_waiters) {
-        max_pollfds = n_waiters;
-        pollfds = xrealloc(pollfds, max_pollfds * sizeof *pollfds);
-    }
-
-    n_pollfds = 0;
-    LIST_FOR_EACH (pw, struct poll_waiter, node, &waiters) {
-        pw->pollfd = &pollfds[n_pollfds];
-        pollfds[n_pollfds].fd = pw->fd;
-        pollfds[n_pollfds].events = pw->events;
-        pollfds[n_pollfds].revents = 0;
-        n_pollfds++;
+    if (!waiters.next) {
+        list_init(&waiters);
     }
-
-    retval = time_poll(pollfds, n_pollfds, timeout);
+    retval = wait_for_events();
     if (retval < 0) {
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
         VLOG_ERR_RL(LOG_MODULE, &rl, "poll: %s", strerror(-retval));
@@ -187,7 +179,7 @@ poll_block(void)
 
     for (node = waiters.next; node != &waiters; ) {
         pw = CONTAINER_OF(node, struct poll_waiter, node);
-        if (!pw->pollfd || !pw->pollfd->revents) {
+        if (!pw->revents) {
             if (pw->function) {
                 node = node->next;
                 continue;
@@ -195,11 +187,11 @@ poll_block(void)
         } else {
             if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
                 log_wakeup(pw->bt_info, "%s%s%s%s%s on fd %d",
-                           pw->pollfd->revents & POLLIN ? "[POLLIN]" : "",
-                           pw->pollfd->revents & POLLOUT ? "[POLLOUT]" : "",
-                           pw->pollfd->revents & POLLERR ? "[POLLERR]" : "",
-                           pw->pollfd->revents & POLLHUP ? "[POLLHUP]" : "",
-                           pw->pollfd->revents & POLLNVAL ? "[POLLNVAL]" : "",
+                           pw->revents & POLLIN ? "[POLLIN]" : "",
+                           pw->revents & POLLOUT ? "[POLLOUT]" : "",
+                           pw->revents & POLLERR ? "[POLLERR]" : "",
+                           pw->revents & POLLHUP ? "[POLLHUP]" : "",
+                           pw->revents & POLLNVAL ? "[POLLNVAL]" : "",
                            pw->fd);
             }
 
@@ -207,7 +199,7 @@ poll_block(void)
 #ifndef NDEBUG
                 running_cb = pw;
 #endif
-                pw->function(pw->fd, pw->pollfd->revents, pw->aux);
+                pw->function(pw->fd, pw->revents, pw->aux);
 #ifndef NDEBUG
                 running_cb = NULL;
 #endif
@@ -274,7 +266,230 @@ new_waiter(int fd, short int events)
         waiter->bt_info = xmalloc(sizeof *waiter->bt_info);
         backtrace_capture(waiter->bt_info);
     }
+    if (!waiters.next) {
+        list_init(&waiters);
+    }
     list_push_back(&waiters, &waiter->node);
     n_waiters++;
     return waiter;
 }
+
+#ifndef HAVE_EPOLL
+/* Waits with poll() for the events of all the waiters, storing the events
+ * that occurred into their 'revents' members.  Returns the number of file
+ * descriptors that are ready, or a negative errno value. */
+static int
+wait_for_events(void)
+{
+    static __thread struct pollfd *pollfds;
+    static __thread size_t max_pollfds;
+
+    struct poll_waiter *pw;
+    int n_pollfds;
+    int retval;
+
+    if (max_pollfds < n_waiters) {
+        max_pollfds = n_waiters;
+        pollfds = xrealloc(pollfds, max_pollfds * sizeof *pollfds);
+    }
+
+    n_pollfds = 0;
+    LIST_FOR_EACH (pw, struct poll_waiter, node, &waiters) {
+        pollfds[n_pollfds].fd = pw->fd;
+        pollfds[n_pollfds].events = pw->events;
+        pollfds[n_pollfds].revents = 0;
+        n_pollfds++;
+    }
+
+    retval = time_poll(pollfds, n_pollfds, timeout);
+
+    n_pollfds = 0;
+    LIST_FOR_EACH (pw, struct poll_waiter, node, &waiters) {
+        pw->revents = retval > 0 ? pollfds[n_pollfds].revents : 0;
+        n_pollfds++;
+    }
+    return retval;
+}
+
+/* Notifies the poll loop that 'fd' is about to be closed.  Nothing to do with
+ * poll(), which keeps no state across calls to poll_block(). */
+void
+poll_fd_forget(int fd UNUSED)
+{
+}
+#else /* HAVE_EPOLL */
+/* The epoll backend keeps file descriptors registered with the kernel across
+ * calls to poll_block(), so that a loop that waits on the same file
+ * descriptors over and over does not pay for re-registering them.  A file
+ * descriptor whose waiters went away stays registered until it becomes ready,
+ * at which point it is dropped.  Registrations are level-triggered, so the
+ * semantics are those of poll(). */
+
+BUILD_ASSERT_DECL(POLLIN == EPOLLIN);
+BUILD_ASSERT_DECL(POLLOUT == EPOLLOUT);
+BUILD_ASSERT_DECL(POLLERR == EPOLLERR);
+BUILD_ASSERT_DECL(POLLHUP == EPOLLHUP);
+
+/* Per file descriptor state, indexed by file descriptor. */
+struct poll_fd_state {
+    uint32_t registered;        /* Events registered with the kernel. */
+    uint32_t wanted;            /* Events waited for in this poll_block(). */
+    short int revents;          /* Events that occurred. */
+};
+
+static __thread int epoll_fd = -1;
+static __thread struct poll_fd_state *fd_states;
+static __thread size_t n_fd_states;
+
+/* File descriptors registered with the kernel by the previous poll_block(). */
+static __thread int *registered_fds;
+static __thread size_t n_registered_fds;
+
+/* Returns the state of 'fd', allocating it if necessary.  'fd' must be
+ * nonnegative. */
+static struct poll_fd_state *
+get_fd_state(int fd)
+{
+    assert(fd >= 0);
+    if (fd >= n_fd_states) {
+        size_t n = MAX(fd + 1, n_fd_states * 2);
+        fd_states = xrealloc(fd_states, n * sizeof *fd_states);
+        memset(&fd_states[n_fd_states], 0,
+               (n - n_fd_states) * sizeof *fd_states);
+        n_fd_states = n;
+    }
+    return &fd_states[fd];
+}
+
+/* Makes the events registered with the kernel for 'fd' match the events that
+ * are currently waited for. */
+static void
+update_registration(int fd, struct poll_fd_state *state)
+{
+    struct epoll_event event;
+    int op;
+
+    memset(&event, 0, sizeof event);
+    event.events = state->wanted;
+    event.data.fd = fd;
+
+    op = state->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(epoll_fd, op, fd, &event) < 0) {
+        /* Our view of the registration went stale, e.g. because 'fd' was
+         * closed without calling poll_fd_forget() and then reused. */
+        op = op == EPOLL_CTL_ADD ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if ((errno != EEXIST && errno != ENOENT)
+            || epoll_ctl(epoll_fd, op, fd, &event) < 0) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+            VLOG_ERR_RL(LOG_MODULE, &rl, "epoll_ctl on fd %d: %s",
+                        fd, strerror(errno));
+            /* Wake up the waiters, as poll() would with POLLNVAL. */
+            state->registered = 0;
+            state->revents = POLLNVAL;
+            poll_immediate_wake();
+            return;
+        }
+    }
+    state->registered = state->wanted;
+}
+
+/* Waits with epoll_wait() for the events of all the waiters, storing the
+ * events that occurred into their 'revents' members.  Returns the number of
+ * file descriptors that are ready, or a negative errno value. */
+static int
+wait_for_events(void)
+{
+    static __thread struct epoll_event *events;
+    static __thread int *fds;
+    static __thread size_t max_fds;
+
+    struct poll_waiter *pw;
+    size_t n_fds, i;
+    int retval;
+
+    if (epoll_fd < 0) {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            ofp_fatal(errno, "epoll_create1");
+        }
+    }
+    if (max_fds < n_waiters) {
+        max_fds = n_waiters;
+        fds = xrealloc(fds, max_fds * sizeof *fds);
+        events = xrealloc(events, max_fds * sizeof *events);
+        registered_fds = xrealloc(registered_fds,
+                                  max_fds * sizeof *registered_fds);
+    }
+
+    /* Collect the events waited for on each file descriptor.  As with poll(),
+     * negative file descriptors are ignored. */
+    n_fds = 0;
+    LIST_FOR_EACH (pw, struct poll_waiter, node, &waiters) {
+        struct poll_fd_state *state;
+
+        if (pw->fd < 0) {
+            continue;
+        }
+        state = get_fd_state(pw->fd);
+        if (!state->wanted) {
+            fds[n_fds++] = pw->fd;
+        }
+        state->wanted |= pw->events;
+    }
+
+    /* Deregister the file descriptors that nobody waits on anymore.  Once
+     * they are closed, the kernel drops their registration on its own, and
+     * keeping ours around would hide that from a later file descriptor with
+     * the same number. */
+    for (i = 0; i < n_registered_fds; i++) {
+        struct poll_fd_state *state = &fd_states[registered_fds[i]];
+        if (!state->wanted && state->registered) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, registered_fds[i], NULL);
+            state->registered = 0;
+        }
+    }
+    for (i = 0; i < n_fds; i++) {
+        struct poll_fd_state *state = &fd_states[fds[i]];
+        if (state->registered != state->wanted) {
+            update_registration(fds[i], state);
+        }
+    }
+
+    retval = time_epoll_wait(epoll_fd, events, MAX(max_fds, 1), timeout);
+    for (i = 0; retval > 0 && i < retval; i++) {
+        int fd = events[i].data.fd;
+        struct poll_fd_state *state = &fd_states[fd];
+
+        if (state->wanted) {
+            state->revents |= events[i].events;
+        }
+    }
+
+    LIST_FOR_EACH (pw, struct poll_waiter, node, &waiters) {
+        pw->revents = (pw->fd < 0 ? 0
+                       : (fd_states[pw->fd].revents
+                          & (pw->events | POLLERR | POLLHUP | POLLNVAL)));
+    }
+    n_registered_fds = 0;
+    for (i = 0; i < n_fds; i++) {
+        fd_states[fds[i]].wanted = 0;
+        fd_states[fds[i]].revents = 0;
+        if (fd_states[fds[i]].registered) {
+            registered_fds[n_registered_fds++] = fds[i];
+        }
+    }
+    return retval;
+}
+
+/* Notifies the poll loop that 'fd' is about to be closed, so that its
+ * registration is not mistaken for that of a later file descriptor with the
+ * same number. */
+void
+poll_fd_forget(int fd)
+{
+    if (fd >= 0 && fd < n_fd_states && fd_states[fd].registered) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        fd_states[fd].registered = 0;
+    }
+}
+#endif /* HAVE_EPOLL */
@@ -41,6 +41,14 @@
  * occurs.  Then the main loop calls poll_block(), which blocks until one of
  * the registered events happens.
  *
+ * When configured with epoll support, poll_block() is backed by epoll and
+ * keeps file descriptors registered across calls, which is much cheaper with
+ * many file descriptors.  Code that closes a file descriptor that it may have
+ * waited on must then call poll_fd_forget() first.
+ *
+ * Each thread has a poll loop of its own: the functions below only affect the
+ * poll loop of the calling thread.
+ *
  * There is also some support for autonomous subroutines that are executed by
  * poll_block() when a file descriptor becomes ready.  To prevent these
  * routines from starving if events are continuously ready, the application
@@ -69,4 +77,7 @@ struct poll_waiter *poll_fd_callback(int fd, short int events,
 /* Cancel a file descriptor callback or event. */
 void poll_cancel(struct poll_waiter *);
 
+/* Notify the poll loop that a file descriptor is about to be closed. */
+void poll_fd_forget(int fd);
+
 #endif /* poll-loop.h */
@@ -0,0 +1,109 @@
+/* Copyright (c) 2008 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#include <config.h>
+#include "spsc-ring.h"
+#include <assert.h>
+#include <stdlib.h>
+#include "util.h"
+
+/* Initializes 'ring' to hold up to 'n_slots' pointers, rounded up to a power
+ * of 2. */
+void
+spsc_ring_init(struct spsc_ring *ring, size_t n_slots)
+{
+    size_t n = 1;
+
+    while (n < n_slots) {
+        n *= 2;
+    }
+    ring->slots = xmalloc(n * sizeof *ring->slots);
+    ring->mask = n - 1;
+    ring->tail = 0;
+    ring->head = 0;
+}
+
+/* Frees the memory of 'ring'.  Pointers still queued are not freed. */
+void
+spsc_ring_destroy(struct spsc_ring *ring)
+{
+    free(ring->slots);
+}
+
+/* Appends 'p' to 'ring'.  Returns false, without appending anything, if
+ * 'ring' is full.  Producer side only. */
+bool
+spsc_ring_push(struct spsc_ring *ring, void *p)
+{
+    size_t tail = ring->tail;
+
+    if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) > ring->mask) {
+        return false;
+    }
+    ring->slots[tail & ring->mask] = p;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Returns true if spsc_ring_push() would fail.  Producer side only; the ring
+ * may only drain in the meantime. */
+bool
+spsc_ring_is_full(const struct spsc_ring *ring)
+{
+    return (ring->tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)
+            > ring->mask);
+}
+
+/* Removes and returns the oldest pointer in 'ring', or a null pointer if
+ * 'ring' is empty.  Consumer side only. */
+void *
+spsc_ring_pop(struct spsc_ring *ring)
+{
+    size_t head = ring->head;
+    void *p;
+
+    if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    p = ring->slots[head & ring->mask];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return p;
+}
+
+/* Returns true if spsc_ring_pop() would return a null pointer.  Consumer side
+ * only; the ring may only fill up in the meantime. */
+bool
+spsc_ring_is_empty(const struct spsc_ring *ring)
+{
+    return ring->head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2008 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H 1
+
+/* Bounded queue of pointers between two threads.
+ *
+ * One thread, the producer, may call spsc_ring_push() and spsc_ring_is_full()
+ * while another one, the consumer, calls spsc_ring_pop() and
+ * spsc_ring_is_empty(), without any locking.  Neither side ever blocks. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "compiler.h"
+
+struct spsc_ring {
+    void **slots;
+    size_t mask;                /* Number of slots minus one. */
+
+    /* Each index is written by one side only, and kept on its own cache line
+     * so that the two sides do not keep stealing each other's line. */
+    size_t tail CACHE_ALIGNED;  /* Next slot to fill, owned by producer. */
+    size_t head CACHE_ALIGNED;  /* Next slot to drain, owned by consumer. */
+};
+
+void spsc_ring_init(struct spsc_ring *, size_t n_slots);
+void spsc_ring_destroy(struct spsc_ring *);
+
+bool spsc_ring_push(struct spsc_ring *, void *);
+bool spsc_ring_is_full(const struct spsc_ring *);
+
+void *spsc_ring_pop(struct spsc_ring *);
+bool spsc_ring_is_empty(const struct spsc_ring *);
+
+#endif /* spsc-ring.h */
@@ -39,17 +39,25 @@
 #include <signal.h>
 #include <string.h>
 #include <sys/time.h>
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 #include "fatal-signal.h"
 #include "util.h"
 
 /* Initialized? */
 static bool inited;
 
-/* Has a timer tick occurred? */
-static volatile sig_atomic_t tick;
+/* Number of timer ticks so far.  The signal handler may run on any thread,
+ * so this is shared and only accessed atomically. */
+static unsigned int tick;
 
-/* The current time, as of the last refresh. */
-static struct timeval now;
+/* The current time, as of this thread's last refresh, and the value of 'tick'
+ * at that refresh.  Each thread keeps its own copy, so threads never read a
+ * 'struct timeval' that another thread is halfway through writing. */
+static __thread struct timeval now;
+static __thread unsigned int now_tick;
+static __thread bool now_valid;
 
 /* Time at which to die with SIGALRM (if not TIME_MIN). */
 static time_t deadline = TIME_MIN;
@@ -72,8 +80,7 @@ time_init(void)
     }
 
     inited = true;
-    gettimeofday(&now, NULL);
-    tick = false;
+    time_refresh();
 
     /* Set up signal handler. */
     memset(&sa, 0, sizeof sa);
@@ -99,8 +106,9 @@ time_init(void)
 void
 time_refresh(void)
 {
+    now_tick = __atomic_load_n(&tick, __ATOMIC_RELAXED);
     gettimeofday(&now, NULL);
-    tick = false;
+    now_valid = true;
 }
 
 /* Returns the current time, in seconds. */
@@ -119,6 +127,18 @@ time_msec(void)
     return (long long int) now.tv_sec * 1000 + now.tv_usec / 1000;
 }
 
+/* Returns the time elapsed since some fixed point in the past, in us.  Unlike
+ * the functions above, this reads the clock afresh, which makes it suitable
+ * for measuring short intervals. */
+long long int
+time_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long int) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /* Configures the program to die with SIGALRM 'secs' seconds from now, if
  * 'secs' is nonzero, or disables the feature if 'secs' is zero. */
 void
@@ -182,6 +202,50 @@ time_poll(struct pollfd *pollfds, int n_pollfds, int timeout)
     return retval;
 }
 
+#ifdef HAVE_EPOLL
+/* Like epoll_wait(), with the same differences as time_poll(). */
+int
+time_epoll_wait(int epfd, struct epoll_event *events, int max_events,
+                int timeout)
+{
+    long long int start;
+    sigset_t oldsigs;
+    bool blocked;
+    int retval;
+
+    time_refresh();
+    start = time_msec();
+    blocked = false;
+    for (;;) {
+        int time_left;
+        if (timeout > 0) {
+            long long int elapsed = time_msec() - start;
+            time_left = timeout >= elapsed ? timeout - elapsed : 0;
+        } else {
+            time_left = timeout;
+        }
+
+        retval = epoll_wait(epfd, events, max_events, time_left);
+        if (retval < 0) {
+            retval = -errno;
+        }
+        if (retval != -EINTR) {
+            break;
+        }
+
+        if (!blocked && deadline == TIME_MIN) {
+            block_sigalrm(&oldsigs);
+            blocked = true;
+        }
+        time_refresh();
+    }
+    if (blocked) {
+        unblock_sigalrm(&oldsigs);
+    }
+    return retval;
+}
+#endif
+
 /* Returns the sum of 'a' and 'b', with saturation on overflow or underflow. */
 static time_t
 time_add(time_t a, time_t b)
@@ -194,7 +258,7 @@ time_add(time_t a, time_t b)
 static void
 sigalrm_handler(int sig_nr)
 {
-    tick = true;
+    __atomic_add_fetch(&tick, 1, __ATOMIC_RELAXED);
     if (deadline != TIME_MIN && time(0) > deadline) {
         fatal_signal_handler(sig_nr);
     }
@@ -204,7 +268,7 @@ static void
 refresh_if_ticked(void)
 {
     assert(inited);
-    if (tick) {
+    if (!now_valid || now_tick != __atomic_load_n(&tick, __ATOMIC_RELAXED)) {
         time_refresh();
     }
 }
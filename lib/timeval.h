@@ -39,6 +39,7 @@
 #include "util.h"
 
 struct pollfd;
+struct epoll_event;
 
 /* POSIX allows floating-point time_t, but we don't support it. */
 BUILD_ASSERT_DECL(TYPE_IS_INTEGRAL(time_t));
@@ -60,7 +61,12 @@ void time_init(void);
 void time_refresh(void);
 time_t time_now(void);
 long long int time_msec(void);
+long long int time_usec(void);
 void time_alarm(unsigned int secs);
 int time_poll(struct pollfd *, int n_pollfds, int timeout);
+#ifdef HAVE_EPOLL
+int time_epoll_wait(int epfd, struct epoll_event *, int max_events,
+                    int timeout);
+#endif
 
 #endif /* timeval.h */
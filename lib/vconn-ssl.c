@@ -487,6 +487,7 @@ ssl_close(struct vconn *vconn)
     ssl_clear_txbuf(sslv);
     ofpbuf_delete(sslv->rxbuf);
     SSL_free(sslv->ssl);
+    poll_fd_forget(sslv->fd);
     close(sslv->fd);
     free(sslv);
 }
@@ -871,6 +872,7 @@ static void
 pssl_close(struct pvconn *pvconn)
 {
     struct pssl_pvconn *pssl = pssl_pvconn_cast(pvconn);
+    poll_fd_forget(pssl->fd);
     close(pssl->fd);
     free(pssl);
 }
@@ -38,12 +38,16 @@
 #include <poll.h>
 #include <stdlib.h>
 #include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include "leak-checker.h"
 #include "ofpbuf.h"
 #include "openflow/openflow.h"
 #include "poll-loop.h"
+#include "queue.h"
 #include "socket-util.h"
 #include "util.h"
 #include "vconn-provider.h"
@@ -54,12 +58,26 @@
 
 /* Active stream socket vconn. */
 
+/* Size of the receive buffer, enough for the longest OpenFlow message.  Every
+ * read() asks for as much as fits, and all the messages it brings in are
+ * handed out before reading again. */
+#define STREAM_RX_BYTES 65536
+
+/* Messages sent are queued and written out together, with one writev() per
+ * STREAM_IOV_MAX messages, when the poll loop next runs.  Sending backs off
+ * once STREAM_TX_BYTES are queued. */
+#define STREAM_TX_BYTES 65536
+#define STREAM_IOV_MAX 64
+
 struct stream_vconn
 {
     struct vconn vconn;
     int fd;
     struct ofpbuf *rxbuf;
-    struct ofpbuf *txbuf;
+    struct ofp_queue txq;       /* Messages not yet written, in order. */
+    size_t tx_bytes;            /* Number of bytes in 'txq'. */
+    int tx_error;               /* Error from writing 'txq', if any. */
+    bool no_cork;               /* Not a TCP socket, TCP_CORK unsupported. */
     struct poll_waiter *tx_waiter;
 };
 
@@ -67,7 +85,8 @@ static struct vconn_class stream_vconn_class;
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(10, 25);
 
-static void stream_clear_txbuf(struct stream_vconn *);
+static void stream_clear_txq(struct stream_vconn *);
+static int stream_flush(struct stream_vconn *);
 
 int
 new_stream_vconn(const char *name, int fd, int connect_status,
@@ -79,7 +98,10 @@ new_stream_vconn(const char *name, int fd, int connect_status,
     vconn_init(&s->vconn, &stream_vconn_class, connect_status, ip, name,
                reconnectable);
     s->fd = fd;
-    s->txbuf = NULL;
+    queue_init(&s->txq);
+    s->tx_bytes = 0;
+    s->tx_error = 0;
+    s->no_cork = false;
     s->tx_waiter = NULL;
     s->rxbuf = NULL;
     *vconnp = &s->vconn;
@@ -98,8 +120,13 @@ stream_close(struct vconn *vconn)
 {
     struct stream_vconn *s = stream_vconn_cast(vconn);
     poll_cancel(s->tx_waiter);
-    stream_clear_txbuf(s);
+    /* Give messages sent just before closing a chance to go out. */
+    if (!s->tx_error) {
+        stream_flush(s);
+    }
+    stream_clear_txq(s);
     ofpbuf_delete(s->rxbuf);
+    poll_fd_forget(s->fd);
     close(s->fd);
     free(s);
 }
@@ -111,119 +138,190 @@ stream_connect(struct vconn *vconn)
     return check_connection_completion(s->fd);
 }
 
+/* Returns the length of the complete message at the start of 'rx', 0 if the
+ * message is not complete yet, or -1 if its header is invalid. */
+static int
+stream_rx_msg_len(const struct ofpbuf *rx)
+{
+    const struct ofp_header *oh = rx->data;
+    size_t length;
+
+    if (rx->size < sizeof(struct ofp_header)) {
+        return 0;
+    }
+    length = ntohs(oh->length);
+    if (length < sizeof(struct ofp_header)) {
+        VLOG_ERR_RL(LOG_MODULE, &rl, "received too-short ofp_header (%zu bytes)",
+                    length);
+        return -1;
+    }
+    return rx->size >= length ? length : 0;
+}
+
 static int
 stream_recv(struct vconn *vconn, struct ofpbuf **bufferp)
 {
     struct stream_vconn *s = stream_vconn_cast(vconn);
     struct ofpbuf *rx;
-    size_t want_bytes;
     ssize_t retval;
+    int length;
 
     if (s->rxbuf == NULL) {
-        s->rxbuf = ofpbuf_new(1564);
+        s->rxbuf = ofpbuf_new(STREAM_RX_BYTES);
     }
     rx = s->rxbuf;
 
-again:
-    if (sizeof(struct ofp_header) > rx->size) {
-        want_bytes = sizeof(struct ofp_header) - rx->size;
-    } else {
-        struct ofp_header *oh = rx->data;
-        size_t length = ntohs(oh->length);
-        if (length < sizeof(struct ofp_header)) {
-            VLOG_ERR_RL(LOG_MODULE, &rl, "received too-short ofp_header (%zu bytes)",
-                        length);
-            return EPROTO;
-        }
-        want_bytes = length - rx->size;
-        if (!want_bytes) {
-            *bufferp = rx;
-            s->rxbuf = NULL;
-            return 0;
+    length = stream_rx_msg_len(rx);
+    if (!length) {
+        /* Move what is left of a message to the front, to make room. */
+        if (rx->data != rx->base) {
+            memmove(rx->base, rx->data, rx->size);
+            rx->data = rx->base;
         }
-    }
-    ofpbuf_prealloc_tailroom(rx, want_bytes);
-
-    retval = read(s->fd, ofpbuf_tail(rx), want_bytes);
-    if (retval > 0) {
-        rx->size += retval;
-        if (retval == want_bytes) {
-            if (rx->size > sizeof(struct ofp_header)) {
-                *bufferp = rx;
-                s->rxbuf = NULL;
-                return 0;
+        retval = read(s->fd, ofpbuf_tail(rx), ofpbuf_tailroom(rx));
+        if (retval > 0) {
+            rx->size += retval;
+            length = stream_rx_msg_len(rx);
+        } else if (retval == 0) {
+            if (rx->size) {
+                VLOG_ERR_RL(LOG_MODULE, &rl, "connection dropped mid-packet");
+                return EPROTO;
             } else {
-                goto again;
+                return EOF;
             }
-        }
-        return EAGAIN;
-    } else if (retval == 0) {
-        if (rx->size) {
-            VLOG_ERR_RL(LOG_MODULE, &rl, "connection dropped mid-packet");
-            return EPROTO;
         } else {
-            return EOF;
+            return errno;
         }
-    } else {
-        return errno;
     }
+    if (length < 0) {
+        return EPROTO;
+    } else if (!length) {
+        return EAGAIN;
+    }
+
+    *bufferp = ofpbuf_clone_data(rx->data, length);
+    ofpbuf_pull(rx, length);
+    return 0;
 }
 
 static void
-stream_clear_txbuf(struct stream_vconn *s)
+stream_clear_txq(struct stream_vconn *s)
 {
-    ofpbuf_delete(s->txbuf);
-    s->txbuf = NULL;
+    queue_clear(&s->txq);
+    s->tx_bytes = 0;
     s->tx_waiter = NULL;
 }
 
+#ifdef TCP_CORK
+static void
+stream_set_cork(struct stream_vconn *s, int on)
+{
+    if (!s->no_cork
+        && setsockopt(s->fd, IPPROTO_TCP, TCP_CORK, &on, sizeof on)) {
+        s->no_cork = true;
+    }
+}
+#else
+static void
+stream_set_cork(struct stream_vconn *s UNUSED, int on UNUSED)
+{
+}
+#endif
+
+/* Writes out as much of 'txq' as the socket takes.  Returns 0 if all of it was
+ * written, EAGAIN if some is left, otherwise a positive errno value.
+ *
+ * TCP_NODELAY is set on TCP connections, so each writev() goes out right
+ * away.  A queue that takes more than one writev() is corked meanwhile, so
+ * that it goes out in full segments. */
+static int
+stream_flush(struct stream_vconn *s)
+{
+    bool cork = s->txq.n > STREAM_IOV_MAX;
+    int error = 0;
+
+    if (cork) {
+        stream_set_cork(s, 1);
+    }
+    while (s->txq.n) {
+        struct iovec iov[STREAM_IOV_MAX];
+        struct ofpbuf *b;
+        size_t n_bytes = 0;
+        size_t n_left;
+        ssize_t retval;
+        int n_iov = 0;
+
+        for (b = s->txq.head; b != NULL && n_iov < STREAM_IOV_MAX;
+             b = b->next) {
+            iov[n_iov].iov_base = b->data;
+            iov[n_iov].iov_len = b->size;
+            n_bytes += b->size;
+            n_iov++;
+        }
+
+        retval = writev(s->fd, iov, n_iov);
+        if (retval < 0) {
+            error = errno == EINTR ? EAGAIN : errno;
+            break;
+        }
+        s->tx_bytes -= retval;
+        for (n_left = retval; n_left > 0; ) {
+            b = s->txq.head;
+            if (n_left < b->size) {
+                ofpbuf_pull(b, n_left);
+                break;
+            }
+            n_left -= b->size;
+            ofpbuf_delete(queue_pop_head(&s->txq));
+        }
+        if (retval < n_bytes) {
+            error = EAGAIN;
+            break;
+        }
+    }
+    if (cork) {
+        stream_set_cork(s, 0);
+    }
+    return error;
+}
+
 static void
 stream_do_tx(int fd UNUSED, short int revents UNUSED, void *vconn_)
 {
     struct vconn *vconn = vconn_;
     struct stream_vconn *s = stream_vconn_cast(vconn);
-    ssize_t n = write(s->fd, s->txbuf->data, s->txbuf->size);
-    if (n < 0) {
-        if (errno != EAGAIN) {
-            VLOG_ERR_RL(LOG_MODULE, &rl, "send: %s", strerror(errno));
-            stream_clear_txbuf(s);
-            return;
-        }
-    } else if (n > 0) {
-        ofpbuf_pull(s->txbuf, n);
-        if (!s->txbuf->size) {
-            stream_clear_txbuf(s);
-            return;
-        }
+    int error;
+
+    s->tx_waiter = NULL;
+    error = stream_flush(s);
+    if (error == EAGAIN) {
+        s->tx_waiter = poll_fd_callback(s->fd, POLLOUT, stream_do_tx, vconn);
+    } else if (error) {
+        VLOG_ERR_RL(LOG_MODULE, &rl, "send: %s", strerror(error));
+        s->tx_error = error;
+        stream_clear_txq(s);
     }
-    s->tx_waiter = poll_fd_callback(s->fd, POLLOUT, stream_do_tx, vconn);
 }
 
 static int
 stream_send(struct vconn *vconn, struct ofpbuf *buffer)
 {
     struct stream_vconn *s = stream_vconn_cast(vconn);
-    ssize_t retval;
 
-    if (s->txbuf) {
+    if (s->tx_error) {
+        return s->tx_error;
+    }
+    if (s->tx_bytes >= STREAM_TX_BYTES) {
         return EAGAIN;
     }
 
-    retval = write(s->fd, buffer->data, buffer->size);
-    if (retval == buffer->size) {
-        ofpbuf_delete(buffer);
-        return 0;
-    } else if (retval >= 0 || errno == EAGAIN) {
-        leak_checker_claim(buffer);
-        s->txbuf = buffer;
-        if (retval > 0) {
-            ofpbuf_pull(buffer, retval);
-        }
+    leak_checker_claim(buffer);
+    queue_push_tail(&s->txq, buffer);
+    s->tx_bytes += buffer->size;
+    if (!s->tx_waiter) {
         s->tx_waiter = poll_fd_callback(s->fd, POLLOUT, stream_do_tx, vconn);
-        return 0;
-    } else {
-        return errno;
     }
+    return 0;
 }
 
 static void
@@ -236,15 +334,20 @@ stream_wait(struct vconn *vconn, enum vconn_wait_type wait)
         break;
 
     case WAIT_SEND:
-        if (!s->txbuf) {
+        if (s->tx_bytes < STREAM_TX_BYTES) {
             poll_fd_wait(s->fd, POLLOUT);
         } else {
-            /* Nothing to do: need to drain txbuf first. */
+            /* Nothing to do: need to drain txq first. */
         }
         break;
 
     case WAIT_RECV:
-        poll_fd_wait(s->fd, POLLIN);
+        if (s->rxbuf && stream_rx_msg_len(s->rxbuf)) {
+            /* A message is already buffered. */
+            poll_immediate_wake();
+        } else {
+            poll_fd_wait(s->fd, POLLIN);
+        }
         break;
 
     default:
@@ -315,6 +418,7 @@ static void
 pstream_close(struct pvconn *pvconn)
 {
     struct pstream_pvconn *ps = pstream_pvconn_cast(pvconn);
+    poll_fd_forget(ps->fd);
     close(ps->fd);
     free(ps);
 }
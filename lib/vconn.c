@@ -608,6 +608,9 @@ again:
  * Returns a positive errno value on failure, in which case the caller
  * retains ownership of 'msg'.
  *
+ * 'msg' may hold several OpenFlow messages back to back, which are then sent
+ * together.  If it does not hold whole messages, it is dropped, as if sent.
+ *
  * vconn_send will not block.  If 'msg' cannot be immediately accepted for
  * transmission, it returns EAGAIN immediately. */
 int
@@ -620,20 +623,45 @@ vconn_send(struct vconn *vconn, struct ofpbuf *msg)
     return retval;
 }
 
+/* Returns true if 'buf' holds one or more complete OpenFlow messages. */
+static bool
+is_whole_msgs(const struct ofpbuf *buf)
+{
+    size_t ofs = 0;
+
+    while (ofs + sizeof(struct ofp_header) <= buf->size) {
+        const struct ofp_header *oh = (const struct ofp_header *)
+                                      ((const uint8_t *) buf->data + ofs);
+        if (ntohs(oh->length) < sizeof *oh) {
+            return false;
+        }
+        ofs += ntohs(oh->length);
+    }
+    return ofs > 0 && ofs == buf->size;
+}
+
 static int
 do_send(struct vconn *vconn, struct ofpbuf *buf)
 {
     int retval;
 
-    assert(buf->size >= sizeof(struct ofp_header));
-    assert(((struct ofp_header *) buf->data)->length == htons(buf->size));
+    /* A message longer than its 16-bit length cannot be framed: it is dropped
+     * rather than sent garbled, which would desynchronize the peer. */
+    if (!is_whole_msgs(buf)) {
+        VLOG_ERR_RL(LOG_MODULE, &rl, "%s: dropping %zu bytes that do not hold "
+                    "whole OpenFlow messages", vconn->name, buf->size);
+        ofpbuf_delete(buf);
+        return 0;
+    }
     if (!VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
         retval = (vconn->class->send)(vconn, buf);
     } else {
+        struct ofp_header *oh = buf->data;
         struct ofl_msg_header *msg;
         char *str;
 
-        if (!ofl_msg_unpack(buf->data, buf->size, &msg, NULL/*xid*/, &ofl_exp)) {
+        /* Only the first of several messages is logged. */
+        if (!ofl_msg_unpack(buf->data, ntohs(oh->length), &msg, NULL/*xid*/, &ofl_exp)) {
             str = ofl_msg_to_string(msg, &ofl_exp);
             ofl_msg_free(msg, &ofl_exp);
         } else {
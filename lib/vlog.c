@@ -36,6 +36,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
@@ -98,6 +99,10 @@ static long long int boot_time;
 static char *log_file_name;
 static FILE *log_file;
 
+/* Serializes log output and rate limiter updates, since the datapath logs
+ * from both its forwarding and control threads. */
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static void format_log_message(enum vlog_module, enum vlog_level,
                                enum vlog_facility, unsigned int msg_num,
                                const char *message, va_list, struct ds *)
@@ -273,13 +278,16 @@ vlog_set_log_file(const char *file_name)
 {
     char *old_log_file_name;
     enum vlog_module module;
+    FILE *new_log_file;
     int error;
 
     /* Close old log file. */
     if (log_file) {
         VLOG_INFO(LOG_MODULE, "closing log file");
+        pthread_mutex_lock(&log_mutex);
         fclose(log_file);
         log_file = NULL;
+        pthread_mutex_unlock(&log_mutex);
     }
 
     /* Update log file name and free old name.  The ordering is important
@@ -293,7 +301,10 @@ vlog_set_log_file(const char *file_name)
 
     /* Open new log file and update min_levels[] to reflect whether we actually
      * have a log_file. */
-    log_file = fopen(log_file_name, "a");
+    new_log_file = fopen(log_file_name, "a");
+    pthread_mutex_lock(&log_mutex);
+    log_file = new_log_file;
+    pthread_mutex_unlock(&log_mutex);
     for (module = 0; module < VLM_N_MODULES; module++) {
         update_min_level(module);
     }
@@ -577,6 +588,7 @@ vlog_valist(enum vlog_module module, enum vlog_level level,
 
         ds_init(&s);
         ds_reserve(&s, 1024);
+        pthread_mutex_lock(&log_mutex);
         msg_num++;
 
         if (log_to_console) {
@@ -599,13 +611,14 @@ vlog_valist(enum vlog_module module, enum vlog_level level,
             }
         }
 
-        if (log_to_file) {
+        if (log_to_file && log_file) {
             format_log_message(module, level, VLF_FILE, msg_num,
                                message, args, &s);
             ds_put_char(&s, '\n');
             fputs(ds_cstr(&s), log_file);
             fflush(log_file);
         }
+        pthread_mutex_unlock(&log_mutex);
 
         ds_destroy(&s);
         errno = save_errno;
@@ -626,12 +639,15 @@ void
 vlog_rate_limit(enum vlog_module module, enum vlog_level level,
                 struct vlog_rate_limit *rl, const char *message, ...)
 {
+    unsigned int n_dropped;
+    time_t first_dropped;
     va_list args;
 
     if (!vlog_is_enabled(module, level)) {
         return;
     }
 
+    pthread_mutex_lock(&log_mutex);
     if (rl->tokens < VLOG_MSG_TOKENS) {
         time_t now = time_now();
         if (rl->last_fill > now) {
@@ -649,20 +665,24 @@ vlog_rate_limit(enum vlog_module module, enum vlog_level level,
                 rl->first_dropped = now;
             }
             rl->n_dropped++;
+            pthread_mutex_unlock(&log_mutex);
             return;
         }
     }
     rl->tokens -= VLOG_MSG_TOKENS;
+    n_dropped = rl->n_dropped;
+    first_dropped = rl->first_dropped;
+    rl->n_dropped = 0;
+    pthread_mutex_unlock(&log_mutex);
 
     va_start(args, message);
     vlog_valist(module, level, message, args);
     va_end(args);
 
-    if (rl->n_dropped) {
+    if (n_dropped) {
         vlog(module, level,
              "Dropped %u messages in last %u seconds due to excessive rate",
-             rl->n_dropped, (unsigned int) (time_now() - rl->first_dropped));
-        rl->n_dropped = 0;
+             n_dropped, (unsigned int) (time_now() - first_dropped));
     }
 }
 
@@ -60,6 +60,29 @@ AC_DEFUN([OFP_CHECK_NETLINK],
                 [Define to 1 if Netlink protocol is available.])
    fi])
 
+dnl Checks for epoll support, unless --disable-epoll is passed in.
+AC_DEFUN([OFP_CHECK_EPOLL],
+  [AC_ARG_ENABLE(
+     [epoll],
+     [AC_HELP_STRING([--disable-epoll],
+                     [Use poll() instead of epoll in the poll loop])],
+     [case "${enableval}" in
+        (yes) epoll=true ;;
+        (no)  epoll=false ;;
+        (*) AC_MSG_ERROR([bad value ${enableval} for --enable-epoll]) ;;
+      esac],
+     [epoll=true])
+
+   HAVE_EPOLL=no
+   if test "$epoll" = true; then
+      AC_CHECK_HEADER([sys/epoll.h],
+                      [AC_CHECK_FUNC([epoll_create1], [HAVE_EPOLL=yes])])
+   fi
+   if test "$HAVE_EPOLL" = yes; then
+      AC_DEFINE([HAVE_EPOLL], [1],
+                [Define to 1 if the poll loop should use epoll.])
+   fi])
+
 dnl Checks for OpenSSL, if --enable-ssl is passed in.
 AC_DEFUN([OFP_CHECK_OPENSSL],
   [AC_ARG_ENABLE(
@@ -157,6 +180,7 @@ AC_DEFUN([OFP_CHECK_LIBOPENFLOW],
   [AC_REQUIRE([AC_USE_SYSTEM_EXTENSIONS])
    AC_REQUIRE([OFP_CHECK_NDEBUG])
    AC_REQUIRE([OFP_CHECK_NETLINK])
+   AC_REQUIRE([OFP_CHECK_EPOLL])
    AC_REQUIRE([OFP_CHECK_OPENSSL])
    AC_REQUIRE([OFP_CHECK_FAULT_LIBS])
    AC_REQUIRE([OFP_CHECK_SOCKET_LIBS])
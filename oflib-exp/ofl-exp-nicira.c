@@ -37,6 +37,7 @@
 #include "openflow/nicira-ext.h"
 #include "ofl-exp-nicira.h"
 #include "../oflib/ofl-print.h"
+#include "../oflib/ofl-arena.h"
 #include "../oflib/ofl-log.h"
 
 #define LOG_MODULE ofl_exp_nx
@@ -103,7 +104,7 @@ ofl_exp_nicira_msg_unpack(struct ofp_header const *oh, size_t *len, struct ofl_m
 
                 src = (struct nx_role_request *)exp;
 
-                dst = (struct ofl_exp_nicira_msg_role *)malloc(sizeof(struct ofl_exp_nicira_msg_role));
+                dst = (struct ofl_exp_nicira_msg_role *)ofl_malloc(sizeof(struct ofl_exp_nicira_msg_role));
                 dst->header.header.experimenter_id = ntohl(exp->vendor);
                 dst->header.type                   = ntohl(exp->subtype);
                 dst->role                          = ntohl(src->role);
@@ -120,7 +121,7 @@ ofl_exp_nicira_msg_unpack(struct ofp_header const *oh, size_t *len, struct ofl_m
         OFL_LOG_WARN(LOG_MODULE, "Trying to unpack non-Nicira Experimenter message.");
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -141,7 +142,7 @@ ofl_exp_nicira_msg_free(struct ofl_msg_experimenter *msg)
     } else {
         OFL_LOG_WARN(LOG_MODULE, "Trying to free non-Nicira Experimenter message.");
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
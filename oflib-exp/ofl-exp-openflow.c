@@ -29,6 +29,7 @@
  * Author: Zoltán Lajos Kis <zoltan.lajos.kis@ericsson.com>
  */
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -36,12 +37,30 @@
 #include "openflow/openflow.h"
 #include "openflow/openflow-ext.h"
 #include "ofl-exp-openflow.h"
+#include "../oflib/ofl-arena.h"
 #include "../oflib/ofl-log.h"
 #include "../oflib/ofl-print.h"
+#include "../oflib/ofl-utils.h"
+#include "ofpbuf.h"
 
 #define LOG_MODULE ofl_exp_of
 OFL_LOG_INIT(LOG_MODULE)
 
+static void
+ofl_bundle_ctrl_type_print(FILE *stream, uint16_t type)
+{
+    switch (type) {
+        case (OFPBCT_EXT_OPEN_REQUEST): {    fprintf(stream, "open_req"); return; }
+        case (OFPBCT_EXT_OPEN_REPLY): {      fprintf(stream, "open_repl"); return; }
+        case (OFPBCT_EXT_CLOSE_REQUEST): {   fprintf(stream, "close_req"); return; }
+        case (OFPBCT_EXT_CLOSE_REPLY): {     fprintf(stream, "close_repl"); return; }
+        case (OFPBCT_EXT_COMMIT_REQUEST): {  fprintf(stream, "commit_req"); return; }
+        case (OFPBCT_EXT_COMMIT_REPLY): {    fprintf(stream, "commit_repl"); return; }
+        case (OFPBCT_EXT_DISCARD_REQUEST): { fprintf(stream, "discard_req"); return; }
+        case (OFPBCT_EXT_DISCARD_REPLY): {   fprintf(stream, "discard_repl"); return; }
+        default: {                           fprintf(stream, "?(%u)", type); return; }
+    }
+}
 
 int
 ofl_exp_openflow_msg_pack(struct ofl_msg_experimenter const *msg, uint8_t **buf, size_t *buf_len)
@@ -79,6 +98,120 @@ ofl_exp_openflow_msg_pack(struct ofl_msg_experimenter const *msg, uint8_t **buf,
 
                 return 0;
             }
+            case (OFP_EXT_SET_PKTIN_LIMIT): {
+                struct ofl_exp_openflow_msg_pktin_limit *l = (struct ofl_exp_openflow_msg_pktin_limit *)exp;
+                struct openflow_ext_set_pktin_limit *ofp;
+
+                *buf_len  = sizeof(struct openflow_ext_set_pktin_limit);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_set_pktin_limit *)(*buf);
+                memset(ofp, 0, *buf_len);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                ofp->reason   = l->reason;
+                ofp->table_id = l->table_id;
+                ofp->rate     = htonl(l->rate);
+                ofp->burst    = htonl(l->burst);
+                ofp->sample   = htonl(l->sample);
+
+                return 0;
+            }
+            case (OFP_EXT_PKTIN_LIMIT_REQUEST):
+            case (OFP_EXT_BUFFER_STATS_REQUEST): {
+                struct ofp_extension_header *ofp;
+
+                *buf_len  = sizeof(struct ofp_extension_header);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct ofp_extension_header *)(*buf);
+                ofp->vendor  = htonl(exp->header.experimenter_id);
+                ofp->subtype = htonl(exp->type);
+
+                return 0;
+            }
+            case (OFP_EXT_PKTIN_LIMIT_REPLY): {
+                struct ofl_exp_openflow_msg_pktin_stats *r = (struct ofl_exp_openflow_msg_pktin_stats *)exp;
+                struct openflow_ext_pktin_limit_reply *ofp;
+                size_t i;
+
+                *buf_len  = sizeof(struct openflow_ext_pktin_limit_reply)
+                          + r->stats_num * sizeof(struct openflow_ext_pktin_stats);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_pktin_limit_reply *)(*buf);
+                memset(ofp, 0, *buf_len);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                for (i = 0; i < r->stats_num; i++) {
+                    ofp->stats[i].reason    = r->stats[i].reason;
+                    ofp->stats[i].table_id  = r->stats[i].table_id;
+                    ofp->stats[i].rate      = htonl(r->stats[i].rate);
+                    ofp->stats[i].burst     = htonl(r->stats[i].burst);
+                    ofp->stats[i].n_sent    = hton64(r->stats[i].n_sent);
+                    ofp->stats[i].n_dropped = hton64(r->stats[i].n_dropped);
+                    ofp->stats[i].sample    = htonl(r->stats[i].sample);
+                    ofp->stats[i].n_sampled = hton64(r->stats[i].n_sampled);
+                }
+
+                return 0;
+            }
+            case (OFP_EXT_BUFFER_STATS_REPLY): {
+                struct ofl_exp_openflow_msg_buffer_stats *b = (struct ofl_exp_openflow_msg_buffer_stats *)exp;
+                struct openflow_ext_buffer_stats_reply *ofp;
+
+                *buf_len  = sizeof(struct openflow_ext_buffer_stats_reply);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_buffer_stats_reply *)(*buf);
+                memset(ofp, 0, *buf_len);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                ofp->capacity  = hton64(b->capacity);
+                ofp->bytes     = hton64(b->bytes);
+                ofp->n_packets = htonl(b->n_packets);
+                ofp->n_saved   = hton64(b->n_saved);
+                ofp->n_hits    = hton64(b->n_hits);
+                ofp->n_misses  = hton64(b->n_misses);
+                ofp->n_expired = hton64(b->n_expired);
+                ofp->n_evicted = hton64(b->n_evicted);
+                ofp->n_failed  = hton64(b->n_failed);
+
+                return 0;
+            }
+            case (OFP_EXT_BUNDLE_CONTROL): {
+                struct ofl_exp_openflow_msg_bundle_ctrl *c = (struct ofl_exp_openflow_msg_bundle_ctrl *)exp;
+                struct openflow_ext_bundle_ctrl *ofp;
+
+                *buf_len  = sizeof(struct openflow_ext_bundle_ctrl);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_bundle_ctrl *)(*buf);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                ofp->bundle_id = htonl(c->bundle_id);
+                ofp->type      = htons(c->type);
+                ofp->flags     = htons(c->flags);
+
+                return 0;
+            }
+            case (OFP_EXT_BUNDLE_ADD): {
+                struct ofl_exp_openflow_msg_bundle_add *a = (struct ofl_exp_openflow_msg_bundle_add *)exp;
+                struct openflow_ext_bundle_add *ofp;
+
+                *buf_len  = sizeof(struct openflow_ext_bundle_add) + a->data_length;
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_bundle_add *)(*buf);
+                memset(ofp, 0, sizeof(struct openflow_ext_bundle_add));
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                ofp->bundle_id = htonl(a->bundle_id);
+                ofp->flags     = htons(a->flags);
+                memcpy(ofp->message, a->data, a->data_length);
+
+                return 0;
+            }
             default: {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to print unknown Openflow Experimenter message.");
                 return -1;
@@ -119,14 +252,14 @@ ofl_exp_openflow_msg_unpack(struct ofp_header const *oh, size_t *len, struct ofl
 
                 src = (struct openflow_queue_command_header *)exp;
 
-                dst = (struct ofl_exp_openflow_msg_queue *)malloc(sizeof(struct ofl_exp_openflow_msg_queue));
+                dst = (struct ofl_exp_openflow_msg_queue *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_queue));
                 dst->header.header.experimenter_id = ntohl(exp->vendor);
                 dst->header.type                   = ntohl(exp->subtype);
                 dst->port_id                       = ntohl(src->port);
 
                 error = ofl_structs_packet_queue_unpack((struct ofp_packet_queue *)(src->body), len, &(dst->queue));
                 if (error) {
-                    free(dst);
+                    ofl_free(dst);
                     return error;
                 }
 
@@ -145,11 +278,160 @@ ofl_exp_openflow_msg_unpack(struct ofp_header const *oh, size_t *len, struct ofl
 
                 src = (struct openflow_ext_set_dp_desc *)exp;
 
-                dst = (struct ofl_exp_openflow_msg_set_dp_desc *)malloc(sizeof(struct ofl_exp_openflow_msg_set_dp_desc));
+                dst = (struct ofl_exp_openflow_msg_set_dp_desc *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_set_dp_desc));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+
+                dst->dp_desc = strcpy((char *)ofl_malloc(strlen(src->dp_desc)+1), src->dp_desc);
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_SET_PKTIN_LIMIT): {
+                struct openflow_ext_set_pktin_limit *src;
+                struct ofl_exp_openflow_msg_pktin_limit *dst;
+
+                if (*len < sizeof(struct openflow_ext_set_pktin_limit)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_SET_PKTIN_LIMIT message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                *len -= sizeof(struct openflow_ext_set_pktin_limit);
+
+                src = (struct openflow_ext_set_pktin_limit *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_pktin_limit *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_pktin_limit));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->reason                        = src->reason;
+                dst->table_id                      = src->table_id;
+                dst->rate                          = ntohl(src->rate);
+                dst->burst                         = ntohl(src->burst);
+                dst->sample                        = ntohl(src->sample);
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_PKTIN_LIMIT_REQUEST):
+            case (OFP_EXT_BUFFER_STATS_REQUEST): {
+                struct ofl_exp_openflow_msg_header *dst;
+
+                *len -= sizeof(struct ofp_extension_header);
+
+                dst = (struct ofl_exp_openflow_msg_header *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_header));
+                dst->header.experimenter_id = ntohl(exp->vendor);
+                dst->type                   = ntohl(exp->subtype);
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_PKTIN_LIMIT_REPLY): {
+                struct openflow_ext_pktin_limit_reply *src;
+                struct ofl_exp_openflow_msg_pktin_stats *dst;
+                size_t i;
+
+                *len -= sizeof(struct openflow_ext_pktin_limit_reply);
+                if (*len % sizeof(struct openflow_ext_pktin_stats) != 0) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_PKTIN_LIMIT_REPLY message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+
+                src = (struct openflow_ext_pktin_limit_reply *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_pktin_stats *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_pktin_stats));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->stats_num = *len / sizeof(struct openflow_ext_pktin_stats);
+                dst->stats = (struct ofl_exp_openflow_pktin_stats *)ofl_malloc(dst->stats_num * sizeof(struct ofl_exp_openflow_pktin_stats));
+                for (i = 0; i < dst->stats_num; i++) {
+                    dst->stats[i].reason    = src->stats[i].reason;
+                    dst->stats[i].table_id  = src->stats[i].table_id;
+                    dst->stats[i].rate      = ntohl(src->stats[i].rate);
+                    dst->stats[i].burst     = ntohl(src->stats[i].burst);
+                    dst->stats[i].n_sent    = ntoh64(src->stats[i].n_sent);
+                    dst->stats[i].n_dropped = ntoh64(src->stats[i].n_dropped);
+                    dst->stats[i].sample    = ntohl(src->stats[i].sample);
+                    dst->stats[i].n_sampled = ntoh64(src->stats[i].n_sampled);
+                }
+                *len = 0;
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_BUFFER_STATS_REPLY): {
+                struct openflow_ext_buffer_stats_reply *src;
+                struct ofl_exp_openflow_msg_buffer_stats *dst;
+
+                if (*len < sizeof(struct openflow_ext_buffer_stats_reply)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_BUFFER_STATS_REPLY message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                *len -= sizeof(struct openflow_ext_buffer_stats_reply);
+
+                src = (struct openflow_ext_buffer_stats_reply *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_buffer_stats *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_buffer_stats));
                 dst->header.header.experimenter_id = ntohl(exp->vendor);
                 dst->header.type                   = ntohl(exp->subtype);
+                dst->capacity  = ntoh64(src->capacity);
+                dst->bytes     = ntoh64(src->bytes);
+                dst->n_packets = ntohl(src->n_packets);
+                dst->n_saved   = ntoh64(src->n_saved);
+                dst->n_hits    = ntoh64(src->n_hits);
+                dst->n_misses  = ntoh64(src->n_misses);
+                dst->n_expired = ntoh64(src->n_expired);
+                dst->n_evicted = ntoh64(src->n_evicted);
+                dst->n_failed  = ntoh64(src->n_failed);
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_BUNDLE_CONTROL): {
+                struct openflow_ext_bundle_ctrl *src;
+                struct ofl_exp_openflow_msg_bundle_ctrl *dst;
+
+                if (*len < sizeof(struct openflow_ext_bundle_ctrl)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_BUNDLE_CONTROL message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                *len -= sizeof(struct openflow_ext_bundle_ctrl);
+
+                src = (struct openflow_ext_bundle_ctrl *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_bundle_ctrl *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_bundle_ctrl));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->bundle_id                     = ntohl(src->bundle_id);
+                dst->type                          = ntohs(src->type);
+                dst->flags                         = ntohs(src->flags);
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_BUNDLE_ADD): {
+                struct openflow_ext_bundle_add *src;
+                struct ofl_exp_openflow_msg_bundle_add *dst;
+
+                if (*len < sizeof(struct openflow_ext_bundle_add) + sizeof(struct ofp_header)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_BUNDLE_ADD message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                *len -= sizeof(struct openflow_ext_bundle_add);
 
-                dst->dp_desc = strcpy((char *)malloc(strlen(src->dp_desc)+1), src->dp_desc);
+                src = (struct openflow_ext_bundle_add *)exp;
+
+                if (ntohs(src->message->length) != *len) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_BUNDLE_ADD message has invalid inner length (%u).", ntohs(src->message->length));
+                    return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_MSG_BAD_LEN);
+                }
+
+                dst = (struct ofl_exp_openflow_msg_bundle_add *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_bundle_add));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->bundle_id                     = ntohl(src->bundle_id);
+                dst->flags                         = ntohs(src->flags);
+                dst->data_length                   = *len;
+                dst->data                          = ofl_memdup(src->message, *len);
+                *len = 0;
 
                 (*msg) = (struct ofl_msg_experimenter *)dst;
                 return 0;
@@ -163,7 +445,7 @@ ofl_exp_openflow_msg_unpack(struct ofp_header const *oh, size_t *len, struct ofl
         OFL_LOG_WARN(LOG_MODULE, "Trying to unpack non-Openflow Experimenter message.");
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -181,7 +463,24 @@ ofl_exp_openflow_msg_free(struct ofl_msg_experimenter *msg)
             }
             case (OFP_EXT_SET_DESC): {
                 struct ofl_exp_openflow_msg_set_dp_desc *s = (struct ofl_exp_openflow_msg_set_dp_desc *)exp;
-                free(s->dp_desc);
+                ofl_free(s->dp_desc);
+                break;
+            }
+            case (OFP_EXT_SET_PKTIN_LIMIT):
+            case (OFP_EXT_PKTIN_LIMIT_REQUEST):
+            case (OFP_EXT_BUFFER_STATS_REQUEST):
+            case (OFP_EXT_BUFFER_STATS_REPLY):
+            case (OFP_EXT_BUNDLE_CONTROL): {
+                break;
+            }
+            case (OFP_EXT_BUNDLE_ADD): {
+                struct ofl_exp_openflow_msg_bundle_add *a = (struct ofl_exp_openflow_msg_bundle_add *)exp;
+                ofl_free(a->data);
+                break;
+            }
+            case (OFP_EXT_PKTIN_LIMIT_REPLY): {
+                struct ofl_exp_openflow_msg_pktin_stats *r = (struct ofl_exp_openflow_msg_pktin_stats *)exp;
+                ofl_free(r->stats);
                 break;
             }
             default: {
@@ -191,7 +490,7 @@ ofl_exp_openflow_msg_free(struct ofl_msg_experimenter *msg)
     } else {
         OFL_LOG_WARN(LOG_MODULE, "Trying to free non-Openflow Experimenter message.");
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -220,6 +519,69 @@ ofl_exp_openflow_msg_to_string(struct ofl_msg_experimenter const *msg)
                 fprintf(stream, "setdesc{desc=\"%s\"}", s->dp_desc);
                 break;
             }
+            case (OFP_EXT_SET_PKTIN_LIMIT): {
+                struct ofl_exp_openflow_msg_pktin_limit *l = (struct ofl_exp_openflow_msg_pktin_limit *)exp;
+                fprintf(stream, "pktinlimit{reason=\"");
+                if (l->reason == OFPR_EXT_ALL) {
+                    fprintf(stream, "all");
+                } else {
+                    ofl_packet_in_reason_print(stream, l->reason);
+                }
+                fprintf(stream, "\", table=\"");
+                ofl_table_print(stream, l->table_id);
+                fprintf(stream, "\", rate=\"%u\", burst=\"%u\", sample=\"%u\"}", l->rate, l->burst, l->sample);
+                break;
+            }
+            case (OFP_EXT_PKTIN_LIMIT_REQUEST): {
+                fprintf(stream, "pktinlimit_req");
+                break;
+            }
+            case (OFP_EXT_PKTIN_LIMIT_REPLY): {
+                struct ofl_exp_openflow_msg_pktin_stats *r = (struct ofl_exp_openflow_msg_pktin_stats *)exp;
+                size_t i;
+
+                fprintf(stream, "pktinlimit_repl{stats=[");
+                for (i = 0; i < r->stats_num; i++) {
+                    fprintf(stream, "{reason=\"");
+                    ofl_packet_in_reason_print(stream, r->stats[i].reason);
+                    fprintf(stream, "\", table=\"");
+                    ofl_table_print(stream, r->stats[i].table_id);
+                    fprintf(stream, "\", rate=\"%u\", burst=\"%u\", sample=\"%u\", sent=\"%"PRIu64"\", dropped=\"%"PRIu64"\", sampled=\"%"PRIu64"\"}",
+                            r->stats[i].rate, r->stats[i].burst, r->stats[i].sample,
+                            r->stats[i].n_sent, r->stats[i].n_dropped, r->stats[i].n_sampled);
+                    if (i < r->stats_num - 1) { fprintf(stream, ", "); };
+                }
+                fprintf(stream, "]}");
+                break;
+            }
+            case (OFP_EXT_BUFFER_STATS_REQUEST): {
+                fprintf(stream, "bufstats_req");
+                break;
+            }
+            case (OFP_EXT_BUFFER_STATS_REPLY): {
+                struct ofl_exp_openflow_msg_buffer_stats *b = (struct ofl_exp_openflow_msg_buffer_stats *)exp;
+                fprintf(stream, "bufstats_repl{capacity=\"%"PRIu64"\", bytes=\"%"PRIu64"\", pkts=\"%u\", "
+                                "saved=\"%"PRIu64"\", hits=\"%"PRIu64"\", misses=\"%"PRIu64"\", "
+                                "expired=\"%"PRIu64"\", evicted=\"%"PRIu64"\", failed=\"%"PRIu64"\"}",
+                        b->capacity, b->bytes, b->n_packets, b->n_saved, b->n_hits,
+                        b->n_misses, b->n_expired, b->n_evicted, b->n_failed);
+                break;
+            }
+            case (OFP_EXT_BUNDLE_CONTROL): {
+                struct ofl_exp_openflow_msg_bundle_ctrl *c = (struct ofl_exp_openflow_msg_bundle_ctrl *)exp;
+                fprintf(stream, "bundle_ctrl{id=\"%u\", type=\"", c->bundle_id);
+                ofl_bundle_ctrl_type_print(stream, c->type);
+                fprintf(stream, "\", flags=\"0x%x\"}", c->flags);
+                break;
+            }
+            case (OFP_EXT_BUNDLE_ADD): {
+                struct ofl_exp_openflow_msg_bundle_add *a = (struct ofl_exp_openflow_msg_bundle_add *)exp;
+                struct ofp_header *oh = (struct ofp_header *)a->data;
+                fprintf(stream, "bundle_add{id=\"%u\", flags=\"0x%x\", msg=\"", a->bundle_id, a->flags);
+                ofl_message_type_print(stream, oh->type);
+                fprintf(stream, "\", xid=\"0x%x\", len=\"%zu\"}", ntohl(oh->xid), a->data_length);
+                break;
+            }
             default: {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to print unknown Openflow Experimenter message.");
                 fprintf(stream, "ofexp{type=\"%u\"}", exp->type);
@@ -233,3 +595,615 @@ ofl_exp_openflow_msg_to_string(struct ofl_msg_experimenter const *msg)
     fclose(stream);
     return str;
 }
+
+/*experimenter multipart functions*/
+
+static void
+flow_update_event_print(FILE *stream, uint16_t event)
+{
+    switch (event) {
+        case (OFPFME_EXT_INITIAL): {  fprintf(stream, "initial"); return; }
+        case (OFPFME_EXT_ADDED): {    fprintf(stream, "added"); return; }
+        case (OFPFME_EXT_REMOVED): {  fprintf(stream, "removed"); return; }
+        case (OFPFME_EXT_MODIFIED): { fprintf(stream, "modified"); return; }
+        case (OFPFME_EXT_PAUSED): {   fprintf(stream, "paused"); return; }
+        case (OFPFME_EXT_RESUMED): {  fprintf(stream, "resumed"); return; }
+        default: {                    fprintf(stream, "?(%u)", event); return; }
+    }
+}
+
+/* Prints a flow monitor update of 'len' bytes, checked by the unpacking of
+ * the reply. */
+static void
+flow_update_print(FILE *stream, uint8_t const *data, size_t len, struct ofl_exp const *exp)
+{
+    struct openflow_ext_flow_update_full const *u = (struct openflow_ext_flow_update_full const *)data;
+    struct ofl_match_header *match;
+    size_t match_len, i;
+    uint16_t event = ntohs(u->event);
+
+    fprintf(stream, "{event=\"");
+    flow_update_event_print(stream, event);
+    fprintf(stream, "\"");
+    if (event == OFPFME_EXT_PAUSED || event == OFPFME_EXT_RESUMED) {
+        fprintf(stream, "}");
+        return;
+    }
+    if (len < sizeof(struct openflow_ext_flow_update_full)) {
+        fprintf(stream, ", (truncated)}");
+        return;
+    }
+
+    fprintf(stream, ", table=\"%u\"", u->table_id);
+    if (event == OFPFME_EXT_REMOVED) {
+        fprintf(stream, ", reason=\"");
+        ofl_flow_removed_reason_print(stream, u->reason);
+        fprintf(stream, "\"");
+    }
+    fprintf(stream, ", prio=\"%u\", idle_to=\"%u\", hard_to=\"%u\", cookie=\"0x%"PRIx64"\"",
+            ntohs(u->priority), ntohs(u->idle_timeout), ntohs(u->hard_timeout), ntoh64(u->cookie));
+
+    match_len = len - (sizeof(struct openflow_ext_flow_update_full) - sizeof(struct ofp_match));
+    if (ROUND_UP(ntohs(u->match.length), 8) > match_len
+        || ofl_structs_match_unpack(&u->match, data + sizeof(struct openflow_ext_flow_update_full) - 4,
+                                 &match_len, &match, false, exp) != 0) {
+        fprintf(stream, ", match=(bad)}");
+        return;
+    }
+    fprintf(stream, ", match=");
+    ofl_structs_match_print(stream, match, exp);
+    ofl_structs_free_match(match, exp);
+
+    /* What the match left are the instructions. */
+    if (match_len > 0) {
+        uint8_t const *inst = data + len - match_len;
+
+        fprintf(stream, ", insts=[");
+        for (i = 0; match_len > 0; i++) {
+            struct ofl_instruction_header *ofl_inst;
+            size_t ilen = match_len;
+
+            if (ofl_structs_instructions_unpack((struct ofp_instruction const *)inst, &ilen, &ofl_inst, exp) != 0) {
+                fprintf(stream, "(bad)");
+                break;
+            }
+            if (i > 0) { fprintf(stream, ", "); };
+            ofl_structs_instruction_print(stream, ofl_inst, exp);
+            ofl_structs_free_instruction(ofl_inst, exp);
+
+            ilen = ntohs(((struct ofp_instruction const *)inst)->len);
+            inst += ilen;
+            match_len -= ilen;
+        }
+        fprintf(stream, "]");
+    }
+    fprintf(stream, "}");
+}
+
+int
+ofl_exp_openflow_stats_req_pack(struct ofl_msg_multipart_request_experimenter const *ext, uint8_t **buf, size_t *buf_len, struct ofl_exp const *exp)
+{
+    struct ofl_exp_openflow_msg_multipart_request const *e = (struct ofl_exp_openflow_msg_multipart_request const *)ext;
+
+    switch (e->type) {
+        case (OFPMP_EXT_FLOW_DELTA): {
+            struct ofl_exp_openflow_msg_multipart_request_flow_delta const *msg = (struct ofl_exp_openflow_msg_multipart_request_flow_delta const *)e;
+            struct ofp_multipart_request *req;
+            struct openflow_ext_flow_delta_request *ofp;
+
+            *buf_len = sizeof(struct ofp_multipart_request) + sizeof(struct openflow_ext_flow_delta_request);
+            *buf     = (uint8_t *)malloc(*buf_len);
+            memset(*buf, 0, *buf_len);
+
+            req = (struct ofp_multipart_request *)(*buf);
+            ofp = (struct openflow_ext_flow_delta_request *)req->body;
+            ofp->header.experimenter = htonl(OPENFLOW_VENDOR_ID);
+            ofp->header.exp_type     = htonl(OFPMP_EXT_FLOW_DELTA);
+            ofp->table_id = msg->table_id;
+            return 0;
+        }
+        case (OFPMP_EXT_FLOW_MONITOR): {
+            struct ofl_exp_openflow_msg_multipart_request_flow_monitor const *msg = (struct ofl_exp_openflow_msg_multipart_request_flow_monitor const *)e;
+            struct openflow_ext_flow_monitor_request *ofp;
+            struct ofpbuf b;
+
+            ofpbuf_init(&b, sizeof(struct ofp_multipart_request) + sizeof(struct openflow_ext_flow_monitor_request)
+                            + ROUND_UP(msg->match->length, 8));
+            ofpbuf_put_zeros(&b, sizeof(struct ofp_multipart_request));
+            ofp = ofpbuf_put_zeros(&b, sizeof(struct openflow_ext_flow_monitor_request) - sizeof(struct ofp_match));
+            ofp->header.experimenter = htonl(OPENFLOW_VENDOR_ID);
+            ofp->header.exp_type     = htonl(OFPMP_EXT_FLOW_MONITOR);
+            ofp->monitor_id = htonl(msg->monitor_id);
+            ofp->out_port   = htonl(msg->out_port);
+            ofp->out_group  = htonl(msg->out_group);
+            ofp->flags      = htons(msg->flags);
+            ofp->table_id   = msg->table_id;
+            ofp->command    = msg->command;
+            ofl_structs_match_put(msg->match, &b, exp);
+
+            *buf     = b.data;
+            *buf_len = b.size;
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to pack unknown Openflow Experimenter multipart request.");
+            return -1;
+        }
+    }
+}
+
+int
+ofl_exp_openflow_stats_reply_pack(struct ofl_msg_multipart_reply_experimenter const *ext, uint8_t **buf, size_t *buf_len)
+{
+    struct ofl_exp_openflow_msg_multipart_reply const *e = (struct ofl_exp_openflow_msg_multipart_reply const *)ext;
+
+    switch (e->type) {
+        case (OFPMP_EXT_FLOW_DELTA): {
+            struct ofl_exp_openflow_msg_multipart_reply_flow_delta const *msg = (struct ofl_exp_openflow_msg_multipart_reply_flow_delta const *)e;
+            struct ofp_multipart_reply *resp;
+            struct ofp_experimenter_stats_header *ext_header;
+            struct openflow_ext_flow_delta *ofp;
+            size_t i;
+
+            *buf_len = sizeof(struct ofp_multipart_reply) + sizeof(struct ofp_experimenter_stats_header)
+                     + msg->deltas_num * sizeof(struct openflow_ext_flow_delta);
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            resp = (struct ofp_multipart_reply *)(*buf);
+            ext_header = (struct ofp_experimenter_stats_header *)resp->body;
+            ext_header->experimenter = htonl(OPENFLOW_VENDOR_ID);
+            ext_header->exp_type     = htonl(OFPMP_EXT_FLOW_DELTA);
+            ofp = (struct openflow_ext_flow_delta *)(ext_header + 1);
+            for (i = 0; i < msg->deltas_num; i++) {
+                ofp[i].entry_id     = hton64(msg->deltas[i].entry_id);
+                ofp[i].cookie       = hton64(msg->deltas[i].cookie);
+                ofp[i].packet_count = hton64(msg->deltas[i].packet_count);
+                ofp[i].byte_count   = hton64(msg->deltas[i].byte_count);
+                ofp[i].duration_sec = htonl(msg->deltas[i].duration_sec);
+                ofp[i].priority     = htons(msg->deltas[i].priority);
+                ofp[i].table_id     = msg->deltas[i].table_id;
+                ofp[i].flags        = msg->deltas[i].flags;
+            }
+            return 0;
+        }
+        case (OFPMP_EXT_FLOW_MONITOR): {
+            struct ofl_exp_openflow_msg_multipart_reply_flow_monitor const *msg = (struct ofl_exp_openflow_msg_multipart_reply_flow_monitor const *)e;
+            struct ofp_multipart_reply *resp;
+            struct ofp_experimenter_stats_header *ext_header;
+
+            *buf_len = sizeof(struct ofp_multipart_reply) + sizeof(struct ofp_experimenter_stats_header)
+                     + msg->data_length;
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            resp = (struct ofp_multipart_reply *)(*buf);
+            ext_header = (struct ofp_experimenter_stats_header *)resp->body;
+            ext_header->experimenter = htonl(OPENFLOW_VENDOR_ID);
+            ext_header->exp_type     = htonl(OFPMP_EXT_FLOW_MONITOR);
+            memcpy(ext_header + 1, msg->data, msg->data_length);
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to pack unknown Openflow Experimenter multipart reply.");
+            return -1;
+        }
+    }
+}
+
+ofl_err
+ofl_exp_openflow_stats_req_unpack(struct ofp_multipart_request const *os, uint8_t const *buf, size_t *len, struct ofl_msg_multipart_request_header **msg, struct ofl_exp const *exp)
+{
+    struct ofp_experimenter_stats_header *ext = (struct ofp_experimenter_stats_header *)os->body;
+
+    switch (ntohl(ext->exp_type)) {
+        case (OFPMP_EXT_FLOW_DELTA): {
+            struct openflow_ext_flow_delta_request *src;
+            struct ofl_exp_openflow_msg_multipart_request_flow_delta *dst;
+
+            if (*len < sizeof(struct openflow_ext_flow_delta_request)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received FLOW_DELTA stats request has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len -= sizeof(struct openflow_ext_flow_delta_request);
+
+            src = (struct openflow_ext_flow_delta_request *)ext;
+            if (src->table_id != OFPTT_ALL && src->table_id >= PIPELINE_TABLES) {
+                OFL_LOG_WARN(LOG_MODULE, "Received FLOW_DELTA stats request has invalid table id (%u).", src->table_id);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
+            }
+
+            dst = (struct ofl_exp_openflow_msg_multipart_request_flow_delta *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_multipart_request_flow_delta));
+            dst->header.header.experimenter_id = ntohl(ext->experimenter);
+            dst->header.type                   = ntohl(ext->exp_type);
+            dst->table_id = src->table_id;
+
+            *msg = (struct ofl_msg_multipart_request_header *)dst;
+            return 0;
+        }
+        case (OFPMP_EXT_FLOW_MONITOR): {
+            struct openflow_ext_flow_monitor_request *src;
+            struct ofl_exp_openflow_msg_multipart_request_flow_monitor *dst;
+            ofl_err error;
+            int match_pos;
+
+            src = (struct openflow_ext_flow_monitor_request *)ext;
+            if (*len < sizeof(struct openflow_ext_flow_monitor_request)
+                || *len - (sizeof(struct openflow_ext_flow_monitor_request) - sizeof(struct ofp_match)) < ROUND_UP(ntohs(src->match.length), 8)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received FLOW_MONITOR stats request has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len -= sizeof(struct openflow_ext_flow_monitor_request) - sizeof(struct ofp_match);
+
+            if (src->table_id != OFPTT_ALL && src->table_id >= PIPELINE_TABLES) {
+                OFL_LOG_WARN(LOG_MODULE, "Received FLOW_MONITOR stats request has invalid table id (%u).", src->table_id);
+                return ofl_error(OFPET_EXPERIMENTER, OFPMOFC_EXT_BAD_TABLE_ID);
+            }
+
+            dst = (struct ofl_exp_openflow_msg_multipart_request_flow_monitor *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_multipart_request_flow_monitor));
+            dst->header.header.experimenter_id = ntohl(ext->experimenter);
+            dst->header.type                   = ntohl(ext->exp_type);
+            dst->monitor_id = ntohl(src->monitor_id);
+            dst->out_port   = ntohl(src->out_port);
+            dst->out_group  = ntohl(src->out_group);
+            dst->flags      = ntohs(src->flags);
+            dst->table_id   = src->table_id;
+            dst->command    = src->command;
+
+            match_pos = sizeof(struct ofp_multipart_request) + sizeof(struct openflow_ext_flow_monitor_request) - 4;
+            error = ofl_structs_match_unpack(&(src->match), buf + match_pos, len, &(dst->match), true, exp);
+            if (error) {
+                ofl_free(dst);
+                return error;
+            }
+
+            *msg = (struct ofl_msg_multipart_request_header *)dst;
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown Openflow Experimenter multipart request.");
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXP_TYPE);
+        }
+    }
+}
+
+ofl_err
+ofl_exp_openflow_stats_reply_unpack(struct ofp_multipart_reply const *os, size_t *len, struct ofl_msg_multipart_reply_header **msg)
+{
+    struct ofp_experimenter_stats_header *ext = (struct ofp_experimenter_stats_header *)os->body;
+
+    switch (ntohl(ext->exp_type)) {
+        case (OFPMP_EXT_FLOW_DELTA): {
+            struct openflow_ext_flow_delta *src;
+            struct ofl_exp_openflow_msg_multipart_reply_flow_delta *dst;
+            size_t i;
+
+            *len -= sizeof(struct ofp_experimenter_stats_header);
+            if (*len % sizeof(struct openflow_ext_flow_delta) != 0) {
+                OFL_LOG_WARN(LOG_MODULE, "Received FLOW_DELTA stats reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+
+            src = (struct openflow_ext_flow_delta *)(ext + 1);
+
+            dst = (struct ofl_exp_openflow_msg_multipart_reply_flow_delta *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_multipart_reply_flow_delta));
+            dst->header.header.experimenter_id = ntohl(ext->experimenter);
+            dst->header.type                   = ntohl(ext->exp_type);
+            dst->deltas_num = *len / sizeof(struct openflow_ext_flow_delta);
+            dst->deltas = (struct ofl_exp_openflow_flow_delta *)ofl_malloc(dst->deltas_num * sizeof(struct ofl_exp_openflow_flow_delta));
+            for (i = 0; i < dst->deltas_num; i++) {
+                dst->deltas[i].entry_id     = ntoh64(src[i].entry_id);
+                dst->deltas[i].cookie       = ntoh64(src[i].cookie);
+                dst->deltas[i].packet_count = ntoh64(src[i].packet_count);
+                dst->deltas[i].byte_count   = ntoh64(src[i].byte_count);
+                dst->deltas[i].duration_sec = ntohl(src[i].duration_sec);
+                dst->deltas[i].priority     = ntohs(src[i].priority);
+                dst->deltas[i].table_id     = src[i].table_id;
+                dst->deltas[i].flags        = src[i].flags;
+            }
+            *len = 0;
+
+            *msg = (struct ofl_msg_multipart_reply_header *)dst;
+            return 0;
+        }
+        case (OFPMP_EXT_FLOW_MONITOR): {
+            struct ofl_exp_openflow_msg_multipart_reply_flow_monitor *dst;
+            uint8_t const *data;
+            size_t left;
+
+            *len -= sizeof(struct ofp_experimenter_stats_header);
+            data = (uint8_t const *)(ext + 1);
+
+            /* The updates are kept in wire format, only their framing is
+             * checked here. */
+            left = *len;
+            while (left > 0) {
+                struct openflow_ext_flow_update_paused const *u = (struct openflow_ext_flow_update_paused const *)data;
+                size_t ulen;
+
+                if (left < sizeof(struct openflow_ext_flow_update_paused)
+                    || (ulen = ntohs(u->length)) < sizeof(struct openflow_ext_flow_update_paused)
+                    || ulen > left || ulen % 8 != 0) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received FLOW_MONITOR stats reply has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                data += ulen;
+                left -= ulen;
+            }
+
+            dst = (struct ofl_exp_openflow_msg_multipart_reply_flow_monitor *)ofl_malloc(sizeof(struct ofl_exp_openflow_msg_multipart_reply_flow_monitor));
+            dst->header.header.experimenter_id = ntohl(ext->experimenter);
+            dst->header.type                   = ntohl(ext->exp_type);
+            dst->data_length = *len;
+            dst->data = (uint8_t *)ofl_malloc(*len);
+            memcpy(dst->data, ext + 1, *len);
+            *len = 0;
+
+            *msg = (struct ofl_msg_multipart_reply_header *)dst;
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown Openflow Experimenter multipart reply.");
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXP_TYPE);
+        }
+    }
+}
+
+int
+ofl_exp_openflow_stats_req_free(struct ofl_msg_multipart_request_header *msg)
+{
+    struct ofl_exp_openflow_msg_multipart_request *e = (struct ofl_exp_openflow_msg_multipart_request *)msg;
+
+    if (e->type == OFPMP_EXT_FLOW_MONITOR) {
+        struct ofl_exp_openflow_msg_multipart_request_flow_monitor *r = (struct ofl_exp_openflow_msg_multipart_request_flow_monitor *)e;
+        if (r->match != NULL) {
+            ofl_structs_free_match(r->match, NULL);
+        }
+    }
+    ofl_free(msg);
+    return 0;
+}
+
+int
+ofl_exp_openflow_stats_reply_free(struct ofl_msg_multipart_reply_header *msg)
+{
+    struct ofl_exp_openflow_msg_multipart_reply *e = (struct ofl_exp_openflow_msg_multipart_reply *)msg;
+
+    switch (e->type) {
+        case (OFPMP_EXT_FLOW_DELTA): {
+            struct ofl_exp_openflow_msg_multipart_reply_flow_delta *r = (struct ofl_exp_openflow_msg_multipart_reply_flow_delta *)e;
+            ofl_free(r->deltas);
+            break;
+        }
+        case (OFPMP_EXT_FLOW_MONITOR): {
+            struct ofl_exp_openflow_msg_multipart_reply_flow_monitor *r = (struct ofl_exp_openflow_msg_multipart_reply_flow_monitor *)e;
+            ofl_free(r->data);
+            break;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to free unknown Openflow Experimenter multipart reply.");
+        }
+    }
+    ofl_free(msg);
+    return 0;
+}
+
+char *
+ofl_exp_openflow_stats_req_to_string(struct ofl_msg_multipart_request_experimenter const *ext, struct ofl_exp const *exp)
+{
+    struct ofl_exp_openflow_msg_multipart_request const *e = (struct ofl_exp_openflow_msg_multipart_request const *)ext;
+    char *str;
+    size_t str_size;
+    FILE *stream = open_memstream(&str, &str_size);
+
+    switch (e->type) {
+        case (OFPMP_EXT_FLOW_DELTA): {
+            struct ofl_exp_openflow_msg_multipart_request_flow_delta const *msg = (struct ofl_exp_openflow_msg_multipart_request_flow_delta const *)e;
+            fprintf(stream, "{exp_type=\"flow_delta\", table=\"");
+            ofl_table_print(stream, msg->table_id);
+            fprintf(stream, "\"");
+            break;
+        }
+        case (OFPMP_EXT_FLOW_MONITOR): {
+            struct ofl_exp_openflow_msg_multipart_request_flow_monitor const *msg = (struct ofl_exp_openflow_msg_multipart_request_flow_monitor const *)e;
+            fprintf(stream, "{exp_type=\"flow_monitor\", id=\"%u\", cmd=\"", msg->monitor_id);
+            switch (msg->command) {
+                case (OFPFMC_EXT_ADD): {    fprintf(stream, "add"); break; }
+                case (OFPFMC_EXT_MODIFY): { fprintf(stream, "mod"); break; }
+                case (OFPFMC_EXT_DELETE): { fprintf(stream, "del"); break; }
+                default: {                  fprintf(stream, "?(%u)", msg->command); }
+            }
+            fprintf(stream, "\", flags=\"0x%"PRIx16"\", table=\"", msg->flags);
+            ofl_table_print(stream, msg->table_id);
+            fprintf(stream, "\", oport=\"");
+            ofl_port_print(stream, msg->out_port);
+            fprintf(stream, "\", ogrp=\"");
+            ofl_group_print(stream, msg->out_group);
+            fprintf(stream, "\", match=");
+            ofl_structs_match_print(stream, msg->match, exp);
+            break;
+        }
+        default: {
+            fprintf(stream, "{exp_type=\"%u\"", e->type);
+        }
+    }
+
+    fclose(stream);
+    return str;
+}
+
+char *
+ofl_exp_openflow_stats_reply_to_string(struct ofl_msg_multipart_reply_experimenter const *ext, struct ofl_exp const *exp)
+{
+    struct ofl_exp_openflow_msg_multipart_reply const *e = (struct ofl_exp_openflow_msg_multipart_reply const *)ext;
+    char *str;
+    size_t str_size;
+    FILE *stream = open_memstream(&str, &str_size);
+
+    switch (e->type) {
+        case (OFPMP_EXT_FLOW_DELTA): {
+            struct ofl_exp_openflow_msg_multipart_reply_flow_delta const *msg = (struct ofl_exp_openflow_msg_multipart_reply_flow_delta const *)e;
+            size_t i;
+
+            fprintf(stream, "{exp_type=\"flow_delta\", flags=\"0x%"PRIx32"\", deltas=[", ext->header.flags);
+            for (i = 0; i < msg->deltas_num; i++) {
+                struct ofl_exp_openflow_flow_delta const *d = &msg->deltas[i];
+
+                fprintf(stream, "{id=\"%"PRIu64"\", table=\"%u\", prio=\"%u\", cookie=\"0x%"PRIx64"\", "
+                                "dur_s=\"%u\", pkt_cnt=\"%"PRIu64"\", byte_cnt=\"%"PRIu64"\"",
+                        d->entry_id, d->table_id, d->priority, d->cookie,
+                        d->duration_sec, d->packet_count, d->byte_count);
+                if (d->flags & OFPFDF_EXT_NEW) {
+                    fprintf(stream, ", new");
+                }
+                if (d->flags & OFPFDF_EXT_REMOVED) {
+                    fprintf(stream, ", removed");
+                }
+                fprintf(stream, "}");
+                if (i < msg->deltas_num - 1) { fprintf(stream, ", "); };
+            }
+            fprintf(stream, "]");
+            break;
+        }
+        case (OFPMP_EXT_FLOW_MONITOR): {
+            struct ofl_exp_openflow_msg_multipart_reply_flow_monitor const *msg = (struct ofl_exp_openflow_msg_multipart_reply_flow_monitor const *)e;
+            size_t off;
+
+            fprintf(stream, "{exp_type=\"flow_monitor\", flags=\"0x%"PRIx32"\", updates=[", ext->header.flags);
+            for (off = 0; off < msg->data_length; ) {
+                struct openflow_ext_flow_update_paused const *u = (struct openflow_ext_flow_update_paused const *)(msg->data + off);
+
+                if (off > 0) { fprintf(stream, ", "); };
+                flow_update_print(stream, msg->data + off, ntohs(u->length), exp);
+                off += ntohs(u->length);
+            }
+            fprintf(stream, "]");
+            break;
+        }
+        default: {
+            fprintf(stream, "{exp_type=\"%u\"", e->type);
+        }
+    }
+
+    fclose(stream);
+    return str;
+}
+
+size_t
+ofl_exp_openflow_flow_update_put(uint16_t event, uint8_t reason, struct ofl_flow_stats const *stats,
+                                 bool instructions, struct ofpbuf *buf, struct ofl_exp const *exp)
+{
+    struct openflow_ext_flow_update_full *update;
+    size_t start = buf->size;
+    size_t inst_len;
+    uint8_t *data;
+    size_t i;
+
+    if (stats == NULL) {
+        struct openflow_ext_flow_update_paused *paused;
+
+        paused = ofpbuf_put_zeros(buf, sizeof(struct openflow_ext_flow_update_paused));
+        paused->length = htons(sizeof(struct openflow_ext_flow_update_paused));
+        paused->event  = htons(event);
+        return sizeof(struct openflow_ext_flow_update_paused);
+    }
+
+    inst_len = !instructions ? 0 :
+            ofl_structs_instructions_ofp_total_len((struct ofl_instruction_header const **)stats->instructions, stats->instructions_num, exp);
+    ofpbuf_prealloc_tailroom(buf, sizeof(struct openflow_ext_flow_update_full) + ROUND_UP(stats->match->length, 8) + inst_len);
+
+    update = ofpbuf_put_zeros(buf, sizeof(struct openflow_ext_flow_update_full) - sizeof(struct ofp_match));
+    update->event        = htons(event);
+    update->table_id     = stats->table_id;
+    update->reason       = reason;
+    update->idle_timeout = htons(stats->idle_timeout);
+    update->hard_timeout = htons(stats->hard_timeout);
+    update->priority     = htons(stats->priority);
+    update->cookie       = hton64(stats->cookie);
+
+    ofl_structs_match_put(stats->match, buf, exp);
+
+    if (instructions) {
+        data = ofpbuf_put_uninit(buf, inst_len);
+        for (i = 0; i < stats->instructions_num; i++) {
+            data += ofl_structs_instructions_pack(stats->instructions[i], (struct ofp_instruction *)data, exp);
+        }
+    }
+
+    update = (struct openflow_ext_flow_update_full *)((uint8_t *)buf->data + start);
+    update->length = htons(buf->size - start);
+    return buf->size - start;
+}
+
+/*experimenter error functions*/
+
+static void
+ofl_openflow_failed_code_print(FILE *stream, uint16_t code)
+{
+    switch (code) {
+        case (OFPBFC_EXT_UNKNOWN): {            fprintf(stream, "OFPBFC_UNKNOWN"); return; }
+        case (OFPBFC_EXT_EPERM): {              fprintf(stream, "OFPBFC_EPERM"); return; }
+        case (OFPBFC_EXT_BAD_ID): {             fprintf(stream, "OFPBFC_BAD_ID"); return; }
+        case (OFPBFC_EXT_BUNDLE_EXIST): {       fprintf(stream, "OFPBFC_BUNDLE_EXIST"); return; }
+        case (OFPBFC_EXT_BUNDLE_CLOSED): {      fprintf(stream, "OFPBFC_BUNDLE_CLOSED"); return; }
+        case (OFPBFC_EXT_OUT_OF_BUNDLES): {     fprintf(stream, "OFPBFC_OUT_OF_BUNDLES"); return; }
+        case (OFPBFC_EXT_BAD_TYPE): {           fprintf(stream, "OFPBFC_BAD_TYPE"); return; }
+        case (OFPBFC_EXT_BAD_FLAGS): {          fprintf(stream, "OFPBFC_BAD_FLAGS"); return; }
+        case (OFPBFC_EXT_MSG_BAD_LEN): {        fprintf(stream, "OFPBFC_MSG_BAD_LEN"); return; }
+        case (OFPBFC_EXT_MSG_BAD_XID): {        fprintf(stream, "OFPBFC_MSG_BAD_XID"); return; }
+        case (OFPBFC_EXT_MSG_UNSUP): {          fprintf(stream, "OFPBFC_MSG_UNSUP"); return; }
+        case (OFPBFC_EXT_MSG_CONFLICT): {       fprintf(stream, "OFPBFC_MSG_CONFLICT"); return; }
+        case (OFPBFC_EXT_MSG_TOO_MANY): {       fprintf(stream, "OFPBFC_MSG_TOO_MANY"); return; }
+        case (OFPBFC_EXT_MSG_FAILED): {         fprintf(stream, "OFPBFC_MSG_FAILED"); return; }
+        case (OFPBFC_EXT_TIMEOUT): {            fprintf(stream, "OFPBFC_TIMEOUT"); return; }
+        case (OFPBFC_EXT_BUNDLE_IN_PROGRESS): { fprintf(stream, "OFPBFC_BUNDLE_IN_PROGRESS"); return; }
+        case (OFPMOFC_EXT_UNKNOWN): {           fprintf(stream, "OFPMOFC_UNKNOWN"); return; }
+        case (OFPMOFC_EXT_MONITOR_EXISTS): {    fprintf(stream, "OFPMOFC_MONITOR_EXISTS"); return; }
+        case (OFPMOFC_EXT_INVALID_MONITOR): {   fprintf(stream, "OFPMOFC_INVALID_MONITOR"); return; }
+        case (OFPMOFC_EXT_UNKNOWN_MONITOR): {   fprintf(stream, "OFPMOFC_UNKNOWN_MONITOR"); return; }
+        case (OFPMOFC_EXT_BAD_COMMAND): {       fprintf(stream, "OFPMOFC_BAD_COMMAND"); return; }
+        case (OFPMOFC_EXT_BAD_FLAGS): {         fprintf(stream, "OFPMOFC_BAD_FLAGS"); return; }
+        case (OFPMOFC_EXT_BAD_TABLE_ID): {      fprintf(stream, "OFPMOFC_BAD_TABLE_ID"); return; }
+        case (OFPMOFC_EXT_BAD_OUT): {           fprintf(stream, "OFPMOFC_BAD_OUT"); return; }
+        default: {                              fprintf(stream, "?(%u)", code); return; }
+    }
+}
+
+int
+ofl_exp_openflow_error_pack(struct ofl_msg_exp_error const *msg, uint8_t **buf, size_t *buf_len)
+{
+    struct ofp_error_experimenter_msg *exp_err;
+
+    *buf_len = sizeof(struct ofp_error_experimenter_msg) + msg->data_length;
+    *buf     = (uint8_t *)malloc(*buf_len);
+
+    exp_err = (struct ofp_error_experimenter_msg *)(*buf);
+    exp_err->type = htons(msg->type);
+    exp_err->exp_type = htons(msg->exp_type);
+    exp_err->experimenter = htonl(msg->experimenter);
+    memcpy(exp_err->data, msg->data, msg->data_length);
+    return 0;
+}
+
+int
+ofl_exp_openflow_error_free(struct ofl_msg_exp_error *msg)
+{
+    ofl_free(msg->data);
+    ofl_free(msg);
+    return 0;
+}
+
+char *
+ofl_exp_openflow_error_to_string(struct ofl_msg_exp_error const *msg)
+{
+    char *str;
+    size_t str_size;
+    FILE *stream = open_memstream(&str, &str_size);
+
+    fprintf(stream, "{type=\"");
+    ofl_error_type_print(stream, msg->type);
+    fprintf(stream, "\", exp_type=\"");
+    ofl_openflow_failed_code_print(stream, msg->exp_type);
+    fprintf(stream, "\", dlen=\"%zu\"}", msg->data_length);
+    fprintf(stream, "{id=\"0x%"PRIx32"\"}", msg->experimenter);
+    fclose(stream);
+    return str;
+}
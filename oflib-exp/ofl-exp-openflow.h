@@ -57,6 +57,126 @@ struct ofl_exp_openflow_msg_set_dp_desc
     char  *dp_desc;
 };
 
+struct ofl_exp_openflow_msg_pktin_limit
+{
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_SET_PKTIN_LIMIT */
+    uint8_t    reason;   /* OFPR_* or OFPR_EXT_ALL. */
+    uint8_t    table_id; /* Table or OFPTT_ALL. */
+    uint32_t   rate;     /* Packets per second, 0 for no limit. */
+    uint32_t   burst;    /* Bucket size, in packets. */
+    uint32_t   sample;   /* 1 in 'sample' sent over the limit, 0 for none. */
+};
+
+struct ofl_exp_openflow_pktin_stats
+{
+    uint8_t    reason;
+    uint8_t    table_id;
+    uint32_t   rate;
+    uint32_t   burst;
+    uint32_t   sample;
+    uint64_t   n_sent;
+    uint64_t   n_dropped;
+    uint64_t   n_sampled;
+};
+
+struct ofl_exp_openflow_msg_pktin_stats
+{
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_PKTIN_LIMIT_REPLY */
+    size_t                                stats_num;
+    struct ofl_exp_openflow_pktin_stats  *stats;
+};
+
+struct ofl_exp_openflow_msg_buffer_stats
+{
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_BUFFER_STATS_REPLY */
+    uint64_t   capacity;
+    uint64_t   bytes;
+    uint32_t   n_packets;
+    uint64_t   n_saved;
+    uint64_t   n_hits;
+    uint64_t   n_misses;
+    uint64_t   n_expired;
+    uint64_t   n_evicted;
+    uint64_t   n_failed;
+};
+
+struct ofl_exp_openflow_msg_bundle_ctrl
+{
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_BUNDLE_CONTROL */
+    uint32_t   bundle_id;
+    uint16_t   type;     /* OFPBCT_EXT_*. */
+    uint16_t   flags;    /* OFPBF_EXT_*. */
+};
+
+struct ofl_exp_openflow_msg_bundle_add
+{
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_BUNDLE_ADD */
+    uint32_t   bundle_id;
+    uint16_t   flags;    /* OFPBF_EXT_*. */
+    size_t     data_length;
+    uint8_t   *data;     /* The message added, still in wire format; it is
+                            decoded by the switch, which knows the
+                            experimenter callbacks it needs. */
+};
+
+struct ofl_exp_openflow_msg_multipart_request
+{
+    struct ofl_msg_multipart_request_experimenter header; /* OPENFLOW_VENDOR_ID */
+    uint32_t   type;     /* OFPMP_EXT_*. */
+};
+
+struct ofl_exp_openflow_msg_multipart_reply
+{
+    struct ofl_msg_multipart_reply_experimenter header; /* OPENFLOW_VENDOR_ID */
+    uint32_t   type;     /* OFPMP_EXT_*. */
+};
+
+struct ofl_exp_openflow_msg_multipart_request_flow_delta
+{
+    struct ofl_exp_openflow_msg_multipart_request header; /* OFPMP_EXT_FLOW_DELTA */
+    uint8_t    table_id; /* Table or OFPTT_ALL. */
+};
+
+struct ofl_exp_openflow_flow_delta
+{
+    uint64_t   entry_id;
+    uint64_t   cookie;
+    uint64_t   packet_count;
+    uint64_t   byte_count;
+    uint32_t   duration_sec;
+    uint16_t   priority;
+    uint8_t    table_id;
+    uint8_t    flags;    /* OFPFDF_EXT_*. */
+};
+
+struct ofl_exp_openflow_msg_multipart_reply_flow_delta
+{
+    struct ofl_exp_openflow_msg_multipart_reply header; /* OFPMP_EXT_FLOW_DELTA */
+    size_t                               deltas_num;
+    struct ofl_exp_openflow_flow_delta  *deltas;
+};
+
+struct ofl_exp_openflow_msg_multipart_request_flow_monitor
+{
+    struct ofl_exp_openflow_msg_multipart_request header; /* OFPMP_EXT_FLOW_MONITOR */
+    uint32_t   monitor_id;
+    uint32_t   out_port;
+    uint32_t   out_group;
+    uint16_t   flags;    /* OFPFMF_EXT_*. */
+    uint8_t    table_id; /* Table or OFPTT_ALL. */
+    uint8_t    command;  /* OFPFMC_EXT_*. */
+    struct ofl_match_header  *match;
+};
+
+struct ofl_exp_openflow_msg_multipart_reply_flow_monitor
+{
+    struct ofl_exp_openflow_msg_multipart_reply header; /* OFPMP_EXT_FLOW_MONITOR */
+    size_t     data_length;
+    uint8_t   *data;     /* The updates, in wire format; the switch packs
+                            them as the entries change, with
+                            ofl_exp_openflow_flow_update_put. */
+};
+
 
 int
 ofl_exp_openflow_msg_pack(struct ofl_msg_experimenter const *msg, uint8_t **buf, size_t *buf_len);
@@ -89,6 +209,50 @@ ofl_exp_openflow_act_free(struct ofl_action_header *act);
 char *
 ofl_exp_openflow_act_to_string(struct ofl_action_header const *act);
 
+/*experimenter multipart functions*/
+
+int
+ofl_exp_openflow_stats_req_pack(struct ofl_msg_multipart_request_experimenter const *ext, uint8_t **buf, size_t *buf_len, struct ofl_exp const *exp);
+
+int
+ofl_exp_openflow_stats_reply_pack(struct ofl_msg_multipart_reply_experimenter const *ext, uint8_t **buf, size_t *buf_len);
+
+ofl_err
+ofl_exp_openflow_stats_req_unpack(struct ofp_multipart_request const *os, uint8_t const *buf, size_t *len, struct ofl_msg_multipart_request_header **msg, struct ofl_exp const *exp);
+
+ofl_err
+ofl_exp_openflow_stats_reply_unpack(struct ofp_multipart_reply const *os, size_t *len, struct ofl_msg_multipart_reply_header **msg);
+
+int
+ofl_exp_openflow_stats_req_free(struct ofl_msg_multipart_request_header *msg);
+
+int
+ofl_exp_openflow_stats_reply_free(struct ofl_msg_multipart_reply_header *msg);
+
+char *
+ofl_exp_openflow_stats_req_to_string(struct ofl_msg_multipart_request_experimenter const *ext, struct ofl_exp const *exp);
+
+char *
+ofl_exp_openflow_stats_reply_to_string(struct ofl_msg_multipart_reply_experimenter const *ext, struct ofl_exp const *exp);
+
+/* Appends to 'buf' a flow monitor update of the entry with 'stats', with its
+ * instructions if 'instructions' is true; 'stats' is NULL for
+ * OFPFME_EXT_PAUSED and OFPFME_EXT_RESUMED.  Returns the length appended. */
+size_t
+ofl_exp_openflow_flow_update_put(uint16_t event, uint8_t reason, struct ofl_flow_stats const *stats,
+                                 bool instructions, struct ofpbuf *buf, struct ofl_exp const *exp);
+
+/*experimenter error functions; the errors are about bundles and flow monitors*/
+
+int
+ofl_exp_openflow_error_pack(struct ofl_msg_exp_error const *msg, uint8_t **buf, size_t *buf_len);
+
+int
+ofl_exp_openflow_error_free(struct ofl_msg_exp_error *msg);
+
+char *
+ofl_exp_openflow_error_to_string(struct ofl_msg_exp_error const *msg);
+
 void
 ofl_error_openstate_exp_type_print(FILE *stream, uint16_t exp_type);
 
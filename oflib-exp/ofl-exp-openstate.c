@@ -9,14 +9,18 @@
 #include "openflow/openflow.h"
 #include "openflow/openstate-ext.h"
 #include "ofl-exp-openstate.h"
+#include "oflib/ofl-arena.h"
 #include "oflib/ofl-log.h"
 #include "oflib/ofl-print.h"
 #include "oflib/ofl-utils.h"
 #include "oflib/ofl-structs.h"
 #include "oflib/oxm-match.h"
 #include "lib/hash.h"
+#include "lib/ofpbuf.h"
 #include "lib/ofp.h"
+#include "lib/random.h"
 #include "timeval.h"
+#include "udatapath/crc32.h"
 
 
 #define LOG_MODULE ofl_exp_os
@@ -158,11 +162,339 @@ ofl_structs_set_global_state_unpack(struct ofp_exp_set_global_state const *src,
     return 0;
 }
 
+static ofl_err
+ofl_structs_set_table_limits_unpack(struct ofp_exp_set_table_limits const *src, size_t *len, struct ofl_exp_set_table_limits *dst)
+{
+    if (*len == sizeof(struct ofp_exp_set_table_limits)) {
+        if (src->table_id >= PIPELINE_TABLES) {
+            OFL_LOG_WARN(LOG_MODULE, "Received STATE_MOD message has invalid table id (%d).", src->table_id );
+            return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_TABLE_ID);
+        }
+        if (src->eviction > OFPSE_RANDOM) {
+            OFL_LOG_WARN(LOG_MODULE, "Received STATE_MOD set table limits has invalid eviction (%u).", src->eviction);
+            return ofl_error(OFPET_EXPERIMENTER, OFPEC_EXP_STATE_MOD_FAILED);
+        }
+        dst->table_id = src->table_id;
+        dst->eviction = src->eviction;
+        dst->max_entries = ntohl(src->max_entries);
+        dst->max_bytes = ntoh64(src->max_bytes);
+    }
+    else {
+        OFL_LOG_WARN(LOG_MODULE, "Received STATE_MOD set table limits has invalid length (%zu).", *len);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+    }
+
+    *len -= sizeof(struct ofp_exp_set_table_limits);
+
+    return 0;
+}
+
+/* Length of an entry of OFPSC_EXP_SET_FLOW_STATES with a 'key_len' key. */
+static size_t
+ofp_exp_flow_state_entry_len(uint32_t key_len)
+{
+    return ROUND_UP(sizeof(struct ofp_exp_flow_state_entry) + key_len, 8);
+}
+
+static ofl_err
+ofl_structs_set_flow_states_unpack(struct ofp_exp_set_flow_states const *src, size_t *len, struct ofl_exp_set_flow_states *dst)
+{
+    size_t entry_len, i;
+
+    dst->n_entries = 0;
+    dst->entries = NULL;
+    if (*len < sizeof(struct ofp_exp_set_flow_states)) {
+        OFL_LOG_WARN(LOG_MODULE, "Received state mod set_flow_states is too short (%zu).", *len);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+    }
+    if (src->table_id >= PIPELINE_TABLES) {
+        OFL_LOG_WARN(LOG_MODULE, "Received STATE_MOD message has invalid table id (%d).", src->table_id );
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_TABLE_ID);
+    }
+    dst->table_id = src->table_id;
+    dst->key_len = ntohl(src->key_len);
+    if (dst->key_len == 0 || dst->key_len > OFPSC_MAX_KEY_LEN) {
+        OFL_LOG_WARN(LOG_MODULE, "Received state mod set_flow_states has invalid key length (%u).", dst->key_len);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+    }
+    entry_len = ofp_exp_flow_state_entry_len(dst->key_len);
+    if ((*len - sizeof(struct ofp_exp_set_flow_states)) / entry_len != ntohl(src->n_entries)
+        || (*len - sizeof(struct ofp_exp_set_flow_states)) % entry_len) {
+        OFL_LOG_WARN(LOG_MODULE, "Received state mod set_flow_states has invalid length (%zu).", *len);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+    }
+
+    dst->n_entries = ntohl(src->n_entries);
+    dst->entries = (struct ofl_exp_set_flow_state *)ofl_malloc(dst->n_entries * sizeof(struct ofl_exp_set_flow_state));
+    for (i = 0; i < dst->n_entries; i++) {
+        struct ofp_exp_flow_state_entry const *se = (struct ofp_exp_flow_state_entry const *)(src->entries + i * entry_len);
+        struct ofl_exp_set_flow_state *de = &dst->entries[i];
+
+        de->table_id = dst->table_id;
+        de->key_len = dst->key_len;
+        de->state = ntohl(se->state);
+        de->state_mask = ntohl(se->state_mask);
+        de->hard_rollback = ntohl(se->hard_rollback);
+        de->idle_rollback = ntohl(se->idle_rollback);
+        de->hard_timeout = ntohl(se->hard_timeout);
+        de->idle_timeout = ntohl(se->idle_timeout);
+        memcpy(de->key, se->key, dst->key_len);
+    }
+
+    *len = 0;
+    return 0;
+}
+
+static ofl_err
+ofl_structs_del_flow_states_unpack(struct ofp_exp_del_flow_states const *src, size_t *len, struct ofl_exp_del_flow_states *dst)
+{
+    size_t key_len, i;
+
+    dst->n_keys = 0;
+    dst->keys = NULL;
+    if (*len < sizeof(struct ofp_exp_del_flow_states)) {
+        OFL_LOG_WARN(LOG_MODULE, "Received state mod del_flow_states is too short (%zu).", *len);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+    }
+    if (src->table_id >= PIPELINE_TABLES) {
+        OFL_LOG_WARN(LOG_MODULE, "Received STATE_MOD message has invalid table id (%d).", src->table_id );
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_TABLE_ID);
+    }
+    dst->table_id = src->table_id;
+    dst->key_len = ntohl(src->key_len);
+    if (dst->key_len == 0 || dst->key_len > OFPSC_MAX_KEY_LEN) {
+        OFL_LOG_WARN(LOG_MODULE, "Received state mod del_flow_states has invalid key length (%u).", dst->key_len);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+    }
+    key_len = ROUND_UP(dst->key_len, 8);
+    if ((*len - sizeof(struct ofp_exp_del_flow_states)) / key_len != ntohl(src->n_keys)
+        || (*len - sizeof(struct ofp_exp_del_flow_states)) % key_len) {
+        OFL_LOG_WARN(LOG_MODULE, "Received state mod del_flow_states has invalid length (%zu).", *len);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+    }
+
+    dst->n_keys = ntohl(src->n_keys);
+    dst->keys = (uint8_t *)ofl_malloc(dst->n_keys * dst->key_len);
+    for (i = 0; i < dst->n_keys; i++)
+        memcpy(dst->keys + i * dst->key_len, src->keys + i * key_len, dst->key_len);
+
+    *len = 0;
+    return 0;
+}
+
+static ofl_err
+ofl_structs_del_flow_states_by_state_unpack(struct ofp_exp_del_flow_states_by_state const *src, size_t *len, struct ofl_exp_del_flow_states_by_state *dst)
+{
+    if (*len != sizeof(struct ofp_exp_del_flow_states_by_state)) {
+        OFL_LOG_WARN(LOG_MODULE, "Received state mod del_flow_states_by_state has invalid length (%zu).", *len);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+    }
+    if (src->table_id >= PIPELINE_TABLES && src->table_id != OFPTT_ALL) {
+        OFL_LOG_WARN(LOG_MODULE, "Received STATE_MOD message has invalid table id (%d).", src->table_id );
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_TABLE_ID);
+    }
+    dst->table_id = src->table_id;
+    dst->state = ntohl(src->state);
+    dst->state_mask = ntohl(src->state_mask);
+
+    *len -= sizeof(struct ofp_exp_del_flow_states_by_state);
+    return 0;
+}
+
+static ofl_err
+ofl_structs_flush_state_table_unpack(struct ofp_exp_flush_state_table const *src, size_t *len, struct ofl_exp_flush_state_table *dst)
+{
+    if (*len != sizeof(struct ofp_exp_flush_state_table)) {
+        OFL_LOG_WARN(LOG_MODULE, "Received state mod flush_state_table has invalid length (%zu).", *len);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+    }
+    if (src->table_id >= PIPELINE_TABLES && src->table_id != OFPTT_ALL) {
+        OFL_LOG_WARN(LOG_MODULE, "Received STATE_MOD message has invalid table id (%d).", src->table_id );
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_TABLE_ID);
+    }
+    dst->table_id = src->table_id;
+
+    *len -= sizeof(struct ofp_exp_flush_state_table);
+    return 0;
+}
+
+/* Returns the length of the payload of 'src' on the wire, or 0 for an
+ * unknown command. */
+static size_t
+ofl_structs_state_mod_payload_ofp_len(struct ofl_exp_msg_state_mod const *src)
+{
+    switch (src->command) {
+        case OFPSC_STATEFUL_TABLE_CONFIG:
+            return sizeof(struct ofp_exp_stateful_table_config);
+        case OFPSC_EXP_SET_L_EXTRACTOR:
+        case OFPSC_EXP_SET_U_EXTRACTOR: {
+            struct ofl_exp_set_extractor const *p = (struct ofl_exp_set_extractor const *)src->payload;
+            return (1 + p->field_count) * sizeof(uint32_t) + 4;
+        }
+        case OFPSC_EXP_SET_FLOW_STATE:
+            return 7 * sizeof(uint32_t) + 4 + ((struct ofl_exp_set_flow_state const *)src->payload)->key_len;
+        case OFPSC_EXP_DEL_FLOW_STATE:
+            return sizeof(uint32_t) + 4 + ((struct ofl_exp_del_flow_state const *)src->payload)->key_len;
+        case OFPSC_EXP_SET_GLOBAL_STATE:
+            return sizeof(struct ofp_exp_set_global_state);
+        case OFPSC_EXP_RESET_GLOBAL_STATE:
+            return 0;
+        case OFPSC_EXP_SET_TABLE_LIMITS:
+            return sizeof(struct ofp_exp_set_table_limits);
+        case OFPSC_EXP_SET_FLOW_STATES: {
+            struct ofl_exp_set_flow_states const *p = (struct ofl_exp_set_flow_states const *)src->payload;
+            return sizeof(struct ofp_exp_set_flow_states) + p->n_entries * ofp_exp_flow_state_entry_len(p->key_len);
+        }
+        case OFPSC_EXP_DEL_FLOW_STATES: {
+            struct ofl_exp_del_flow_states const *p = (struct ofl_exp_del_flow_states const *)src->payload;
+            return sizeof(struct ofp_exp_del_flow_states) + p->n_keys * ROUND_UP(p->key_len, 8);
+        }
+        case OFPSC_EXP_DEL_FLOW_STATES_BY_STATE:
+            return sizeof(struct ofp_exp_del_flow_states_by_state);
+        case OFPSC_EXP_FLUSH_STATE_TABLE:
+            return sizeof(struct ofp_exp_flush_state_table);
+        default:
+            return 0;
+    }
+}
+
+/* Packs the payload of 'src' into 'dst', zeroed and of the length given by
+ * ofl_structs_state_mod_payload_ofp_len(). */
+static void
+ofl_structs_state_mod_payload_pack(struct ofl_exp_msg_state_mod const *src, uint8_t *dst)
+{
+    size_t i;
+
+    switch (src->command) {
+        case OFPSC_STATEFUL_TABLE_CONFIG: {
+            struct ofl_exp_stateful_table_config const *p = (struct ofl_exp_stateful_table_config const *)src->payload;
+            struct ofp_exp_stateful_table_config *d = (struct ofp_exp_stateful_table_config *)dst;
+            d->table_id = p->table_id;
+            d->stateful = p->stateful;
+            break;
+        }
+        case OFPSC_EXP_SET_L_EXTRACTOR:
+        case OFPSC_EXP_SET_U_EXTRACTOR: {
+            struct ofl_exp_set_extractor const *p = (struct ofl_exp_set_extractor const *)src->payload;
+            struct ofp_exp_set_extractor *d = (struct ofp_exp_set_extractor *)dst;
+            d->table_id = p->table_id;
+            d->field_count = htonl(p->field_count);
+            for (i = 0; i < p->field_count; i++)
+                d->fields[i] = htonl(p->fields[i]);
+            break;
+        }
+        case OFPSC_EXP_SET_FLOW_STATE: {
+            struct ofl_exp_set_flow_state const *p = (struct ofl_exp_set_flow_state const *)src->payload;
+            struct ofp_exp_set_flow_state *d = (struct ofp_exp_set_flow_state *)dst;
+            d->table_id = p->table_id;
+            d->key_len = htonl(p->key_len);
+            d->state = htonl(p->state);
+            d->state_mask = htonl(p->state_mask);
+            d->hard_rollback = htonl(p->hard_rollback);
+            d->idle_rollback = htonl(p->idle_rollback);
+            d->hard_timeout = htonl(p->hard_timeout);
+            d->idle_timeout = htonl(p->idle_timeout);
+            memcpy(d->key, p->key, p->key_len);
+            break;
+        }
+        case OFPSC_EXP_DEL_FLOW_STATE: {
+            struct ofl_exp_del_flow_state const *p = (struct ofl_exp_del_flow_state const *)src->payload;
+            struct ofp_exp_del_flow_state *d = (struct ofp_exp_del_flow_state *)dst;
+            d->table_id = p->table_id;
+            d->key_len = htonl(p->key_len);
+            memcpy(d->key, p->key, p->key_len);
+            break;
+        }
+        case OFPSC_EXP_SET_GLOBAL_STATE: {
+            struct ofl_exp_set_global_state const *p = (struct ofl_exp_set_global_state const *)src->payload;
+            struct ofp_exp_set_global_state *d = (struct ofp_exp_set_global_state *)dst;
+            d->global_state = htonl(p->global_state);
+            d->global_state_mask = htonl(p->global_state_mask);
+            break;
+        }
+        case OFPSC_EXP_SET_TABLE_LIMITS: {
+            struct ofl_exp_set_table_limits const *p = (struct ofl_exp_set_table_limits const *)src->payload;
+            struct ofp_exp_set_table_limits *d = (struct ofp_exp_set_table_limits *)dst;
+            d->table_id = p->table_id;
+            d->eviction = p->eviction;
+            d->max_entries = htonl(p->max_entries);
+            d->max_bytes = hton64(p->max_bytes);
+            break;
+        }
+        case OFPSC_EXP_SET_FLOW_STATES: {
+            struct ofl_exp_set_flow_states const *p = (struct ofl_exp_set_flow_states const *)src->payload;
+            struct ofp_exp_set_flow_states *d = (struct ofp_exp_set_flow_states *)dst;
+            size_t entry_len = ofp_exp_flow_state_entry_len(p->key_len);
+            d->table_id = p->table_id;
+            d->key_len = htonl(p->key_len);
+            d->n_entries = htonl(p->n_entries);
+            for (i = 0; i < p->n_entries; i++) {
+                struct ofl_exp_set_flow_state const *se = &p->entries[i];
+                struct ofp_exp_flow_state_entry *de = (struct ofp_exp_flow_state_entry *)(d->entries + i * entry_len);
+                de->state = htonl(se->state);
+                de->state_mask = htonl(se->state_mask);
+                de->hard_rollback = htonl(se->hard_rollback);
+                de->idle_rollback = htonl(se->idle_rollback);
+                de->hard_timeout = htonl(se->hard_timeout);
+                de->idle_timeout = htonl(se->idle_timeout);
+                memcpy(de->key, se->key, p->key_len);
+            }
+            break;
+        }
+        case OFPSC_EXP_DEL_FLOW_STATES: {
+            struct ofl_exp_del_flow_states const *p = (struct ofl_exp_del_flow_states const *)src->payload;
+            struct ofp_exp_del_flow_states *d = (struct ofp_exp_del_flow_states *)dst;
+            d->table_id = p->table_id;
+            d->key_len = htonl(p->key_len);
+            d->n_keys = htonl(p->n_keys);
+            for (i = 0; i < p->n_keys; i++)
+                memcpy(d->keys + i * ROUND_UP(p->key_len, 8), p->keys + i * p->key_len, p->key_len);
+            break;
+        }
+        case OFPSC_EXP_DEL_FLOW_STATES_BY_STATE: {
+            struct ofl_exp_del_flow_states_by_state const *p = (struct ofl_exp_del_flow_states_by_state const *)src->payload;
+            struct ofp_exp_del_flow_states_by_state *d = (struct ofp_exp_del_flow_states_by_state *)dst;
+            d->table_id = p->table_id;
+            d->state = htonl(p->state);
+            d->state_mask = htonl(p->state_mask);
+            break;
+        }
+        case OFPSC_EXP_FLUSH_STATE_TABLE: {
+            struct ofl_exp_flush_state_table const *p = (struct ofl_exp_flush_state_table const *)src->payload;
+            struct ofp_exp_flush_state_table *d = (struct ofp_exp_flush_state_table *)dst;
+            d->table_id = p->table_id;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
 int
-ofl_exp_openstate_msg_pack(struct ofl_msg_experimenter const *msg, uint8_t **buf UNUSED, size_t *buf_len UNUSED, struct ofl_exp const *exp UNUSED)
+ofl_exp_openstate_msg_pack(struct ofl_msg_experimenter const *msg, uint8_t **buf, size_t *buf_len, struct ofl_exp const *exp UNUSED)
 {
     struct ofl_exp_openstate_msg_header *exp_msg = (struct ofl_exp_openstate_msg_header *)msg;
     switch (exp_msg->type) {
+        case (OFPT_EXP_STATE_MOD): {
+            struct ofl_exp_msg_state_mod *sm = (struct ofl_exp_msg_state_mod *)exp_msg;
+            struct ofp_exp_msg_state_mod *ofp;
+            size_t payload_len = ofl_structs_state_mod_payload_ofp_len(sm);
+
+            if (payload_len == 0 && sm->command != OFPSC_EXP_RESET_GLOBAL_STATE) {
+                OFL_LOG_WARN(LOG_MODULE, "Trying to pack STATE_MOD message with unknown command (%u).", sm->command);
+                return -1;
+            }
+            *buf_len = offsetof(struct ofp_exp_msg_state_mod, payload) + payload_len;
+            *buf     = (uint8_t *)malloc(*buf_len);
+            memset(*buf, 0, *buf_len);
+
+            ofp = (struct ofp_exp_msg_state_mod *)(*buf);
+            ofp->header.experimenter = htonl(exp_msg->header.experimenter_id);
+            ofp->header.exp_type     = htonl(exp_msg->type);
+            ofp->command             = sm->command;
+            ofl_structs_state_mod_payload_pack(sm, ofp->payload);
+            return 0;
+        }
         default: {
            OFL_LOG_WARN(LOG_MODULE, "Trying to pack unknown Openstate Experimenter message.");
            break;
@@ -192,7 +524,7 @@ ofl_exp_openstate_msg_unpack(struct ofp_header const *oh, size_t *len, struct of
             *len -= sizeof(struct ofp_experimenter_header);
 
             sm = (struct ofp_exp_msg_state_mod *)exp_header;
-            dm = (struct ofl_exp_msg_state_mod *)malloc(sizeof(struct ofl_exp_msg_state_mod));
+            dm = (struct ofl_exp_msg_state_mod *)ofl_malloc(sizeof(struct ofl_exp_msg_state_mod));
 
             dm->header.header.experimenter_id = ntohl(exp_header->experimenter);
             dm->header.type                   = ntohl(exp_header->exp_type);
@@ -226,6 +558,21 @@ ofl_exp_openstate_msg_unpack(struct ofp_header const *oh, size_t *len, struct of
                 case OFPSC_EXP_SET_GLOBAL_STATE:
                     return ofl_structs_set_global_state_unpack((struct ofp_exp_set_global_state const *)&(sm->payload[0]), len,
                                                           (struct ofl_exp_set_global_state *)&(dm->payload[0]));
+                case OFPSC_EXP_SET_TABLE_LIMITS:
+                    return ofl_structs_set_table_limits_unpack((struct ofp_exp_set_table_limits const *)&(sm->payload[0]), len,
+                                                          (struct ofl_exp_set_table_limits *)&(dm->payload[0]));
+                case OFPSC_EXP_SET_FLOW_STATES:
+                    return ofl_structs_set_flow_states_unpack((struct ofp_exp_set_flow_states const *)&(sm->payload[0]), len,
+                                                         (struct ofl_exp_set_flow_states *)&(dm->payload[0]));
+                case OFPSC_EXP_DEL_FLOW_STATES:
+                    return ofl_structs_del_flow_states_unpack((struct ofp_exp_del_flow_states const *)&(sm->payload[0]), len,
+                                                         (struct ofl_exp_del_flow_states *)&(dm->payload[0]));
+                case OFPSC_EXP_DEL_FLOW_STATES_BY_STATE:
+                    return ofl_structs_del_flow_states_by_state_unpack((struct ofp_exp_del_flow_states_by_state const *)&(sm->payload[0]), len,
+                                                                  (struct ofl_exp_del_flow_states_by_state *)&(dm->payload[0]));
+                case OFPSC_EXP_FLUSH_STATE_TABLE:
+                    return ofl_structs_flush_state_table_unpack((struct ofp_exp_flush_state_table const *)&(sm->payload[0]), len,
+                                                           (struct ofl_exp_flush_state_table *)&(dm->payload[0]));
                 default:
                     return ofl_error(OFPET_EXPERIMENTER, OFPEC_EXP_STATE_MOD_BAD_COMMAND);
             }
@@ -233,7 +580,7 @@ ofl_exp_openstate_msg_unpack(struct ofp_header const *oh, size_t *len, struct of
 
         default: {
             struct ofl_msg_experimenter *dm;
-            dm = (struct ofl_msg_experimenter *)malloc(sizeof(struct ofl_msg_experimenter));
+            dm = (struct ofl_msg_experimenter *)ofl_malloc(sizeof(struct ofl_msg_experimenter));
             dm->experimenter_id = ntohl(exp_header->experimenter);
             (*msg) = dm;
             OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown Openstate Experimenter message.");
@@ -251,7 +598,11 @@ ofl_exp_openstate_msg_free(struct ofl_msg_experimenter *msg)
         {
             struct ofl_exp_msg_state_mod *state_mod = (struct ofl_exp_msg_state_mod *)exp;
             OFL_LOG_DBG(LOG_MODULE, "Free Openstate STATE_MOD Experimenter message. OPENSTATE_MSG{type=\"%u\", command=\"%u\"}", exp->type, state_mod->command);
-            free(msg);
+            if (state_mod->command == OFPSC_EXP_SET_FLOW_STATES)
+                ofl_free(((struct ofl_exp_set_flow_states *)state_mod->payload)->entries);
+            else if (state_mod->command == OFPSC_EXP_DEL_FLOW_STATES)
+                ofl_free(((struct ofl_exp_del_flow_states *)state_mod->payload)->keys);
+            ofl_free(msg);
             break;
         }
         default: {
@@ -274,6 +625,36 @@ ofl_exp_openstate_msg_to_string(struct ofl_msg_experimenter const *msg)
         {
             struct ofl_exp_msg_state_mod *state_mod = (struct ofl_exp_msg_state_mod *)exp;
             OFL_LOG_DBG(LOG_MODULE, "Print Openstate STATE_MOD Experimenter message OPENSTATE_MSG{type=\"%u\", command=\"%u\"}", exp->type, state_mod->command);
+            fprintf(stream, "{exp_type=\"state_mod\", command=\"%u\"", state_mod->command);
+            switch (state_mod->command) {
+                case OFPSC_EXP_SET_FLOW_STATES: {
+                    struct ofl_exp_set_flow_states *p = (struct ofl_exp_set_flow_states *)state_mod->payload;
+                    fprintf(stream, ", table=\"%u\", key_len=\"%u\", entries=\"%zu\"", p->table_id, p->key_len, p->n_entries);
+                    break;
+                }
+                case OFPSC_EXP_DEL_FLOW_STATES: {
+                    struct ofl_exp_del_flow_states *p = (struct ofl_exp_del_flow_states *)state_mod->payload;
+                    fprintf(stream, ", table=\"%u\", key_len=\"%u\", keys=\"%zu\"", p->table_id, p->key_len, p->n_keys);
+                    break;
+                }
+                case OFPSC_EXP_DEL_FLOW_STATES_BY_STATE: {
+                    struct ofl_exp_del_flow_states_by_state *p = (struct ofl_exp_del_flow_states_by_state *)state_mod->payload;
+                    fprintf(stream, ", table=\"");
+                    ofl_table_print(stream, p->table_id);
+                    fprintf(stream, "\", state=\"%u\", state_mask=\"0x%x\"", p->state, p->state_mask);
+                    break;
+                }
+                case OFPSC_EXP_FLUSH_STATE_TABLE: {
+                    struct ofl_exp_flush_state_table *p = (struct ofl_exp_flush_state_table *)state_mod->payload;
+                    fprintf(stream, ", table=\"");
+                    ofl_table_print(stream, p->table_id);
+                    fprintf(stream, "\"");
+                    break;
+                }
+                default:
+                    break;
+            }
+            fprintf(stream, "}");
             break;
         }
         default: {
@@ -287,6 +668,20 @@ ofl_exp_openstate_msg_to_string(struct ofl_msg_experimenter const *msg)
 
 /*experimenter action functions*/
 
+static ofl_err
+ofl_exp_openstate_state_reg_check(uint8_t table_id, uint8_t reg)
+{
+    if (table_id >= PIPELINE_TABLES) {
+        OFL_LOG_WARN(LOG_MODULE, "Register action refers to an invalid table (%u).", table_id);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_TABLE_ID);
+    }
+    if (reg >= OFPSC_MAX_REGISTERS) {
+        OFL_LOG_WARN(LOG_MODULE, "Register action refers to an invalid register (%u).", reg);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_ACTION);
+    }
+    return 0;
+}
+
 ofl_err
 ofl_exp_openstate_act_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_action_header **dst)
 {
@@ -308,7 +703,7 @@ ofl_exp_openstate_act_unpack(struct ofp_action_header const *src, size_t *len, s
             struct ofl_exp_action_set_state *da;
 
             sa = (struct ofp_exp_action_set_state *)ext;
-            da = (struct ofl_exp_action_set_state *)malloc(sizeof(struct ofl_exp_action_set_state));
+            da = (struct ofl_exp_action_set_state *)ofl_malloc(sizeof(struct ofl_exp_action_set_state));
             da->header.header.experimenter_id = ntohl(exp->experimenter);
             da->header.act_type = ntohl(ext->act_type);
             *dst = (struct ofl_action_header *)da;
@@ -322,7 +717,7 @@ ofl_exp_openstate_act_unpack(struct ofp_action_header const *src, size_t *len, s
                 if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
                     char *ts = ofl_table_to_string(sa->table_id);
                     OFL_LOG_WARN(LOG_MODULE, "Received SET STATE action has invalid table_id (%s).", ts);
-                    free(ts);
+                    ofl_free(ts);
                 }
                 return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_TABLE_ID);
             }
@@ -344,7 +739,7 @@ ofl_exp_openstate_act_unpack(struct ofp_action_header const *src, size_t *len, s
             struct ofp_exp_action_set_global_state *sa;
             struct ofl_exp_action_set_global_state *da;
             sa = (struct ofp_exp_action_set_global_state*)ext;
-            da = (struct ofl_exp_action_set_global_state *)malloc(sizeof(struct ofl_exp_action_set_global_state));
+            da = (struct ofl_exp_action_set_global_state *)ofl_malloc(sizeof(struct ofl_exp_action_set_global_state));
 
             da->header.header.experimenter_id = ntohl(exp->experimenter);
             da->header.act_type = ntohl(ext->act_type);
@@ -362,10 +757,102 @@ ofl_exp_openstate_act_unpack(struct ofp_action_header const *src, size_t *len, s
             break;
         }
 
+        case (OFPAT_EXP_INC_STATE_REG):
+        {
+            struct ofp_exp_action_inc_state_reg *sa;
+            struct ofl_exp_action_inc_state_reg *da;
+            ofl_err error;
+
+            sa = (struct ofp_exp_action_inc_state_reg *)ext;
+            da = (struct ofl_exp_action_inc_state_reg *)ofl_malloc(sizeof(struct ofl_exp_action_inc_state_reg));
+            da->header.header.experimenter_id = ntohl(exp->experimenter);
+            da->header.act_type = ntohl(ext->act_type);
+            *dst = (struct ofl_action_header *)da;
+
+            if (*len < sizeof(struct ofp_exp_action_inc_state_reg)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received INC STATE REG action has invalid length (%zu).", *len);
+                return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+            }
+            error = ofl_exp_openstate_state_reg_check(sa->table_id, sa->reg);
+            if (error)
+                return error;
+
+            da->table_id = sa->table_id;
+            da->reg = sa->reg;
+            da->flags = sa->flags;
+            da->value = ntoh64(sa->value);
+
+            *len -= sizeof(struct ofp_exp_action_inc_state_reg);
+            break;
+        }
+
+        case (OFPAT_EXP_SET_STATE_REG):
+        {
+            struct ofp_exp_action_set_state_reg *sa;
+            struct ofl_exp_action_set_state_reg *da;
+            ofl_err error;
+
+            sa = (struct ofp_exp_action_set_state_reg *)ext;
+            da = (struct ofl_exp_action_set_state_reg *)ofl_malloc(sizeof(struct ofl_exp_action_set_state_reg));
+            da->header.header.experimenter_id = ntohl(exp->experimenter);
+            da->header.act_type = ntohl(ext->act_type);
+            *dst = (struct ofl_action_header *)da;
+
+            if (*len < sizeof(struct ofp_exp_action_set_state_reg)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received SET STATE REG action has invalid length (%zu).", *len);
+                return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+            }
+            error = ofl_exp_openstate_state_reg_check(sa->table_id, sa->reg);
+            if (error)
+                return error;
+
+            da->table_id = sa->table_id;
+            da->reg = sa->reg;
+            da->value = ntoh64(sa->value);
+
+            *len -= sizeof(struct ofp_exp_action_set_state_reg);
+            break;
+        }
+
+        case (OFPAT_EXP_CMP_SET_STATE):
+        {
+            struct ofp_exp_action_cmp_set_state *sa;
+            struct ofl_exp_action_cmp_set_state *da;
+            ofl_err error;
+
+            sa = (struct ofp_exp_action_cmp_set_state *)ext;
+            da = (struct ofl_exp_action_cmp_set_state *)ofl_malloc(sizeof(struct ofl_exp_action_cmp_set_state));
+            da->header.header.experimenter_id = ntohl(exp->experimenter);
+            da->header.act_type = ntohl(ext->act_type);
+            *dst = (struct ofl_action_header *)da;
+
+            if (*len < sizeof(struct ofp_exp_action_cmp_set_state)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received CMP SET STATE action has invalid length (%zu).", *len);
+                return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+            }
+            error = ofl_exp_openstate_state_reg_check(sa->table_id, sa->reg);
+            if (error)
+                return error;
+            if (sa->cmp > OFPSRC_GE) {
+                OFL_LOG_WARN(LOG_MODULE, "Received CMP SET STATE action has invalid comparison (%u).", sa->cmp);
+                return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_ACTION);
+            }
+
+            da->table_id = sa->table_id;
+            da->reg = sa->reg;
+            da->cmp = sa->cmp;
+            da->value = ntoh64(sa->value);
+            da->state = ntohl(sa->state);
+            da->state_mask = ntohl(sa->state_mask);
+
+            *len -= sizeof(struct ofp_exp_action_cmp_set_state);
+            break;
+        }
+
         default:
         {
             struct ofl_action_experimenter *da;
-            da = (struct ofl_action_experimenter *)malloc(sizeof(struct ofl_action_experimenter));
+            da = (struct ofl_action_experimenter *)ofl_malloc(sizeof(struct ofl_action_experimenter));
             da->experimenter_id = ntohl(exp->experimenter);
             (*dst) = (struct ofl_action_header *)da;
             OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown Openstate Experimenter action.");
@@ -418,6 +905,58 @@ ofl_exp_openstate_act_pack(struct ofl_action_header const *src, struct ofp_actio
 
             return sizeof(struct ofp_exp_action_set_global_state);
         }
+        case (OFPAT_EXP_INC_STATE_REG):
+        {
+            struct ofl_exp_action_inc_state_reg *sa = (struct ofl_exp_action_inc_state_reg *) ext;
+            struct ofp_exp_action_inc_state_reg *da = (struct ofp_exp_action_inc_state_reg *) dst;
+
+            da->header.header.experimenter = htonl(exp->experimenter_id);
+            da->header.act_type = htonl(ext->act_type);
+            memset(da->header.pad, 0x00, 4);
+            da->table_id = sa->table_id;
+            da->reg = sa->reg;
+            da->flags = sa->flags;
+            memset(da->pad, 0x00, 5);
+            da->value = hton64(sa->value);
+            dst->len = htons(sizeof(struct ofp_exp_action_inc_state_reg));
+
+            return sizeof(struct ofp_exp_action_inc_state_reg);
+        }
+        case (OFPAT_EXP_SET_STATE_REG):
+        {
+            struct ofl_exp_action_set_state_reg *sa = (struct ofl_exp_action_set_state_reg *) ext;
+            struct ofp_exp_action_set_state_reg *da = (struct ofp_exp_action_set_state_reg *) dst;
+
+            da->header.header.experimenter = htonl(exp->experimenter_id);
+            da->header.act_type = htonl(ext->act_type);
+            memset(da->header.pad, 0x00, 4);
+            da->table_id = sa->table_id;
+            da->reg = sa->reg;
+            memset(da->pad, 0x00, 6);
+            da->value = hton64(sa->value);
+            dst->len = htons(sizeof(struct ofp_exp_action_set_state_reg));
+
+            return sizeof(struct ofp_exp_action_set_state_reg);
+        }
+        case (OFPAT_EXP_CMP_SET_STATE):
+        {
+            struct ofl_exp_action_cmp_set_state *sa = (struct ofl_exp_action_cmp_set_state *) ext;
+            struct ofp_exp_action_cmp_set_state *da = (struct ofp_exp_action_cmp_set_state *) dst;
+
+            da->header.header.experimenter = htonl(exp->experimenter_id);
+            da->header.act_type = htonl(ext->act_type);
+            memset(da->header.pad, 0x00, 4);
+            da->table_id = sa->table_id;
+            da->reg = sa->reg;
+            da->cmp = sa->cmp;
+            memset(da->pad, 0x00, 5);
+            da->value = hton64(sa->value);
+            da->state = htonl(sa->state);
+            da->state_mask = htonl(sa->state_mask);
+            dst->len = htons(sizeof(struct ofp_exp_action_cmp_set_state));
+
+            return sizeof(struct ofp_exp_action_cmp_set_state);
+        }
         default:
             return 0;
     }
@@ -436,6 +975,12 @@ ofl_exp_openstate_act_ofp_len(struct ofl_action_header const *act)
             return sizeof(struct ofp_exp_action_set_state);
         case (OFPAT_EXP_SET_GLOBAL_STATE):
             return sizeof(struct ofp_exp_action_set_global_state);
+        case (OFPAT_EXP_INC_STATE_REG):
+            return sizeof(struct ofp_exp_action_inc_state_reg);
+        case (OFPAT_EXP_SET_STATE_REG):
+            return sizeof(struct ofp_exp_action_set_state_reg);
+        case (OFPAT_EXP_CMP_SET_STATE):
+            return sizeof(struct ofp_exp_action_cmp_set_state);
         default:
             return 0;
     }
@@ -466,6 +1011,32 @@ ofl_exp_openstate_act_to_string(struct ofl_action_header const *act)
             sprintf(string, "{set_global_state=[global_state=%s]}", string_value);
             return string;
         }
+        case (OFPAT_EXP_INC_STATE_REG):
+        {
+            struct ofl_exp_action_inc_state_reg *a = (struct ofl_exp_action_inc_state_reg *)ext;
+            char *string = malloc(100);
+            if (a->flags & OFPSRF_PKT_LEN)
+                sprintf(string, "{inc_state_reg=[table_id=\"%u\",reg=\"%u\",value=\"pkt_len\"]}", a->table_id, a->reg);
+            else
+                sprintf(string, "{inc_state_reg=[table_id=\"%u\",reg=\"%u\",value=\"%"PRIu64"\"]}", a->table_id, a->reg, a->value);
+            return string;
+        }
+        case (OFPAT_EXP_SET_STATE_REG):
+        {
+            struct ofl_exp_action_set_state_reg *a = (struct ofl_exp_action_set_state_reg *)ext;
+            char *string = malloc(100);
+            sprintf(string, "{set_state_reg=[table_id=\"%u\",reg=\"%u\",value=\"%"PRIu64"\"]}", a->table_id, a->reg, a->value);
+            return string;
+        }
+        case (OFPAT_EXP_CMP_SET_STATE):
+        {
+            static char const *cmps[] = {"==", "!=", "<", "<=", ">", ">="};
+            struct ofl_exp_action_cmp_set_state *a = (struct ofl_exp_action_cmp_set_state *)ext;
+            char *string = malloc(150);
+            sprintf(string, "{cmp_set_state=[table_id=\"%u\",reg=\"%u\",cmp=\"%s\",value=\"%"PRIu64"\",state=\"%u\",state_mask=\"%"PRIu32"\"]}",
+                    a->table_id, a->reg, a->cmp <= OFPSRC_GE ? cmps[a->cmp] : "?", a->value, a->state, a->state_mask);
+            return string;
+        }
     }
     return NULL;
 }
@@ -480,15 +1051,20 @@ ofl_exp_openstate_act_free(struct ofl_action_header *act)
         case (OFPAT_EXP_SET_STATE):
         {
             struct ofl_exp_action_set_state *a = (struct ofl_exp_action_set_state *)ext;
-            free(a);
+            ofl_free(a);
             break;
         }
         case (OFPAT_EXP_SET_GLOBAL_STATE):
         {
             struct ofl_exp_action_set_global_state *a = (struct ofl_exp_action_set_global_state *)ext;
-            free(a);
+            ofl_free(a);
             break;
         }
+        case (OFPAT_EXP_INC_STATE_REG):
+        case (OFPAT_EXP_SET_STATE_REG):
+        case (OFPAT_EXP_CMP_SET_STATE):
+            ofl_free(ext);
+            break;
         default: {
             OFL_LOG_WARN(LOG_MODULE, "Trying to free unknown Openstate Experimenter action.");
         }
@@ -540,6 +1116,27 @@ ofl_exp_openstate_stats_req_pack(struct ofl_msg_multipart_request_experimenter c
             exp_header -> experimenter = htonl(OPENSTATE_VENDOR_ID);
             exp_header -> exp_type = htonl(OFPMP_EXP_STATE_STATS_NUM);
             stats->table_id = msg->table_id;
+            stats->get_from_state = msg->get_from_state;
+            memset(stats->pad, 0x00, 2);
+            stats->state = htonl(msg->state);
+
+            return 0;
+        }
+        case (OFPMP_EXP_STATE_TABLE_STATS):
+        {
+            struct ofl_exp_msg_multipart_request_state_table *msg = (struct ofl_exp_msg_multipart_request_state_table *)e;
+            struct ofp_multipart_request *req;
+            struct ofp_exp_state_table_stats_request *stats;
+            struct ofp_experimenter_stats_header *exp_header;
+            *buf_len = sizeof(struct ofp_multipart_request) + sizeof(struct ofp_exp_state_table_stats_request);
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            req = (struct ofp_multipart_request *)(*buf);
+            stats = (struct ofp_exp_state_table_stats_request *)req->body;
+            exp_header = (struct ofp_experimenter_stats_header *)stats;
+            exp_header -> experimenter = htonl(OPENSTATE_VENDOR_ID);
+            exp_header -> exp_type = htonl(OFPMP_EXP_STATE_TABLE_STATS);
+            stats->table_id = msg->table_id;
             memset(stats->pad, 0x00, 7);
 
             return 0;
@@ -633,6 +1230,33 @@ ofl_exp_openstate_stats_reply_pack(struct ofl_msg_multipart_reply_experimenter c
             stats->count=htonl(msg->count);
             return 0;
         }
+        case (OFPMP_EXP_STATE_TABLE_STATS):
+        {
+            struct ofl_exp_msg_multipart_reply_state_table *msg = (struct ofl_exp_msg_multipart_reply_state_table *)e;
+            struct ofp_multipart_reply *resp;
+            struct ofp_exp_state_table_stats *stats;
+            struct ofp_experimenter_stats_header * exp_header;
+
+            *buf_len = sizeof(struct ofp_multipart_reply) + sizeof(struct ofp_exp_state_table_stats);
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            resp = (struct ofp_multipart_reply *)(*buf);
+            stats = (struct ofp_exp_state_table_stats *)resp->body;
+            exp_header = (struct ofp_experimenter_stats_header *)stats;
+
+            exp_header->experimenter = htonl(OPENSTATE_VENDOR_ID);
+            exp_header->exp_type = htonl(OFPMP_EXP_STATE_TABLE_STATS);
+            stats->table_id = msg->table_id;
+            stats->eviction = msg->eviction;
+            memset(stats->pad, 0x00, 2);
+            stats->count = htonl(msg->count);
+            stats->max_entries = htonl(msg->max_entries);
+            memset(stats->pad2, 0x00, 4);
+            stats->bytes = hton64(msg->bytes);
+            stats->max_bytes = hton64(msg->max_bytes);
+            stats->evictions = hton64(msg->evictions);
+            return 0;
+        }
         default:
             return -1;
     }
@@ -660,11 +1284,11 @@ ofl_exp_openstate_stats_req_unpack(struct ofp_multipart_request const *os, uint8
             *len -= ((sizeof(struct ofp_exp_state_stats_request)) - sizeof(struct ofp_match));
 
             sm = (struct ofp_exp_state_stats_request *)ext;
-            dm = (struct ofl_exp_msg_multipart_request_state *) malloc(sizeof(struct ofl_exp_msg_multipart_request_state));
+            dm = (struct ofl_exp_msg_multipart_request_state *) ofl_malloc(sizeof(struct ofl_exp_msg_multipart_request_state));
 
             if (sm->table_id != OFPTT_ALL && sm->table_id >= PIPELINE_TABLES) {
                  OFL_LOG_WARN(LOG_MODULE, "Received MULTIPART REQUEST STATE message has invalid table id (%d).", sm->table_id );
-                 free(dm);
+                 ofl_free(dm);
                  return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
             }
             dm->header.type = ntohl(ext->exp_type);
@@ -675,7 +1299,7 @@ ofl_exp_openstate_stats_req_unpack(struct ofp_multipart_request const *os, uint8
             match_pos = sizeof(struct ofp_multipart_request) + sizeof(struct ofp_exp_state_stats_request) - 4;
             error = ofl_structs_match_unpack(&(sm->match),buf + match_pos, len, &(dm->match), check_prereq, exp);
             if (error) {
-                free(dm);
+                ofl_free(dm);
                 return error;
             }
 
@@ -688,26 +1312,50 @@ ofl_exp_openstate_stats_req_unpack(struct ofp_multipart_request const *os, uint8
             struct ofl_exp_msg_multipart_request_state_num *dm;
 
             sm = (struct ofp_exp_state_stats_num_request *)ext;
-            dm = (struct ofl_exp_msg_multipart_request_state_num *) malloc(sizeof(struct ofl_exp_msg_multipart_request_state_num));
+            dm = (struct ofl_exp_msg_multipart_request_state_num *) ofl_malloc(sizeof(struct ofl_exp_msg_multipart_request_state_num));
 
             //TODO: up to now we allow just single table statistics ()
             if (sm->table_id == OFPTT_ALL || sm->table_id >= PIPELINE_TABLES) {
                  OFL_LOG_WARN(LOG_MODULE, "Received MULTIPART REQUEST STATE message has invalid table id (%d).", sm->table_id );
-                 free (dm);
+                 ofl_free(dm);
                  return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
             }
 
             dm->header.type = ntohl(ext->exp_type);
             dm->header.header.experimenter_id = ntohl(ext->experimenter);
             dm->table_id = sm->table_id;
+            dm->get_from_state = sm->get_from_state;
+            dm->state = ntohl(sm->state);
             *len -= sizeof(struct ofp_exp_state_stats_num_request);
             *msg = (struct ofl_msg_multipart_request_header *)dm;
             return 0;
         }
+        case (OFPMP_EXP_STATE_TABLE_STATS):
+        {
+            struct ofp_exp_state_table_stats_request *sm;
+            struct ofl_exp_msg_multipart_request_state_table *dm;
+
+            if (*len < sizeof(struct ofp_exp_state_table_stats_request)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received STATE TABLE stats request has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            sm = (struct ofp_exp_state_table_stats_request *)ext;
+            if (sm->table_id >= PIPELINE_TABLES) {
+                 OFL_LOG_WARN(LOG_MODULE, "Received MULTIPART REQUEST STATE TABLE message has invalid table id (%d).", sm->table_id );
+                 return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
+            }
+            dm = (struct ofl_exp_msg_multipart_request_state_table *) ofl_malloc(sizeof(struct ofl_exp_msg_multipart_request_state_table));
+            dm->header.type = ntohl(ext->exp_type);
+            dm->header.header.experimenter_id = ntohl(ext->experimenter);
+            dm->table_id = sm->table_id;
+            *len -= sizeof(struct ofp_exp_state_table_stats_request);
+            *msg = (struct ofl_msg_multipart_request_header *)dm;
+            return 0;
+        }
         case (OFPMP_EXP_GLOBAL_STATE_STATS):
         {
             struct ofl_exp_msg_multipart_request_global_state *dm;
-            dm = (struct ofl_exp_msg_multipart_request_global_state *) malloc(sizeof(struct ofl_exp_msg_multipart_request_global_state));
+            dm = (struct ofl_exp_msg_multipart_request_global_state *) ofl_malloc(sizeof(struct ofl_exp_msg_multipart_request_global_state));
             dm->header.type = ntohl(ext->exp_type);
             dm->header.header.experimenter_id = ntohl(ext->experimenter);
             *len -= sizeof(struct ofp_exp_global_state_stats_request);
@@ -734,16 +1382,16 @@ ofl_exp_openstate_stats_reply_unpack(struct ofp_multipart_reply const *os, uint8
 
             // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
             stat = (struct ofp_exp_state_stats *) (os->body + sizeof(struct ofp_experimenter_stats_header));
-            dm = (struct ofl_exp_msg_multipart_reply_state *)malloc(sizeof(struct ofl_exp_msg_multipart_reply_state));
+            dm = (struct ofl_exp_msg_multipart_reply_state *)ofl_malloc(sizeof(struct ofl_exp_msg_multipart_reply_state));
             dm->header.type = ntohl(ext->exp_type);
             dm->header.header.experimenter_id = ntohl(ext->experimenter);
             *len -= (sizeof(struct ofp_experimenter_stats_header));
             error = ofl_utils_count_ofp_state_stats(stat, *len, &dm->stats_num);
             if (error) {
-                free(dm);
+                ofl_free(dm);
                 return error;
             }
-            dm->stats = (struct ofl_exp_state_stats **)malloc(dm->stats_num * sizeof(struct ofl_exp_state_stats *));
+            dm->stats = (struct ofl_exp_state_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_exp_state_stats *));
 
             ini_len = *len;
             ptr = buf + sizeof(struct ofp_multipart_reply) + sizeof(struct ofp_experimenter_stats_header);
@@ -752,7 +1400,7 @@ ofl_exp_openstate_stats_reply_unpack(struct ofp_multipart_reply const *os, uint8
                 ptr += ini_len - *len;
                 ini_len = *len;
                 if (error) {
-                    free (dm);
+                    ofl_free(dm);
                     return error;
                 }
                 stat = (struct ofp_exp_state_stats *)((uint8_t *)stat + ntohs(stat->length));
@@ -773,7 +1421,7 @@ ofl_exp_openstate_stats_reply_unpack(struct ofp_multipart_reply const *os, uint8
             *len -= sizeof(struct ofp_exp_global_state_stats);
 
             sm = (struct ofp_exp_global_state_stats *)os->body;
-            dm = (struct ofl_exp_msg_multipart_reply_global_state *) malloc(sizeof(struct ofl_exp_msg_multipart_reply_global_state));
+            dm = (struct ofl_exp_msg_multipart_reply_global_state *) ofl_malloc(sizeof(struct ofl_exp_msg_multipart_reply_global_state));
             dm->header.type = ntohl(ext->exp_type);
             dm->header.header.experimenter_id = ntohl(ext->experimenter);
             dm->global_state =  ntohl(sm->global_state);
@@ -793,7 +1441,7 @@ ofl_exp_openstate_stats_reply_unpack(struct ofp_multipart_reply const *os, uint8
             *len -= sizeof(struct ofp_exp_state_stats_num);
 
             sm = (struct ofp_exp_state_stats_num *)os->body;
-            dm = (struct ofl_exp_msg_multipart_reply_state_num *) malloc(sizeof(struct ofl_exp_msg_multipart_reply_state_num));
+            dm = (struct ofl_exp_msg_multipart_reply_state_num *) ofl_malloc(sizeof(struct ofl_exp_msg_multipart_reply_state_num));
             dm->header.type = ntohl(ext->exp_type);
             dm->header.header.experimenter_id = ntohl(ext->experimenter);
             dm->count =  ntohl(sm->count);
@@ -801,6 +1449,32 @@ ofl_exp_openstate_stats_reply_unpack(struct ofp_multipart_reply const *os, uint8
             *msg = (struct ofl_msg_multipart_reply_header *)dm;
             return 0;
         }
+        case (OFPMP_EXP_STATE_TABLE_STATS):
+        {
+            struct ofp_exp_state_table_stats *sm;
+            struct ofl_exp_msg_multipart_reply_state_table *dm;
+
+            if (*len < sizeof(struct ofp_exp_state_table_stats)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received STATE TABLE stats reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len -= sizeof(struct ofp_exp_state_table_stats);
+
+            sm = (struct ofp_exp_state_table_stats *)os->body;
+            dm = (struct ofl_exp_msg_multipart_reply_state_table *) ofl_malloc(sizeof(struct ofl_exp_msg_multipart_reply_state_table));
+            dm->header.type = ntohl(ext->exp_type);
+            dm->header.header.experimenter_id = ntohl(ext->experimenter);
+            dm->table_id = sm->table_id;
+            dm->eviction = sm->eviction;
+            dm->count = ntohl(sm->count);
+            dm->max_entries = ntohl(sm->max_entries);
+            dm->bytes = ntoh64(sm->bytes);
+            dm->max_bytes = ntoh64(sm->max_bytes);
+            dm->evictions = ntoh64(sm->evictions);
+
+            *msg = (struct ofl_msg_multipart_reply_header *)dm;
+            return 0;
+        }
         default:
             return -1;
     }
@@ -834,6 +1508,18 @@ ofl_exp_openstate_stats_request_to_string(struct ofl_msg_multipart_request_exper
             ofl_exp_stats_type_print(stream, e->type);
             fprintf(stream, "\", table=\"");
             ofl_table_print(stream, msg->table_id);
+            if (msg->get_from_state)
+                fprintf(stream, "\", state=\"%u", msg->state);
+            break;
+        }
+        case (OFPMP_EXP_STATE_TABLE_STATS):
+        {
+            struct ofl_exp_msg_multipart_request_state_table *msg = (struct ofl_exp_msg_multipart_request_state_table *)e;
+            fprintf(stream, "{exp_type=\"");
+            ofl_exp_stats_type_print(stream, e->type);
+            fprintf(stream, "\", table=\"");
+            ofl_table_print(stream, msg->table_id);
+            fprintf(stream, "\"");
             break;
         }
         case (OFPMP_EXP_GLOBAL_STATE_STATS):
@@ -898,7 +1584,20 @@ ofl_exp_openstate_stats_reply_to_string(struct ofl_msg_multipart_reply_experimen
 
             fprintf(stream, "{stat_exp_type=\"");
             ofl_exp_stats_type_print(stream, e->type);
-            fprintf(stream, "\", count=\"%"PRIu32"\"",msg->count);
+            fprintf(stream, "\", count=\"%"PRIu32"\"",msg->count);
+            break;
+        }
+        case (OFPMP_EXP_STATE_TABLE_STATS):
+        {
+            struct ofl_exp_msg_multipart_reply_state_table *msg = (struct ofl_exp_msg_multipart_reply_state_table *)e;
+
+            fprintf(stream, "{stat_exp_type=\"");
+            ofl_exp_stats_type_print(stream, e->type);
+            fprintf(stream, "\", table=\"%u\", eviction=\"", msg->table_id);
+            ofl_exp_state_eviction_print(stream, msg->eviction);
+            fprintf(stream, "\", count=\"%"PRIu32"\", max_entries=\"%"PRIu32"\", "
+                            "bytes=\"%"PRIu64"\", max_bytes=\"%"PRIu64"\", evictions=\"%"PRIu64"\"",
+                    msg->count, msg->max_entries, msg->bytes, msg->max_bytes, msg->evictions);
             break;
         }
     }
@@ -915,19 +1614,25 @@ ofl_exp_openstate_stats_req_free(struct ofl_msg_multipart_request_header *msg)
         case (OFPMP_EXP_STATE_STATS):
         {
             struct ofl_exp_msg_multipart_request_state *a = (struct ofl_exp_msg_multipart_request_state *) ext;
-            free(a);
+            ofl_free(a);
             break;
         }
         case (OFPMP_EXP_STATE_STATS_NUM):
         {
             struct ofl_exp_msg_multipart_request_state_num *a = (struct ofl_exp_msg_multipart_request_state_num *) ext;
-            free(a);
+            ofl_free(a);
+            break;
+        }
+        case (OFPMP_EXP_STATE_TABLE_STATS):
+        {
+            struct ofl_exp_msg_multipart_request_state_table *a = (struct ofl_exp_msg_multipart_request_state_table *) ext;
+            ofl_free(a);
             break;
         }
         case (OFPMP_EXP_GLOBAL_STATE_STATS):
         {
             struct ofl_exp_msg_multipart_request_global_state *a = (struct ofl_exp_msg_multipart_request_global_state *) ext;
-            free(a);
+            ofl_free(a);
             break;
         }
         default: {
@@ -946,19 +1651,25 @@ ofl_exp_openstate_stats_reply_free(struct ofl_msg_multipart_reply_header *msg)
         case (OFPMP_EXP_STATE_STATS):
         {
             struct ofl_exp_msg_multipart_reply_state *a = (struct ofl_exp_msg_multipart_reply_state *) ext;
-            free(a);
+            ofl_free(a);
             break;
         }
         case (OFPMP_EXP_GLOBAL_STATE_STATS):
         {
             struct ofl_exp_msg_multipart_reply_global_state *a = (struct ofl_exp_msg_multipart_reply_global_state *) ext;
-            free(a);
+            ofl_free(a);
             break;
         }
         case (OFPMP_EXP_STATE_STATS_NUM):
         {
             struct ofl_exp_msg_multipart_reply_state_num *a = (struct ofl_exp_msg_multipart_reply_state_num *) ext;
-            free(a);
+            ofl_free(a);
+            break;
+        }
+        case (OFPMP_EXP_STATE_TABLE_STATS):
+        {
+            struct ofl_exp_msg_multipart_reply_state_table *a = (struct ofl_exp_msg_multipart_reply_state_table *) ext;
+            ofl_free(a);
             break;
         }
         default: {
@@ -1303,7 +2014,7 @@ ofl_exp_openstate_inst_unpack (struct ofp_instruction const *src, size_t *len, s
     switch (ntohl(openstate_exp->instr_type)) {
         default: {
             struct ofl_instruction_experimenter *di;
-            di = (struct ofl_instruction_experimenter *)malloc(sizeof(struct ofl_instruction_experimenter));
+            di = (struct ofl_instruction_experimenter *)ofl_malloc(sizeof(struct ofl_instruction_experimenter));
             di->experimenter_id  = ntohl(exp->experimenter); //OPENSTATE_VENDOR_ID
             inst = (struct ofl_instruction_header *)di;
             OFL_LOG_WARN(LOG_MODULE, "The received OPENSTATE instruction type (%u) is invalid.", ntohs(openstate_exp->instr_type));
@@ -1335,7 +2046,7 @@ ofl_exp_openstate_inst_free (struct ofl_instruction_header *i) {
                 OFL_LOG_WARN(LOG_MODULE, "Unknown OPENSTATE instruction type. Perhaps not freed correctly");
             }
         }
-    free(i);
+    ofl_free(i);
     return 1;
 }
 
@@ -1377,17 +2088,436 @@ ofl_exp_openstate_inst_to_string (struct ofl_instruction_header const *i)
 
 int __extract_key(uint8_t *, struct key_extractor *, struct packet *);
 
+static uint32_t
+key_extractor_len(struct key_extractor const *extractor)
+{
+    uint32_t len = 0;
+    int i;
+
+    for (i=0; i<extractor->field_count; i++)
+        len += OXM_LENGTH(extractor->fields[i]);
+    return len;
+}
+
+/* Sets the copies of 'extractor' from its fields.  The fields of the
+ * headers the parser keeps a pointer to are read from the packet, the
+ * others from its match. */
+static void
+key_extractor_compile(struct key_extractor *extractor)
+{
+    int i;
+
+    extractor->compiled = true;
+    for (i=0; i<extractor->field_count; i++) {
+        struct key_copy *c = &extractor->copies[i];
+
+        c->header = extractor->fields[i];
+        c->len = OXM_LENGTH(c->header);
+        c->offset = 0;
+        c->swap = false;
+        switch (c->header) {
+            case OXM_OF_IN_PORT:  c->src = STATE_KEY_IN_PORT; break;
+            case OXM_OF_ETH_DST:  c->src = STATE_KEY_ETH;  c->offset = offsetof(struct eth_header, eth_dst); break;
+            case OXM_OF_ETH_SRC:  c->src = STATE_KEY_ETH;  c->offset = offsetof(struct eth_header, eth_src); break;
+            case OXM_OF_IPV4_SRC: c->src = STATE_KEY_IPV4; c->offset = offsetof(struct ip_header, ip_src); break;
+            case OXM_OF_IPV4_DST: c->src = STATE_KEY_IPV4; c->offset = offsetof(struct ip_header, ip_dst); break;
+            case OXM_OF_IPV6_SRC: c->src = STATE_KEY_IPV6; c->offset = offsetof(struct ipv6_header, ipv6_src); break;
+            case OXM_OF_IPV6_DST: c->src = STATE_KEY_IPV6; c->offset = offsetof(struct ipv6_header, ipv6_dst); break;
+            case OXM_OF_IP_PROTO: c->src = STATE_KEY_IP_PROTO; break;
+            case OXM_OF_TCP_SRC:  c->src = STATE_KEY_TCP;  c->offset = offsetof(struct tcp_header, tcp_src); c->swap = true; break;
+            case OXM_OF_TCP_DST:  c->src = STATE_KEY_TCP;  c->offset = offsetof(struct tcp_header, tcp_dst); c->swap = true; break;
+            case OXM_OF_UDP_SRC:  c->src = STATE_KEY_UDP;  c->offset = offsetof(struct udp_header, udp_src); c->swap = true; break;
+            case OXM_OF_UDP_DST:  c->src = STATE_KEY_UDP;  c->offset = offsetof(struct udp_header, udp_dst); c->swap = true; break;
+            default:
+                c->src = STATE_KEY_MATCH;
+                extractor->compiled = false;
+                break;
+        }
+    }
+}
+
+static bool
+key_extractor_equal(struct key_extractor const *a, struct key_extractor const *b)
+{
+    return a->field_count == b->field_count
+           && !memcmp(a->fields, b->fields, a->field_count * sizeof a->fields[0]);
+}
+
+/* State keys are zero padded up to MAX_STATE_KEY_LEN, so the hash and the
+ * compare may read whole words past the table's key_len.  The key lengths
+ * of the usual extractors (IPv4 address, MAC address, IPv4 pair, 5-tuple,
+ * IPv6 pair with ports...) are switched on to let the compiler unroll the
+ * loads. */
+#ifdef CRC_HW
+static inline CRC_HW_TARGET uint32_t
+state_key_crc(uint8_t const *key, size_t len)
+{
+    uint32_t crc = crc_init();
+    uint64_t w;
+    uint32_t v;
+
+    for (; len >= sizeof w; len -= sizeof w, key += sizeof w) {
+        memcpy(&w, key, sizeof w);
+        crc = crc_update_hw64(crc, w);
+    }
+    if (len > sizeof v) {
+        memcpy(&w, key, sizeof w);
+        crc = crc_update_hw64(crc, w);
+    } else if (len) {
+        memcpy(&v, key, sizeof v);
+        crc = crc_update_hw32(crc, v);
+    }
+    return crc;
+}
+
+static CRC_HW_TARGET uint32_t
+state_key_hash_hw(uint8_t const *key, size_t len)
+{
+    switch (len) {
+    case 4:  return state_key_crc(key, 4);
+    case 6:  return state_key_crc(key, 6);
+    case 8:  return state_key_crc(key, 8);
+    case 12: return state_key_crc(key, 12);
+    case 13: return state_key_crc(key, 13);
+    case 16: return state_key_crc(key, 16);
+    case 36: return state_key_crc(key, 36);
+    default: return state_key_crc(key, len);
+    }
+}
+#endif
+
+static inline uint32_t
+state_key_hash(struct state_table const *table, uint8_t const *key)
+{
+#ifdef CRC_HW
+    if (crc_hw_available())
+        return state_key_hash_hw(key, table->key_len);
+#endif
+    return hash_bytes(key, table->key_len, 0);
+}
+
+static inline bool
+state_key_equal(struct state_table const *table, uint8_t const *a, uint8_t const *b)
+{
+    switch (table->key_len) {
+    case 4:  return !memcmp(a, b, 4);
+    case 6:  return !memcmp(a, b, 8);
+    case 8:  return !memcmp(a, b, 8);
+    case 12: return !memcmp(a, b, 12);
+    case 13: return !memcmp(a, b, 16);
+    case 16: return !memcmp(a, b, 16);
+    case 36: return !memcmp(a, b, 36);
+    default: return !memcmp(a, b, table->key_len);
+    }
+}
+
+/* Returns the shard of 'table' for keys with 'hash'. */
+static inline struct state_shard *
+state_table_shard(struct state_table *table, uint32_t hash)
+{
+    return &table->shards[hash >> (32 - STATE_TABLE_SHARD_BITS)];
+}
+
+/* Locks all the shards of 'table', for a change or a walk of the whole
+ * table. */
+static void
+state_table_lock(struct state_table *table)
+{
+    int i;
+
+    for (i = 0; i < STATE_TABLE_SHARDS; i++)
+        pthread_mutex_lock(&table->shards[i].mutex);
+}
+
+static void
+state_table_unlock(struct state_table *table)
+{
+    int i;
+
+    for (i = STATE_TABLE_SHARDS - 1; i >= 0; i--)
+        pthread_mutex_unlock(&table->shards[i].mutex);
+}
+
+/* Returns the 'seq' of 'table' to build a key from its extractors with,
+ * waiting for a change of the extractors under way to end. */
+static unsigned int
+state_table_read_begin(struct state_table *table)
+{
+    unsigned int seq;
+
+    while ((seq = __atomic_load_n(&table->seq, __ATOMIC_ACQUIRE)) & 1) {
+        /* The change holds all the shards. */
+        pthread_mutex_lock(&table->shards[0].mutex);
+        pthread_mutex_unlock(&table->shards[0].mutex);
+    }
+    return seq;
+}
+
+/* Returns true if the extractors of 'table' changed since 'seq'. */
+static inline bool
+state_table_read_retry(struct state_table *table, unsigned int seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&table->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/* Locks and returns the shard of 'key', built from the extractors of 'table'
+ * as of 'seq', and stores the hash of the key in '*hash'.  Returns NULL if
+ * the extractors changed since, and the key must be built again. */
+static struct state_shard *
+state_table_lock_key(struct state_table *table, uint8_t const *key, unsigned int seq, uint32_t *hash)
+{
+    struct state_shard *shard;
+
+    *hash = state_key_hash(table, key);
+    shard = state_table_shard(table, *hash);
+    pthread_mutex_lock(&shard->mutex);
+    if (__atomic_load_n(&table->seq, __ATOMIC_RELAXED) == seq)
+        return shard;
+    pthread_mutex_unlock(&shard->mutex);
+    return NULL;
+}
+
+static struct state_entry *
+state_shard_find(struct state_table const *table, struct state_shard *shard, uint8_t const *key, uint32_t hash)
+{
+    struct state_entry *e;
+
+    HMAP_FOR_EACH_WITH_HASH(e, struct state_entry,
+        hmap_node, hash, &shard->entries){
+            if (state_key_equal(table, key, e->key))
+                return e;
+    }
+    return NULL;
+}
+
+static struct state_group *
+state_shard_group(struct state_shard const *shard, uint32_t state)
+{
+    struct state_group *g;
+
+    HMAP_FOR_EACH_WITH_HASH(g, struct state_group,
+        node, hash_int(state, 0), &shard->groups){
+            if (g->state == state)
+                return g;
+    }
+    return NULL;
+}
+
+/* Adds 'e' to the group of its state in 'shard'. */
+static void
+state_entry_group(struct state_shard *shard, struct state_entry *e)
+{
+    struct state_group *g = state_shard_group(shard, e->state);
+
+    if (g == NULL) {
+        g = xmalloc(sizeof *g);
+        g->state = e->state;
+        g->n_entries = 0;
+        list_init(&g->entries);
+        hmap_insert(&shard->groups, &g->node, hash_int(e->state, 0));
+    }
+    list_push_back(&g->entries, &e->state_node);
+    g->n_entries++;
+}
+
+static void
+state_entry_ungroup(struct state_shard *shard, struct state_entry *e)
+{
+    struct state_group *g = state_shard_group(shard, e->state);
+
+    list_remove(&e->state_node);
+    if (--g->n_entries == 0) {
+        hmap_remove(&shard->groups, &g->node);
+        free(g);
+    }
+}
+
+/* Moves 'e' of 'shard' to 'state'. */
+static void
+state_entry_set_state(struct state_shard *shard, struct state_entry *e, uint32_t state)
+{
+    if (e->state != state) {
+        state_entry_ungroup(shard, e);
+        e->state = state;
+        state_entry_group(shard, e);
+    }
+}
+
+/* Links 'e' in the slot of 'wheel' its timer_tick falls in: level 0 if it is
+ * due within STATE_WHEEL_SLOTS ticks, and so on.  Past the top level the
+ * entry goes in the last slot reached, and is rescheduled from there. */
+static void
+state_wheel_insert(struct state_wheel *wheel, struct state_entry *e)
+{
+    uint64_t delta = e->timer_tick - wheel->tick;
+    uint64_t tick = e->timer_tick;
+    int level;
+
+    for (level = 0; level < STATE_WHEEL_LEVELS - 1; level++) {
+        if (delta < 1ULL << (STATE_WHEEL_BITS * (level + 1)))
+            break;
+    }
+    if (delta >= 1ULL << (STATE_WHEEL_BITS * STATE_WHEEL_LEVELS))
+        tick = wheel->tick + (1ULL << (STATE_WHEEL_BITS * STATE_WHEEL_LEVELS)) - 1;
+    list_push_back(&wheel->slots[level][(tick >> (STATE_WHEEL_BITS * level)) & (STATE_WHEEL_SLOTS - 1)],
+                   &e->timer_node);
+}
+
+/* Schedules the timeouts of 'e', which has at least one, on the wheel of
+ * 'shard': the timer is due at the earlier of the hard and idle timeouts.
+ * state_table_timeout() skips the wheels without timers, so an empty wheel
+ * is first brought to 'now'. */
+static void
+state_entry_schedule(struct state_shard *shard, struct state_entry *e, uint64_t now)
+{
+    struct state_wheel *wheel = &shard->wheel;
+    uint64_t due = UINT64_MAX;
+
+    if (!wheel->n_timers)
+        wheel->tick = MAX(wheel->tick, now >> STATE_WHEEL_TICK_BITS);
+    if (e->hard_timeout)
+        due = e->remove_at;
+    if (e->idle_timeout)
+        due = MIN(due, e->last_used + e->idle_timeout);
+
+    e->timer_tick = (due + (1 << STATE_WHEEL_TICK_BITS) - 1) >> STATE_WHEEL_TICK_BITS;
+    if (e->timer_tick <= wheel->tick)
+        e->timer_tick = wheel->tick + 1;
+    state_wheel_insert(wheel, e);
+    __atomic_store_n(&wheel->n_timers, wheel->n_timers + 1, __ATOMIC_RELAXED);
+}
+
+static void
+state_entry_unschedule(struct state_shard *shard, struct state_entry *e)
+{
+    list_remove(&e->timer_node);
+    __atomic_store_n(&shard->wheel.n_timers, shard->wheel.n_timers - 1, __ATOMIC_RELAXED);
+}
+
+/* Removes 'e', whose timer is not scheduled, from 'shard' of 'table' and
+ * frees it. */
+static void
+state_entry_remove(struct state_table *table, struct state_shard *shard, struct state_entry *e)
+{
+    hmap_remove_and_shrink(&shard->entries, &e->hmap_node);
+    list_remove(&e->evict_node);
+    state_entry_ungroup(shard, e);
+    __atomic_sub_fetch(&table->n_entries, 1, __ATOMIC_RELAXED);
+    free(e);
+}
+
+/* Re-inserts the entries of 'table', whose shards are all locked, after its
+ * key_len changed: a new hash may put an entry in another shard. */
+static void
+state_table_rehash(struct state_table *table)
+{
+    uint64_t now = __atomic_load_n(&table->now, __ATOMIC_RELAXED);
+    struct list entries;
+    int i;
+
+    list_init(&entries);
+    for (i = 0; i < STATE_TABLE_SHARDS; i++) {
+        struct state_shard *shard = &table->shards[i];
+
+        while (!list_is_empty(&shard->evict)) {
+            struct state_entry *e = CONTAINER_OF(list_pop_front(&shard->evict), struct state_entry, evict_node);
+
+            if (e->hard_timeout || e->idle_timeout)
+                state_entry_unschedule(shard, e);
+            state_entry_ungroup(shard, e);
+            list_push_back(&entries, &e->evict_node);
+        }
+        hmap_destroy(&shard->entries);
+        hmap_init(&shard->entries);
+    }
+    while (!list_is_empty(&entries)) {
+        struct state_entry *e = CONTAINER_OF(list_pop_front(&entries), struct state_entry, evict_node);
+        uint32_t hash = state_key_hash(table, e->key);
+        struct state_shard *shard = state_table_shard(table, hash);
+
+        hmap_insert(&shard->entries, &e->hmap_node, hash);
+        list_push_back(&shard->evict, &e->evict_node);
+        state_entry_group(shard, e);
+        if (e->hard_timeout || e->idle_timeout)
+            state_entry_schedule(shard, e, now);
+    }
+}
+
+/* Runs the timer of 'e' of 'shard', which has fired at 'now'.  The idle
+ * timeout is not rescheduled as packets hit the entry, so it is checked
+ * against last_used here, and the timer put back if the entry has been used
+ * since. */
+static void
+state_entry_expire(struct state_table *table, struct state_shard *shard, struct state_entry *e, uint64_t now)
+{
+    uint32_t rollback;
+
+    if (e->hard_timeout && now >= e->remove_at)
+        rollback = e->hard_rollback;
+    else if (e->idle_timeout && now >= e->last_used + e->idle_timeout)
+        rollback = e->idle_rollback;
+    else {
+        state_entry_schedule(shard, e, now);
+        return;
+    }
+
+    if (rollback == STATE_DEFAULT) {
+        state_entry_remove(table, shard, e);
+        return;
+    }
+    state_entry_set_state(shard, e, rollback);
+    e->created = now;
+    e->idle_timeout = 0;
+    e->hard_timeout = 0;
+    e->idle_rollback = 0;
+    e->hard_rollback = 0;
+    list_remove(&e->evict_node);
+    list_push_back(&shard->evict, &e->evict_node);
+}
+
+/* Moves the timers of the current slot of 'level' down the wheel, as the
+ * wheel's tick enters it. */
+static void
+state_wheel_cascade(struct state_wheel *wheel, int level)
+{
+    struct list *slot = &wheel->slots[level][(wheel->tick >> (STATE_WHEEL_BITS * level))
+                                             & (STATE_WHEEL_SLOTS - 1)];
+    struct list timers;
+
+    if (list_is_empty(slot))
+        return;
+    list_init(&timers);
+    list_splice(&timers, list_front(slot), slot);
+    while (!list_is_empty(&timers)) {
+        struct state_entry *e = CONTAINER_OF(list_pop_front(&timers), struct state_entry, timer_node);
+
+        state_wheel_insert(wheel, e);
+    }
+}
+
 struct state_table * state_table_create(void)
 {
     struct state_table *table = malloc(sizeof(struct state_table));
+    int i, j, k;
     memset(table, 0, sizeof(*table));
 
-    table->state_entries = (struct hmap) HMAP_INITIALIZER(&table->state_entries);
-    table->hard_entries = (struct hmap) HMAP_INITIALIZER(&table->hard_entries);
-    table->idle_entries = (struct hmap) HMAP_INITIALIZER(&table->idle_entries);
+    table->eviction = OFPSE_LRU;
+    table->now = time_usec();
+
+    for (k = 0; k < STATE_TABLE_SHARDS; k++) {
+        struct state_shard *shard = &table->shards[k];
 
-    /* default state entry */
-    table->default_state_entry.state = STATE_DEFAULT;
+        pthread_mutex_init(&shard->mutex, NULL);
+        hmap_init(&shard->entries);
+        hmap_init(&shard->groups);
+        list_init(&shard->evict);
+        shard->wheel.tick = table->now >> STATE_WHEEL_TICK_BITS;
+        for (i = 0; i < STATE_WHEEL_LEVELS; i++) {
+            for (j = 0; j < STATE_WHEEL_SLOTS; j++)
+                list_init(&shard->wheel.slots[i][j]);
+        }
+    }
 
     table->stateful = 0;
 
@@ -1417,214 +2547,377 @@ state_table_configure_stateful(struct state_table *table, uint8_t stateful)
 
 void state_table_destroy(struct state_table *table)
 {
-    hmap_destroy(&table->state_entries);
-    hmap_destroy(&table->hard_entries);
-    hmap_destroy(&table->idle_entries);
+    struct state_entry *e, *next;
+    int i;
+
+    for (i = 0; i < STATE_TABLE_SHARDS; i++) {
+        struct state_shard *shard = &table->shards[i];
+
+        struct state_group *g, *next_g;
+
+        LIST_FOR_EACH_SAFE (e, next, struct state_entry, evict_node, &shard->evict)
+            free(e);
+        HMAP_FOR_EACH_SAFE (g, next_g, struct state_group, node, &shard->groups)
+            free(g);
+        hmap_destroy(&shard->entries);
+        hmap_destroy(&shard->groups);
+        pthread_mutex_destroy(&shard->mutex);
+    }
     free(table);
 }
-/* having the key extractor field goes to look for these key inside the packet and map to corresponding value and copy the value into buf. */
-int __extract_key(uint8_t *buf, struct key_extractor *extractor, struct packet *pkt)
+/* Returns the field of 'pkt' with 'header', as held in its match, or NULL. */
+static uint8_t const *
+__extract_match_field(struct packet *pkt, uint32_t header)
 {
-    int i, extracted_key_len=0, expected_key_len=0;
     struct ofl_match_tlv *f;
 
-    for (i=0; i<extractor->field_count; i++) {
-        uint32_t type = (int)extractor->fields[i];
-        HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-            hmap_node, hash_int(type, 0), &pkt->handle_std->match.match_fields){
-                if (type == f->header) {
-                    memcpy(&buf[extracted_key_len], f->value, OXM_LENGTH(f->header));
-                    extracted_key_len = extracted_key_len + OXM_LENGTH(f->header);//keeps only 8 last bits of oxm_header that contains oxm_length(in which length of oxm_payload)
-                    break;
-                }
-        }
-        expected_key_len = expected_key_len + OXM_LENGTH(type);
+    HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
+        hmap_node, hash_int(header, 0), &pkt->handle_std->match.match_fields){
+            if (header == f->header)
+                return f->value;
     }
-    /* check if the full key has been extracted: if key is extracted partially or not at all, we cannot access the state table */
-    if (extracted_key_len==expected_key_len)
-        return 1;
-    else
-        return 0;
+    return NULL;
 }
 
-static bool
-state_entry_idle_timeout(struct state_table *table, struct state_entry *entry)
+/* Builds in 'buf' the key of 'pkt' for 'extractor'.  Returns 0 if a field of
+ * the key is not in the packet, as then the state table cannot be accessed.
+ * While the packet's parse is valid, its match holds the fields of the
+ * headers it points to, so these are read from the packet; otherwise the
+ * packet has changed since, and its match is read as before. */
+int __extract_key(uint8_t *buf, struct key_extractor *extractor, struct packet *pkt)
 {
-    bool timeout;
-    struct timeval tv;
-    gettimeofday(&tv,NULL);
-
-    timeout = (entry->stats->idle_timeout != 0) &&
-              (1000000 * tv.tv_sec + tv.tv_usec > entry->last_used + entry->stats->idle_timeout);
+    struct packet_handle_std *handle = pkt->handle_std;
+    struct protocols_std const *proto = handle->proto;
+    size_t offset = 0;
+    int i;
 
-    if (timeout) {
-        hmap_remove_and_shrink(&table->idle_entries, &entry->idle_node);
-        if(entry->stats->hard_timeout > 0)
-            hmap_remove_and_shrink(&table->hard_entries, &entry->hard_node);
+    for (i=0; i<extractor->field_count; i++) {
+        struct key_copy const *c = &extractor->copies[i];
+        uint8_t const *hdr = NULL;
 
+        if (offset + c->len > MAX_STATE_KEY_LEN)
+            return 0;
 
-        if(entry->stats->idle_rollback == STATE_DEFAULT){
-            hmap_remove_and_shrink(&table->state_entries, &entry->hmap_node);
-            entry->state = entry->stats->idle_rollback;
+        if (!handle->valid) {
+            hdr = __extract_match_field(pkt, c->header);
+            if (hdr == NULL)
+                return 0;
+            memcpy(&buf[offset], hdr, c->len);
+            offset += c->len;
+            continue;
         }
-        else{
-            entry->state = entry->stats->idle_rollback;
-            entry->created = 1000000 * tv.tv_sec + tv.tv_usec;
-            entry->stats->idle_timeout = 0;
-            entry->stats->hard_timeout = 0;
-            entry->stats->idle_rollback = 0;
-            entry->stats->hard_rollback = 0;
+
+        switch (c->src) {
+            case STATE_KEY_MATCH:   hdr = __extract_match_field(pkt, c->header); break;
+            case STATE_KEY_IN_PORT: hdr = (uint8_t const *)&pkt->in_port; break;
+            case STATE_KEY_ETH:     hdr = (uint8_t const *)proto->eth; break;
+            case STATE_KEY_IPV4:    hdr = (uint8_t const *)proto->ipv4; break;
+            case STATE_KEY_IPV6:    hdr = (uint8_t const *)proto->ipv6; break;
+            case STATE_KEY_IP_PROTO:
+                if (proto->ipv4 != NULL)
+                    hdr = &proto->ipv4->ip_proto;
+                else if (proto->ipv6 != NULL)
+                    hdr = &proto->ipv6->ipv6_next_hd;
+                break;
+            case STATE_KEY_TCP:     hdr = (uint8_t const *)proto->tcp; break;
+            case STATE_KEY_UDP:     hdr = (uint8_t const *)proto->udp; break;
         }
+        if (hdr == NULL)
+            return 0;
+
+        if (c->swap) {
+            uint16_t v;
+
+            memcpy(&v, hdr + c->offset, sizeof v);
+            v = ntohs(v);
+            memcpy(&buf[offset], &v, sizeof v);
+        } else
+            memcpy(&buf[offset], hdr + c->offset, c->len);
+        offset += c->len;
     }
-    return timeout;
+    return 1;
 }
 
-static bool
-state_entry_hard_timeout(struct state_table *table, struct state_entry *entry)
+void
+state_table_timeout(struct state_table *table, uint64_t now)
 {
-    bool timeout;
-    struct timeval tv;
-    gettimeofday(&tv,NULL);
+    uint64_t tick = now >> STATE_WHEEL_TICK_BITS;
+    int i;
 
-    timeout = (entry->remove_at != 0) && (1000000 * tv.tv_sec + tv.tv_usec > entry->remove_at);
+    __atomic_store_n(&table->now, now, __ATOMIC_RELAXED);
+    for (i = 0; i < STATE_TABLE_SHARDS; i++) {
+        struct state_shard *shard = &table->shards[i];
+        struct state_wheel *wheel = &shard->wheel;
 
-    if (timeout) {
-        hmap_remove_and_shrink(&table->hard_entries, &entry->hard_node);
-        if(entry->stats->idle_timeout > 0)
-            hmap_remove_and_shrink(&table->idle_entries, &entry->idle_node);
+        /* A wheel without timers is brought to date by the next one
+         * scheduled. */
+        if (!__atomic_load_n(&wheel->n_timers, __ATOMIC_RELAXED))
+            continue;
 
-        if(entry->stats->hard_rollback == STATE_DEFAULT){
-            hmap_remove_and_shrink(&table->state_entries, &entry->hmap_node);
-            entry->state = entry->stats->hard_rollback;
-        }
-        else{
-            entry->state = entry->stats->hard_rollback;
-            entry->created = 1000000 * tv.tv_sec + tv.tv_usec;
-            entry->stats->idle_timeout = 0;
-            entry->stats->hard_timeout = 0;
-            entry->stats->idle_rollback = 0;
-            entry->stats->hard_rollback = 0;
+        pthread_mutex_lock(&shard->mutex);
+        while (wheel->tick < tick && wheel->n_timers) {
+            struct list *slot;
+            int level;
+
+            wheel->tick++;
+            for (level = 1; level < STATE_WHEEL_LEVELS; level++) {
+                if (wheel->tick & ((1ULL << (STATE_WHEEL_BITS * level)) - 1))
+                    break;
+                state_wheel_cascade(wheel, level);
+            }
+
+            slot = &wheel->slots[0][wheel->tick & (STATE_WHEEL_SLOTS - 1)];
+            while (!list_is_empty(slot)) {
+                struct state_entry *e = CONTAINER_OF(list_pop_front(slot), struct state_entry, timer_node);
 
+                __atomic_store_n(&wheel->n_timers, wheel->n_timers - 1, __ATOMIC_RELAXED);
+                state_entry_expire(table, shard, e, now);
+            }
         }
+        /* With no timer left there is nothing to step through. */
+        if (!wheel->n_timers)
+            wheel->tick = tick;
+        pthread_mutex_unlock(&shard->mutex);
     }
-    return timeout;
 }
 
-void
-state_table_timeout(struct state_table *table)
+uint64_t
+state_table_next_timeout(struct state_table *table)
 {
-    struct state_entry *entry;
+    uint64_t next = UINT64_MAX;
+    int i;
 
-    /* NOTE: hard timeout entries are ordered by the time they should be removed at,
-     * so if one is not removed, the rest will not be either. */
-    HMAP_FOR_EACH(entry, struct state_entry, hard_node, &table->hard_entries){
-        state_entry_hard_timeout(table, entry);
-    }
+    for (i = 0; i < STATE_TABLE_SHARDS; i++) {
+        struct state_shard *shard = &table->shards[i];
+        struct state_wheel const *wheel = &shard->wheel;
+        uint64_t tick;
 
-    HMAP_FOR_EACH(entry, struct state_entry, idle_node, &table->idle_entries){
-        state_entry_idle_timeout(table, entry);
+        if (!__atomic_load_n(&wheel->n_timers, __ATOMIC_RELAXED))
+            continue;
+
+        /* The next tick with a timer in level 0, or else the next
+         * cascade. */
+        pthread_mutex_lock(&shard->mutex);
+        for (tick = wheel->tick + 1; tick & (STATE_WHEEL_SLOTS - 1); tick++) {
+            if (!list_is_empty(&wheel->slots[0][tick & (STATE_WHEEL_SLOTS - 1)]))
+                break;
+        }
+        pthread_mutex_unlock(&shard->mutex);
+        next = MIN(next, tick << STATE_WHEEL_TICK_BITS);
     }
+    return next;
 }
 
 /*having the read_key, look for the state vaule inside the state_table */
-struct state_entry * state_table_lookup(struct state_table* table, struct packet *pkt)
+void state_table_lookup(struct state_table* table, struct packet *pkt)
 {
-    struct state_entry * e = NULL;
     uint8_t key[MAX_STATE_KEY_LEN] = {0};
-    struct timeval tv;
-
-    if(!__extract_key(key, &table->read_key, pkt))
-    {
-        OFL_LOG_DBG(LOG_MODULE, "lookup key fields not found in the packet's header -> NULL");
-        return NULL;
+    struct state_shard *shard;
+    struct state_entry *e;
+    unsigned int seq;
+    uint32_t hash;
+
+    for (;;) {
+        seq = state_table_read_begin(table);
+        if (!__extract_key(key, &table->read_key, pkt)) {
+            if (state_table_read_retry(table, seq))
+                continue;
+            OFL_LOG_DBG(LOG_MODULE, "lookup key fields not found in the packet's header");
+            return;
+        }
+        shard = state_table_lock_key(table, key, seq, &hash);
+        if (shard != NULL)
+            break;
+        memset(key, 0, sizeof key);
     }
-
-    HMAP_FOR_EACH_WITH_HASH(e, struct state_entry,
-        hmap_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0), &table->state_entries){
-            if (!memcmp(key, e->key, MAX_STATE_KEY_LEN)){
-                OFL_LOG_DBG(LOG_MODULE, "found corresponding state %u",e->state);
-
-                //check if the hard_timeout of matched state entry has expired
-                if ((e->stats->hard_timeout>0) && state_entry_hard_timeout(table,e)) {
-                    if (e->state==STATE_DEFAULT)
-                        e = NULL;
-                    break;
-                }
-                //check if the idle_timeout of matched state entry has expired
-                if ((e->stats->idle_timeout>0) && state_entry_idle_timeout(table,e)) {
-                    if (e->state==STATE_DEFAULT)
-                        e = NULL;
-                    break;
-                }
-                gettimeofday(&tv,NULL);
-                e->last_used = 1000000 * tv.tv_sec + tv.tv_usec;
-                break;
-            }
+    if (table->same_key && pkt->handle_std->valid) {
+        pkt->handle_std->state_table = table;
+        memcpy(pkt->handle_std->state_key, key, table->key_len);
     }
 
-    if (e == NULL)
-    {
-        OFL_LOG_DBG(LOG_MODULE, "not found the corresponding state value\n");
-        return &table->default_state_entry;
+    e = state_shard_find(table, shard, key, hash);
+    if (e != NULL) {
+        OFL_LOG_DBG(LOG_MODULE, "found corresponding state %u",e->state);
+
+        /* Expired entries are rolled back by state_table_timeout(), which
+         * the datapath runs before it takes in packets. */
+        e->last_used = __atomic_load_n(&table->now, __ATOMIC_RELAXED);
+        if (table->eviction == OFPSE_LRU) {
+            list_remove(&e->evict_node);
+            list_push_back(&shard->evict, &e->evict_node);
+        }
+        pkt->state = e->state;
+    } else {
+        OFL_LOG_DBG(LOG_MODULE, "not found the corresponding state value");
+        pkt->state = STATE_DEFAULT;
     }
-    else
-        return e;
+    pkt->has_state = true;
+    pthread_mutex_unlock(&shard->mutex);
 }
-/* having the state value  */
-void state_table_write_state(struct state_entry *entry, struct packet *pkt)
+
+/* Locks and returns the shard of 'key', 'len' bytes received in a state mod
+ * for 'table', copied to 'key' in full.  Returns NULL if the length is not
+ * the one of the update-scope extractor. */
+static struct state_shard *
+state_table_lock_msg_key(struct state_table *table, uint8_t *key, uint8_t const *key_, uint32_t len,
+                         uint32_t *hash)
 {
-    struct  ofl_match_tlv *f;
+    struct state_shard *shard;
 
-    HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-        hmap_node, hash_int(OXM_EXP_STATE,0), &pkt->handle_std->match.match_fields){
-                uint32_t *state = (uint32_t*) (f->value + EXP_ID_LEN);
-                *state = (*state & 0x00000000) | (entry->state);
+    if (len > MAX_STATE_KEY_LEN) {
+        OFL_LOG_WARN(LOG_MODULE, "key extractor length != received key length");
+        return NULL;
+    }
+    memcpy(key, key_, len);
+    do {
+        shard = state_table_lock_key(table, key, state_table_read_begin(table), hash);
+    } while (shard == NULL);
+
+    /* With the shard locked the extractors do not change. */
+    if (key_extractor_len(&table->write_key) != len) {
+        pthread_mutex_unlock(&shard->mutex);
+        OFL_LOG_WARN(LOG_MODULE, "key extractor length != received key length");
+        return NULL;
     }
+    return shard;
 }
-ofl_err state_table_del_state(struct state_table *table, uint8_t *key, uint32_t len) {
+
+ofl_err state_table_del_state(struct state_table *table, uint8_t *key_, uint32_t len) {
+    uint8_t key[MAX_STATE_KEY_LEN] = {0};
+    struct state_shard *shard;
     struct state_entry *e;
-    int i;
-    uint8_t found = 0;
-    uint32_t key_len=0; //update-scope key extractor length
-    struct key_extractor *extractor=&table->write_key;
-    for (i=0; i<extractor->field_count; i++) {
-        uint32_t type = (int)extractor->fields[i];
-        key_len = key_len + OXM_LENGTH(type);
-     }
-    if(key_len != len)
-    {
-        OFL_LOG_WARN(LOG_MODULE, "key extractor length != received key length");
+    uint32_t hash;
+
+    shard = state_table_lock_msg_key(table, key, key_, len, &hash);
+    if (shard == NULL)
         return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+
+    e = state_shard_find(table, shard, key, hash);
+    if (e == NULL) {
+        pthread_mutex_unlock(&shard->mutex);
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_EXP_DEL_FLOW_STATE);
     }
 
-    HMAP_FOR_EACH_WITH_HASH(e, struct state_entry,
-        hmap_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0), &table->state_entries){
-            if (!memcmp(key, e->key, MAX_STATE_KEY_LEN)){
-                hmap_remove_and_shrink(&table->state_entries, &e->hmap_node);
-                found = 1;
-                break;
-            }
+    if (e->hard_timeout || e->idle_timeout)
+        state_entry_unschedule(shard, e);
+    state_entry_remove(table, shard, e);
+    pthread_mutex_unlock(&shard->mutex);
+    return 0;
+}
+
+/* Entries 'table' may hold within its limits. */
+static size_t
+state_table_capacity(struct state_table const *table)
+{
+    size_t capacity = SIZE_MAX;
+
+    if (table->max_entries)
+        capacity = table->max_entries;
+    if (table->max_bytes)
+        capacity = MIN(capacity, table->max_bytes / sizeof(struct state_entry));
+    return capacity;
+}
+
+/* Entries looked at to pick the one evicted under OFPSE_RANDOM. */
+#define STATE_EVICT_SAMPLES 5
+
+/* Returns the least recently used of a few entries of 'shard' taken from
+ * random buckets, which must not all be empty. */
+static struct state_entry *
+state_shard_sample(struct state_shard *shard)
+{
+    struct hmap *map = &shard->entries;
+    struct state_entry *victim = NULL;
+    int i;
+
+    for (i = 0; i < STATE_EVICT_SAMPLES; i++) {
+        size_t bucket = random_uint32() & map->mask;
+        struct state_entry *e;
+
+        while (map->buckets[bucket] == NULL)
+            bucket = (bucket + 1) & map->mask;
+        e = CONTAINER_OF(map->buckets[bucket], struct state_entry, hmap_node);
+        if (victim == NULL || e->last_used < victim->last_used)
+            victim = e;
     }
+    return victim;
+}
+
+/* Returns the entry of 'shard' its eviction policy would drop first, or
+ * NULL if the shard is empty. */
+static struct state_entry *
+state_shard_victim(struct state_table const *table, struct state_shard *shard)
+{
+    if (hmap_is_empty(&shard->entries))
+        return NULL;
+    if (table->eviction == OFPSE_RANDOM)
+        return state_shard_sample(shard);
+    return CONTAINER_OF(list_front(&shard->evict), struct state_entry, evict_node);
+}
+
+/* Releases 'shard', unless it is 'held' by the caller of
+ * state_table_evict(). */
+static inline void
+state_shard_release(struct state_shard *held, struct state_shard *shard)
+{
+    if (held != NULL && shard != held)
+        pthread_mutex_unlock(&shard->mutex);
+}
+
+/* Drops an entry of 'table' as its eviction policy picks it: the earliest
+ * of the victims of the shards, by last use or, under OFPSE_OLDEST, by
+ * creation.  The caller has locked the shard 'held', or all of them if
+ * 'held' is NULL; the other shards are only looked at if they are not busy.
+ * Returns false if there was no entry to drop. */
+static bool
+state_table_evict(struct state_table *table, struct state_shard *held)
+{
+    struct state_shard *victim_shard = NULL;
+    struct state_entry *victim = NULL;
+    int i;
 
-    if (!found){
-        return ofl_error(OFPET_EXPERIMENTER, OFPEC_EXP_DEL_FLOW_STATE);
+    for (i = 0; i < STATE_TABLE_SHARDS; i++) {
+        struct state_shard *shard = &table->shards[i];
+        struct state_entry *e;
+
+        if (held != NULL && shard != held && pthread_mutex_trylock(&shard->mutex))
+            continue;
+        e = state_shard_victim(table, shard);
+        if (e != NULL && (victim == NULL
+                          || (table->eviction == OFPSE_OLDEST ? e->created < victim->created
+                                                              : e->last_used < victim->last_used))) {
+            if (victim_shard != NULL)
+                state_shard_release(held, victim_shard);
+            victim = e;
+            victim_shard = shard;
+        } else
+            state_shard_release(held, shard);
     }
+    if (victim == NULL)
+        return false;
+
+    if (victim->hard_timeout || victim->idle_timeout)
+        state_entry_unschedule(victim_shard, victim);
+    state_entry_remove(table, victim_shard, victim);
+    victim_shard->evictions++;
+    state_shard_release(held, victim_shard);
+    return true;
+}
 
-    HMAP_FOR_EACH_WITH_HASH(e, struct state_entry,
-        hard_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0), &table->hard_entries){
-            if (!memcmp(key, e->key, MAX_STATE_KEY_LEN)){
-                hmap_remove_and_shrink(&table->hard_entries, &e->hard_node);
-                break;
-            }
-    }
+ofl_err
+state_table_set_limits(struct state_table *table, struct ofl_exp_set_table_limits *limits)
+{
+    size_t capacity;
 
-    HMAP_FOR_EACH_WITH_HASH(e, struct state_entry,
-        idle_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0), &table->idle_entries){
-            if (!memcmp(key, e->key, MAX_STATE_KEY_LEN)){
-                hmap_remove_and_shrink(&table->idle_entries, &e->idle_node);
-                break;
-            }
-    }
+    state_table_lock(table);
+    table->eviction = limits->eviction;
+    table->max_entries = limits->max_entries;
+    table->max_bytes = limits->max_bytes;
+
+    capacity = state_table_capacity(table);
+    while (table->n_entries > capacity && state_table_evict(table, NULL))
+        continue;
+    state_table_unlock(table);
     return 0;
 }
 
@@ -1632,10 +2925,14 @@ ofl_err state_table_del_state(struct state_table *table, uint8_t *key, uint32_t
 ofl_err state_table_set_extractor(struct state_table *table, struct key_extractor *ke, int update)
 {
     struct key_extractor *dest;
+    uint32_t key_len;
+
+    state_table_lock(table);
     if (update){
         if (table->read_key.field_count!=0){
             if (table->read_key.field_count != ke->field_count){
                 OFL_LOG_WARN(LOG_MODULE, "Update-scope should provide same length keys of lookup-scope: %d vs %d\n",ke->field_count,table->read_key.field_count);
+                state_table_unlock(table);
                 return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
             }
         }
@@ -1646,158 +2943,544 @@ ofl_err state_table_set_extractor(struct state_table *table, struct key_extracto
         if (table->write_key.field_count!=0){
             if (table->write_key.field_count != ke->field_count){
                 OFL_LOG_WARN(LOG_MODULE, "Lookup-scope should provide same length keys of update-scope: %d vs %d\n",ke->field_count,table->write_key.field_count);
+                state_table_unlock(table);
                 return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
             }
         }
         dest = &table->read_key;
         OFL_LOG_DBG(LOG_MODULE, "Lookup-scope set");
         }
+    __atomic_store_n(&table->seq, table->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
     dest->table_id = ke->table_id;
     dest->field_count = ke->field_count;
     memcpy(dest->fields, ke->fields, sizeof(uint32_t)*ke->field_count);
+    key_extractor_compile(dest);
+    table->same_key = key_extractor_equal(&table->read_key, &table->write_key)
+                      && table->read_key.compiled;
+
+    /* Keys built by both extractors are compared, so the longer one sets
+     * the length.  While there are entries the length only grows, so keys
+     * that differ past a shorter length stay apart. */
+    key_len = MAX(key_extractor_len(&table->read_key), key_extractor_len(&table->write_key));
+    if (table->n_entries)
+        key_len = MAX(key_len, table->key_len);
+    if (key_len != table->key_len) {
+        table->key_len = key_len;
+        state_table_rehash(table);
+    }
+    __atomic_store_n(&table->seq, table->seq + 1, __ATOMIC_RELEASE);
+    state_table_unlock(table);
     return 0;
 }
 
-ofl_err state_table_set_state(struct state_table *table, struct packet *pkt, struct ofl_exp_set_flow_state *msg, struct ofl_exp_action_set_state *act)
+/* Inserts an entry of 'key', with 'hash', in 'state' and without timeouts
+ * in 'shard' of 'table', evicting entries as its limits require.  The
+ * caller has locked 'shard', or all the shards if 'held' is NULL.  Returns
+ * NULL if the limits leave no room for it. */
+static struct state_entry *
+state_shard_new_entry(struct state_table *table, struct state_shard *shard, struct state_shard *held,
+                      uint8_t const *key, uint32_t hash, uint32_t state)
 {
-    uint8_t key[MAX_STATE_KEY_LEN] = {0};
+    uint64_t now = __atomic_load_n(&table->now, __ATOMIC_RELAXED);
     struct state_entry *e;
-    uint32_t state = 0, state_mask = 0;
-    uint32_t idle_rollback = 0, hard_rollback = 0;
-    uint32_t idle_timeout = 0, hard_timeout = 0;
-    uint64_t now;
-    struct timeval tv;
-
-    int i;
-    uint32_t key_len=0; //update-scope key extractor length
-    struct key_extractor *extractor=&table->write_key;
-    for (i=0; i<extractor->field_count; i++)
-    {
-        uint32_t type = (int)extractor->fields[i];
-        key_len = key_len + OXM_LENGTH(type);
-    }
+    size_t capacity;
 
-    if (pkt)
-    {
-        //SET_STATE action
-        state = act->state;
-        state_mask = act->state_mask;
-        idle_rollback = act->idle_rollback;
-        hard_rollback = act->hard_rollback;
-        idle_timeout = act->idle_timeout;
-        hard_timeout = act->hard_timeout;
-
-        if(!__extract_key(key, &table->write_key, pkt)){
-            OFL_LOG_DBG(LOG_MODULE, "lookup key fields not found in the packet's header");
-            return 0;
-        }
-    }
-    else if (msg){
-        //SET_STATE message
-        state = msg->state;
-        state_mask = msg->state_mask;
-        idle_rollback = msg->idle_rollback;
-        hard_rollback = msg->hard_rollback;
-        idle_timeout = msg->idle_timeout;
-        hard_timeout = msg->hard_timeout;
-        if(key_len == msg->key_len)
-        {
-            memcpy(key, msg->key, msg->key_len);
+    capacity = state_table_capacity(table);
+    while (__atomic_load_n(&table->n_entries, __ATOMIC_RELAXED) >= capacity) {
+        if (capacity == 0 || !state_table_evict(table, held)) {
+            OFL_LOG_DBG(LOG_MODULE, "state table limits leave no room for an entry");
+            return NULL;
         }
-        else
-        {
-            OFL_LOG_WARN(LOG_MODULE, "key extractor length != received key length");
-            return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
-        }
-    }
-
-    HMAP_FOR_EACH_WITH_HASH(e, struct state_entry,
-        hmap_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0), &table->state_entries){
-            if (!memcmp(key, e->key, MAX_STATE_KEY_LEN)){
-                OFL_LOG_DBG(LOG_MODULE, "state value is %u updated to hash map", state);
-                if ((((e->state & ~(state_mask)) | (state & state_mask)) == STATE_DEFAULT) && hard_timeout==0 && idle_timeout==0){
-                    return state_table_del_state(table, key, key_len);
-                }
-                else {
-                    e->state = (e->state & ~(state_mask)) | (state & state_mask);
-                    gettimeofday(&tv,NULL);
-                    now = 1000000 * tv.tv_sec + tv.tv_usec;
-
-                    e->created = now;
-
-                    if (e->stats->idle_timeout)
-                        hmap_remove_and_shrink(&table->idle_entries, &e->idle_node);
-                    if (e->stats->hard_timeout)
-                        hmap_remove_and_shrink(&table->hard_entries, &e->hard_node);
-
-                    e->stats->idle_timeout = 0;
-                    e->stats->hard_timeout = 0;
-                    e->stats->idle_rollback = 0;
-                    e->stats->hard_rollback = 0;
-
-                    if (hard_timeout>0 && hard_rollback!=((e->state & ~(state_mask)) | (state & state_mask))) {
-                        e->stats->hard_timeout = hard_timeout;
-                        e->stats->hard_rollback = hard_rollback;
-                        e->remove_at = now + hard_timeout;
-                        hmap_insert(&table->hard_entries, &e->hard_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0));
-                    }
-                    if (idle_timeout>0 && idle_rollback!=((e->state & ~(state_mask)) | (state & state_mask))) {
-                        e->stats->idle_timeout = idle_timeout;
-                        e->stats->idle_rollback = idle_rollback;
-                        e->last_used = now;
-                        hmap_insert(&table->idle_entries, &e->idle_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0));
-                    }
-                }
-                return 0;
-            }
     }
 
-    gettimeofday(&tv,NULL);
-    now = 1000000 * tv.tv_sec + tv.tv_usec;
     e = xmalloc(sizeof(struct state_entry));
     e->created = now;
-    e->stats = xmalloc(sizeof(struct ofl_exp_state_stats));
-    e->stats->idle_timeout = 0;
-    e->stats->hard_timeout = 0;
-    e->stats->idle_rollback = 0;
-    e->stats->hard_rollback = 0;
+    e->last_used = now;
+    e->idle_timeout = 0;
+    e->hard_timeout = 0;
+    e->idle_rollback = 0;
+    e->hard_rollback = 0;
+    memset(e->registers, 0, sizeof e->registers);
     memcpy(e->key, key, MAX_STATE_KEY_LEN);
-    e->state = state & state_mask;
+    e->state = state;
+
+    OFL_LOG_DBG(LOG_MODULE, "state value is %u inserted to hash map", e->state);
+    hmap_insert(&shard->entries, &e->hmap_node, hash);
+    list_push_back(&shard->evict, &e->evict_node);
+    state_entry_group(shard, e);
+    __atomic_add_fetch(&table->n_entries, 1, __ATOMIC_RELAXED);
+    return e;
+}
 
-    // A new state entry with state!=DEF is always installed.
-    if ((state & state_mask) != STATE_DEFAULT)
-    {
-        OFL_LOG_DBG(LOG_MODULE, "state value is %u inserted to hash map", e->state);
-        hmap_insert(&table->state_entries, &e->hmap_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0));
+/* Applies the state, timeouts and rollbacks of 'p' to the entry of 'key',
+ * with 'hash', in 'shard' of 'table'.  The caller has locked 'shard', or all
+ * the shards if 'held' is NULL, and keeps them locked. */
+static ofl_err
+state_shard_set_state(struct state_table *table, struct state_shard *shard, struct state_shard *held,
+                      uint8_t const *key, uint32_t hash, struct ofl_exp_set_flow_state const *p)
+{
+    uint32_t state = p->state, state_mask = p->state_mask;
+    uint32_t idle_rollback = p->idle_rollback, hard_rollback = p->hard_rollback;
+    uint32_t idle_timeout = p->idle_timeout, hard_timeout = p->hard_timeout;
+    uint64_t now = __atomic_load_n(&table->now, __ATOMIC_RELAXED);
+    struct state_entry *e;
+
+    e = state_shard_find(table, shard, key, hash);
+    if (e != NULL) {
+        OFL_LOG_DBG(LOG_MODULE, "state value is %u updated to hash map", state);
+        if (e->hard_timeout || e->idle_timeout)
+            state_entry_unschedule(shard, e);
+        if ((((e->state & ~(state_mask)) | (state & state_mask)) == STATE_DEFAULT) && hard_timeout==0 && idle_timeout==0){
+            state_entry_remove(table, shard, e);
+        }
+        else {
+            state_entry_set_state(shard, e, (e->state & ~(state_mask)) | (state & state_mask));
+            e->created = now;
+            e->last_used = now;
+            list_remove(&e->evict_node);
+            list_push_back(&shard->evict, &e->evict_node);
+
+            e->idle_timeout = 0;
+            e->hard_timeout = 0;
+            e->idle_rollback = 0;
+            e->hard_rollback = 0;
+
+            if (hard_timeout>0 && hard_rollback!=((e->state & ~(state_mask)) | (state & state_mask))) {
+                e->hard_timeout = hard_timeout;
+                e->hard_rollback = hard_rollback;
+                e->remove_at = now + hard_timeout;
+            }
+            if (idle_timeout>0 && idle_rollback!=((e->state & ~(state_mask)) | (state & state_mask))) {
+                e->idle_timeout = idle_timeout;
+                e->idle_rollback = idle_rollback;
+            }
+            if (e->hard_timeout || e->idle_timeout)
+                state_entry_schedule(shard, e, now);
+        }
+        return 0;
     }
-    else
-    {
-        // Otherwise a new state entry with state=DEF will be installed only if at least one timeout is set with rollback!=DEF
-        if ((hard_timeout>0 && hard_rollback!=STATE_DEFAULT) || (idle_timeout>0 && idle_rollback!=STATE_DEFAULT))
-            hmap_insert(&table->state_entries, &e->hmap_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0));
+
+    // A new state entry with state!=DEF is always installed, otherwise only
+    // if at least one timeout is set with rollback!=DEF
+    if ((state & state_mask) == STATE_DEFAULT
+        && !(hard_timeout>0 && hard_rollback!=STATE_DEFAULT)
+        && !(idle_timeout>0 && idle_rollback!=STATE_DEFAULT)) {
+        return 0;
     }
 
+    e = state_shard_new_entry(table, shard, held, key, hash, state & state_mask);
+    if (e == NULL)
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_EXP_SET_FLOW_STATE);
+
     // Configuring a timeout with rollback state=state makes no sense
     if (hard_timeout>0 && hard_rollback!=(state & state_mask)){
         // FIXME!?!?!
         // e->remove_at = hard_timeout>0 == 0 ? 0 : now + hard_timeout;
         e->remove_at = hard_timeout == 0 ? 0 : now + hard_timeout;
-        e->stats->hard_timeout = hard_timeout;
-        e->stats->hard_rollback = hard_rollback;
-        hmap_insert(&table->hard_entries, &e->hard_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0));
+        e->hard_timeout = hard_timeout;
+        e->hard_rollback = hard_rollback;
     }
     if (idle_timeout>0 && idle_rollback!=(state & state_mask)){
-        e->stats->idle_timeout = idle_timeout;
-        e->stats->idle_rollback = idle_rollback;
-        e->last_used = now;
-        hmap_insert(&table->idle_entries, &e->idle_node, hash_bytes(key, MAX_STATE_KEY_LEN, 0));
+        e->idle_timeout = idle_timeout;
+        e->idle_rollback = idle_rollback;
+    }
+    if (e->hard_timeout || e->idle_timeout)
+        state_entry_schedule(shard, e, now);
+    return 0;
+}
+
+/* Builds in 'key' the update-scope key of 'pkt' for 'table', then locks and
+ * returns its shard.  Returns NULL if the packet lacks the key fields. */
+static struct state_shard *
+state_table_lock_pkt_key(struct state_table *table, uint8_t *key, struct packet *pkt, uint32_t *hash)
+{
+    struct state_shard *shard = NULL;
+
+    while (shard == NULL) {
+        unsigned int seq = state_table_read_begin(table);
+
+        /* The key the lookup of the stage built, if the packet has not
+         * changed since; the handle is parsed again after a change. */
+        if (pkt->handle_std->state_table == table && pkt->handle_std->valid)
+            memcpy(key, pkt->handle_std->state_key, table->key_len);
+        else if(!__extract_key(key, &table->write_key, pkt)){
+            if (state_table_read_retry(table, seq))
+                continue;
+            OFL_LOG_DBG(LOG_MODULE, "lookup key fields not found in the packet's header");
+            return NULL;
+        }
+        shard = state_table_lock_key(table, key, seq, hash);
+        if (shard == NULL)
+            memset(key, 0, MAX_STATE_KEY_LEN);
+    }
+    return shard;
+}
+
+ofl_err state_table_set_state(struct state_table *table, struct packet *pkt, struct ofl_exp_set_flow_state *msg, struct ofl_exp_action_set_state *act)
+{
+    uint8_t key[MAX_STATE_KEY_LEN] = {0};
+    struct state_shard *shard = NULL;
+    ofl_err error;
+    uint32_t hash;
+
+    if (pkt)
+    {
+        //SET_STATE action
+        struct ofl_exp_set_flow_state p = {
+            .state = act->state,
+            .state_mask = act->state_mask,
+            .idle_rollback = act->idle_rollback,
+            .hard_rollback = act->hard_rollback,
+            .idle_timeout = act->idle_timeout,
+            .hard_timeout = act->hard_timeout,
+        };
+
+        shard = state_table_lock_pkt_key(table, key, pkt, &hash);
+        if (shard == NULL)
+            return 0;
+        /* A packet that finds no room simply leaves no state. */
+        state_shard_set_state(table, shard, shard, key, hash, &p);
+        pthread_mutex_unlock(&shard->mutex);
+        return 0;
+    }
+
+    //SET_STATE message
+    shard = state_table_lock_msg_key(table, key, msg->key, msg->key_len, &hash);
+    if (shard == NULL)
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
+    error = state_shard_set_state(table, shard, shard, key, hash, msg);
+    pthread_mutex_unlock(&shard->mutex);
+    return error;
+}
+
+static bool
+state_reg_cmp(uint64_t reg, uint8_t cmp, uint64_t value)
+{
+    switch (cmp) {
+        case OFPSRC_EQ: return reg == value;
+        case OFPSRC_NE: return reg != value;
+        case OFPSRC_LT: return reg < value;
+        case OFPSRC_LE: return reg <= value;
+        case OFPSRC_GT: return reg > value;
+        case OFPSRC_GE: return reg >= value;
+        default: return false;
+    }
+}
+
+/* Applies the register action 'act' to the entry 'pkt' updates in 'table'.
+ * Increments and sets install an entry in the default state for a flow that
+ * has none; a comparison reads the registers of a missing entry as zero. */
+void state_table_reg_action(struct state_table *table, struct packet *pkt, struct ofl_exp_openstate_act_header const *act)
+{
+    uint8_t key[MAX_STATE_KEY_LEN] = {0};
+    struct state_shard *shard;
+    struct state_entry *e;
+    uint32_t hash;
+
+    shard = state_table_lock_pkt_key(table, key, pkt, &hash);
+    if (shard == NULL)
+        return;
+
+    e = state_shard_find(table, shard, key, hash);
+    switch (act->act_type) {
+        case (OFPAT_EXP_INC_STATE_REG): {
+            struct ofl_exp_action_inc_state_reg const *a = (struct ofl_exp_action_inc_state_reg const *)act;
+
+            if (e == NULL)
+                e = state_shard_new_entry(table, shard, shard, key, hash, STATE_DEFAULT);
+            if (e != NULL)
+                e->registers[a->reg] += a->flags & OFPSRF_PKT_LEN ? pkt->buffer->size : a->value;
+            break;
+        }
+        case (OFPAT_EXP_SET_STATE_REG): {
+            struct ofl_exp_action_set_state_reg const *a = (struct ofl_exp_action_set_state_reg const *)act;
+
+            if (e == NULL)
+                e = state_shard_new_entry(table, shard, shard, key, hash, STATE_DEFAULT);
+            if (e != NULL)
+                e->registers[a->reg] = a->value;
+            break;
+        }
+        case (OFPAT_EXP_CMP_SET_STATE): {
+            struct ofl_exp_action_cmp_set_state const *a = (struct ofl_exp_action_cmp_set_state const *)act;
+            struct ofl_exp_set_flow_state p = {
+                .state = a->state,
+                .state_mask = a->state_mask,
+            };
+
+            if (state_reg_cmp(e != NULL ? e->registers[a->reg] : 0, a->cmp, a->value))
+                state_shard_set_state(table, shard, shard, key, hash, &p);
+            break;
+        }
+        default:
+            break;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+/* Checks, with the shards of 'table' locked, that keys of 'len' bytes are
+ * the ones of its update-scope extractor. */
+static ofl_err
+state_table_check_key_len(struct state_table *table, uint32_t len)
+{
+    if (key_extractor_len(&table->write_key) != len) {
+        OFL_LOG_WARN(LOG_MODULE, "key extractor length != received key length");
+        return ofl_error(OFPET_EXPERIMENTER, OFPEC_BAD_EXP_LEN);
     }
     return 0;
 }
 
+ofl_err
+state_table_set_states(struct state_table *table, struct ofl_exp_set_flow_states *msg)
+{
+    ofl_err error;
+    size_t i;
+
+    state_table_lock(table);
+    error = state_table_check_key_len(table, msg->key_len);
+    if (error) {
+        state_table_unlock(table);
+        return error;
+    }
+    for (i = 0; i < STATE_TABLE_SHARDS; i++)
+        hmap_reserve(&table->shards[i].entries,
+                     hmap_count(&table->shards[i].entries) + msg->n_entries / STATE_TABLE_SHARDS);
+
+    for (i = 0; i < msg->n_entries; i++) {
+        uint8_t key[MAX_STATE_KEY_LEN] = {0};
+        uint32_t hash;
+        ofl_err err;
+
+        memcpy(key, msg->entries[i].key, msg->key_len);
+        hash = state_key_hash(table, key);
+        err = state_shard_set_state(table, state_table_shard(table, hash), NULL, key, hash, &msg->entries[i]);
+        if (err && !error)
+            error = err;
+    }
+    state_table_unlock(table);
+    return error;
+}
+
+ofl_err
+state_table_del_states(struct state_table *table, struct ofl_exp_del_flow_states *msg)
+{
+    ofl_err error;
+    size_t i;
+
+    state_table_lock(table);
+    error = state_table_check_key_len(table, msg->key_len);
+    if (error) {
+        state_table_unlock(table);
+        return error;
+    }
+    for (i = 0; i < msg->n_keys; i++) {
+        uint8_t key[MAX_STATE_KEY_LEN] = {0};
+        struct state_shard *shard;
+        struct state_entry *e;
+        uint32_t hash;
+
+        memcpy(key, msg->keys + i * msg->key_len, msg->key_len);
+        hash = state_key_hash(table, key);
+        shard = state_table_shard(table, hash);
+        e = state_shard_find(table, shard, key, hash);
+        if (e == NULL) {
+            if (!error)
+                error = ofl_error(OFPET_EXPERIMENTER, OFPEC_EXP_DEL_FLOW_STATE);
+            continue;
+        }
+        if (e->hard_timeout || e->idle_timeout)
+            state_entry_unschedule(shard, e);
+        state_entry_remove(table, shard, e);
+    }
+    for (i = 0; i < STATE_TABLE_SHARDS; i++)
+        hmap_shrink(&table->shards[i].entries);
+    state_table_unlock(table);
+    return error;
+}
+
+void
+state_table_del_states_by_state(struct state_table *table, uint32_t state, uint32_t mask)
+{
+    size_t n = 0;
+    int i;
+
+    state_table_lock(table);
+    for (i = 0; i < STATE_TABLE_SHARDS; i++) {
+        struct state_shard *shard = &table->shards[i];
+        struct state_group *g, *next_g;
+        struct state_entry *e, *next;
+
+        HMAP_FOR_EACH_SAFE (g, next_g, struct state_group, node, &shard->groups) {
+            if ((g->state & mask) != (state & mask))
+                continue;
+            LIST_FOR_EACH_SAFE (e, next, struct state_entry, state_node, &g->entries) {
+                if (e->hard_timeout || e->idle_timeout)
+                    state_entry_unschedule(shard, e);
+                hmap_remove(&shard->entries, &e->hmap_node);
+                list_remove(&e->evict_node);
+                free(e);
+                n++;
+            }
+            hmap_remove(&shard->groups, &g->node);
+            free(g);
+        }
+        hmap_shrink(&shard->entries);
+    }
+    __atomic_sub_fetch(&table->n_entries, n, __ATOMIC_RELAXED);
+    state_table_unlock(table);
+}
+
+static size_t
+state_entry_snapshot_len(uint32_t key_len)
+{
+    return ROUND_UP(sizeof(struct state_entry_snapshot) + key_len, 8);
+}
+
+void
+state_table_save(struct state_table *table, uint8_t table_id, struct ofpbuf *buf)
+{
+    struct state_table_snapshot *ts;
+    size_t entry_len;
+    uint64_t now;
+    int i;
+
+    if (!table->stateful && !table->read_key.field_count && !table->write_key.field_count)
+        return;
+
+    state_table_lock(table);
+    now = __atomic_load_n(&table->now, __ATOMIC_RELAXED);
+    entry_len = state_entry_snapshot_len(table->key_len);
+
+    ts = ofpbuf_put_zeros(buf, sizeof *ts);
+    ts->table_id = table_id;
+    ts->stateful = table->stateful;
+    ts->eviction = table->eviction;
+    ts->key_len = table->key_len;
+    ts->read_count = table->read_key.field_count;
+    ts->write_count = table->write_key.field_count;
+    memcpy(ts->read_fields, table->read_key.fields, sizeof ts->read_fields);
+    memcpy(ts->write_fields, table->write_key.fields, sizeof ts->write_fields);
+    ts->max_entries = table->max_entries;
+    ts->max_bytes = table->max_bytes;
+    ts->n_entries = table->n_entries;
+
+    /* In eviction order, which the restore keeps. */
+    ofpbuf_prealloc_tailroom(buf, table->n_entries * entry_len);
+    for (i = 0; i < STATE_TABLE_SHARDS; i++) {
+        struct state_entry *e;
+
+        LIST_FOR_EACH (e, struct state_entry, evict_node, &table->shards[i].evict) {
+            struct state_entry_snapshot *es = ofpbuf_put_zeros(buf, entry_len);
+
+            es->state = e->state;
+            es->hard_rollback = e->hard_rollback;
+            es->idle_rollback = e->idle_rollback;
+            es->hard_timeout = e->hard_timeout;
+            es->idle_timeout = e->idle_timeout;
+            es->age = now > e->created ? now - e->created : 0;
+            es->idle = now > e->last_used ? now - e->last_used : 0;
+            es->hard_left = e->hard_timeout && e->remove_at > now ? e->remove_at - now : 0;
+            memcpy(es->registers, e->registers, sizeof es->registers);
+            memcpy(es->key, e->key, table->key_len);
+        }
+    }
+    state_table_unlock(table);
+}
+
+/* Sets the extractor of 'table' for 'update' to the 'count' 'fields', if
+ * any. */
+static ofl_err
+state_table_restore_extractor(struct state_table *table, uint8_t table_id,
+                              uint32_t count, uint32_t const *fields, int update)
+{
+    struct key_extractor ke = {.table_id = table_id, .field_count = count};
+
+    if (count == 0)
+        return 0;
+    memcpy(ke.fields, fields, count * sizeof *fields);
+    return state_table_set_extractor(table, &ke, update);
+}
+
+size_t
+state_table_restore(struct state_table *table, struct state_table_snapshot const *ts, size_t len)
+{
+    struct ofl_exp_set_table_limits limits;
+    uint8_t const *data = (uint8_t const *)(ts + 1);
+    size_t entry_len, capacity;
+    uint64_t now, i;
+
+    if (len < sizeof *ts
+        || ts->read_count > MAX_EXTRACTION_FIELD_COUNT
+        || ts->write_count > MAX_EXTRACTION_FIELD_COUNT
+        || ts->key_len > MAX_STATE_KEY_LEN)
+        return 0;
+    entry_len = state_entry_snapshot_len(ts->key_len);
+    if (ts->n_entries > (len - sizeof *ts) / entry_len)
+        return 0;
+
+    state_table_configure_stateful(table, ts->stateful);
+    if (state_table_restore_extractor(table, ts->table_id, ts->read_count, ts->read_fields, 0)
+        || state_table_restore_extractor(table, ts->table_id, ts->write_count, ts->write_fields, 1))
+        return 0;
+    limits = (struct ofl_exp_set_table_limits) {
+        .table_id = ts->table_id,
+        .eviction = ts->eviction,
+        .max_entries = ts->max_entries,
+        .max_bytes = ts->max_bytes};
+    state_table_set_limits(table, &limits);
+
+    /* The table is empty, so the entries are inserted without lookups, and
+     * a key length grown before the save is taken back as is. */
+    state_table_lock(table);
+    table->key_len = MAX(table->key_len, ts->key_len);
+    now = __atomic_load_n(&table->now, __ATOMIC_RELAXED);
+    for (i = 0; i < STATE_TABLE_SHARDS; i++)
+        hmap_reserve(&table->shards[i].entries, ts->n_entries / STATE_TABLE_SHARDS);
+
+    for (i = 0; i < ts->n_entries; i++) {
+        struct state_entry_snapshot const *es = (struct state_entry_snapshot const *)(data + i * entry_len);
+        struct state_entry *e = xmalloc(sizeof *e);
+        struct state_shard *shard;
+        uint32_t hash;
+
+        memset(e->key, 0, MAX_STATE_KEY_LEN);
+        memcpy(e->key, es->key, ts->key_len);
+        e->state = es->state;
+        e->hard_rollback = es->hard_rollback;
+        e->idle_rollback = es->idle_rollback;
+        e->hard_timeout = es->hard_timeout;
+        e->idle_timeout = es->idle_timeout;
+        e->created = now - MIN(es->age, now);
+        e->last_used = now - MIN(es->idle, now);
+        e->remove_at = now + es->hard_left;
+        memcpy(e->registers, es->registers, sizeof e->registers);
+
+        hash = state_key_hash(table, e->key);
+        shard = state_table_shard(table, hash);
+        hmap_insert(&shard->entries, &e->hmap_node, hash);
+        list_push_back(&shard->evict, &e->evict_node);
+        state_entry_group(shard, e);
+        if (e->hard_timeout || e->idle_timeout)
+            state_entry_schedule(shard, e, now);
+    }
+    __atomic_add_fetch(&table->n_entries, ts->n_entries, __ATOMIC_RELAXED);
+
+    /* A snapshot edited, or saved before the limits were lowered, may hold
+     * more entries than they allow: the eviction policy picks the extra. */
+    capacity = state_table_capacity(table);
+    while (table->n_entries > capacity && state_table_evict(table, NULL))
+        continue;
+    state_table_unlock(table);
+
+    return sizeof *ts + ts->n_entries * entry_len;
+}
+
 ofl_err
 handle_state_mod(struct pipeline *pl, struct ofl_exp_msg_state_mod *msg, const struct sender *sender UNUSED)
 {
+    ofl_err error = 0;
+
     switch (msg->command){
         case OFPSC_STATEFUL_TABLE_CONFIG:{
             struct ofl_exp_stateful_table_config *p = (struct ofl_exp_stateful_table_config *) msg->payload;
@@ -1813,7 +3496,7 @@ handle_state_mod(struct pipeline *pl, struct ofl_exp_msg_state_mod *msg, const s
                 int update = 0;
                 if (msg->command == OFPSC_EXP_SET_U_EXTRACTOR)
                     update = 1;
-                return state_table_set_extractor(st, (struct key_extractor *)p, update);
+                error = state_table_set_extractor(st, (struct key_extractor *)p, update);
             }
             else{
                 OFL_LOG_WARN(LOG_MODULE, "ERROR STATE MOD: cannot configure extractor (stage %u is not stateful)", p->table_id);
@@ -1825,7 +3508,7 @@ handle_state_mod(struct pipeline *pl, struct ofl_exp_msg_state_mod *msg, const s
             struct ofl_exp_set_flow_state *p = (struct ofl_exp_set_flow_state *) msg->payload;
             struct state_table *st = pl->tables[p->table_id]->state_table;
             if (state_table_is_stateful(st) && state_table_is_configured(st)){
-                return state_table_set_state(st, NULL, p, NULL);
+                error = state_table_set_state(st, NULL, p, NULL);
             }
             else{
                 OFL_LOG_WARN(LOG_MODULE, "ERROR STATE MOD at stage %u: stage not stateful or not configured", p->table_id);
@@ -1837,7 +3520,7 @@ handle_state_mod(struct pipeline *pl, struct ofl_exp_msg_state_mod *msg, const s
             struct ofl_exp_del_flow_state *p = (struct ofl_exp_del_flow_state *) msg->payload;
             struct state_table *st = pl->tables[p->table_id]->state_table;
             if (state_table_is_stateful(st) && state_table_is_configured(st)){
-                return state_table_del_state(st, p->key, p->key_len);
+                error = state_table_del_state(st, p->key, p->key_len);
             }
             else{
                 OFL_LOG_WARN(LOG_MODULE, "ERROR STATE MOD at stage %u: stage not stateful or not configured", p->table_id);
@@ -1856,9 +3539,61 @@ handle_state_mod(struct pipeline *pl, struct ofl_exp_msg_state_mod *msg, const s
             pl->dp->global_state = OFP_GLOBAL_STATE_DEFAULT;
             break;}
 
+        case OFPSC_EXP_SET_TABLE_LIMITS:{
+            struct ofl_exp_set_table_limits *p = (struct ofl_exp_set_table_limits *) msg->payload;
+            state_table_set_limits(pl->tables[p->table_id]->state_table, p);
+            break;}
+
+        case OFPSC_EXP_SET_FLOW_STATES:{
+            struct ofl_exp_set_flow_states *p = (struct ofl_exp_set_flow_states *) msg->payload;
+            struct state_table *st = pl->tables[p->table_id]->state_table;
+            if (state_table_is_stateful(st) && state_table_is_configured(st)){
+                error = state_table_set_states(st, p);
+            }
+            else{
+                OFL_LOG_WARN(LOG_MODULE, "ERROR STATE MOD at stage %u: stage not stateful or not configured", p->table_id);
+                return ofl_error(OFPET_EXPERIMENTER, OFPEC_EXP_SET_FLOW_STATE);
+            }
+            break;}
+
+        case OFPSC_EXP_DEL_FLOW_STATES:{
+            struct ofl_exp_del_flow_states *p = (struct ofl_exp_del_flow_states *) msg->payload;
+            struct state_table *st = pl->tables[p->table_id]->state_table;
+            if (state_table_is_stateful(st) && state_table_is_configured(st)){
+                error = state_table_del_states(st, p);
+            }
+            else{
+                OFL_LOG_WARN(LOG_MODULE, "ERROR STATE MOD at stage %u: stage not stateful or not configured", p->table_id);
+                return ofl_error(OFPET_EXPERIMENTER, OFPEC_EXP_DEL_FLOW_STATE);
+            }
+            break;}
+
+        case OFPSC_EXP_DEL_FLOW_STATES_BY_STATE:{
+            struct ofl_exp_del_flow_states_by_state *p = (struct ofl_exp_del_flow_states_by_state *) msg->payload;
+            size_t i;
+            for (i = 0; i < PIPELINE_TABLES; i++) {
+                if (p->table_id == OFPTT_ALL || p->table_id == i)
+                    state_table_del_states_by_state(pl->tables[i]->state_table, p->state, p->state_mask);
+            }
+            break;}
+
+        case OFPSC_EXP_FLUSH_STATE_TABLE:{
+            /* A flush matches any state. */
+            struct ofl_exp_flush_state_table *p = (struct ofl_exp_flush_state_table *) msg->payload;
+            size_t i;
+            for (i = 0; i < PIPELINE_TABLES; i++) {
+                if (p->table_id == OFPTT_ALL || p->table_id == i)
+                    state_table_del_states_by_state(pl->tables[i]->state_table, 0, 0);
+            }
+            break;}
+
         default:
             return ofl_error(OFPET_EXPERIMENTER, OFPEC_EXP_STATE_MOD_FAILED);
     }
+    /* The bulk commands apply what they can, then report the first
+     * failure; on an error the caller frees the message. */
+    if (error)
+        return error;
     ofl_msg_free((struct ofl_msg_header *)msg, pl->dp->exp);
     return 0;
 }
@@ -1901,16 +3636,39 @@ handle_stats_request_global_state(struct pipeline *pl, const struct sender *send
     return 0;
 }
 
+/* Returns the number of entries of 'table' in 'state'. */
+static size_t
+state_table_count(struct state_table *table, uint32_t state)
+{
+    size_t count = 0;
+    int i;
+
+    for (i = 0; i < STATE_TABLE_SHARDS; i++) {
+        struct state_shard *shard = &table->shards[i];
+        struct state_group *g;
+
+        pthread_mutex_lock(&shard->mutex);
+        g = state_shard_group(shard, state);
+        if (g != NULL)
+            count += g->n_entries;
+        pthread_mutex_unlock(&shard->mutex);
+    }
+    return count;
+}
+
 ofl_err
 handle_stats_request_state_num(struct pipeline *pl, struct ofl_exp_msg_multipart_request_state_num *msg, const struct sender *sender UNUSED, struct ofl_exp_msg_multipart_reply_state_num *reply)
 {
-    if (state_table_is_stateful(pl->tables[msg->table_id]->state_table) && state_table_is_configured(pl->tables[msg->table_id]->state_table)){
+    struct state_table *st = pl->tables[msg->table_id]->state_table;
+
+    if (state_table_is_stateful(st) && state_table_is_configured(st)){
         *reply = (struct ofl_exp_msg_multipart_reply_state_num)
             {{{{{.type = OFPT_MULTIPART_REPLY},
               .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
              .experimenter_id = OPENSTATE_VENDOR_ID},
              .type = OFPMP_EXP_STATE_STATS_NUM},
-             .count = (uint32_t) hmap_count(&pl->tables[msg->table_id]->state_table->state_entries)};
+             .count = (uint32_t) (msg->get_from_state ? state_table_count(st, msg->state)
+                                                      : __atomic_load_n(&st->n_entries, __ATOMIC_RELAXED))};
 
         return 0;
     } else {
@@ -1919,94 +3677,135 @@ handle_stats_request_state_num(struct pipeline *pl, struct ofl_exp_msg_multipart
 
 }
 
+ofl_err
+handle_stats_request_state_table(struct pipeline *pl, struct ofl_exp_msg_multipart_request_state_table *msg, const struct sender *sender UNUSED, struct ofl_exp_msg_multipart_reply_state_table *reply)
+{
+    struct state_table *table = pl->tables[msg->table_id]->state_table;
+    uint64_t evictions = 0;
+    size_t count;
+    int i;
+
+    state_table_lock(table);
+    count = table->n_entries;
+    for (i = 0; i < STATE_TABLE_SHARDS; i++)
+        evictions += table->shards[i].evictions;
+    state_table_unlock(table);
+
+    *reply = (struct ofl_exp_msg_multipart_reply_state_table)
+        {{{{{.type = OFPT_MULTIPART_REPLY},
+          .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+         .experimenter_id = OPENSTATE_VENDOR_ID},
+         .type = OFPMP_EXP_STATE_TABLE_STATS},
+         .table_id = msg->table_id,
+         .eviction = table->eviction,
+         .count = (uint32_t) count,
+         .max_entries = table->max_entries,
+         .bytes = count * sizeof(struct state_entry),
+         .max_bytes = table->max_bytes,
+         .evictions = evictions};
+    return 0;
+}
+
+/* The fields of a state stats request, each at 'offset' in the keys. */
+struct state_stats_filter {
+    size_t n;
+    uint8_t const *value[MAX_EXTRACTION_FIELD_COUNT];
+    uint8_t offset[MAX_EXTRACTION_FIELD_COUNT];
+    uint8_t length[MAX_EXTRACTION_FIELD_COUNT];
+};
+
+/* Appends to 'stats' the stats of 'entry' of 'table', whose read key has
+ * 'key_len' bytes, if its key matches 'filter'. */
+static void
+state_entry_stats(struct state_table const *table, struct state_entry const *entry,
+                  struct state_stats_filter const *filter, uint32_t key_len, uint64_t now, uint8_t table_id,
+                  struct ofl_exp_state_stats ***stats, size_t *stats_size, size_t *stats_num)
+{
+    struct key_extractor const *extractor = &table->read_key;
+    struct ofl_exp_state_stats *s;
+    size_t i;
+
+    for (i = 0; i < filter->n; i++) {
+        if (memcmp(filter->value[i], &entry->key[filter->offset[i]], filter->length[i]))
+            return;
+    }
+
+    if ((*stats_size) == (*stats_num)) {
+        (*stats) = xrealloc(*stats, (sizeof(struct ofl_exp_state_stats *)) * (*stats_size) * 2);
+        *stats_size *= 2;
+    }
+    s = (*stats)[(*stats_num)++] = malloc(sizeof(struct ofl_exp_state_stats));
+    s->idle_timeout = entry->idle_timeout;
+    s->hard_timeout = entry->hard_timeout;
+    s->idle_rollback = entry->idle_rollback;
+    s->hard_rollback = entry->hard_rollback;
+    s->duration_sec  =  (now - entry->created) / 1000000;
+    s->duration_nsec = ((now - entry->created) % 1000000)*1000;
+    for (i=0;i<extractor->field_count;i++)
+        s->fields[i] = extractor->fields[i];
+    s->table_id = table_id;
+    s->field_count = extractor->field_count;
+    s->entry.key_len = key_len;
+    memcpy(s->entry.key, entry->key, key_len);
+    s->entry.state = entry->state;
+    memcpy(s->registers, entry->registers, sizeof s->registers);
+}
+
 void
 state_table_stats(struct state_table *table, struct ofl_exp_msg_multipart_request_state *msg,
                  struct ofl_exp_state_stats ***stats, size_t *stats_size, size_t *stats_num, uint8_t table_id)
 {
-    struct state_entry *entry;
-    size_t  i;
-    uint32_t key_len = 0; //update-scope key extractor length
-    uint32_t fields[MAX_EXTRACTION_FIELD_COUNT] = {0};
-    struct timeval tv;
+    struct state_stats_filter filter = {.n = 0};
     struct key_extractor *extractor=&table->read_key;
-
     struct ofl_match const * a = (struct ofl_match const *)msg->match;
     struct ofl_match_tlv *state_key_match;
-    uint8_t count = 0;
-    uint8_t found = 0;
-    uint8_t len = 0;
-    uint8_t aux = 0;
-
-    uint8_t offset[MAX_EXTRACTION_FIELD_COUNT] = {0};
-    uint8_t length[MAX_EXTRACTION_FIELD_COUNT] = {0};
-
+    uint32_t key_len = 0; //lookup-scope key extractor length
+    uint64_t now = time_usec();
+    size_t i;
+    int k;
 
-    for (i=0; i<extractor->field_count; i++) {
-        fields[i] = (int)extractor->fields[i];
-        key_len = key_len + OXM_LENGTH(fields[i]);
-     }
+    for (i=0; i<extractor->field_count; i++)
+        key_len = key_len + OXM_LENGTH(extractor->fields[i]);
 
     //for each received match_field we must verify if it can be found in the key extractor and (if yes) save its position in the key (offset) and its length
     HMAP_FOR_EACH(state_key_match, struct ofl_match_tlv, hmap_node, &a->match_fields)
     {
-        len = 0;
-        found = 0;
+        uint8_t len = 0;
+
         for (i=0;i<extractor->field_count;i++)
         {
-                if(OXM_TYPE(state_key_match->header)==OXM_TYPE(fields[i]))
-                {
-                    offset[count] = len;
-                    length[count] = OXM_LENGTH(fields[i]);
-                    count++;
-                    found = 1;
+                if(OXM_TYPE(state_key_match->header)==OXM_TYPE(extractor->fields[i]))
                     break;
-                }
-                len += OXM_LENGTH(fields[i]);
+                len += OXM_LENGTH(extractor->fields[i]);
         }
-        if(!found)
+        if (i == extractor->field_count || filter.n == MAX_EXTRACTION_FIELD_COUNT)
             return; //If at least one of the received match_field is not found in the key extractor, the function returns an empty list of entries
+        filter.value[filter.n] = state_key_match->value;
+        filter.offset[filter.n] = len;
+        filter.length[filter.n] = OXM_LENGTH(extractor->fields[i]);
+        filter.n++;
     }
 
-    //for each state entry
-    HMAP_FOR_EACH(entry, struct state_entry, hmap_node, &table->state_entries) {
-        if ((*stats_size) == (*stats_num)) {
-                (*stats) = xrealloc(*stats, (sizeof(struct ofl_exp_state_stats *)) * (*stats_size) * 2);
-                *stats_size *= 2;
-            }
-            if(entry == NULL)
-                break;
-
-            //for each received match_field compare the received value with the state entry's key
-            aux = 0;
-            found = 1;
-            HMAP_FOR_EACH(state_key_match, struct ofl_match_tlv, hmap_node, &a->match_fields)
-            {
-                if(memcmp(state_key_match->value,&entry->key[offset[aux]], length[aux])) 
-                    found = 0;
-                aux+=1;
-            }
-
-            if(found && ((msg->get_from_state && msg->state == entry->state) || (!msg->get_from_state)))
-            {
-                gettimeofday(&tv,NULL);
-                (*stats)[(*stats_num)] = malloc(sizeof(struct ofl_exp_state_stats));
-                (*stats)[(*stats_num)]->idle_timeout = entry->stats->idle_timeout;
-                (*stats)[(*stats_num)]->hard_timeout = entry->stats->hard_timeout;
-                (*stats)[(*stats_num)]->idle_rollback = entry->stats->idle_rollback;
-                (*stats)[(*stats_num)]->hard_rollback = entry->stats->hard_rollback;
-                (*stats)[(*stats_num)]->duration_sec  =  (1000000 * tv.tv_sec + tv.tv_usec - entry->created) / 1000000;
-                (*stats)[(*stats_num)]->duration_nsec = ((1000000 * tv.tv_sec + tv.tv_usec - entry->created) % 1000000)*1000;
-                for (i=0;i<extractor->field_count;i++)
-                    (*stats)[(*stats_num)]->fields[i]=fields[i];
-                (*stats)[(*stats_num)]->table_id = table_id;
-                (*stats)[(*stats_num)]->field_count = extractor->field_count;
-                (*stats)[(*stats_num)]->entry.key_len = key_len;
-                for (i=0;i<key_len;i++)
-                    (*stats)[(*stats_num)]->entry.key[i]=entry->key[i];
-                (*stats)[(*stats_num)]->entry.state = entry->state;
-                (*stats_num)++;
-             }
+    /* Asked for a state, only the entries of its groups are walked.  The
+     * shards are locked one at a time, so that packets only ever wait for
+     * the walk of one. */
+    for (k = 0; k < STATE_TABLE_SHARDS; k++) {
+        struct state_shard *shard = &table->shards[k];
+        struct state_entry *entry;
+
+        pthread_mutex_lock(&shard->mutex);
+        if (msg->get_from_state) {
+            struct state_group *g = state_shard_group(shard, msg->state);
+
+            if (g != NULL)
+                LIST_FOR_EACH (entry, struct state_entry, state_node, &g->entries)
+                    state_entry_stats(table, entry, &filter, key_len, now, table_id, stats, stats_size, stats_num);
+        } else {
+            HMAP_FOR_EACH(entry, struct state_entry, hmap_node, &shard->entries)
+                state_entry_stats(table, entry, &filter, key_len, now, table_id, stats, stats_size, stats_num);
         }
+        pthread_mutex_unlock(&shard->mutex);
+    }
      /*DEFAULT ENTRY*/
     if(!msg->get_from_state || (msg->get_from_state && msg->state == STATE_DEFAULT))
     {
@@ -2016,7 +3815,7 @@ state_table_stats(struct state_table *table, struct ofl_exp_msg_multipart_reques
         }
         (*stats)[(*stats_num)] = malloc(sizeof(struct ofl_exp_state_stats));
         for (i=0;i<extractor->field_count;i++)
-            (*stats)[(*stats_num)]->fields[i]=fields[i];
+            (*stats)[(*stats_num)]->fields[i]=extractor->fields[i];
         (*stats)[(*stats_num)]->table_id = table_id;
         (*stats)[(*stats_num)]->field_count = extractor->field_count;
         (*stats)[(*stats_num)]->entry.key_len = 0;
@@ -2025,6 +3824,7 @@ state_table_stats(struct state_table *table, struct ofl_exp_msg_multipart_reques
         (*stats)[(*stats_num)]->hard_timeout = 0;
         (*stats)[(*stats_num)]->idle_rollback = 0;
         (*stats)[(*stats_num)]->hard_rollback = 0;
+        memset((*stats)[(*stats_num)]->registers, 0, sizeof (*stats)[(*stats_num)]->registers);
         (*stats_num)++;
     }
 }
@@ -2070,6 +3870,8 @@ ofl_structs_state_stats_pack(struct ofl_exp_state_stats const *src, uint8_t *dst
     state_stats->idle_rollback = htonl(src->idle_rollback);
     state_stats->hard_timeout = htonl(src->hard_timeout);
     state_stats->hard_rollback = htonl(src->hard_rollback);
+    for (i = 0; i < OFPSC_MAX_REGISTERS; i++)
+        state_stats->registers[i] = hton64(src->registers[i]);
     return total_len;
 }
 
@@ -2351,6 +4153,23 @@ ofl_structs_state_entry_print_default(FILE *stream, uint32_t field)
     }
 }
 
+static void
+ofl_structs_state_registers_print(FILE *stream, struct ofl_exp_state_stats const *s)
+{
+    size_t i;
+
+    for (i = 0; i < OFPSC_MAX_REGISTERS; i++) {
+        if (s->registers[i] != 0)
+            break;
+    }
+    if (i == OFPSC_MAX_REGISTERS)
+        return;
+    fprintf(stream, ", regs=[");
+    for (i = 0; i < OFPSC_MAX_REGISTERS; i++)
+        fprintf(stream, "%s%"PRIu64, i ? ", " : "", s->registers[i]);
+    fprintf(stream, "]");
+}
+
 void
 ofl_structs_state_stats_print(FILE *stream, struct ofl_exp_state_stats *s, struct ofl_exp const *exp UNUSED)
 {
@@ -2375,6 +4194,7 @@ ofl_structs_state_stats_print(FILE *stream, struct ofl_exp_state_stats *s, struc
         fprintf(stream, "%"PRIu32"\"", s->entry.state);
         if(s->entry.key_len!=0)
             fprintf(stream, ", dur_s=\"%u\", dur_ns=\"%09u\", idle_to=\"%u\", idle_rb=\"%u\", hard_to=\"%u\", hard_rb=\"%u\"",s->duration_sec, s->duration_nsec, s->idle_timeout, s->idle_rollback, s->hard_timeout, s->hard_rollback);
+        ofl_structs_state_registers_print(stream, s);
     }
 
     else
@@ -2396,6 +4216,7 @@ ofl_structs_state_stats_print(FILE *stream, struct ofl_exp_state_stats *s, struc
         fprintf(stream, "%"PRIu32"\"", s->entry.state);
         if(s->entry.key_len!=0)
             fprintf(stream, ", dur_s=\"%u\", dur_ns=\"%09u\", idle_to=\"%u\", idle_rb=\"%u\", hard_to=\"%u\", hard_rb=\"%u\"",s->duration_sec, s->duration_nsec, s->idle_timeout, s->idle_rollback, s->hard_timeout, s->hard_rollback);
+        ofl_structs_state_registers_print(stream, s);
     }
 
     fprintf(stream, "}");
@@ -2421,14 +4242,14 @@ ofl_structs_state_stats_unpack(struct ofp_exp_state_stats const *src, uint8_t co
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ts = ofl_table_to_string(src->table_id);
             OFL_LOG_WARN(LOG_MODULE, "Received state stats has invalid table_id (%s).", ts);
-            free(ts);
+            ofl_free(ts);
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
     }
 
     slen = ntohs(src->length) - sizeof(struct ofp_exp_state_stats);
 
-    s = (struct ofl_exp_state_stats *)malloc(sizeof(struct ofl_exp_state_stats));
+    s = (struct ofl_exp_state_stats *)ofl_malloc(sizeof(struct ofl_exp_state_stats));
     s->table_id =  src->table_id;
     s->duration_sec = ntohl(src->duration_sec);
     s->duration_nsec = ntohl(src->duration_nsec);
@@ -2445,11 +4266,13 @@ ofl_structs_state_stats_unpack(struct ofp_exp_state_stats const *src, uint8_t co
     s->idle_rollback = ntohl(src->idle_rollback);
     s->hard_timeout = ntohl(src->hard_timeout);
     s->hard_rollback = ntohl(src->hard_rollback);
+    for (i = 0; i < OFPSC_MAX_REGISTERS; i++)
+        s->registers[i] = ntoh64(src->registers[i]);
 
     if (slen != 0) {
         *len = *len - ntohs(src->length) + slen;
         OFL_LOG_WARN(LOG_MODULE, "The received state stats contained extra bytes (%zu).", slen);
-        free(s);
+        ofl_free(s);
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
     }
     *len -= ntohs(src->length);
@@ -2486,21 +4309,33 @@ ofl_exp_stats_type_print(FILE *stream, uint32_t type)
         case (OFPMP_EXP_STATE_STATS):          { fprintf(stream, "state"); return; }
         case (OFPMP_EXP_STATE_STATS_NUM):          { fprintf(stream, "state_num"); return; }
         case (OFPMP_EXP_GLOBAL_STATE_STATS):          { fprintf(stream, "global_state"); return; }
+        case (OFPMP_EXP_STATE_TABLE_STATS):          { fprintf(stream, "state_table"); return; }
         default: {                    fprintf(stream, "?(%u)", type); return; }
     }
 }
 
+void
+ofl_exp_state_eviction_print(FILE *stream, uint8_t eviction)
+{
+    switch (eviction) {
+        case (OFPSE_LRU):     { fprintf(stream, "lru"); return; }
+        case (OFPSE_OLDEST):  { fprintf(stream, "oldest"); return; }
+        case (OFPSE_RANDOM):  { fprintf(stream, "random"); return; }
+        default: {              fprintf(stream, "?(%u)", eviction); return; }
+    }
+}
+
 
 /*Functions used by experimenter match fields*/
 
 void
 ofl_structs_match_exp_put8(struct ofl_match *match, uint32_t header, uint32_t experimenter_id, uint8_t value)
 {
-   struct ofl_match_tlv *m = xmalloc(sizeof (struct ofl_match_tlv));
+   struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
    int len = sizeof(uint8_t);
 
    m->header = header;
-   m->value = malloc(EXP_ID_LEN + len);
+   m->value = ofl_malloc(EXP_ID_LEN + len);
    memcpy(m->value, &experimenter_id, EXP_ID_LEN);
    memcpy(m->value + EXP_ID_LEN, &value, len);
    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -2510,11 +4345,11 @@ ofl_structs_match_exp_put8(struct ofl_match *match, uint32_t header, uint32_t ex
 void
 ofl_structs_match_exp_put8m(struct ofl_match *match, uint32_t header, uint32_t experimenter_id, uint8_t value, uint8_t mask)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint8_t);
 
     m->header = header;
-    m->value = malloc(EXP_ID_LEN + len*2);
+    m->value = ofl_malloc(EXP_ID_LEN + len*2);
     memcpy(m->value, &experimenter_id, EXP_ID_LEN);
     memcpy(m->value + EXP_ID_LEN, &value, len);
     memcpy(m->value + EXP_ID_LEN + len, &mask, len);
@@ -2525,11 +4360,11 @@ ofl_structs_match_exp_put8m(struct ofl_match *match, uint32_t header, uint32_t e
 void
 ofl_structs_match_exp_put16(struct ofl_match *match, uint32_t header, uint32_t experimenter_id, uint16_t value)
 {
-   struct ofl_match_tlv *m = xmalloc(sizeof (struct ofl_match_tlv));
+   struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
    int len = sizeof(uint16_t);
 
    m->header = header;
-   m->value = malloc(EXP_ID_LEN + len);
+   m->value = ofl_malloc(EXP_ID_LEN + len);
    memcpy(m->value, &experimenter_id, EXP_ID_LEN);
    memcpy(m->value + EXP_ID_LEN, &value, len);
    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -2539,11 +4374,11 @@ ofl_structs_match_exp_put16(struct ofl_match *match, uint32_t header, uint32_t e
 void
 ofl_structs_match_exp_put16m(struct ofl_match *match, uint32_t header, uint32_t experimenter_id, uint16_t value, uint16_t mask)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint16_t);
 
     m->header = header;
-    m->value = malloc(EXP_ID_LEN + len*2);
+    m->value = ofl_malloc(EXP_ID_LEN + len*2);
     memcpy(m->value, &experimenter_id, EXP_ID_LEN);
     memcpy(m->value + EXP_ID_LEN, &value, len);
     memcpy(m->value + EXP_ID_LEN + len, &mask, len);
@@ -2554,11 +4389,11 @@ ofl_structs_match_exp_put16m(struct ofl_match *match, uint32_t header, uint32_t
 void
 ofl_structs_match_exp_put32(struct ofl_match *match, uint32_t header, uint32_t experimenter_id, uint32_t value)
 {
-   struct ofl_match_tlv *m = xmalloc(sizeof (struct ofl_match_tlv));
+   struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
    int len = sizeof(uint32_t);
 
    m->header = header;
-   m->value = malloc(EXP_ID_LEN + len);
+   m->value = ofl_malloc(EXP_ID_LEN + len);
    memcpy(m->value, &experimenter_id, EXP_ID_LEN);
    memcpy(m->value + EXP_ID_LEN, &value, len);
    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -2568,11 +4403,11 @@ ofl_structs_match_exp_put32(struct ofl_match *match, uint32_t header, uint32_t e
 void
 ofl_structs_match_exp_put32m(struct ofl_match *match, uint32_t header, uint32_t experimenter_id, uint32_t value, uint32_t mask)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint32_t);
 
     m->header = header;
-    m->value = malloc(EXP_ID_LEN + len*2);
+    m->value = ofl_malloc(EXP_ID_LEN + len*2);
     memcpy(m->value, &experimenter_id, EXP_ID_LEN);
     memcpy(m->value + EXP_ID_LEN, &value, len);
     memcpy(m->value + EXP_ID_LEN + len, &mask, len);
@@ -2583,11 +4418,11 @@ ofl_structs_match_exp_put32m(struct ofl_match *match, uint32_t header, uint32_t
 void
 ofl_structs_match_exp_put64(struct ofl_match *match, uint32_t header, uint32_t experimenter_id, uint64_t value)
 {
-   struct ofl_match_tlv *m = xmalloc(sizeof (struct ofl_match_tlv));
+   struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
    int len = sizeof(uint64_t);
 
    m->header = header;
-   m->value = malloc(EXP_ID_LEN + len);
+   m->value = ofl_malloc(EXP_ID_LEN + len);
    memcpy(m->value, &experimenter_id, EXP_ID_LEN);
    memcpy(m->value + EXP_ID_LEN, &value, len);
    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -2597,11 +4432,11 @@ ofl_structs_match_exp_put64(struct ofl_match *match, uint32_t header, uint32_t e
 void
 ofl_structs_match_exp_put64m(struct ofl_match *match, uint32_t header, uint32_t experimenter_id, uint64_t value, uint64_t mask)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint64_t);
 
     m->header = header;
-    m->value = malloc(EXP_ID_LEN + len*2);
+    m->value = ofl_malloc(EXP_ID_LEN + len*2);
     memcpy(m->value, &experimenter_id, EXP_ID_LEN);
     memcpy(m->value + EXP_ID_LEN, &value, len);
     memcpy(m->value + EXP_ID_LEN + len, &mask, len);
@@ -2620,8 +4455,8 @@ get_experimenter_id(struct ofl_msg_header const *msg)
     if (msg->type == OFPT_EXPERIMENTER){
         exp_id = ((struct ofl_msg_experimenter *) msg)->experimenter_id;
     }
-    else if (msg->type == OFPT_MULTIPART_REQUEST && ((struct ofl_exp_openstate_msg_multipart_request *) msg)->type == OFPMP_EXP_STATE_STATS_NUM){
-        exp_id = ((struct ofl_exp_openstate_msg_multipart_request *) msg)->header.experimenter_id;
+    else if (msg->type == OFPT_MULTIPART_REQUEST && ((struct ofl_msg_multipart_request_header *) msg)->type == OFPMP_EXPERIMENTER){
+        exp_id = ((struct ofl_msg_multipart_request_experimenter *) msg)->experimenter_id;
     }
     /*if not, the error is triggered by an experimenter match/action*/
     else if(msg->type == OFPT_FLOW_MOD) {
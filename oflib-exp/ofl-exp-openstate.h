@@ -1,7 +1,9 @@
 #ifndef OFL_EXP_OPENSTATE_H
 #define OFL_EXP_OPENSTATE_H 1
 
+#include <pthread.h>
 #include "../lib/hmap.h"
+#include "../lib/list.h"
 #include "../udatapath/packet.h"
 #include "../udatapath/pipeline.h"
 #include "../oflib/ofl-structs.h"
@@ -13,6 +15,21 @@
 #define MAX_STATE_KEY_LEN 48
 
 #define STATE_DEFAULT 0
+
+/* The timeouts of a state table run on a hierarchical timing wheel of
+ * STATE_WHEEL_LEVELS levels of STATE_WHEEL_SLOTS slots.  A level 0 slot
+ * spans one tick of 2^STATE_WHEEL_TICK_BITS us, a slot of level i spans
+ * STATE_WHEEL_SLOTS^i ticks; the top level covers the 2^32 us of the longest
+ * timeout. */
+#define STATE_WHEEL_TICK_BITS 8
+#define STATE_WHEEL_BITS 6
+#define STATE_WHEEL_SLOTS (1 << STATE_WHEEL_BITS)
+#define STATE_WHEEL_LEVELS 4
+
+/* A state table is split in 2^STATE_TABLE_SHARD_BITS shards, the shard of a
+ * key picked by the top bits of its hash. */
+#define STATE_TABLE_SHARD_BITS 2
+#define STATE_TABLE_SHARDS (1 << STATE_TABLE_SHARD_BITS)
 /**************************************************************************/
 /*                        experimenter messages ofl_exp                   */
 /**************************************************************************/
@@ -72,11 +89,43 @@ struct ofl_exp_del_flow_state {
     uint8_t key[OFPSC_MAX_KEY_LEN];
 };
 
+/* The bulk commands carry their entries out of the payload. */
+struct ofl_exp_set_flow_states {
+    uint8_t table_id;
+    uint32_t key_len;
+    size_t n_entries;
+    struct ofl_exp_set_flow_state *entries;
+};
+
+struct ofl_exp_del_flow_states {
+    uint8_t table_id;
+    uint32_t key_len;
+    size_t n_keys;
+    uint8_t *keys;          /* 'n_keys' keys of 'key_len' bytes. */
+};
+
+struct ofl_exp_del_flow_states_by_state {
+    uint8_t table_id;       /* OFPTT_ALL for all the stages. */
+    uint32_t state;
+    uint32_t state_mask;
+};
+
+struct ofl_exp_flush_state_table {
+    uint8_t table_id;       /* OFPTT_ALL for all the stages. */
+};
+
 struct ofl_exp_set_global_state {
     uint32_t global_state;
     uint32_t global_state_mask;
 };
 
+struct ofl_exp_set_table_limits {
+    uint8_t table_id;
+    uint8_t eviction;       /* OFPSE_* */
+    uint32_t max_entries;
+    uint64_t max_bytes;
+};
+
 /*************************
 * Multipart reply message: State entry statistics
 *************************/
@@ -97,6 +146,7 @@ struct ofl_exp_state_stats {
     uint32_t                        hard_timeout;  /* Number of seconds before expiration. */
     uint32_t                        idle_timeout;  /* Number of seconds idle before expiration. */
     struct ofl_exp_state_entry      entry;         /* Description of the state entry. */
+    uint64_t                        registers[OFPSC_MAX_REGISTERS];
 };
 
 struct ofl_exp_msg_multipart_request_state {
@@ -123,6 +173,8 @@ struct ofl_exp_msg_multipart_request_state_num {
     uint8_t                  table_id; /* ID of table to read
                                            (from ofp_table_multipart), 0xff for all
                                            tables. */
+    uint8_t                  get_from_state;
+    uint32_t                 state;
 };
 
 struct ofl_exp_msg_multipart_reply_state_num {
@@ -130,6 +182,22 @@ struct ofl_exp_msg_multipart_reply_state_num {
     uint32_t count;
 };
 
+struct ofl_exp_msg_multipart_request_state_table {
+    struct ofl_exp_openstate_msg_multipart_request   header; /* OFPMP_STATE_TABLE */
+    uint8_t                  table_id;
+};
+
+struct ofl_exp_msg_multipart_reply_state_table {
+    struct ofl_exp_openstate_msg_multipart_reply   header; /* OFPMP_STATE_TABLE */
+    uint8_t    table_id;
+    uint8_t    eviction;
+    uint32_t   count;
+    uint32_t   max_entries;
+    uint64_t   bytes;
+    uint64_t   max_bytes;
+    uint64_t   evictions;
+};
+
 struct ofl_exp_msg_multipart_request_global_state {
     struct ofl_exp_openstate_msg_multipart_request   header; /* OFPMP_GLOBAL_STATE */
 };
@@ -168,41 +236,184 @@ struct ofl_exp_action_set_global_state {
     uint32_t global_state_mask;
 };
 
+struct ofl_exp_action_inc_state_reg {
+    struct ofl_exp_openstate_act_header   header; /* OFPAT_EXP_INC_STATE_REG */
+
+    uint8_t table_id;
+    uint8_t reg;
+    uint8_t flags;    /* OFPSRF_* */
+    uint64_t value;
+};
+
+struct ofl_exp_action_set_state_reg {
+    struct ofl_exp_openstate_act_header   header; /* OFPAT_EXP_SET_STATE_REG */
+
+    uint8_t table_id;
+    uint8_t reg;
+    uint64_t value;
+};
+
+struct ofl_exp_action_cmp_set_state {
+    struct ofl_exp_openstate_act_header   header; /* OFPAT_EXP_CMP_SET_STATE */
+
+    uint8_t table_id;
+    uint8_t reg;
+    uint8_t cmp;      /* OFPSRC_* */
+    uint64_t value;
+    uint32_t state;
+    uint32_t state_mask;
+};
+
 
 /*************************************************************************/
 /*                        experimenter state table                       */
 /*************************************************************************/
 
 
+/* Where a field of a compiled key extractor is copied from. */
+enum state_key_src {
+    STATE_KEY_MATCH,        /* the packet's match, looked up by header. */
+    STATE_KEY_IN_PORT,
+    STATE_KEY_ETH,
+    STATE_KEY_IPV4,
+    STATE_KEY_IPV6,
+    STATE_KEY_IP_PROTO,     /* of the IPv4 or IPv6 header. */
+    STATE_KEY_TCP,
+    STATE_KEY_UDP
+};
+
+/* Copy of a field into the key: 'len' bytes at 'offset' of the header of
+ * 'src' of a parsed packet, byte swapped if the match holds the field in
+ * host byte order. */
+struct key_copy {
+    uint32_t                    header;
+    uint8_t                     src;     /* STATE_KEY_* */
+    uint8_t                     offset;
+    uint8_t                     len;
+    bool                        swap;
+};
+
 struct key_extractor {
     uint8_t                     table_id;
     uint32_t                    field_count;
     uint32_t                    fields[MAX_EXTRACTION_FIELD_COUNT];
+    /* Set by state_table_set_extractor(). */
+    struct key_copy             copies[MAX_EXTRACTION_FIELD_COUNT];
+    bool                        compiled; /* no copy is from the match. */
 };
 
 struct state_entry {
     struct hmap_node            hmap_node;
-    struct hmap_node            hard_node;
-    struct hmap_node            idle_node;
+    struct list                 timer_node; /* in a wheel slot, if the entry
+                                               has a timeout. */
+    struct list                 evict_node; /* in the table's evict list. */
+    struct list                 state_node; /* in the group of its state. */
+    uint64_t                    timer_tick; /* tick the timer is due at. */
     uint8_t             key[MAX_STATE_KEY_LEN];
     uint32_t                state;
-    struct ofl_exp_state_stats   *stats;
+    uint32_t                hard_rollback;
+    uint32_t                idle_rollback;
+    uint32_t                hard_timeout; /* [us] */
+    uint32_t                idle_timeout; /* [us] */
     uint64_t                created;  /* time the entry was created at [us] */
     uint64_t                remove_at; /* time the entry should be removed at
                                            due to its hard timeout. [us] */
     uint64_t                last_used; /* last time the flow entry matched a packet [us]*/
+    uint64_t                registers[OFPSC_MAX_REGISTERS];
+};
+
+struct state_wheel {
+    uint64_t                    tick;     /* the timers due up to this tick
+                                             have run. */
+    size_t                      n_timers;
+    struct list                 slots[STATE_WHEEL_LEVELS][STATE_WHEEL_SLOTS];
+};
+
+/* The entries of a shard in one state, for the state stats to reach them
+ * without a walk of the whole shard. */
+struct state_group {
+    struct hmap_node            node;     /* in the shard's groups, by the
+                                             hash of 'state'. */
+    uint32_t                    state;
+    size_t                      n_entries;
+    struct list                 entries;  /* by their state_node. */
+};
+
+/* The entries of a state table whose keys hash to the shard, with their
+ * timers and eviction order.  All of it is guarded by 'mutex'. */
+struct state_shard {
+    pthread_mutex_t             mutex;
+    struct hmap                 entries;
+    struct hmap                 groups;   /* state_group's, one per state
+                                             its entries are in. */
+    struct state_wheel          wheel;    /* entries with a timeout. */
+    struct list                 evict;    /* entries, the first to evict
+                                             first under OFPSE_LRU and
+                                             OFPSE_OLDEST. */
+    uint64_t                    evictions;
 };
 
+/* Packets and state mods for a key lock only the shard of the key.  The
+ * extractors and limits are changed with all the shards locked; 'seq' is odd
+ * while the extractors change, so that a key built from them is checked to
+ * be still valid once its shard is locked. */
 struct state_table {
     struct key_extractor        read_key;
     struct key_extractor        write_key;
-    struct hmap                 state_entries;
-    struct hmap                 hard_entries;
-    struct hmap                 idle_entries;
-    struct state_entry          default_state_entry;
+    uint32_t                    key_len;   /* bytes of the keys hashed and
+                                              compared; the rest of the
+                                              key is zero. */
+    bool                        same_key;  /* the read and write keys of a
+                                              packet are the same, and are
+                                              only read from its headers. */
+    unsigned int                seq;
+    uint64_t                    now;       /* time of the last timeout run,
+                                              that entries are stamped with
+                                              [us] */
+    size_t                      n_entries; /* over all the shards. */
+    struct state_shard          shards[STATE_TABLE_SHARDS];
+    uint8_t                     eviction; /* OFPSE_* */
+    uint32_t                    max_entries; /* 0 for no limit. */
+    uint64_t                    max_bytes;   /* 0 for no limit. */
     uint8_t stateful;
 };
 
+/* A stage in a snapshot of the state tables, followed by its 'n_entries'
+ * entries, each a state_entry_snapshot and the 'key_len' bytes of its key
+ * padded to 8 bytes.  Snapshots are only read back by the datapath that
+ * wrote them, so they are kept in host byte order. */
+struct state_table_snapshot {
+    uint8_t                     table_id;
+    uint8_t                     stateful;
+    uint8_t                     eviction;    /* OFPSE_* */
+    uint8_t                     pad;
+    uint32_t                    key_len;
+    uint32_t                    read_count;
+    uint32_t                    write_count;
+    uint32_t                    read_fields[MAX_EXTRACTION_FIELD_COUNT];
+    uint32_t                    write_fields[MAX_EXTRACTION_FIELD_COUNT];
+    uint32_t                    max_entries;
+    uint32_t                    pad2;
+    uint64_t                    max_bytes;
+    uint64_t                    n_entries;
+};
+
+/* The times of a saved entry are relative to the clock of its table when
+ * saved, so that they are re-based on the clock of the table restored. */
+struct state_entry_snapshot {
+    uint32_t                    state;
+    uint32_t                    hard_rollback;
+    uint32_t                    idle_rollback;
+    uint32_t                    hard_timeout; /* [us] */
+    uint32_t                    idle_timeout; /* [us] */
+    uint32_t                    pad;
+    uint64_t                    age;          /* since created [us] */
+    uint64_t                    idle;         /* since last used [us] */
+    uint64_t                    hard_left;    /* until the hard timeout [us] */
+    uint64_t                    registers[OFPSC_MAX_REGISTERS];
+    uint8_t                     key[];
+};
+
 /*experimenter table functions*/
 struct state_table *
 state_table_create(void);
@@ -215,23 +426,61 @@ state_table_is_stateful(struct state_table *);
 
 bool state_table_is_configured(struct state_table *table);
 
-struct state_entry *
-state_table_lookup(struct state_table*, struct packet *);
-
+/* Sets the state of 'pkt' to the one of its key in 'table', or leaves the
+ * packet without a state if it lacks a field of the lookup key. */
 void
-state_table_write_state(struct state_entry *, struct packet *);
+state_table_lookup(struct state_table*, struct packet *);
 
 ofl_err
 state_table_set_state(struct state_table *, struct packet *, struct ofl_exp_set_flow_state *msg, struct ofl_exp_action_set_state *act);
 
+/* Applies register action 'act' (OFPAT_EXP_INC_STATE_REG,
+ * OFPAT_EXP_SET_STATE_REG or OFPAT_EXP_CMP_SET_STATE) to the entry of the
+ * update-scope key of 'pkt' in 'table'. */
+void
+state_table_reg_action(struct state_table *, struct packet *, struct ofl_exp_openstate_act_header const *act);
+
 ofl_err
 state_table_set_extractor(struct state_table *, struct key_extractor *, int);
 
 ofl_err
 state_table_del_state(struct state_table *, uint8_t *, uint32_t);
 
+ofl_err
+state_table_set_limits(struct state_table *, struct ofl_exp_set_table_limits *);
+
+/* Apply the entries or keys of a bulk state mod to 'table' in one pass,
+ * returning the first error met. */
+ofl_err
+state_table_set_states(struct state_table *, struct ofl_exp_set_flow_states *);
+
+ofl_err
+state_table_del_states(struct state_table *, struct ofl_exp_del_flow_states *);
+
+/* Drops the entries of 'table' whose state matches 'state' under 'mask'; a
+ * 0 'mask' flushes the table. */
+void
+state_table_del_states_by_state(struct state_table *, uint32_t state, uint32_t mask);
+
+/* Runs the timeouts of 'table' due by 'now', in us of time_usec(). */
 void
-state_table_timeout(struct state_table *table);
+state_table_timeout(struct state_table *table, uint64_t now);
+
+/* Returns the time by which state_table_timeout() should run next, in us of
+ * time_usec(), or UINT64_MAX if 'table' has no timeout pending. */
+uint64_t
+state_table_next_timeout(struct state_table *table);
+
+/* Appends to 'buf' a state_table_snapshot of 'table', the stage 'table_id',
+ * and its entries.  Appends nothing for a stage never configured. */
+void
+state_table_save(struct state_table *table, uint8_t table_id, struct ofpbuf *buf);
+
+/* Restores in 'table', which has no entries, the stage saved in the 'len'
+ * bytes at 'ts', evicting the entries beyond its limits.  Returns the bytes
+ * the stage takes, or 0 if they do not hold a valid one. */
+size_t
+state_table_restore(struct state_table *table, struct state_table_snapshot const *ts, size_t len);
 
 /*experimenter message functions*/
 
@@ -322,6 +571,9 @@ handle_stats_request_state(struct pipeline *pl, struct ofl_exp_msg_multipart_req
 ofl_err
 handle_stats_request_state_num(struct pipeline *pl, struct ofl_exp_msg_multipart_request_state_num *msg, const struct sender *sender, struct ofl_exp_msg_multipart_reply_state_num *reply);
 
+ofl_err
+handle_stats_request_state_table(struct pipeline *pl, struct ofl_exp_msg_multipart_request_state_table *msg, const struct sender *sender, struct ofl_exp_msg_multipart_reply_state_table *reply);
+
 /* Handles a global state stats request. */
 ofl_err
 handle_stats_request_global_state(struct pipeline *pl, const struct sender *sender, struct ofl_exp_msg_multipart_reply_global_state *reply);
@@ -385,6 +637,9 @@ ofl_exp_openstate_error_to_string(struct ofl_msg_exp_error const *msg);
 void
 ofl_exp_stats_type_print(FILE *stream, uint32_t type);
 
+void
+ofl_exp_state_eviction_print(FILE *stream, uint8_t eviction);
+
 void
 ofl_structs_match_exp_put8(struct ofl_match *match, uint32_t header, uint32_t experimenter_id, uint8_t value);
 
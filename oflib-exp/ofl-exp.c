@@ -38,6 +38,7 @@
 #include "ofl-exp-openflow.h"
 #include "ofl-exp-openstate.h"
 #include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-arena.h"
 #include "../oflib/ofl-log.h"
 #include "openflow/openflow.h"
 #include "openflow/nicira-ext.h"
@@ -126,7 +127,7 @@ ofl_exp_msg_free(struct ofl_msg_experimenter *msg)
         }
         default: {
             OFL_LOG_WARN(LOG_MODULE, "Trying to free unknown EXPERIMENTER message (%u).", msg->experimenter_id);
-            free(msg);
+            ofl_free(msg);
             return -1;
         }
     }
@@ -249,6 +250,8 @@ ofl_exp_stats_req_pack (struct ofl_msg_multipart_request_header const *msg, uint
 
         case (OPENSTATE_VENDOR_ID):
             return ofl_exp_openstate_stats_req_pack(ext, buf, buf_len, exp);
+        case (OPENFLOW_VENDOR_ID):
+            return ofl_exp_openflow_stats_req_pack(ext, buf, buf_len, exp);
 
         default: {
             OFL_LOG_WARN(LOG_MODULE, "Trying to pack unknown multipart EXPERIMENTER message (%u).", ext->experimenter_id);
@@ -267,6 +270,9 @@ ofl_exp_stats_reply_pack (struct ofl_msg_multipart_reply_header const *msg, uint
         case (OPENSTATE_VENDOR_ID): {
             return ofl_exp_openstate_stats_reply_pack(ext, buf, buf_len, exp);
         }
+        case (OPENFLOW_VENDOR_ID): {
+            return ofl_exp_openflow_stats_reply_pack(ext, buf, buf_len);
+        }
 
         default: {
             OFL_LOG_WARN(LOG_MODULE, "Trying to pack unknown multipart EXPERIMENTER message (%u).", ext->experimenter_id);
@@ -290,6 +296,9 @@ ofl_exp_stats_req_unpack (struct ofp_multipart_request const *os, uint8_t const
         case (OPENSTATE_VENDOR_ID): {
             return ofl_exp_openstate_stats_req_unpack(os, buf, len, msg, exp);
         }
+        case (OPENFLOW_VENDOR_ID): {
+            return ofl_exp_openflow_stats_req_unpack(os, buf, len, msg, exp);
+        }
         default: {
             OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown EXPERIMENTER message %"PRIx32".", ntohl(ext->experimenter));
             return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
@@ -312,6 +321,9 @@ ofl_exp_stats_reply_unpack (struct ofp_multipart_reply const *os, uint8_t const
         case (OPENSTATE_VENDOR_ID): {
             return ofl_exp_openstate_stats_reply_unpack(os, buf, len, (struct ofl_msg_multipart_reply_header **)msg, exp);
         }
+        case (OPENFLOW_VENDOR_ID): {
+            return ofl_exp_openflow_stats_reply_unpack(os, len, msg);
+        }
         default: {
             OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown EXPERIMENTER message (%u).", ntohl(ext->experimenter));
             return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
@@ -327,6 +339,9 @@ ofl_exp_stats_req_to_string (struct ofl_msg_multipart_request_header const *msg,
         case (OPENSTATE_VENDOR_ID): {
             return ofl_exp_openstate_stats_request_to_string(ext, exp);
         }
+        case (OPENFLOW_VENDOR_ID): {
+            return ofl_exp_openflow_stats_req_to_string(ext, exp);
+        }
         default: {
         return ofl_exp_unknown_id_to_string(ext->experimenter_id);
         }
@@ -342,6 +357,9 @@ ofl_exp_stats_reply_to_string (struct ofl_msg_multipart_reply_header const *msg,
         case (OPENSTATE_VENDOR_ID): {
             return ofl_exp_openstate_stats_reply_to_string(ext, exp);
         }
+        case (OPENFLOW_VENDOR_ID): {
+            return ofl_exp_openflow_stats_reply_to_string(ext, exp);
+        }
         default: {
             return ofl_exp_unknown_id_to_string(ext->experimenter_id);
         }
@@ -358,9 +376,12 @@ ofl_exp_stats_req_free (struct ofl_msg_multipart_request_header *msg)
         case (OPENSTATE_VENDOR_ID): {
             return ofl_exp_openstate_stats_req_free(msg);
         }
+        case (OPENFLOW_VENDOR_ID): {
+            return ofl_exp_openflow_stats_req_free(msg);
+        }
         default: {
             OFL_LOG_WARN(LOG_MODULE, "Trying to free unknown EXPERIMENTER message (%u).", exp->experimenter_id);
-            free(msg);
+            ofl_free(msg);
             return -1;
         }
     }
@@ -374,9 +395,12 @@ ofl_exp_stats_reply_free (struct ofl_msg_multipart_reply_header *msg)
         case (OPENSTATE_VENDOR_ID): {
             return ofl_exp_openstate_stats_reply_free(msg);
         }
+        case (OPENFLOW_VENDOR_ID): {
+            return ofl_exp_openflow_stats_reply_free(msg);
+        }
         default: {
             OFL_LOG_WARN(LOG_MODULE, "Trying to free unknown EXPERIMENTER message (%u).", exp->experimenter_id);
-            free(msg);
+            ofl_free(msg);
             return -1;
         }
     }
@@ -561,6 +585,8 @@ ofl_exp_err_pack(struct ofl_msg_exp_error const *msg, uint8_t **buf, size_t *buf
         case OPENSTATE_VENDOR_ID:{
             ofl_exp_openstate_error_pack(msg,buf,buf_len);
             break;}
+        case OPENFLOW_VENDOR_ID:{
+            return ofl_exp_openflow_error_pack(msg, buf, buf_len);}
         default:{
             OFL_LOG_WARN(LOG_MODULE, "Trying to pack unknown ERROR EXPERIMENTER message (%u).", msg->experimenter);
             return -1;}
@@ -574,6 +600,8 @@ ofl_exp_err_free(struct ofl_msg_exp_error *msg){
         case OPENSTATE_VENDOR_ID:{
             ofl_exp_openstate_error_free(msg);
             break;}
+        case OPENFLOW_VENDOR_ID:{
+            return ofl_exp_openflow_error_free(msg);}
         default:{
             OFL_LOG_WARN(LOG_MODULE, "Trying to free unknown ERROR EXPERIMENTER message (%u).", msg->experimenter);
             return -1;}
@@ -588,6 +616,9 @@ ofl_exp_err_to_string(struct ofl_msg_exp_error const *msg)
         case OPENSTATE_VENDOR_ID:{
             return ofl_exp_openstate_error_to_string(msg);
         }
+        case OPENFLOW_VENDOR_ID:{
+            return ofl_exp_openflow_error_to_string(msg);
+        }
         default:{
             return ofl_exp_unknown_id_to_string(msg->experimenter);
         }
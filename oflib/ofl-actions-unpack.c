@@ -36,6 +36,7 @@
 #include "ofl.h"
 #include "ofl-utils.h"
 #include "ofl-actions.h"
+#include "ofl-arena.h"
 #include "ofl-structs.h"
 #include "ofl-messages.h"
 #include "ofl-print.h"
@@ -74,7 +75,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
             struct ofp_action_output *sa;
             struct ofl_action_output *da;
 
-            da = (struct ofl_action_output *)malloc(sizeof(struct ofl_action_output));
+            da = (struct ofl_action_output *)ofl_malloc(sizeof(struct ofl_action_output));
             *dst = (struct ofl_action_header *)da;
 
             if (*len < sizeof(struct ofp_action_output)) {
@@ -91,7 +92,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
                 if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
                     char *ps = ofl_port_to_string(ntohl(sa->port));
                     OFL_LOG_WARN(LOG_MODULE, "Received OUTPUT action has invalid port (%s).", ps);
-                    free(ps);
+                    ofl_free(ps);
                 }
                 error = ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_OUT_PORT);
                 break;
@@ -106,14 +107,14 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
         case OFPAT_COPY_TTL_OUT: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
         case OFPAT_COPY_TTL_IN: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -121,7 +122,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
             struct ofp_action_mpls_ttl *sa;
             struct ofl_action_mpls_ttl *da;
 
-            da = (struct ofl_action_mpls_ttl *)malloc(sizeof(struct ofl_action_mpls_ttl));
+            da = (struct ofl_action_mpls_ttl *)ofl_malloc(sizeof(struct ofl_action_mpls_ttl));
             *dst = (struct ofl_action_header *)da;
 
             if (*len < sizeof(struct ofp_action_mpls_ttl)) {
@@ -141,7 +142,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
         case OFPAT_DEC_MPLS_TTL: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_mpls_ttl);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -151,7 +152,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
             struct ofp_action_push *sa;
             struct ofl_action_push *da;
 
-            da = (struct ofl_action_push *)malloc(sizeof(struct ofl_action_push));
+            da = (struct ofl_action_push *)ofl_malloc(sizeof(struct ofl_action_push));
             *dst = (struct ofl_action_header *)da;
 
             if (*len < sizeof(struct ofp_action_push)) {
@@ -185,7 +186,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
         case OFPAT_POP_PBB: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
                 
@@ -193,7 +194,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
             struct ofp_action_pop_mpls *sa;
             struct ofl_action_pop_mpls *da;
 
-            da = (struct ofl_action_pop_mpls *)malloc(sizeof(struct ofl_action_pop_mpls));
+            da = (struct ofl_action_pop_mpls *)ofl_malloc(sizeof(struct ofl_action_pop_mpls));
             *dst = (struct ofl_action_header *)da;
 
             if (*len < sizeof(struct ofp_action_pop_mpls)) {
@@ -214,7 +215,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
             struct ofp_action_set_queue *sa;
             struct ofl_action_set_queue *da;
 
-            da = (struct ofl_action_set_queue *)malloc(sizeof(struct ofl_action_set_queue));
+            da = (struct ofl_action_set_queue *)ofl_malloc(sizeof(struct ofl_action_set_queue));
             *dst = (struct ofl_action_header *)da;
 
             if (*len < sizeof(struct ofp_action_set_queue)) {
@@ -235,7 +236,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
             struct ofp_action_group *sa;
             struct ofl_action_group *da;
 
-            da = (struct ofl_action_group *)malloc(sizeof(struct ofl_action_group));
+            da = (struct ofl_action_group *)ofl_malloc(sizeof(struct ofl_action_group));
             *dst = (struct ofl_action_header *)da;
 
             if (*len < sizeof(struct ofp_action_group)) {
@@ -250,7 +251,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
                 if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
                     char *gs = ofl_group_to_string(ntohl(sa->group_id));
                     OFL_LOG_WARN(LOG_MODULE, "Received GROUP action has invalid group id (%s).", gs);
-                    free(gs);
+                    ofl_free(gs);
                 }
                 error = ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_OUT_GROUP);
                 break;
@@ -266,7 +267,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
             struct ofp_action_nw_ttl *sa;
             struct ofl_action_set_nw_ttl *da;
 
-            da = (struct ofl_action_set_nw_ttl *)malloc(sizeof(struct ofl_action_set_nw_ttl));
+            da = (struct ofl_action_set_nw_ttl *)ofl_malloc(sizeof(struct ofl_action_set_nw_ttl));
             *dst = (struct ofl_action_header *)da;
 
             if (*len < sizeof(struct ofp_action_nw_ttl)) {
@@ -286,7 +287,7 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
         case OFPAT_DEC_NW_TTL: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -296,14 +297,14 @@ ofl_actions_unpack(struct ofp_action_header const *src, size_t *len, struct ofl_
             uint8_t *value;
             
             sa = (struct ofp_action_set_field*) src;
-            da = (struct ofl_action_set_field *)malloc(sizeof(struct ofl_action_set_field));
-            da->field = (struct ofl_match_tlv*) malloc(sizeof(struct ofl_match_tlv));
+            da = (struct ofl_action_set_field *)ofl_malloc(sizeof(struct ofl_action_set_field));
+            da->field = (struct ofl_match_tlv*) ofl_malloc(sizeof(struct ofl_match_tlv));
             *dst = (struct ofl_action_header *)da;
             
             memcpy(&da->field->header,sa->field,4);
             da->field->header = ntohl(da->field->header);
             value = (uint8_t *) src + sizeof (struct ofp_action_set_field);
-            da->field->value = malloc(OXM_LENGTH(da->field->header));
+            da->field->value = ofl_malloc(OXM_LENGTH(da->field->header));
 
             /*TODO: need to check if other fields are valid */
             if(da->field->header == OXM_OF_IN_PORT || da->field->header == OXM_OF_IN_PHY_PORT
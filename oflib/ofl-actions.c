@@ -34,6 +34,7 @@
 #include <netinet/in.h>
 #include "ofl.h"
 #include "ofl-actions.h"
+#include "ofl-arena.h"
 #include "ofl-log.h"
 
 #define LOG_MODULE ofl_act
@@ -45,9 +46,9 @@ ofl_actions_free(struct ofl_action_header *act, struct ofl_exp const *exp)
     switch (act->type) {
         case OFPAT_SET_FIELD:{
             struct ofl_action_set_field *a = (struct ofl_action_set_field*) act;
-            free(a->field->value);
-            free(a->field);
-            free(a);
+            ofl_free(a->field->value);
+            ofl_free(a->field);
+            ofl_free(a);
             return;
             break;
         }
@@ -79,7 +80,7 @@ ofl_actions_free(struct ofl_action_header *act, struct ofl_exp const *exp)
         default: {
         }
     }
-    free(act);
+    ofl_free(act);
 }
 
 ofl_err
@@ -0,0 +1,198 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ofl-arena.h"
+#include "util.h"
+
+#define ARENA_ALIGN 16
+#define ARENA_MIN_CHUNK 512
+
+struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;                /* Usable bytes in 'data'. */
+    size_t used;
+    uint8_t data[] __attribute__((aligned(ARENA_ALIGN)));
+};
+
+struct arena_cleanup {
+    struct arena_cleanup *next;
+    void (*cb)(void *);
+    void *aux;
+};
+
+struct ofl_arena {
+    struct arena_chunk *chunks;     /* Most recently added first. */
+    struct arena_cleanup *cleanups;
+};
+
+static __thread struct ofl_arena *current;
+
+static struct arena_chunk *
+arena_chunk_create(size_t size)
+{
+    struct arena_chunk *c;
+
+    size = ROUND_UP(MAX(size, ARENA_MIN_CHUNK), ARENA_ALIGN);
+    c = xmalloc(sizeof *c + size);
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+    return c;
+}
+
+struct ofl_arena *
+ofl_arena_create(size_t size)
+{
+    struct ofl_arena *arena = xmalloc(sizeof *arena);
+
+    arena->chunks = arena_chunk_create(size);
+    arena->cleanups = NULL;
+    return arena;
+}
+
+void
+ofl_arena_destroy(struct ofl_arena *arena)
+{
+    struct arena_cleanup *cu;
+    struct arena_chunk *c, *next;
+
+    if (arena == NULL) {
+        return;
+    }
+    for (cu = arena->cleanups; cu != NULL; cu = cu->next) {
+        cu->cb(cu->aux);
+    }
+    for (c = arena->chunks; c != NULL; c = next) {
+        next = c->next;
+        free(c);
+    }
+    free(arena);
+}
+
+void *
+ofl_arena_alloc(struct ofl_arena *arena, size_t size)
+{
+    struct arena_chunk *c = arena->chunks;
+    void *p;
+
+    size = ROUND_UP(MAX(size, 1), ARENA_ALIGN);
+    if (c->size - c->used < size) {
+        /* Grow geometrically so that a badly sized arena still ends up with
+         * only a handful of chunks. */
+        struct arena_chunk *n = arena_chunk_create(MAX(size, c->size * 2));
+
+        n->next = c;
+        arena->chunks = c = n;
+    }
+    p = c->data + c->used;
+    c->used += size;
+    return p;
+}
+
+void
+ofl_arena_at_destroy(struct ofl_arena *arena, void (*cb)(void *), void *aux)
+{
+    struct arena_cleanup *cu = ofl_arena_alloc(arena, sizeof *cu);
+
+    cu->cb = cb;
+    cu->aux = aux;
+    cu->next = arena->cleanups;
+    arena->cleanups = cu;
+}
+
+bool
+ofl_arena_contains(struct ofl_arena const *arena, void const *p)
+{
+    struct arena_chunk const *c;
+
+    for (c = arena->chunks; c != NULL; c = c->next) {
+        if ((uint8_t const *)p >= c->data
+            && (uint8_t const *)p < c->data + c->size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct ofl_arena *
+ofl_arena_swap(struct ofl_arena *arena)
+{
+    struct ofl_arena *prev = current;
+
+    current = arena;
+    return prev;
+}
+
+struct ofl_arena *
+ofl_arena_current(void)
+{
+    return current;
+}
+
+bool
+ofl_arena_owns(void const *p)
+{
+    return current != NULL && p != NULL && ofl_arena_contains(current, p);
+}
+
+void *
+ofl_malloc(size_t size)
+{
+    return current ? ofl_arena_alloc(current, size) : xmalloc(size);
+}
+
+void *
+ofl_calloc(size_t n, size_t size)
+{
+    void *p;
+
+    if (!current) {
+        return xcalloc(n, size);
+    }
+    p = ofl_arena_alloc(current, n * size);
+    memset(p, 0, n * size);
+    return p;
+}
+
+void *
+ofl_memdup(void const *p, size_t size)
+{
+    return memcpy(ofl_malloc(size), p, size);
+}
+
+void
+ofl_free(void *p)
+{
+    if (!ofl_arena_owns(p)) {
+        free(p);
+    }
+}
@@ -0,0 +1,96 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OFL_ARENA_H
+#define OFL_ARENA_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/****************************************************************************
+ * Bump allocator for decoded OpenFlow messages.
+ *
+ * While an arena is made current with ofl_arena_swap(), the unpack routines
+ * allocate everything they build from it through ofl_malloc() and friends,
+ * and ofl_free() ignores pointers into it.  The whole structure is then
+ * released at once by ofl_arena_destroy().  The current arena is per thread.
+ ****************************************************************************/
+
+struct ofl_arena;
+
+/* Creates an arena whose first chunk can hold 'size' bytes. */
+struct ofl_arena *
+ofl_arena_create(size_t size);
+
+/* Runs the registered cleanups and releases all memory of 'arena'. */
+void
+ofl_arena_destroy(struct ofl_arena *arena);
+
+/* Returns 'size' bytes from 'arena', aligned for any OFLib structure. */
+void *
+ofl_arena_alloc(struct ofl_arena *arena, size_t size);
+
+/* Arranges for 'cb(aux)' to be called when 'arena' is destroyed.  Used for
+ * the few structures that keep heap memory of their own, such as the hash
+ * buckets of a match. */
+void
+ofl_arena_at_destroy(struct ofl_arena *arena, void (*cb)(void *), void *aux);
+
+/* Returns true if 'p' points into memory handed out by 'arena'. */
+bool
+ofl_arena_contains(struct ofl_arena const *arena, void const *p);
+
+/* Makes 'arena' (which may be NULL) the current arena of the calling thread,
+ * and returns the previous one. */
+struct ofl_arena *
+ofl_arena_swap(struct ofl_arena *arena);
+
+/* Returns the current arena of the calling thread, or NULL. */
+struct ofl_arena *
+ofl_arena_current(void);
+
+/* Returns true if 'p' belongs to the current arena of the calling thread. */
+bool
+ofl_arena_owns(void const *p);
+
+/* Allocate from the current arena, or from the heap if there is none. */
+void *
+ofl_malloc(size_t size);
+
+void *
+ofl_calloc(size_t n, size_t size);
+
+void *
+ofl_memdup(void const *p, size_t size);
+
+/* Frees 'p' unless it belongs to the current arena. */
+void
+ofl_free(void *p);
+
+#endif /* OFL_ARENA_H */
@@ -37,6 +37,7 @@
 #include "ofl-structs.h"
 #include "ofl-log.h"
 #include "ofl-utils.h"
+#include "ofpbuf.h"
 #include "openflow/openflow.h"
 
 #define UNUSED __attribute__((__unused__))
@@ -207,6 +208,7 @@ ofl_msg_pack_flow_removed(struct ofl_msg_flow_removed const *msg, uint8_t **buf,
     ofr->duration_sec  = htonl( msg->stats->duration_sec);
     ofr->duration_nsec = htonl( msg->stats->duration_nsec);
     ofr->idle_timeout  = htons( msg->stats->idle_timeout);
+    ofr->hard_timeout  = htons( msg->stats->hard_timeout);
     ofr->packet_count  = hton64(msg->stats->packet_count);
     ofr->byte_count    = hton64(msg->stats->byte_count);
 
@@ -1183,3 +1185,134 @@ ofl_msg_pack(struct ofl_msg_header const *msg, uint32_t xid, uint8_t **buf, size
 
     return 0;
 }
+
+/****************************************************************************
+ * Functions for packing ofl structures straight into ofpbufs.
+ ****************************************************************************/
+
+static int
+ofl_msg_put_packet_in(struct ofl_msg_packet_in const *msg, struct ofpbuf *buf, struct ofl_exp const *exp)
+{
+    struct ofp_packet_in *packet_in;
+
+    ofpbuf_prealloc_tailroom(buf, sizeof(struct ofp_packet_in) + ROUND_UP(msg->match->length - 4 ,8) + msg->data_length + 2);
+
+    packet_in = ofpbuf_put_uninit(buf, sizeof(struct ofp_packet_in) - sizeof(struct ofp_match));
+    packet_in->buffer_id   = htonl(msg->buffer_id);
+    packet_in->total_len   = htons(msg->total_len);
+    packet_in->reason      =       msg->reason;
+    packet_in->table_id    =       msg->table_id;
+    packet_in->cookie      = hton64(msg->cookie);
+
+    ofl_structs_match_put(msg->match, buf, exp);
+    /*padding bytes*/
+    ofpbuf_put_zeros(buf, 2);
+    /* Ethernet frame */
+    if (msg->data_length > 0) {
+        ofpbuf_put(buf, msg->data, msg->data_length);
+    }
+
+    return 0;
+}
+
+static int
+ofl_msg_put_flow_removed(struct ofl_msg_flow_removed const *msg, struct ofpbuf *buf, struct ofl_exp const *exp)
+{
+    struct ofp_flow_removed *ofr;
+
+    ofpbuf_prealloc_tailroom(buf, ROUND_UP((sizeof(struct ofp_flow_removed) -4) + msg->stats->match->length ,8));
+
+    ofr = ofpbuf_put_uninit(buf, sizeof(struct ofp_flow_removed) - sizeof(struct ofp_match));
+    ofr->cookie        = hton64(msg->stats->cookie);
+    ofr->priority      = htons(msg->stats->priority);
+    ofr->reason        =        msg->reason;
+    ofr->table_id      =        msg->stats->table_id;
+    ofr->duration_sec  = htonl( msg->stats->duration_sec);
+    ofr->duration_nsec = htonl( msg->stats->duration_nsec);
+    ofr->idle_timeout  = htons( msg->stats->idle_timeout);
+    ofr->hard_timeout  = htons( msg->stats->hard_timeout);
+    ofr->packet_count  = hton64(msg->stats->packet_count);
+    ofr->byte_count    = hton64(msg->stats->byte_count);
+
+    ofl_structs_match_put(msg->stats->match, buf, exp);
+
+    return 0;
+}
+
+static int
+ofl_msg_put_multipart_reply_flow(struct ofl_msg_multipart_reply_flow const *msg, struct ofpbuf *buf, struct ofl_exp const *exp)
+{
+    size_t start = buf->size;
+    struct ofp_multipart_reply *resp;
+    size_t i;
+
+    /* Reserve the whole reply up front, as ofpbufs grow linearly. */
+    ofpbuf_prealloc_tailroom(buf, sizeof(struct ofp_multipart_reply) + ofl_structs_flow_stats_ofp_total_len((struct ofl_flow_stats const **)msg->stats, msg->stats_num, exp));
+
+    ofpbuf_put_uninit(buf, sizeof(struct ofp_multipart_reply));
+    for (i=0; i<msg->stats_num; i++) {
+        ofl_structs_flow_stats_put(msg->stats[i], buf, exp);
+    }
+
+    resp = (struct ofp_multipart_reply *)((uint8_t *)buf->data + start);
+    resp->type  = htons(msg->header.type);
+    resp->flags = htons(msg->header.flags);
+    memset(resp->pad, 0x00, 4);
+    return 0;
+}
+
+int
+ofl_msg_pack_ofpbuf(struct ofl_msg_header const *msg, uint32_t xid, struct ofpbuf *buf, struct ofl_exp const *exp)
+{
+    size_t start = buf->size;
+    struct ofp_header *oh;
+    uint8_t *data;
+    size_t data_len;
+    int error;
+
+    switch (msg->type) {
+        case OFPT_PACKET_IN: {
+            error = ofl_msg_put_packet_in((struct ofl_msg_packet_in const *)msg, buf, exp);
+            break;
+        }
+        case OFPT_FLOW_REMOVED: {
+            error = ofl_msg_put_flow_removed((struct ofl_msg_flow_removed const *)msg, buf, exp);
+            break;
+        }
+        case OFPT_MULTIPART_REPLY: {
+            if (((struct ofl_msg_multipart_reply_header const *)msg)->type == OFPMP_FLOW) {
+                error = ofl_msg_put_multipart_reply_flow((struct ofl_msg_multipart_reply_flow const *)msg, buf, exp);
+                break;
+            }
+        }
+        /* fall through */
+        default: {
+            error = ofl_msg_pack(msg, xid, &data, &data_len, exp);
+            if (error) {
+                return error;
+            }
+            if (buf->allocated == 0) {
+                /* Take over the packed message instead of copying it. */
+                ofpbuf_use(buf, data, data_len);
+                ofpbuf_put_uninit(buf, data_len);
+            } else {
+                ofpbuf_put(buf, data, data_len);
+                free(data);
+            }
+            return 0;
+        }
+    }
+
+    if (error) {
+        buf->size = start;
+        return error;
+    }
+
+    oh = (struct ofp_header *)((uint8_t *)buf->data + start);
+    oh->version =        OFP_VERSION;
+    oh->type    =        msg->type;
+    oh->length  = htons(buf->size - start);
+    oh->xid     = htonl(xid);
+
+    return 0;
+}
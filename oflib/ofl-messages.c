@@ -35,6 +35,7 @@
 #include <netinet/in.h>
 #include "ofl.h"
 #include "ofl-actions.h"
+#include "ofl-arena.h"
 #include "ofl-messages.h"
 #include "ofl-structs.h"
 #include "ofl-utils.h"
@@ -45,6 +46,18 @@
 
 OFL_LOG_INIT(LOG_MODULE)
 
+/* Releases 'msg' at once if it was decoded into an arena, in which case none of
+ * its parts may be kept, and returns true.  Returns false otherwise. */
+static bool
+ofl_msg_free_arena(struct ofl_msg_header *msg)
+{
+    if (msg->arena == NULL) {
+        return false;
+    }
+    ofl_arena_destroy(msg->arena);
+    return true;
+}
+
 /* Frees the OFlib stats request message along with any dynamically allocated
  * structures. */
 static int
@@ -62,8 +75,8 @@ ofl_msg_free_error(struct ofl_msg_error *msg, struct ofl_exp const *exp)
             }
 	} break;
         default: {
-    free(msg->data);
-    free(msg);
+    ofl_free(msg->data);
+    ofl_free(msg);
     }
     }
     return 0;
@@ -110,7 +123,7 @@ ofl_msg_free_multipart_request(struct ofl_msg_multipart_request_header *msg, str
         default:
             return -1;
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -124,11 +137,11 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
     switch (msg->type) {
         case OFPMP_DESC: {
             struct ofl_msg_reply_desc *stat = (struct ofl_msg_reply_desc *) msg;
-            free(stat->mfr_desc);
-            free(stat->hw_desc);
-            free(stat->sw_desc);
-            free(stat->serial_num);
-            free(stat->dp_desc);
+            ofl_free(stat->mfr_desc);
+            ofl_free(stat->hw_desc);
+            ofl_free(stat->sw_desc);
+            ofl_free(stat->serial_num);
+            ofl_free(stat->dp_desc);
             break;
         }
         case OFPMP_FLOW: {
@@ -175,7 +188,7 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
         }
         case OFPMP_METER_FEATURES:{
             struct ofl_msg_multipart_reply_meter_features *feat = (struct ofl_msg_multipart_reply_meter_features *)msg;
-            free(feat->features);
+            ofl_free(feat->features);
             break;
         }
         case OFPMP_GROUP_DESC: {
@@ -212,13 +225,16 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
         }
     }
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
 int
 ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp const *exp)
 {
+    if (ofl_msg_free_arena(msg)) {
+        return 0;
+    }
     switch (msg->type) {
         case OFPT_HELLO: {
             break;
@@ -228,7 +244,7 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp const *exp)
         }
         case OFPT_ECHO_REQUEST:
         case OFPT_ECHO_REPLY: {
-            free(((struct ofl_msg_echo *)msg)->data);
+            ofl_free(((struct ofl_msg_echo *)msg)->data);
             break;
         }
         case OFPT_EXPERIMENTER: {
@@ -249,16 +265,16 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp const *exp)
             break;
         }
         case OFPT_GET_CONFIG_REPLY: {
-            free(((struct ofl_msg_get_config_reply *)msg)->config);
+            ofl_free(((struct ofl_msg_get_config_reply *)msg)->config);
             break;
         }
         case OFPT_SET_CONFIG: {
-            free(((struct ofl_msg_set_config *)msg)->config);
+            ofl_free(((struct ofl_msg_set_config *)msg)->config);
             break;
         }
         case OFPT_PACKET_IN: {
             ofl_structs_free_match(((struct ofl_msg_packet_in *)msg)->match,NULL);
-            free(((struct ofl_msg_packet_in *)msg)->data);
+            ofl_free(((struct ofl_msg_packet_in *)msg)->data);
             break;
         }
         case OFPT_FLOW_REMOVED: {
@@ -266,7 +282,7 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp const *exp)
             break;
         }
         case OFPT_PORT_STATUS: {
-            free(((struct ofl_msg_port_status *)msg)->desc);
+            ofl_free(((struct ofl_msg_port_status *)msg)->desc);
             break;
         }
         case OFPT_PACKET_OUT: {
@@ -314,49 +330,61 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp const *exp)
         }
     }
     
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
 int 
 ofl_msg_free_meter_mod(struct ofl_msg_meter_mod * msg, bool with_bands)
 {
+    if (ofl_msg_free_arena(&msg->header)) {
+        return 0;
+    }
     if (with_bands) {
        OFL_UTILS_FREE_ARR_FUN(msg->bands, msg->meter_bands_num,
                                   ofl_structs_free_meter_bands);
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
 int
 ofl_msg_free_packet_out(struct ofl_msg_packet_out *msg, bool with_data, struct ofl_exp const *exp)
 {
+    if (ofl_msg_free_arena(&msg->header)) {
+        return 0;
+    }
     if (with_data) {
-        free(msg->data);
+        ofl_free(msg->data);
     }
     OFL_UTILS_FREE_ARR_FUN2(msg->actions, msg->actions_num,
                             ofl_actions_free, exp);
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
 int
 ofl_msg_free_group_mod(struct ofl_msg_group_mod *msg, bool with_buckets, struct ofl_exp const *exp)
 {
+    if (ofl_msg_free_arena(&msg->header)) {
+        return 0;
+    }
     if (with_buckets) {
         OFL_UTILS_FREE_ARR_FUN2(msg->buckets, msg->buckets_num,
                                 ofl_structs_free_bucket, exp);
     }
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
 int
 ofl_msg_free_flow_mod(struct ofl_msg_flow_mod *msg, bool with_match, bool with_instructions, struct ofl_exp const *exp)
 {
+    if (ofl_msg_free_arena(&msg->header)) {
+        return 0;
+    }
     if (with_match) {
         ofl_structs_free_match(msg->match, exp);
     }
@@ -365,7 +393,7 @@ ofl_msg_free_flow_mod(struct ofl_msg_flow_mod *msg, bool with_match, bool with_i
                                 ofl_structs_free_instruction, exp);
     }
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -373,10 +401,13 @@ ofl_msg_free_flow_mod(struct ofl_msg_flow_mod *msg, bool with_match, bool with_i
 int
 ofl_msg_free_flow_removed(struct ofl_msg_flow_removed *msg, bool with_stats, struct ofl_exp const *exp)
 {
+    if (ofl_msg_free_arena(&msg->header)) {
+        return 0;
+    }
     if (with_stats) {
         ofl_structs_free_flow_stats(msg->stats, exp);
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -38,6 +38,7 @@
 
 #include "../include/openflow/openflow.h"
 #include "ofl.h"
+#include "ofl-arena.h"
 #include "ofl-structs.h"
 #include "ofl-actions.h"
 
@@ -49,7 +50,9 @@
 /* The common header for messages. All message structures start with this
  * header, therefore they can be safely cast back and forth */
 struct ofl_msg_header {
-    enum ofp_type   type;   /* One of the OFPT_ constants. */
+    enum ofp_type      type;   /* One of the OFPT_ constants. */
+    struct ofl_arena  *arena;  /* Holds the whole message if it was decoded
+                                  by ofl_msg_unpack_arena, otherwise NULL. */
 };
 
 
@@ -496,6 +499,14 @@ struct ofl_msg_queue_get_config_reply {
 int
 ofl_msg_pack(struct ofl_msg_header const *msg, uint32_t xid, uint8_t **buf, size_t *buf_len, struct ofl_exp const *exp);
 
+/* Packs the message in msg to the tail of the OpenFlow buffer buf, in a single
+ * pass where possible: packet ins, flow removed messages and flow stats
+ * replies are written straight into buf, other messages are packed with
+ * ofl_msg_pack and adopted by buf when it is still unallocated. The return
+ * value is zero on success, in which case buf holds the whole message. */
+int
+ofl_msg_pack_ofpbuf(struct ofl_msg_header const *msg, uint32_t xid, struct ofpbuf *buf, struct ofl_exp const *exp);
+
 /* Unpacks the wire format message in buf to a new OFLib message pointed at by
  * msg. If xid is not null, it will hold the transaction ID of the received
  * message. Returns zero on success. In case of experimenter features, the
@@ -503,6 +514,14 @@ ofl_msg_pack(struct ofl_msg_header const *msg, uint32_t xid, uint8_t **buf, size
 ofl_err
 ofl_msg_unpack(uint8_t const *buf, size_t buf_len, struct ofl_msg_header **msg, uint32_t *xid, struct ofl_exp const *exp);
 
+/* Same as ofl_msg_unpack, but builds the whole message in a single arena
+ * instead of allocating each structure on its own. The message is released
+ * at once by ofl_msg_free, and the partial free functions below always free
+ * it whole, so anything to be kept must be copied out first. On failure msg
+ * is set to NULL. */
+ofl_err
+ofl_msg_unpack_arena(uint8_t const *buf, size_t buf_len, struct ofl_msg_header **msg, uint32_t *xid, struct ofl_exp const *exp);
+
 
 
 /****************************************************************************
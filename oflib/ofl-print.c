@@ -722,6 +722,7 @@ ofl_packet_in_reason_print(FILE *stream, uint8_t reason)
     switch (reason) {
         case (OFPR_NO_MATCH): { fprintf(stream, "no_match"); return; }
         case (OFPR_ACTION): {   fprintf(stream, "action"); return; }
+        case (OFPR_INVALID_TTL): { fprintf(stream, "invalid_ttl"); return; }
         default: {              fprintf(stream, "?(%u)", reason); return; }
     }
 }
@@ -28,6 +28,7 @@
  *
  */
 
+#include "ofl-arena.h"
 #include "ofl-structs.h"
 #include "lib/hash.h"
 #include "oxm-match.h"
@@ -45,11 +46,11 @@ ofl_structs_match_init(struct ofl_match *match)
 void
 ofl_structs_match_put8(struct ofl_match *match, uint32_t header, uint8_t value)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint8_t);
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, &value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -58,11 +59,11 @@ ofl_structs_match_put8(struct ofl_match *match, uint32_t header, uint8_t value)
 void
 ofl_structs_match_put8m(struct ofl_match *match, uint32_t header, uint8_t value, uint8_t mask)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint8_t);
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, &value, len);
     memcpy(m->value + len, &mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -72,11 +73,11 @@ ofl_structs_match_put8m(struct ofl_match *match, uint32_t header, uint8_t value,
 void
 ofl_structs_match_put16(struct ofl_match *match, uint32_t header, uint16_t value)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint16_t);
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, &value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -86,11 +87,11 @@ ofl_structs_match_put16(struct ofl_match *match, uint32_t header, uint16_t value
 void
 ofl_structs_match_put16m(struct ofl_match *match, uint32_t header, uint16_t value, uint16_t mask)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint16_t);
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, &value, len);
     memcpy(m->value + len, &mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -100,12 +101,12 @@ ofl_structs_match_put16m(struct ofl_match *match, uint32_t header, uint16_t valu
 void
 ofl_structs_match_put32(struct ofl_match *match, uint32_t header, uint32_t value)
 {
-    struct ofl_match_tlv *m = xmalloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
 
     int len = sizeof(uint32_t);
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, &value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -115,11 +116,11 @@ ofl_structs_match_put32(struct ofl_match *match, uint32_t header, uint32_t value
 void
 ofl_structs_match_put32m(struct ofl_match *match, uint32_t header, uint32_t value, uint32_t mask)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint32_t);
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, &value, len);
     memcpy(m->value + len, &mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -130,11 +131,11 @@ ofl_structs_match_put32m(struct ofl_match *match, uint32_t header, uint32_t valu
 void
 ofl_structs_match_put64(struct ofl_match *match, uint32_t header, uint64_t value)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint64_t);
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, &value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -144,11 +145,11 @@ ofl_structs_match_put64(struct ofl_match *match, uint32_t header, uint64_t value
 void
 ofl_structs_match_put64m(struct ofl_match *match, uint32_t header, uint64_t value, uint64_t mask)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint64_t);
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, &value, len);
     memcpy(m->value + len, &mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -159,11 +160,11 @@ ofl_structs_match_put64m(struct ofl_match *match, uint32_t header, uint64_t valu
 void
 ofl_structs_match_put_pbb_isid(struct ofl_match *match, uint32_t header, uint8_t const value[PBB_ISID_LEN])
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = OXM_LENGTH(header);
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -173,11 +174,11 @@ ofl_structs_match_put_pbb_isid(struct ofl_match *match, uint32_t header, uint8_t
 void
 ofl_structs_match_put_pbb_isidm(struct ofl_match *match, uint32_t header, uint8_t const value[PBB_ISID_LEN], uint8_t const mask[PBB_ISID_LEN])
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = OXM_LENGTH(header);
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, value, len);
     memcpy(m->value + len, mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -187,11 +188,11 @@ ofl_structs_match_put_pbb_isidm(struct ofl_match *match, uint32_t header, uint8_
 void
 ofl_structs_match_put_eth(struct ofl_match *match, uint32_t header, uint8_t const value[ETH_ADDR_LEN])
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = ETH_ADDR_LEN;
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -201,11 +202,11 @@ ofl_structs_match_put_eth(struct ofl_match *match, uint32_t header, uint8_t cons
 void
 ofl_structs_match_put_eth_m(struct ofl_match *match, uint32_t header, uint8_t const value[ETH_ADDR_LEN], uint8_t const mask[ETH_ADDR_LEN])
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = ETH_ADDR_LEN;
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, value, len);
     memcpy(m->value + len, mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -217,11 +218,11 @@ void
 ofl_structs_match_put_ipv6(struct ofl_match *match, uint32_t header, uint8_t const value[IPv6_ADDR_LEN])
 {
 
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = IPv6_ADDR_LEN;
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -231,11 +232,11 @@ ofl_structs_match_put_ipv6(struct ofl_match *match, uint32_t header, uint8_t con
 void
 ofl_structs_match_put_ipv6m(struct ofl_match *match, uint32_t header, uint8_t const value[IPv6_ADDR_LEN], uint8_t const mask[IPv6_ADDR_LEN])
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = IPv6_ADDR_LEN;
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, value, len);
     memcpy(m->value + len, mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
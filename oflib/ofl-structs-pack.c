@@ -34,6 +34,7 @@
 #include <netinet/in.h>
 
 #include "include/openflow/openflow.h"
+#include "lib/compiler.h"
 #include "oxm-match.h"
 #include "ofl.h"
 #include "ofl-actions.h"
@@ -42,7 +43,6 @@
 #include "ofl-log.h"
 #include "ofl-packets.h"
 
-
 #define LOG_MODULE ofl_str_p
 OFL_LOG_INIT(LOG_MODULE)
 
@@ -574,6 +574,45 @@ ofl_structs_flow_stats_pack(struct ofl_flow_stats const *src, uint8_t *dst, stru
     return total_len;
 }
 
+size_t
+ofl_structs_flow_stats_put(struct ofl_flow_stats const *src, struct ofpbuf *buf, struct ofl_exp const *exp)
+{
+    struct ofp_flow_stats *flow_stats;
+    size_t start = buf->size;
+    size_t inst_len;
+    uint8_t *data;
+    size_t i;
+
+    inst_len = ofl_structs_instructions_ofp_total_len((struct ofl_instruction_header const **)src->instructions, src->instructions_num, exp);
+    ofpbuf_prealloc_tailroom(buf, ROUND_UP(sizeof(struct ofp_flow_stats) - 4 + src->match->length, 8) + inst_len);
+
+    flow_stats = ofpbuf_put_uninit(buf, sizeof(struct ofp_flow_stats) - sizeof(struct ofp_match));
+    flow_stats->table_id = src->table_id;
+    flow_stats->pad = 0x00;
+    flow_stats->duration_sec = htonl(src->duration_sec);
+    flow_stats->duration_nsec = htonl(src->duration_nsec);
+    flow_stats->priority = htons(src->priority);
+    flow_stats->idle_timeout = htons(src->idle_timeout);
+    flow_stats->hard_timeout = htons(src->hard_timeout);
+    flow_stats->flags = htons(src->flags);
+    memset(flow_stats->pad2, 0x00, 4);
+    flow_stats->cookie = hton64(src->cookie);
+    flow_stats->packet_count = hton64(src->packet_count);
+    flow_stats->byte_count = hton64(src->byte_count);
+
+    ofl_structs_match_put(src->match, buf, exp);
+
+    data = ofpbuf_put_uninit(buf, inst_len);
+    for (i=0; i < src->instructions_num; i++) {
+        data += ofl_structs_instructions_pack(src->instructions[i], (struct ofp_instruction *) data, exp);
+    }
+
+    /* The match may have moved the data, so the entry is looked up again. */
+    flow_stats = (struct ofp_flow_stats *)((uint8_t *)buf->data + start);
+    flow_stats->length = htons(buf->size - start);
+    return buf->size - start;
+}
+
 size_t
 ofl_structs_group_stats_ofp_len(struct ofl_group_stats const *stats)
 {
@@ -962,25 +1001,37 @@ ofl_structs_match_ofp_len(struct ofl_match_header const *match, struct ofl_exp c
     }
 }
 
+/* Writes the OXM match in src to the tail of buf, without padding, and
+ * returns the match length as stored in its header. */
+static size_t
+ofl_structs_oxm_match_put(struct ofl_match const *src, struct ofpbuf *buf, struct ofl_exp const *exp)
+{
+    size_t start = buf->size;
+    struct ofp_match *dst;
+    size_t oxm_len = 0;
+
+    ofpbuf_put_uninit(buf, sizeof(struct ofp_match) - 4);
+    if (src->header.length) {
+        oxm_len = oxm_put_match(buf, src, exp);
+    }
+    dst = (struct ofp_match *)((uint8_t *)buf->data + start);
+    dst->type = htons(src->header.type);
+    dst->length = htons(oxm_len + (sizeof(struct ofp_match) - 4));
+    return ntohs(dst->length);
+}
+
 size_t
-ofl_structs_match_pack(struct ofl_match_header const *src, struct ofp_match *dst, uint8_t * oxm_fields, struct ofl_exp const *exp)
+ofl_structs_match_pack(struct ofl_match_header const *src, struct ofp_match *dst, uint8_t * oxm_fields UNUSED, struct ofl_exp const *exp)
 {
     switch (src->type) {
         case (OFPMT_OXM): {
-            struct ofl_match *m = (struct ofl_match *)src;
-            struct ofpbuf *b = ofpbuf_new(0);
-            int oxm_len;
-            dst->type = htons(m->header.type);
-            oxm_fields = (uint8_t*) &dst->oxm_fields;
-            dst->length = htons(sizeof(struct ofp_match) - 4);
-            if (src->length){
-                oxm_len = oxm_put_match(b, m, exp);
-                memcpy(oxm_fields, (uint8_t*) ofpbuf_pull(b, oxm_len), oxm_len);
-                dst->length = htons(oxm_len + ((sizeof(struct ofp_match )-4)));
-                ofpbuf_delete(b);
-                return ntohs(dst->length);
-            }
-            else return 0;
+            struct ofpbuf b;
+            size_t len;
+
+            /* The OXM fields are written in place; dst has room for them. */
+            ofpbuf_use(&b, dst, (sizeof(struct ofp_match) - 4) + src->length);
+            len = ofl_structs_oxm_match_put((struct ofl_match *)src, &b, exp);
+            return src->length ? len : 0;
         }
         default: {
             if (exp == NULL || exp->match == NULL || exp->match->pack == NULL) {
@@ -992,3 +1043,29 @@ ofl_structs_match_pack(struct ofl_match_header const *src, struct ofp_match *dst
     }
 }
 
+size_t
+ofl_structs_match_put(struct ofl_match_header const *src, struct ofpbuf *buf, struct ofl_exp const *exp)
+{
+    size_t start = buf->size;
+    size_t len;
+
+    switch (src->type) {
+        case (OFPMT_OXM): {
+            len = ofl_structs_oxm_match_put((struct ofl_match *)src, buf, exp);
+            break;
+        }
+        default: {
+            if (exp == NULL || exp->match == NULL || exp->match->pack == NULL
+                            || exp->match->ofp_len == NULL) {
+                OFL_LOG_WARN(LOG_MODULE, "Trying to pack experimenter match, but no callback was given.");
+                return 0;
+            }
+            len = exp->match->ofp_len(src);
+            exp->match->pack(src, ofpbuf_put_zeros(buf, len));
+            break;
+        }
+    }
+    ofpbuf_put_zeros(buf, ROUND_UP(len, 8) - len);
+    return buf->size - start;
+}
+
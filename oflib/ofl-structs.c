@@ -35,6 +35,7 @@
 #include "ofl.h"
 #include "ofl-structs.h"
 #include "ofl-actions.h"
+#include "ofl-arena.h"
 #include "ofl-utils.h"
 #include "ofl-log.h"
 #include "hmap.h"
@@ -392,7 +393,7 @@ void
 ofl_structs_free_packet_queue(struct ofl_packet_queue *queue)
 {
     OFL_UTILS_FREE_ARR(queue->properties, queue->properties_num);
-    free(queue);
+    ofl_free(queue);
 }
 
 void
@@ -422,18 +423,18 @@ ofl_structs_free_instruction(struct ofl_instruction_header *inst, struct ofl_exp
             }
         }
     }
-    free(inst);
+    ofl_free(inst);
 }
 
 void ofl_structs_free_meter_bands(struct ofl_meter_band_header *meter_band)
 {
-    free(meter_band);
+    ofl_free(meter_band);
 }
 
 void
 ofl_structs_free_meter_band_stats(struct ofl_meter_band_stats* s)
 {
-    free(s);
+    ofl_free(s);
 }
 
 void
@@ -441,7 +442,7 @@ ofl_structs_free_meter_stats(struct ofl_meter_stats *stats)
 {
     OFL_UTILS_FREE_ARR_FUN(stats->band_stats, stats->meter_bands_num,
                             ofl_structs_free_meter_band_stats);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -449,13 +450,13 @@ ofl_structs_free_meter_config(struct ofl_meter_config *conf)
 {
     OFL_UTILS_FREE_ARR_FUN(conf->bands, conf->meter_bands_num,
                             ofl_structs_free_meter_bands);
-    free(conf);
+    ofl_free(conf);
 }
 
 void
 ofl_structs_free_table_stats(struct ofl_table_stats *stats)
 {
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -463,7 +464,7 @@ ofl_structs_free_bucket(struct ofl_bucket *bucket, struct ofl_exp const *exp)
 {
     OFL_UTILS_FREE_ARR_FUN2(bucket->actions, bucket->actions_num,
                             ofl_actions_free, exp);
-    free(bucket);
+    ofl_free(bucket);
 }
 
 
@@ -473,21 +474,21 @@ ofl_structs_free_flow_stats(struct ofl_flow_stats *stats, struct ofl_exp const *
     OFL_UTILS_FREE_ARR_FUN2(stats->instructions, stats->instructions_num,
                             ofl_structs_free_instruction, exp);
     ofl_structs_free_match(stats->match, exp);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
 ofl_structs_free_port(struct ofl_port *port)
 {
-    free(port->name);
-    free(port);
+    ofl_free(port->name);
+    ofl_free(port);
 }
 
 void
 ofl_structs_free_group_stats(struct ofl_group_stats *stats)
 {
     OFL_UTILS_FREE_ARR(stats->counters, stats->counters_num);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -495,7 +496,7 @@ ofl_structs_free_group_desc_stats(struct ofl_group_desc_stats *stats, struct ofl
 {
     OFL_UTILS_FREE_ARR_FUN2(stats->buckets, stats->buckets_num,
                             ofl_structs_free_bucket, exp);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -507,8 +508,8 @@ ofl_structs_free_table_features(struct ofl_table_features* features, struct ofl_
 
     OFL_UTILS_FREE_ARR_FUN2(features->properties, features->properties_num,
                             ofl_structs_free_table_properties, exp);
-    free(features->name);
-    free(features);
+    ofl_free(features->name);
+    ofl_free(features);
 }
 
 void
@@ -518,13 +519,13 @@ ofl_structs_free_table_properties(struct ofl_table_feature_prop_header *prop, st
         case (OFPTFPT_INSTRUCTIONS):
         case (OFPTFPT_INSTRUCTIONS_MISS):{
             struct ofl_table_feature_prop_instructions *inst = (struct ofl_table_feature_prop_instructions *)prop;
-            free(inst->instruction_ids);
+            ofl_free(inst->instruction_ids);
             break;
         }
         case (OFPTFPT_NEXT_TABLES_MISS):
         case (OFPTFPT_NEXT_TABLES):{
             struct ofl_table_feature_prop_next_tables *tables = (struct ofl_table_feature_prop_next_tables *)prop ;
-            free(tables->next_table_ids);
+            ofl_free(tables->next_table_ids);
             break;
         }
         case (OFPTFPT_WRITE_ACTIONS):
@@ -532,7 +533,7 @@ ofl_structs_free_table_properties(struct ofl_table_feature_prop_header *prop, st
         case (OFPTFPT_APPLY_ACTIONS):
         case (OFPTFPT_APPLY_ACTIONS_MISS):{
             struct ofl_table_feature_prop_actions *act = (struct ofl_table_feature_prop_actions *)prop;
-            free(act->action_ids);
+            ofl_free(act->action_ids);
             break;
         }
         case (OFPTFPT_APPLY_SETFIELD):
@@ -542,16 +543,20 @@ ofl_structs_free_table_properties(struct ofl_table_feature_prop_header *prop, st
         case (OFPTFPT_WILDCARDS):
         case (OFPTFPT_MATCH):{
             struct ofl_table_feature_prop_oxm *oxm = (struct ofl_table_feature_prop_oxm *)prop;
-            free(oxm->oxm_ids);
+            ofl_free(oxm->oxm_ids);
             break;
         }
     }
-    free(prop);
+    ofl_free(prop);
 }
 
 void
 ofl_structs_free_match(struct ofl_match_header *match, struct ofl_exp const *exp)
 {
+    if (ofl_arena_owns(match)) {
+        /* The arena releases the fields and hash buckets itself. */
+        return;
+    }
     switch (match->type) {
         case (OFPMT_OXM): {
             if (match->length > sizeof(struct ofp_match)){
@@ -559,20 +564,20 @@ ofl_structs_free_match(struct ofl_match_header *match, struct ofl_exp const *exp
                 struct ofl_match_tlv *tlv, *next;
                 HMAP_FOR_EACH_SAFE(tlv, next, struct ofl_match_tlv, hmap_node, &m->match_fields)
                 {
-                    free(tlv->value);
-                    free(tlv);
+                    ofl_free(tlv->value);
+                    ofl_free(tlv);
                 }
                 hmap_destroy(&m->match_fields);
-                free(m);
+                ofl_free(m);
             }
-            else free(match);
+            else ofl_free(match);
 
             break;
         }
         default: {
             if (exp == NULL || exp->match == NULL || exp->match->free == NULL) {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to free experimented instruction, but no callback was given.");
-                free(match);
+                ofl_free(match);
             } else {
                 exp->match->free(match);
             }
@@ -44,6 +44,7 @@
 
 
 struct ofl_exp;
+struct ofpbuf;
 
 /****************************************************************************
  * Supplementary structure definitions.
@@ -487,6 +488,11 @@ ofl_structs_bucket_pack(struct ofl_bucket const *src, struct ofp_bucket *dst, st
 size_t
 ofl_structs_flow_stats_pack(struct ofl_flow_stats const *src, uint8_t *dst, struct ofl_exp const *exp);
 
+/* Appends the flow stats entry in src to buf in wire format, growing buf if
+ * needed. Returns the number of bytes appended. */
+size_t
+ofl_structs_flow_stats_put(struct ofl_flow_stats const *src, struct ofpbuf *buf, struct ofl_exp const *exp);
+
 size_t
 ofl_structs_group_stats_pack(struct ofl_group_stats const *src, struct ofp_group_stats *dst);
 
@@ -519,6 +525,12 @@ ofl_structs_bucket_counter_pack(struct ofl_bucket_counter const *src, struct ofp
 size_t
 ofl_structs_match_pack(struct ofl_match_header const *src, struct ofp_match *dst, uint8_t * oxm_fields, struct ofl_exp const *exp);
 
+/* Appends the match in src to buf in wire format, including the zero padding
+ * up to the next 8 byte boundary. The OXM fields are written straight into
+ * buf. Returns the number of bytes appended. */
+size_t
+ofl_structs_match_put(struct ofl_match_header const *src, struct ofpbuf *buf, struct ofl_exp const *exp);
+
 ofl_err
 ofl_structs_instructions_unpack(struct ofp_instruction const *src, size_t *len, struct ofl_instruction_header **dst, struct ofl_exp const *exp);
 
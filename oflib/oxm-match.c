@@ -849,7 +849,7 @@ is_requisite(uint32_t header)
     return false;
 }
 
-/* Puts the match in the buffer */
+/* Puts the match in the buffer. The caller pads the enclosing ofp_match. */
 int oxm_put_match(struct ofpbuf *buf, struct ofl_match const *omt, struct ofl_exp const *exp)
 {
     struct ofl_match_tlv *oft;
@@ -1027,7 +1027,6 @@ int oxm_put_match(struct ofpbuf *buf, struct ofl_match const *omt, struct ofl_ex
         }
     }
     match_len = buf->size - start_len;
-    ofpbuf_put_zeros(buf, ROUND_UP(match_len - 4, 8) - (match_len -4));
     return match_len;
 }
 
@@ -16,12 +16,22 @@ udatapath_ofdatapath_SOURCES = \
 	udatapath/dp_actions.h \
 	udatapath/dp_buffers.c \
 	udatapath/dp_buffers.h \
+	udatapath/dp_bundle.c \
+	udatapath/dp_bundle.h \
 	udatapath/dp_control.c \
 	udatapath/dp_control.h \
 	udatapath/dp_exp.c \
 	udatapath/dp_exp.h \
+	udatapath/dp_flow_delta.c \
+	udatapath/dp_flow_delta.h \
+	udatapath/dp_flow_monitor.c \
+	udatapath/dp_flow_monitor.h \
+	udatapath/dp_pktin.c \
+	udatapath/dp_pktin.h \
 	udatapath/dp_ports.c \
 	udatapath/dp_ports.h \
+	udatapath/dp_snapshot.c \
+	udatapath/dp_snapshot.h \
 	udatapath/flow_table.c \
 	udatapath/flow_table.h \
 	udatapath/flow_entry.c \
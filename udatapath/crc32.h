@@ -85,6 +85,56 @@ static inline crc_t crc_finalize(crc_t crc)
 }
 
 
+#if defined(__GNUC__) && defined(__x86_64__)
+/**
+ * The SSE4.2 crc32 instruction computes the same CRC as crc_update(), a word
+ * at a time.  The functions below may only be called from functions built
+ * for CRC_HW_TARGET, and only when crc_hw_available() is true.
+ *****************************************************************************/
+#define CRC_HW 1
+#define CRC_HW_TARGET __attribute__((target("sse4.2")))
+
+
+/**
+ * Check whether the CPU implements the crc32 instruction.
+ *
+ * \return     Non-zero if crc_update_hw32() and crc_update_hw64() may be used.
+ *****************************************************************************/
+static inline int crc_hw_available(void)
+{
+    return __builtin_cpu_supports("sse4.2");
+}
+
+
+/**
+ * Update the crc value with a 32 bit word, as stored in host byte order.
+ *
+ * \param crc      The current crc value.
+ * \param data     The word to add.
+ * \return         The updated crc value.
+ *****************************************************************************/
+static inline CRC_HW_TARGET uint32_t crc_update_hw32(uint32_t crc, uint32_t data)
+{
+    return __builtin_ia32_crc32si(crc, data);
+}
+
+
+/**
+ * Update the crc value with a 64 bit word, as stored in host byte order.
+ *
+ * \param crc      The current crc value.
+ * \param data     The word to add.
+ * \return         The updated crc value.
+ *****************************************************************************/
+static inline CRC_HW_TARGET uint32_t crc_update_hw64(uint32_t crc, uint64_t data)
+{
+    uint64_t ret = __builtin_ia32_crc32di(crc, data);
+
+    return ret;
+}
+#endif
+
+
 #ifdef __cplusplus
 }           /* closing brace for extern "C" */
 #endif
@@ -41,12 +41,20 @@
 #include <assert.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include "csum.h"
 #include "dp_buffers.h"
+#include "dp_bundle.h"
+#include "dp_flow_delta.h"
+#include "dp_flow_monitor.h"
 #include "dp_control.h"
+#include "dp_pktin.h"
+#include "dp_snapshot.h"
 #include "ofp.h"
 #include "ofpbuf.h"
 #include "group_table.h"
@@ -64,8 +72,10 @@
 #include "openflow/private-ext.h"
 #include "openflow/openflow-ext.h"
 #include "pipeline.h"
+#include "latch.h"
 #include "poll-loop.h"
 #include "rconn.h"
+#include "spsc-ring.h"
 #include "stp.h"
 #include "vconn.h"
 #define LOG_MODULE VLM_dp
@@ -76,8 +86,15 @@ static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 static struct remote *remote_create(struct datapath *dp, struct rconn *rconn, struct rconn *rconn_aux);
 static void remote_run(struct datapath *, struct remote *);
 static void remote_rconn_run(struct datapath *, struct remote *, uint8_t);
-static void remote_wait(struct remote *);
+static void remote_wait(struct remote *, bool recv);
 static void remote_destroy(struct remote *);
+static int send_openflow_buffer_to_remote(struct ofpbuf *, struct remote *);
+static void remote_publish_txq(struct remote *);
+static void remote_send(struct ofpbuf *, struct remote *);
+static void remote_send_held(struct remote *);
+static bool remote_tx_is_blocked(struct remote *);
+static int flush_packet_ins(struct datapath *, struct remote *);
+static void push_tx_backlogs(struct datapath *);
 
 
 #define MFR_DESC     "Stanford University, Ericsson Research and CPqD Research"
@@ -86,8 +103,12 @@ static void remote_destroy(struct remote *);
 #define DP_DESC      "OpenFlow 1.3 Reference Userspace Switch Datapath"
 #define SERIAL_NUM   "1"
 
-#define MAIN_CONNECTION 0
-#define PTIN_CONNECTION 1
+/* Capacity of the rings between the control and forwarding sides. */
+#define CONTROL_RING_SIZE 1024
+
+/* Packet-ins to a remote are coalesced into buffers of up to this many
+ * bytes. */
+#define PKTIN_BATCH_BYTES 16384
 
 
 /* Callbacks for processing experimenter messages in OFLib. */
@@ -184,15 +205,38 @@ dp_new(void)
 
     dp->last_timeout = time_now();
     list_init(&dp->remotes);
+    list_init(&dp->ctl_remotes);
+    spsc_ring_init(&dp->ctl_rx, CONTROL_RING_SIZE);
+    spsc_ring_init(&dp->ctl_tx, CONTROL_RING_SIZE);
+    latch_init(&dp->ctl_rx_latch);
+    latch_init(&dp->ctl_tx_latch);
+    dp->ctl_rx_pending = false;
+    dp->ctl_tx_pending = false;
+    dp->ctl_rx_stalled = false;
+    dp->ctl_tx_stalled = false;
+    dp->n_tx_backlogs = 0;
+    dp->ctl_threaded = false;
+    dp->ctl_tx_held = NULL;
+    pthread_rwlock_init(&dp->tables_lock, NULL);
+    dp->tables_wanted = false;
     dp->listeners = NULL;
     dp->n_listeners = 0;
     dp->listeners_aux = NULL;
     dp->n_listeners_aux = 0;
 
-    memset(dp->ports, 0x00, sizeof (dp->ports));
+    hmap_init(&dp->ports);
     dp->local_port = NULL;
+    dp->all_ports = NULL;
+    dp->all_ports_num = 0;
+    dp->flood_ports = NULL;
+    dp->flood_ports_num = 0;
+    dp->port_monitor = NULL;
 
     dp->buffers = dp_buffers_create(dp);
+    dp->pktin = dp_pktin_create(dp);
+    dp->snapshot = NULL;
+    dp->flow_entry_ids = 0;
+    dp->flow_monitors_num = 0;
     dp->pipeline = pipeline_create(dp);
     dp->groups = group_table_create(dp);
     dp->meters = meter_table_create(dp);
@@ -200,6 +244,7 @@ dp_new(void)
     list_init(&dp->port_list);
     dp->ports_num = 0;
     dp->max_queues = NETDEV_MAX_QUEUES;
+    dp->offload = true;
 
     dp->exp = &dp_exp;
 
@@ -233,27 +278,162 @@ dp_add_pvconn(struct datapath *dp, struct pvconn *pvconn, struct pvconn *pvconn_
     dp->listeners_aux[dp->n_listeners_aux++] = pvconn_aux;
 }
 
-void
-dp_run(struct datapath *dp) {
-    time_t now = time_now();
-    struct remote *r, *rn;
-    size_t i;
+/* Events sent by the control side to the forwarding side over 'ctl_rx', and
+ * back over 'ctl_tx'. */
+enum control_event_type {
+    CTL_REMOTE_ADD,             /* A remote connected. */
+    CTL_REMOTE_DEL,             /* A remote disconnected. */
+    CTL_MSG,                    /* A message was received from a remote. */
+    CTL_SEND,                   /* A message is to be sent to a remote. */
+    CTL_STATS                   /* A multipart request is to be served on the
+                                   control side. */
+};
+
+struct control_event {
+    struct list node;           /* In the 'tx_backlog' of the remote. */
+    enum control_event_type type;
+    struct sender sender;       /* Remote, and connection of CTL_MSG and
+                                   CTL_STATS. */
+    struct ofl_msg_header *msg; /* Unpacked message, if 'error' is 0. */
+    ofl_err error;              /* Error unpacking 'buffer'. */
+    struct ofpbuf *buffer;      /* Received message, or message to send. */
+};
+
+/* Set while the control side serves a deferred request, whose replies are
+ * then sent right away. */
+static __thread bool serving_deferred;
+
+/* Time spent handling control events per dp_run(), in us, so that a burst of
+ * messages does not stall forwarding.  Messages such as flow-mods vary
+ * widely in cost, so counting them would not bound the stall. */
+#define CONTROL_BUDGET_USEC 500
+
+/* Nice value of the control thread, relative to the forwarding thread. */
+#define CONTROL_NICE 10
 
-    if (now != dp->last_timeout) {
-        dp->last_timeout = now;
-        meter_table_add_tokens(dp->meters);
-        pipeline_timeout(dp->pipeline);
+static void
+control_push(struct datapath *dp, struct control_event *ev)
+{
+    /* Room was checked by the caller; the forwarding side only drains. */
+    spsc_ring_push(&dp->ctl_rx, ev);
+    dp->ctl_rx_pending = true;
+}
+
+static void
+control_push_remote(struct datapath *dp, enum control_event_type type,
+                    struct remote *r)
+{
+    struct control_event *ev = xcalloc(1, sizeof *ev);
+
+    ev->type = type;
+    ev->sender.remote = r;
+    control_push(dp, ev);
+}
+
+static void
+control_event_free(struct datapath *dp, struct control_event *ev)
+{
+    ofpbuf_delete(ev->buffer);
+    if (ev->msg != NULL) {
+        ofl_msg_free(ev->msg, dp->exp);
     }
+    free(ev);
+}
 
-    poll_timer_wait(100);
-    dp_ports_run(dp);
+/* Serves the multipart request deferred by the forwarding side in 'ev'.  The
+ * forwarding side cannot change the tables meanwhile.  Runs on the control
+ * side. */
+static void
+control_serve_stats(struct datapath *dp, struct control_event *ev)
+{
+    struct ofl_msg_multipart_request_header *msg =
+            (struct ofl_msg_multipart_request_header *) ev->msg;
+    ofl_err error;
+
+    pthread_rwlock_rdlock(&dp->tables_lock);
+    serving_deferred = true;
+    error = handle_control_stats_request(dp, msg, &ev->sender);
+    if (error) {
+        dp_send_error(dp, error, ev->msg, NULL, 0, &ev->sender);
+        ofl_msg_free(ev->msg, dp->exp);
+    }
+    serving_deferred = false;
+    pthread_rwlock_unlock(&dp->tables_lock);
+
+    /* The forwarding side gave up on the lock meanwhile. */
+    if (__atomic_load_n(&dp->tables_wanted, __ATOMIC_SEQ_CST)) {
+        dp->ctl_rx_pending = true;
+    }
+    free(ev);
+}
+
+/* Sends the messages queued by the forwarding side, and serves the requests
+ * it deferred.  A request is held back while the forwarding side waits for
+ * the tables, in which case false is returned, as 'ctl_tx' was not drained.
+ * Runs on the control side. */
+static bool
+control_send_queued(struct datapath *dp)
+{
+    struct control_event *ev;
+    bool drained = true;
+    size_t n = 0;
+
+    while ((ev = dp->ctl_tx_held) != NULL
+           || (ev = spsc_ring_pop(&dp->ctl_tx)) != NULL) {
+        struct remote *r = ev->sender.remote;
+
+        dp->ctl_tx_held = NULL;
+        if (r->closing) {
+            control_event_free(dp, ev);
+        } else if (ev->type == CTL_SEND) {
+            remote_send(ev->buffer, r);
+            free(ev);
+        } else if (__atomic_load_n(&dp->tables_wanted, __ATOMIC_SEQ_CST)) {
+            dp->ctl_tx_held = ev;
+            drained = false;
+            break;
+        } else {
+            control_serve_stats(dp, ev);
+        }
+        n++;
+    }
+    if (n > 0 && __atomic_exchange_n(&dp->ctl_tx_stalled, false,
+                                     __ATOMIC_SEQ_CST)) {
+        dp->ctl_rx_pending = true;
+    }
+    return drained;
+}
+
+/* Services the listeners and the connections to remotes.  Runs on the control
+ * side. */
+static void
+control_run(struct datapath *dp)
+{
+    struct remote *r, *rn;
+    bool drained;
+    size_t i;
 
-    /* Talk to remotes. */
-    LIST_FOR_EACH_SAFE (r, rn, struct remote, node, &dp->remotes) {
-        remote_run(dp, r);
+    latch_poll(&dp->ctl_tx_latch);
+
+    /* A remote let go of by the forwarding side has no more messages queued
+     * in 'ctl_tx' once the messages queued so far are sent. */
+    LIST_FOR_EACH (r, struct remote, ctl_node, &dp->ctl_remotes) {
+        r->releasable = r->closing
+                        && __atomic_load_n(&r->released, __ATOMIC_ACQUIRE);
+    }
+    drained = control_send_queued(dp);
+
+    LIST_FOR_EACH_SAFE (r, rn, struct remote, ctl_node, &dp->ctl_remotes) {
+        if (r->releasable && drained) {
+            remote_destroy(r);
+        } else if (!r->closing) {
+            remote_run(dp, r);
+            remote_send_held(r);
+            remote_publish_txq(r);
+        }
     }
 
-    for (i = 0; i < dp->n_listeners; ) {
+    for (i = 0; i < dp->n_listeners && !spsc_ring_is_full(&dp->ctl_rx); ) {
         struct pvconn *pvconn = dp->listeners[i];
         struct vconn *new_vconn;
 
@@ -267,7 +447,8 @@ dp_run(struct datapath *dp) {
                 if (!retval_aux)
                     rconn_aux = rconn_new_from_vconn("passive_aux", new_vconn_aux);
             }
-            remote_create(dp, rconn_new_from_vconn("passive", new_vconn), rconn_aux);
+            r = remote_create(dp, rconn_new_from_vconn("passive", new_vconn), rconn_aux);
+            control_push_remote(dp, CTL_REMOTE_ADD, r);
         }
         else if (retval != EAGAIN) {
             VLOG_WARN_RL(LOG_MODULE, &rl, "accept failed (%s)", strerror(retval));
@@ -279,6 +460,224 @@ dp_run(struct datapath *dp) {
         }
         i++;
     }
+
+    if (dp->ctl_rx_pending) {
+        dp->ctl_rx_pending = false;
+        latch_set(&dp->ctl_rx_latch);
+    }
+}
+
+static void
+control_wait(struct datapath *dp)
+{
+    struct remote *r;
+    bool full = spsc_ring_is_full(&dp->ctl_rx);
+    size_t i;
+
+    latch_wait(&dp->ctl_tx_latch);
+    if (full) {
+        /* Stop receiving until the forwarding side catches up, which it
+         * tells through 'ctl_tx_latch'. */
+        __atomic_store_n(&dp->ctl_rx_stalled, true, __ATOMIC_SEQ_CST);
+        if (!spsc_ring_is_full(&dp->ctl_rx)) {
+            poll_immediate_wake();
+        }
+    }
+    LIST_FOR_EACH (r, struct remote, ctl_node, &dp->ctl_remotes) {
+        if (!r->closing) {
+            remote_wait(r, !full);
+        }
+    }
+    for (i = 0; i < dp->n_listeners && !full; i++) {
+        pvconn_wait(dp->listeners[i]);
+    }
+}
+
+static void *
+control_thread(void *dp_)
+{
+    struct datapath *dp = dp_;
+
+    /* Yield to forwarding when the two compete for a CPU.  Linux applies
+     * the nice value of a thread to that thread only. */
+    if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), CONTROL_NICE)) {
+        VLOG_WARN(LOG_MODULE, "failed to lower control thread priority (%s)",
+                  strerror(errno));
+    }
+
+    for (;;) {
+        control_run(dp);
+        control_wait(dp);
+        poll_block();
+    }
+    return NULL;
+}
+
+void
+dp_start_control_thread(struct datapath *dp)
+{
+    int error = pthread_create(&dp->ctl_thread, NULL, control_thread, dp);
+    if (error) {
+        ofp_fatal(error, "failed to start control thread");
+    }
+    dp->ctl_threaded = true;
+}
+
+/* Handles a message received from a remote.  Runs on the forwarding side. */
+static void
+handle_remote_msg(struct datapath *dp, struct control_event *ev)
+{
+    struct ofl_msg_header *msg = ev->msg;
+    struct ofpbuf *buffer = ev->buffer;
+    struct sender *sender = &ev->sender;
+    ofl_err error = ev->error;
+
+    if (!error) {
+        error = handle_control_msg(dp, msg, sender);
+    }
+
+    if (error) {
+        dp_send_error(dp, error, msg, buffer->data, buffer->size, sender);
+        if (msg != NULL){
+            ofl_msg_free(msg, dp->exp);
+        }
+    }
+
+    ofpbuf_delete(buffer);
+}
+
+/* Lets go of a disconnected remote.  Runs on the forwarding side. */
+static void
+remote_release(struct datapath *dp, struct remote *r)
+{
+    list_remove(&r->node);
+    ofpbuf_delete(r->pktin_batch);
+    r->pktin_batch = NULL;
+    if (!list_is_empty(&r->tx_backlog)) {
+        struct control_event *ev, *next;
+
+        LIST_FOR_EACH_SAFE (ev, next, struct control_event, node,
+                            &r->tx_backlog) {
+            control_event_free(dp, ev);
+        }
+        list_init(&r->tx_backlog);
+        dp->n_tx_backlogs--;
+    }
+    if (r->mp_req_msg != NULL) {
+        ofl_msg_free((struct ofl_msg_header *) r->mp_req_msg, NULL);
+    }
+    dp_bundle_discard_all(dp, r);
+    dp_flow_delta_destroy(r->flow_deltas);
+    r->flow_deltas = NULL;
+    dp_flow_monitor_remove_all(dp, r);
+    __atomic_store_n(&r->released, true, __ATOMIC_RELEASE);
+    dp->ctl_tx_pending = true;
+}
+
+/* Handles the events received from the control side.  Runs on the forwarding
+ * side. */
+static void
+handle_control_events(struct datapath *dp)
+{
+    long long int deadline = time_usec() + CONTROL_BUDGET_USEC;
+    struct control_event *ev;
+    size_t i;
+
+    latch_poll(&dp->ctl_rx_latch);
+    for (i = 0; i == 0 || time_usec() < deadline; i++) {
+        ev = spsc_ring_pop(&dp->ctl_rx);
+        if (ev == NULL) {
+            break;
+        }
+        switch (ev->type) {
+            case CTL_REMOTE_ADD: {
+                list_push_back(&dp->remotes, &ev->sender.remote->node);
+                break;
+            }
+            case CTL_REMOTE_DEL: {
+                remote_release(dp, ev->sender.remote);
+                break;
+            }
+            case CTL_MSG: {
+                handle_remote_msg(dp, ev);
+                break;
+            }
+            case CTL_SEND:
+            case CTL_STATS: {
+                /* Only ever sent over 'ctl_tx'. */
+                break;
+            }
+        }
+        free(ev);
+    }
+    if (i > 0 && __atomic_exchange_n(&dp->ctl_rx_stalled, false,
+                                     __ATOMIC_SEQ_CST)) {
+        dp->ctl_tx_pending = true;
+    }
+}
+
+/* Takes 'tables_lock' for changing the tables, unless the control side holds
+ * it for a request: forwarding does not wait for it, but leaves the changes
+ * for later.  Runs on the forwarding side. */
+static bool
+tables_trylock(struct datapath *dp)
+{
+    if (!pthread_rwlock_trywrlock(&dp->tables_lock)) {
+        return true;
+    }
+    /* Tell the control side to wake us up and let go of the lock, then try
+     * once more in case it already did. */
+    __atomic_store_n(&dp->tables_wanted, true, __ATOMIC_SEQ_CST);
+    return !pthread_rwlock_trywrlock(&dp->tables_lock);
+}
+
+static void
+tables_unlock(struct datapath *dp)
+{
+    pthread_rwlock_unlock(&dp->tables_lock);
+    if (__atomic_exchange_n(&dp->tables_wanted, false, __ATOMIC_SEQ_CST)) {
+        /* The control side may be holding back a request. */
+        dp->ctl_tx_pending = true;
+    }
+}
+
+void
+dp_run(struct datapath *dp) {
+    time_t now = time_now();
+    struct remote *r;
+
+    if (now != dp->last_timeout && tables_trylock(dp)) {
+        dp->last_timeout = now;
+        meter_table_add_tokens(dp->meters);
+        pipeline_timeout(dp->pipeline);
+        dp_buffers_run(dp->buffers);
+        tables_unlock(dp);
+    }
+    pipeline_state_timeout(dp->pipeline);
+    dp_snapshot_run(dp);
+
+    poll_timer_wait(100);
+    dp_ports_run(dp);
+
+    if (!dp->ctl_threaded) {
+        control_run(dp);
+    }
+    push_tx_backlogs(dp);
+    if (tables_trylock(dp)) {
+        handle_control_events(dp);
+        tables_unlock(dp);
+    }
+    dp_flow_monitor_run(dp);
+
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        dp_flow_monitor_flush(dp, r);
+        flush_packet_ins(dp, r);
+    }
+
+    if (dp->ctl_tx_pending) {
+        dp->ctl_tx_pending = false;
+        latch_set(&dp->ctl_tx_latch);
+    }
 }
 
 static void
@@ -287,7 +686,12 @@ remote_run(struct datapath *dp, struct remote *r)
     remote_rconn_run(dp, r, MAIN_CONNECTION);
 
     if (!rconn_is_alive(r->rconn)) {
-        remote_destroy(r);
+        /* The forwarding side must let go of the remote before it is
+         * destroyed. */
+        if (!spsc_ring_is_full(&dp->ctl_rx)) {
+            r->closing = true;
+            control_push_remote(dp, CTL_REMOTE_DEL, r);
+        }
         return;
     }
 
@@ -297,10 +701,21 @@ remote_run(struct datapath *dp, struct remote *r)
     remote_rconn_run(dp, r, PTIN_CONNECTION);
 }
 
+/* Flow mods make up the bulk of controller traffic and the flow tables copy
+ * what they keep of them, so they are decoded into an arena that is dropped
+ * in one go.  Other messages may hand parts over to the datapath (group
+ * buckets, meter bands, multipart reassembly) and are decoded as usual. */
+static bool
+remote_msg_uses_arena(struct ofpbuf const *buffer)
+{
+    struct ofp_header const *oh = buffer->data;
+
+    return buffer->size >= sizeof *oh && oh->type == OFPT_FLOW_MOD;
+}
+
 static void
 remote_rconn_run(struct datapath *dp, struct remote *r, uint8_t conn_id) {
     struct rconn *rconn = NULL;
-    ofl_err error;
     size_t i;
 
     if (conn_id == MAIN_CONNECTION)
@@ -311,80 +726,44 @@ remote_rconn_run(struct datapath *dp, struct remote *r, uint8_t conn_id) {
     rconn_run(rconn);
     /* Do some remote processing, but cap it at a reasonable amount so that
      * other processing doesn't starve. */
-    for (i = 0; i < 50; i++) {
-        if (!r->cb_dump) {
-            struct ofpbuf *buffer;
-
-            buffer = rconn_recv(rconn);
-            if (buffer == NULL) {
-                break;
-            } else {
-                struct ofl_msg_header *msg = NULL;
-                struct sender sender = {.remote = r, .conn_id = conn_id};
-
-                error = ofl_msg_unpack(buffer->data, buffer->size, &msg, &(sender.xid), dp->exp);
-
-                if (!error) {
-                    error = handle_control_msg(dp, msg, &sender);
-                }
-
-                if (error) {
-                    /* [*] The highest bit of 'error' is always set to one, but on-the-wire we
-                    need full compliance to OF specification: the 'type' of an experimenter
-                    error message must be 0xffff instead of 0x7ffff. */
-                    if ((ofl_error_type(error) | 0x8000) == OFPET_EXPERIMENTER){
-                        struct ofl_msg_exp_error err =
-                               {{.type = OFPT_ERROR},
-                                .type = ofl_error_type(error) | 0x8000, // [*]
-                                .exp_type = ofl_error_code(error),
-                                .experimenter = get_experimenter_id(msg),
-                                .data_length = buffer->size,
-                                .data        = buffer->data};
-                        dp_send_message(dp, (struct ofl_msg_header *)&err, &sender);
-                    }
-                    else{
-                        struct ofl_msg_error err =
-                               {{.type = OFPT_ERROR},
-                                .type = ofl_error_type(error),
-                                .code = ofl_error_code(error),
-                                .data_length = buffer->size,
-                                .data        = buffer->data};
-                        dp_send_message(dp, (struct ofl_msg_header *)&err, &sender);
-                    }
-                    if (msg != NULL){
-                        ofl_msg_free(msg, dp->exp);
-                    }
-                }
+    for (i = 0; i < 50 && !spsc_ring_is_full(&dp->ctl_rx)
+                && !remote_tx_is_blocked(r); i++) {
+        struct control_event *ev;
+        struct ofpbuf *buffer;
 
-                ofpbuf_delete(buffer);
-            }
-        } else {
-            if (r->n_txq < TXQ_LIMIT) {
-                int error = r->cb_dump(dp, r->cb_aux);
-                if (error <= 0) {
-                    if (error) {
-                        VLOG_WARN_RL(LOG_MODULE, &rl, "Callback error: %s.",
-                                     strerror(-error));
-                    }
-                    r->cb_done(r->cb_aux);
-                    r->cb_dump = NULL;
-                }
-            } else {
-                break;
-            }
+        buffer = rconn_recv(rconn);
+        if (buffer == NULL) {
+            break;
         }
+
+        /* Unpacking is done here, off the forwarding side. */
+        ev = xmalloc(sizeof *ev);
+        ev->type = CTL_MSG;
+        ev->sender.remote = r;
+        ev->sender.conn_id = conn_id;
+        ev->msg = NULL;
+        ev->error = (remote_msg_uses_arena(buffer) ? ofl_msg_unpack_arena
+                                                   : ofl_msg_unpack)
+            (buffer->data, buffer->size, &ev->msg, &ev->sender.xid, dp->exp);
+        ev->buffer = buffer;
+        control_push(dp, ev);
     }
 }
 
 static void
-remote_wait(struct remote *r)
+remote_wait(struct remote *r, bool recv)
 {
+    recv = recv && !remote_tx_is_blocked(r);
     rconn_run_wait(r->rconn);
-    rconn_recv_wait(r->rconn);
+    if (recv) {
+        rconn_recv_wait(r->rconn);
+    }
 
     if (r->rconn_aux) {
         rconn_run_wait(r->rconn_aux);
-        rconn_recv_wait(r->rconn_aux);
+        if (recv) {
+            rconn_recv_wait(r->rconn_aux);
+        }
     }
 }
 
@@ -392,31 +771,54 @@ static void
 remote_destroy(struct remote *r)
 {
     if (r) {
-        if (r->cb_dump && r->cb_done) {
-             r->cb_done(r->cb_aux);
-        }
-        list_remove(&r->node);
+        list_remove(&r->ctl_node);
         if (r->rconn_aux != NULL) {
             rconn_destroy(r->rconn_aux);
         }
         rconn_destroy(r->rconn);
-	if(r->mp_req_msg != NULL) {
-	  ofl_msg_free((struct ofl_msg_header *) r->mp_req_msg, NULL);
-	}
+        queue_destroy(&r->tx_held);
         free(r);
     }
 }
 
+/* Recomputes the broadcast messages 'remote' receives, from its role and
+ * asynchronous configuration.  Slaves only receive port status messages. */
+static void
+remote_update_async_filter(struct remote *remote)
+{
+    bool slave = remote->role == OFPCR_ROLE_SLAVE;
+
+    remote->async_filter[REMOTE_MSG_PACKET_IN] =
+            slave ? 0 : remote->config.packet_in_mask[0];
+    remote->async_filter[REMOTE_MSG_PORT_STATUS] =
+            remote->config.port_status_mask[slave ? 1 : 0];
+    remote->async_filter[REMOTE_MSG_FLOW_REMOVED] =
+            slave ? 0 : remote->config.flow_removed_mask[0];
+    remote->async_filter[REMOTE_MSG_OTHER] = slave ? 0 : 0x1;
+}
+
 static struct remote *
 remote_create(struct datapath *dp, struct rconn *rconn, struct rconn *rconn_aux)
 {
     size_t i;
     struct remote *remote = xmalloc(sizeof *remote);
-    list_push_back(&dp->remotes, &remote->node);
+    list_push_back(&dp->ctl_remotes, &remote->ctl_node);
     remote->rconn = rconn;
     remote->rconn_aux = rconn_aux;
-    remote->cb_dump = NULL;
     remote->n_txq = 0;
+    remote->n_txq_shared = 0;
+    queue_init(&remote->tx_held);
+    list_init(&remote->tx_backlog);
+    remote->tx_blocked = false;
+    remote->closing = false;
+    remote->released = false;
+    remote->releasable = false;
+    remote->pktin_batch = NULL;
+    list_init(&remote->bundles);
+    remote->flow_deltas = NULL;
+    list_init(&remote->flow_monitors);
+    remote->flow_updates = NULL;
+    remote->flow_updates_paused = false;
     remote->mp_req_msg = NULL;
     remote->mp_req_xid = 0;  /* Currently not needed. Jean II. */
     remote->role = OFPCR_ROLE_EQUAL;
@@ -426,6 +828,7 @@ remote_create(struct datapath *dp, struct rconn *rconn, struct rconn *rconn_aux)
         memset(&remote->config.port_status_mask[i], 0x7, sizeof(uint32_t));
         memset(&remote->config.flow_removed_mask[i], 0x1f, sizeof(uint32_t));
     }
+    remote_update_async_filter(remote);
     return remote;
 }
 
@@ -434,8 +837,6 @@ void
 dp_wait(struct datapath *dp)
 {
     struct sw_port *p;
-    struct remote *r;
-    size_t i;
 
     LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
         if (IS_HW_PORT(p)) {
@@ -443,11 +844,28 @@ dp_wait(struct datapath *dp)
         }
         netdev_recv_wait(p->netdev);
     }
-    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
-        remote_wait(r);
+    if (dp->port_monitor != NULL) {
+        netdev_monitor_wait(dp->port_monitor);
     }
-    for (i = 0; i < dp->n_listeners; i++) {
-        pvconn_wait(dp->listeners[i]);
+    pipeline_state_timeout_wait(dp->pipeline);
+    dp_snapshot_wait(dp);
+    latch_wait(&dp->ctl_rx_latch);
+    /* While the control side holds 'tables_lock', it tells when it is done
+     * through 'ctl_rx_latch'. */
+    if (!spsc_ring_is_empty(&dp->ctl_rx)
+        && !__atomic_load_n(&dp->tables_wanted, __ATOMIC_RELAXED)) {
+        poll_immediate_wake();
+    }
+    if (dp->n_tx_backlogs) {
+        /* Wait for room in 'ctl_tx', which the control side tells through
+         * 'ctl_rx_latch'. */
+        __atomic_store_n(&dp->ctl_tx_stalled, true, __ATOMIC_SEQ_CST);
+        if (!spsc_ring_is_full(&dp->ctl_tx)) {
+            poll_immediate_wake();
+        }
+    }
+    if (!dp->ctl_threaded) {
+        control_wait(dp);
     }
 }
 
@@ -491,7 +909,18 @@ dp_set_max_queues(struct datapath *dp, uint32_t max_queues) {
     dp->max_queues = max_queues;
 }
 
+void
+dp_set_offload(struct datapath *dp, bool offload) {
+    dp->offload = offload;
+}
+
+void
+dp_set_buffer_size(struct datapath *dp, size_t bytes) {
+    dp_buffers_set_capacity(dp->buffers, bytes);
+}
+
 
+/* Sends 'buffer' on the connection to 'remote'.  Runs on the control side. */
 static int
 send_openflow_buffer_to_remote(struct ofpbuf *buffer, struct remote *remote) {
     struct rconn* rconn = remote->rconn;
@@ -505,6 +934,7 @@ send_openflow_buffer_to_remote(struct ofpbuf *buffer, struct remote *remote) {
     }
     retval = rconn_send_with_limit(rconn, buffer, &remote->n_txq,
                                       TXQ_LIMIT);
+    remote_publish_txq(remote);
 
     if (retval) {
         VLOG_WARN_RL(LOG_MODULE, &rl, "send to %s failed: %s",
@@ -514,83 +944,239 @@ send_openflow_buffer_to_remote(struct ofpbuf *buffer, struct remote *remote) {
     return retval;
 }
 
+/* Publishes the length of the tx queue of 'remote' to the forwarding side.
+ * Runs on the control side. */
+static void
+remote_publish_txq(struct remote *remote) {
+    __atomic_store_n(&remote->n_txq_shared, remote->n_txq, __ATOMIC_RELAXED);
+}
+
+/* Sends 'buffer' to 'remote', or holds it back until the tx queue of 'remote'
+ * drains below TXQ_LIMIT.  Packet-ins are rather dropped past the limit, as
+ * they always were.  Runs on the control side. */
+static void
+remote_send(struct ofpbuf *buffer, struct remote *remote) {
+    if (buffer->conn_id == PTIN_CONNECTION) {
+        if (remote->tx_held.n) {
+            ofpbuf_delete(buffer);
+        } else {
+            send_openflow_buffer_to_remote(buffer, remote);
+        }
+    } else if (remote->tx_held.n || remote->n_txq >= TXQ_LIMIT) {
+        queue_push_tail(&remote->tx_held, buffer);
+    } else {
+        send_openflow_buffer_to_remote(buffer, remote);
+    }
+}
+
+/* Sends the messages held back for 'remote' that its tx queue has room for.
+ * Runs on the control side. */
+static void
+remote_send_held(struct remote *remote) {
+    while (remote->tx_held.n && remote->n_txq < TXQ_LIMIT) {
+        send_openflow_buffer_to_remote(queue_pop_head(&remote->tx_held),
+                                       remote);
+    }
+}
+
+/* Returns true if no more messages should be received from 'remote' until
+ * those to send to it get going: it would only make for more replies to hold
+ * back.  Runs on the control side. */
+static bool
+remote_tx_is_blocked(struct remote *remote) {
+    return remote->tx_held.n
+           || __atomic_load_n(&remote->tx_blocked, __ATOMIC_ACQUIRE);
+}
+
+/* Hands 'ev' over to the control side.  While 'ctl_tx' is full, events are
+ * held back in the backlog of their remote, and packet-ins dropped.  Runs on
+ * the forwarding side. */
+static int
+push_control_event(struct datapath *dp, struct control_event *ev) {
+    struct remote *remote = ev->sender.remote;
+
+    if (list_is_empty(&remote->tx_backlog)
+        && spsc_ring_push(&dp->ctl_tx, ev)) {
+        dp->ctl_tx_pending = true;
+        return 0;
+    }
+    if (ev->type == CTL_SEND && ev->buffer->conn_id == PTIN_CONNECTION) {
+        control_event_free(dp, ev);
+        return EAGAIN;
+    }
+    if (list_is_empty(&remote->tx_backlog)) {
+        dp->n_tx_backlogs++;
+        __atomic_store_n(&remote->tx_blocked, true, __ATOMIC_RELEASE);
+    }
+    list_push_back(&remote->tx_backlog, &ev->node);
+    return 0;
+}
+
+/* Hands 'buffer' over to the control side, for sending to 'remote'.  Runs on
+ * the forwarding side. */
+static int
+push_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
+                     struct remote *remote) {
+    struct control_event *ev = xcalloc(1, sizeof *ev);
+
+    ev->type = CTL_SEND;
+    ev->sender.remote = remote;
+    ev->buffer = buffer;
+    return push_control_event(dp, ev);
+}
+
+/* Moves the events held back in the backlogs of the remotes to 'ctl_tx', as
+ * room allows.  Runs on the forwarding side. */
+static void
+push_tx_backlogs(struct datapath *dp) {
+    struct remote *r;
+
+    if (!dp->n_tx_backlogs) {
+        return;
+    }
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        if (list_is_empty(&r->tx_backlog)) {
+            continue;
+        }
+        while (!list_is_empty(&r->tx_backlog)
+               && !spsc_ring_is_full(&dp->ctl_tx)) {
+            struct list *node = list_pop_front(&r->tx_backlog);
+
+            spsc_ring_push(&dp->ctl_tx,
+                           CONTAINER_OF(node, struct control_event, node));
+        }
+        dp->ctl_tx_pending = true;
+        if (list_is_empty(&r->tx_backlog)) {
+            dp->n_tx_backlogs--;
+            __atomic_store_n(&r->tx_blocked, false, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+bool
+dp_defer_stats_request(struct datapath *dp,
+                       struct ofl_msg_multipart_request_header *msg,
+                       const struct sender *sender) {
+    struct control_event *ev;
+
+    if (!dp->ctl_threaded || serving_deferred) {
+        return false;
+    }
+    /* The reply goes after what was queued for the remote so far. */
+    dp_flow_monitor_flush(dp, sender->remote);
+    flush_packet_ins(dp, sender->remote);
+
+    ev = xcalloc(1, sizeof *ev);
+    ev->type = CTL_STATS;
+    ev->sender = *sender;
+    ev->msg = (struct ofl_msg_header *) msg;
+    push_control_event(dp, ev);
+    return true;
+}
+
+/* Hands the packet-ins coalesced for 'remote' over to the control side. */
+static int
+flush_packet_ins(struct datapath *dp, struct remote *remote) {
+    struct ofpbuf *batch = remote->pktin_batch;
+
+    if (batch == NULL) {
+        return 0;
+    }
+    remote->pktin_batch = NULL;
+    return push_openflow_buffer(dp, batch, remote);
+}
+
+/* Queues 'buffer' for sending to 'remote'.  Packet-ins are held back and
+ * coalesced, so that a burst of them makes for a single write to the
+ * connection; any other message first flushes those held back, and the flow
+ * monitor updates, to keep the order of messages. */
+static int
+queue_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
+                      struct remote *remote) {
+    struct ofpbuf *batch = remote->pktin_batch;
+
+    if (buffer->conn_id != PTIN_CONNECTION) {
+        dp_flow_monitor_flush(dp, remote);
+        flush_packet_ins(dp, remote);
+        return push_openflow_buffer(dp, buffer, remote);
+    }
+
+    if (batch == NULL) {
+        remote->pktin_batch = buffer;
+        return 0;
+    }
+    if (batch->size + buffer->size > PKTIN_BATCH_BYTES) {
+        flush_packet_ins(dp, remote);
+        remote->pktin_batch = buffer;
+        return 0;
+    }
+    ofpbuf_prealloc_tailroom(batch, PKTIN_BATCH_BYTES - batch->size);
+    ofpbuf_put(batch, buffer->data, buffer->size);
+    ofpbuf_delete(buffer);
+    return 0;
+}
+
+/* Returns the kind of the broadcast message in 'buffer', and its reason in
+ * '*reason'. */
+static enum remote_msg_kind
+broadcast_msg_kind(const struct ofpbuf *buffer, uint8_t *reason) {
+    const struct ofp_header *oh = buffer->data;
+
+    switch (oh->type) {
+        case (OFPT_PACKET_IN): {
+            *reason = ((const struct ofp_packet_in *)oh)->reason;
+            return REMOTE_MSG_PACKET_IN;
+        }
+        case (OFPT_PORT_STATUS): {
+            *reason = ((const struct ofp_port_status *)oh)->reason;
+            return REMOTE_MSG_PORT_STATUS;
+        }
+        case (OFPT_FLOW_REMOVED): {
+            *reason = ((const struct ofp_flow_removed *)oh)->reason;
+            return REMOTE_MSG_FLOW_REMOVED;
+        }
+        default: {
+            *reason = 0;
+            return REMOTE_MSG_OTHER;
+        }
+    }
+}
+
+/* Queues 'buffer' for the remote of 'sender', or if there is none, for every
+ * remote whose filter lets it through.  The remotes share the data of a
+ * broadcast message rather than each getting a copy. */
 static int
 send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
                      const struct sender *sender) {
     update_openflow_length(buffer);
-    if (sender) {
+    if (sender && serving_deferred) {
+        /* Already on the control side. */
+        remote_send(buffer, sender->remote);
+        return 0;
+    } else if (sender) {
         /* Send back to the sender. */
-        return send_openflow_buffer_to_remote(buffer, sender->remote);
+        return queue_openflow_buffer(dp, buffer, sender->remote);
 
     } else {
         /* Broadcast to all remotes. */
         struct remote *r, *prev = NULL;
-        uint8_t msg_type;
-        /* Get the type of the message */
-        memcpy(&msg_type,((char* ) buffer->data) + 1, sizeof(uint8_t));
+        enum remote_msg_kind kind;
+        uint32_t reason_bit;
+        uint8_t reason;
+
+        kind = broadcast_msg_kind(buffer, &reason);
+        reason_bit = reason < 32 ? 1u << reason : 0;
         LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
-            /* do not send to remotes with slave role apart from port status */
-            if (r->role == OFPCR_ROLE_EQUAL || r->role == OFPCR_ROLE_MASTER){
-                /*Check if the message is enabled in the asynchronous configuration*/
-                switch(msg_type){
-                    case (OFPT_PACKET_IN):{
-                        struct ofp_packet_in *p = (struct ofp_packet_in*)buffer->data;
-                        /* Do not send message if the reason is not enabled */
-                        if((p->reason == OFPR_NO_MATCH) && !(r->config.packet_in_mask[0] & 0x1))
-                            continue;
-                        if((p->reason == OFPR_ACTION) && !(r->config.packet_in_mask[0] & 0x2))
-                            continue;
-                        if((p->reason == OFPR_INVALID_TTL) && !(r->config.packet_in_mask[0] & 0x4))
-                            continue;
-                        break;
-                    }
-                    case (OFPT_PORT_STATUS):{
-                        struct ofp_port_status *p = (struct ofp_port_status*)buffer->data;
-                        if((p->reason == OFPPR_ADD) && !(r->config.port_status_mask[0] & 0x1))
-                            continue;
-                        if((p->reason == OFPPR_DELETE) && !(r->config.port_status_mask[0] & 0x2))
-                            continue;
-                        if((p->reason == OFPPR_MODIFY) && !(r->config.port_status_mask[0] & 0x4))
-                            continue;
-                    }
-                    case (OFPT_FLOW_REMOVED):{
-                        struct ofp_flow_removed *p= (struct ofp_flow_removed *)buffer->data;
-                        if((p->reason == OFPRR_IDLE_TIMEOUT) && !(r->config.flow_removed_mask[0] & 0x1))
-                            continue;
-                        if((p->reason == OFPRR_HARD_TIMEOUT) && !(r->config.flow_removed_mask[0] & 0x2))
-                            continue;
-                        if((p->reason == OFPRR_DELETE) && !(r->config.flow_removed_mask[0] & 0x4))
-                            continue;
-                        if((p->reason == OFPRR_GROUP_DELETE) && !(r->config.flow_removed_mask[0] & 0x8))
-                            continue;
-                        if((p->reason == OFPRR_METER_DELETE) && !(r->config.flow_removed_mask[0] & 0x10))
-                            continue;
-                    }
-                }
-            }
-            else {
-                /* In this implementation we assume that a controller with role slave
-                   can is able to receive only port stats messages */
-                if (r->role == OFPCR_ROLE_SLAVE && msg_type != OFPT_PORT_STATUS) {
-                    continue;
-                }
-                else {
-                    struct ofp_port_status *p = (struct ofp_port_status*)buffer->data;
-                    if((p->reason == OFPPR_ADD) && !(r->config.port_status_mask[1] & 0x1))
-                        continue;
-                    if((p->reason == OFPPR_DELETE) && !(r->config.port_status_mask[1] & 0x2))
-                        continue;
-                    if((p->reason == OFPPR_MODIFY) && !(r->config.port_status_mask[1] & 0x4))
-                        continue;
-                }
+            if (!(r->async_filter[kind] & reason_bit)) {
+                continue;
             }
             if (prev) {
-                send_openflow_buffer_to_remote(ofpbuf_clone(buffer), prev);
+                queue_openflow_buffer(dp, ofpbuf_share(buffer), prev);
             }
             prev = r;
         }
         if (prev) {
-            send_openflow_buffer_to_remote(buffer, prev);
+            queue_openflow_buffer(dp, buffer, prev);
         } else {
             ofpbuf_delete(buffer);
         }
@@ -598,12 +1184,91 @@ send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
     }
 }
 
+/* Returns the length of the item of the body of a multipart reply of 'type'
+ * at 'item', of which 'left' bytes remain, or 0 if it cannot be told. */
+static size_t
+multipart_item_len(uint16_t type, uint8_t const *item, size_t left) {
+    size_t ofs = 0;
+    uint16_t len;
+
+    switch (type) {
+        case OFPMP_TABLE:
+            return MIN(sizeof(struct ofp_table_stats), left);
+        case OFPMP_PORT_STATS:
+            return MIN(sizeof(struct ofp_port_stats), left);
+        case OFPMP_QUEUE:
+            return MIN(sizeof(struct ofp_queue_stats), left);
+        case OFPMP_PORT_DESC:
+            return MIN(sizeof(struct ofp_port), left);
+        case OFPMP_METER:
+            ofs = offsetof(struct ofp_meter_stats, len);
+            break;
+        case OFPMP_FLOW:
+        case OFPMP_GROUP:
+        case OFPMP_GROUP_DESC:
+        case OFPMP_METER_CONFIG:
+        case OFPMP_TABLE_FEATURES:
+            break;
+        default:
+            return 0;
+    }
+    if (left < ofs + sizeof len) {
+        return 0;
+    }
+    memcpy(&len, item + ofs, sizeof len);
+    len = ntohs(len);
+    return len <= left ? len : 0;
+}
+
+/* Sends the multipart reply in 'buf', too long for the 16-bit length of an
+ * OpenFlow message, as parts of whole items, all but the last flagged
+ * OFPMPF_REPLY_MORE.  Consumes 'buf'. */
+static int
+send_multipart_parts(struct datapath *dp, struct ofpbuf *buf,
+                     const struct sender *sender) {
+    struct ofp_multipart_reply const *reply = buf->data;
+    uint8_t const *body = reply->body;
+    size_t left = buf->size - sizeof *reply;
+    uint16_t type = ntohs(reply->type);
+    int error = 0;
+
+    while (left > 0 && !error) {
+        struct ofp_multipart_reply *hdr;
+        struct ofpbuf *part;
+        size_t len = 0;
+        size_t n;
+
+        while (len < left
+               && (n = multipart_item_len(type, body + len, left - len)) != 0
+               && sizeof *reply + len + n <= UINT16_MAX) {
+            len += n;
+        }
+        if (len == 0) {
+            VLOG_ERR_RL(LOG_MODULE, &rl, "Dropping the rest of a multipart reply "
+                        "(type %u), which cannot be split (%zu bytes).", type, left);
+            error = EMSGSIZE;
+            break;
+        }
+        part = ofpbuf_new(sizeof *reply + len);
+        hdr = ofpbuf_put(part, reply, sizeof *reply);
+        ofpbuf_put(part, body, len);
+        hdr->header.length = htons(part->size);
+        if (len < left) {
+            hdr->flags |= htons(OFPMPF_REPLY_MORE);
+        }
+        part->conn_id = buf->conn_id;
+        body += len;
+        left -= len;
+        error = send_openflow_buffer(dp, part, sender);
+    }
+    ofpbuf_delete(buf);
+    return error;
+}
+
 int
 dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
                      const struct sender *sender) {
     struct ofpbuf *ofpbuf;
-    uint8_t *buf;
-    size_t buf_size;
     int error;
 
     if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
@@ -612,14 +1277,14 @@ dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
         free(msg_str);
     }
 
-    error = ofl_msg_pack(msg, sender == NULL ? 0 : sender->xid, &buf, &buf_size, dp->exp);
+    /* Packed in place: the message is written once, into its own buffer. */
+    ofpbuf = ofpbuf_new(0);
+    error = ofl_msg_pack_ofpbuf(msg, sender == NULL ? 0 : sender->xid, ofpbuf, dp->exp);
     if (error) {
         VLOG_WARN_RL(LOG_MODULE, &rl, "There was an error packing the message!");
+        ofpbuf_delete(ofpbuf);
         return error;
     }
-    ofpbuf = ofpbuf_new(0);
-    ofpbuf_use(ofpbuf, buf, buf_size);
-    ofpbuf_put_uninit(ofpbuf, buf_size);
 
     /* Choose the connection to send the packet to.
        1) By default, we send it to the main connection
@@ -633,16 +1298,63 @@ dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
     if (msg->type == OFPT_PACKET_IN)
         ofpbuf->conn_id = PTIN_CONNECTION;
 
+    /* The length in the header has wrapped around: a multipart reply is
+     * split, anything else cannot be sent. */
+    if (ofpbuf->size > UINT16_MAX) {
+        if (msg->type == OFPT_MULTIPART_REPLY) {
+            return send_multipart_parts(dp, ofpbuf, sender);
+        }
+        VLOG_ERR_RL(LOG_MODULE, &rl, "Dropping a message (type %u) of %zu bytes, "
+                    "over the OpenFlow limit.", msg->type, ofpbuf->size);
+        ofpbuf_delete(ofpbuf);
+        return EMSGSIZE;
+    }
+
+    /* The buffer is consumed even on error. */
     error = send_openflow_buffer(dp, ofpbuf, sender);
     if (error) {
         VLOG_WARN_RL(LOG_MODULE, &rl, "There was an error sending the message!");
-        /* TODO Zoltan: is delete needed? */
-        ofpbuf_delete(ofpbuf);
         return error;
     }
     return 0;
 }
 
+void
+dp_send_error(struct datapath *dp, ofl_err error, struct ofl_msg_header const *msg,
+              uint8_t const *data, size_t data_length, const struct sender *sender)
+{
+    /* [*] The highest bit of 'error' is always set to one, but on-the-wire we
+    need full compliance to OF specification: the 'type' of an experimenter
+    error message must be 0xffff instead of 0x7ffff. */
+    if ((ofl_error_type(error) | 0x8000) == OFPET_EXPERIMENTER){
+        struct ofp_experimenter_header const *oh = (struct ofp_experimenter_header const *)data;
+        struct ofl_msg_exp_error err =
+               {{.type = OFPT_ERROR},
+                .type = ofl_error_type(error) | 0x8000, // [*]
+                .exp_type = ofl_error_code(error),
+                .experimenter = OPENSTATE_VENDOR_ID,
+                .data_length = data_length,
+                .data        = (uint8_t *)data};
+
+        /* The request may have failed to decode. */
+        if (msg != NULL) {
+            err.experimenter = get_experimenter_id(msg);
+        } else if (data_length >= sizeof *oh && oh->header.type == OFPT_EXPERIMENTER) {
+            err.experimenter = ntohl(oh->experimenter);
+        }
+        dp_send_message(dp, (struct ofl_msg_header *)&err, sender);
+    }
+    else{
+        struct ofl_msg_error err =
+               {{.type = OFPT_ERROR},
+                .type = ofl_error_type(error),
+                .code = ofl_error_code(error),
+                .data_length = data_length,
+                .data        = (uint8_t *)data};
+        dp_send_message(dp, (struct ofl_msg_header *)&err, sender);
+    }
+}
+
 ofl_err
 dp_handle_set_desc(struct datapath *dp, struct ofl_exp_openflow_msg_set_dp_desc *msg,
                                             const struct sender *sender UNUSED)
@@ -690,6 +1402,7 @@ dp_handle_role_request(struct datapath *dp, struct ofl_msg_role_request *msg,
             LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
                 if (r->role == OFPCR_ROLE_MASTER) {
                     r->role = OFPCR_ROLE_SLAVE;
+                    remote_update_async_filter(r);
                 }
             }
             sender->remote->role = OFPCR_ROLE_MASTER;
@@ -709,6 +1422,7 @@ dp_handle_role_request(struct datapath *dp, struct ofl_msg_role_request *msg,
             return ofl_error(OFPET_ROLE_REQUEST_FAILED, OFPRRFC_BAD_ROLE);
         }
     }
+    remote_update_async_filter(sender->remote);
 
     {
     struct ofl_msg_role_request reply =
@@ -739,6 +1453,7 @@ dp_handle_async_request(struct datapath *dp, struct ofl_msg_async_config *msg,
         }
         case (OFPT_SET_ASYNC):{
             memcpy(&sender->remote->config, msg->config, sizeof(struct ofl_async_config));
+            remote_update_async_filter(sender->remote);
             break;
         }
     }
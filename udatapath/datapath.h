@@ -40,6 +40,7 @@
 #define DATAPATH_H 1
 
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include "dp_buffers.h"
@@ -51,6 +52,9 @@
 #include "oflib/ofl-structs.h"
 #include "oflib-exp/ofl-exp-nicira.h"
 #include "group_table.h"
+#include "latch.h"
+#include "queue.h"
+#include "spsc-ring.h"
 #include "timeval.h"
 #include "list.h"
 
@@ -58,6 +62,9 @@
 struct rconn;
 struct pvconn;
 struct sender;
+struct control_event;
+struct flow_deltas;
+struct dp_snapshot;
 
 /****************************************************************************
  * The datapath
@@ -79,7 +86,7 @@ struct datapath
 
     uint32_t  global_state;    /* Global state for this datapath. */
 
-    struct list remotes;        /* Remote connections. */
+    struct list remotes;        /* Remote connections, forwarding side. */
 
     uint64_t generation_id;     /* Identifies a given mastership view */
 
@@ -90,9 +97,49 @@ struct datapath
     size_t n_listeners_aux;
     time_t last_timeout;
 
+    /* OpenFlow channel.  The listeners and the connections to remotes are
+     * served by the control side: the control thread once started with
+     * dp_start_control_thread(), dp_run() otherwise.  Received messages are
+     * handled by the forwarding side, the caller of dp_run(), which is thus
+     * the only one to ever modify the flow, group and meter tables.  Requests
+     * that walk the flow or state tables are handed back to the control side
+     * though, which builds the replies while holding 'tables_lock' for
+     * reading.  The two sides exchange messages and remotes over the rings
+     * below. */
+    struct list ctl_remotes;    /* All remotes, control side. */
+    struct spsc_ring ctl_rx;    /* Control events, to the forwarding side. */
+    struct spsc_ring ctl_tx;    /* Outgoing messages and deferred requests,
+                                   to the control side. */
+    struct latch ctl_rx_latch;  /* Set when 'ctl_rx' got events, or 'ctl_tx'
+                                   room. */
+    struct latch ctl_tx_latch;  /* Set when 'ctl_tx' got messages. */
+    bool ctl_rx_pending;        /* 'ctl_rx_latch' needs setting. */
+    bool ctl_tx_pending;        /* 'ctl_tx_latch' needs setting. */
+    bool ctl_rx_stalled;        /* Control side waits for room in 'ctl_rx'. */
+    bool ctl_tx_stalled;        /* Forwarding side waits for room in 'ctl_tx'. */
+    size_t n_tx_backlogs;       /* Remotes with messages in 'tx_backlog';
+                                   forwarding side only. */
+    bool ctl_threaded;          /* Is the control thread running? */
+    pthread_t ctl_thread;
+    struct control_event *ctl_tx_held; /* Deferred request waiting for the
+                                   forwarding side to be done with
+                                   'tables_lock'; control side only. */
+    pthread_rwlock_t tables_lock; /* Held for writing by the forwarding side
+                                   while it may change the flow, group and
+                                   meter tables; never waited for by it. */
+    bool tables_wanted;         /* Forwarding side failed to take
+                                   'tables_lock'; accessed atomically. */
+
     struct dp_buffers *buffers;
 
+    struct dp_pktin *pktin;     /* Packet-in rate limits. */
+
+    struct dp_snapshot *snapshot; /* Snapshots of the state tables, if
+                                     set. */
+
     struct pipeline *pipeline;  /* Pipeline with multi-tables. */
+    uint64_t flow_entry_ids;    /* Last id given to a flow entry. */
+    size_t flow_monitors_num;   /* Flow monitors set by all the remotes. */
 
     struct group_table *groups; /* Group tables */
 
@@ -103,10 +150,16 @@ struct datapath
     /* Switch ports. */
     /* NOTE: ports are numbered starting at 1 in OF 1.1 */
     uint32_t         max_queues; /* used when creating ports */
-    struct sw_port   ports[DP_MAX_PORTS + 1];
+    bool             offload;    /* Enable offloading when creating ports? */
+    struct hmap      ports;       /* All ports, indexed by port number. */
     struct sw_port  *local_port;  /* OFPP_LOCAL port, if any. */
     struct list      port_list; /* All ports, including local_port. */
     size_t           ports_num;
+    struct sw_port **all_ports;   /* Output ports of OFPP_ALL. */
+    size_t           all_ports_num;
+    struct sw_port **flood_ports; /* Output ports of OFPP_FLOOD. */
+    size_t           flood_ports_num;
+    struct netdev_monitor *port_monitor; /* Link state changes of ports. */
 
     /* Experimenter handling. */
     struct ofl_exp  *exp;
@@ -121,6 +174,10 @@ struct datapath
 #endif
 };
 
+/* Connections of a remote. */
+#define MAIN_CONNECTION 0
+#define PTIN_CONNECTION 1
+
 /* The origin of a received OpenFlow message, to enable sending a reply. */
 struct sender {
     struct remote *remote;      /* The device that sent the message. */
@@ -128,27 +185,62 @@ struct sender {
     uint32_t xid;               /* The OpenFlow transaction ID. */
 };
 
-/* A connection to a secure channel. */
+/* Kinds of messages broadcast to the remotes, which each remote filters by
+ * reason according to its role and asynchronous configuration. */
+enum remote_msg_kind {
+    REMOTE_MSG_PACKET_IN,
+    REMOTE_MSG_PORT_STATUS,
+    REMOTE_MSG_FLOW_REMOVED,
+    REMOTE_MSG_OTHER,           /* Any other message, reason 0. */
+    REMOTE_MSG_N_KINDS
+};
+
+/* A connection to a secure channel.
+ *
+ * A remote is created and destroyed by the control side of the datapath,
+ * which owns the connections.  The forwarding side owns the OpenFlow state
+ * of the remote, from the role on. */
 struct remote {
-    struct list node;
+    struct list node;           /* In datapath's 'remotes'. */
+    struct list ctl_node;       /* In datapath's 'ctl_remotes'. */
     struct rconn *rconn;
     struct rconn *rconn_aux;
 
 #define TXQ_LIMIT 128           /* Max number of packets to queue for tx. */
-    int n_txq;                  /* Number of packets queued for tx on rconn. */
-
-    /* Support for reliable, multi-message replies to requests.
-     *
-     * If an incoming request needs to have a reliable reply that might
-     * require multiple messages, it can use remote_start_dump() to set up
-     * a callback that will be called as buffer space for replies. */
-    int (*cb_dump)(struct datapath *, void *aux);
-    void (*cb_done)(void *aux);
-    void *cb_aux;
+    int n_txq;                  /* Number of packets queued for tx on rconn;
+                                   control side only. */
+    int n_txq_shared;           /* Copy of 'n_txq' for the forwarding side;
+                                   accessed atomically. */
+    struct ofp_queue tx_held;   /* Messages held back while 'n_txq' is at
+                                   TXQ_LIMIT; control side only. */
+    struct list tx_backlog;     /* Events held back while 'ctl_tx' is full;
+                                   forwarding side only. */
+    bool tx_blocked;            /* 'tx_backlog' is not empty, so the control
+                                   side stops receiving from the remote;
+                                   accessed atomically. */
+
+    bool closing;               /* Disconnected, waiting for 'released'. */
+    bool released;              /* Let go of by the forwarding side. */
+    bool releasable;            /* 'released' seen before sending queued
+                                   messages, control side only. */
+
+    struct ofpbuf *pktin_batch; /* Packet-ins not yet queued for tx. */
 
     uint32_t role; /*OpenFlow controller role.*/
     struct ofl_async_config config;  /* Asynchronous messages configuration,
                                             set from controller*/
+    uint32_t async_filter[REMOTE_MSG_N_KINDS]; /* Bitmaps of the reasons of
+                                   broadcast messages sent, by kind; derived
+                                   from 'role' and 'config'. */
+
+    struct list bundles;        /* Open bundles; forwarding side only. */
+    struct flow_deltas *flow_deltas; /* Flow counters last reported; forwarding
+                                   side only, NULL until asked for. */
+    struct list flow_monitors;  /* Flow monitors; forwarding side only. */
+    struct ofpbuf *flow_updates; /* Flow monitor updates not yet queued for
+                                   tx. */
+    bool flow_updates_paused;   /* Updates stopped until the connection
+                                   catches up. */
 
     /* Multipart request message pending reassembly. */
     struct ofl_msg_multipart_request_header *mp_req_msg; /* Message. */
@@ -173,6 +265,11 @@ dp_run(struct datapath *dp);
 void
 dp_wait(struct datapath *dp);
 
+/* Moves the OpenFlow connections, and the unpacking of received messages, to
+ * a thread of their own, so that they do not stall forwarding. */
+void
+dp_start_control_thread(struct datapath *dp);
+
 
 /* Setter functions for various datapath fields */
 void
@@ -196,6 +293,12 @@ dp_set_serial_num(struct datapath *dp, char *serial_num);
 void
 dp_set_max_queues(struct datapath *dp, uint32_t max_queues);
 
+void
+dp_set_offload(struct datapath *dp, bool offload);
+
+void
+dp_set_buffer_size(struct datapath *dp, size_t bytes);
+
 
 /* Sends the given OFLib message to the connection represented by sender,
  * or to all open connections, if sender is null. */
@@ -204,6 +307,21 @@ dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
                      const struct sender *sender);
 
 
+/* Sends an error message for 'error', quoting the 'data_length' bytes of
+ * 'data' of the request that failed, which is 'msg' once decoded (if it
+ * could be). */
+void
+dp_send_error(struct datapath *dp, ofl_err error, struct ofl_msg_header const *msg,
+              uint8_t const *data, size_t data_length, const struct sender *sender);
+
+/* Hands the multipart request 'msg', which walks the flow or state tables,
+ * over to the control side, which builds the reply off the forwarding path.
+ * Returns false if 'msg' is rather to be served right away, as it already is
+ * on the control side, or there is no control thread. */
+bool
+dp_defer_stats_request(struct datapath *dp,
+                       struct ofl_msg_multipart_request_header *msg,
+                       const struct sender *sender);
 
 /* Handles a set description (openflow experimenter) message */
 ofl_err
@@ -36,6 +36,7 @@
 #include "dp_exp.h"
 #include "dp_actions.h"
 #include "dp_buffers.h"
+#include "dp_pktin.h"
 #include "datapath.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-actions.h"
@@ -43,7 +44,6 @@
 #include "packet.h"
 #include "packets.h"
 #include "pipeline.h"
-#include "crc32.h"
 #include "util.h"
 #include "oflib/oxm-match.h"
 #include "hash.h"
@@ -69,6 +69,111 @@ output(struct packet *pkt, struct ofl_action_output *action) {
     }
 }
 
+/* Returns true if the L4 checksum of the packet is left to the output device.
+ * Its checksum field then holds the uncomplemented sum of the pseudo-header
+ * only, and fields covered by the checksum may change without updating it. */
+static bool
+l4_csum_offloaded(const struct packet *pkt) {
+    return (pkt->offload.flags & NETDEV_OFFLOAD_NEEDS_CSUM) != 0;
+}
+
+/* Header rewrites do not update checksums in place.  They add their change to
+ * the deltas kept in the packet, which packet_csum_flush() applies once when
+ * the packet is output, so several rewrites cost a single checksum update.
+ * They run on a parsed packet, and note where its checksums are for the flush
+ * to find them without parsing it again. */
+
+/* Returns the offset of 'field' back from the end of the packet. */
+static uint32_t
+csum_ofs(const struct packet *pkt, void const *field) {
+    return (uint8_t *) ofpbuf_tail(pkt->buffer) - (uint8_t const *) field;
+}
+
+/* Notes where the L4 checksum of the packet is. */
+static void
+l4_csum_locate(struct packet *pkt) {
+    struct protocols_std *proto = pkt->handle_std->proto;
+    uint16_t *csum = NULL;
+
+    if (proto->tcp != NULL) {
+        csum = &proto->tcp->tcp_csum;
+    } else if (proto->udp != NULL) {
+        /* A zero UDP checksum over IPv4 means there is none. */
+        if (proto->udp->udp_csum != 0 || proto->ipv4 == NULL) {
+            csum = &proto->udp->udp_csum;
+        }
+    } else if (proto->icmp != NULL) {
+        csum = &proto->icmp->icmp_csum;
+    }
+    pkt->l4_csum_ofs = csum != NULL ? csum_ofs(pkt, csum) : 0;
+}
+
+/* Records the change of an IPv4 header word from 'old' to 'new'. */
+static void
+ip_csum_update16(struct packet *pkt, uint16_t old, uint16_t new) {
+    pkt->ip_csum_delta = csum_delta16(pkt->ip_csum_delta, old, new);
+    pkt->ip_csum_ofs = csum_ofs(pkt, &pkt->handle_std->proto->ipv4->ip_csum);
+    pkt->csum_dirty = true;
+}
+
+/* Records the change of a 32 bit IPv4 header field from 'old' to 'new'. */
+static void
+ip_csum_update32(struct packet *pkt, uint32_t old, uint32_t new) {
+    pkt->ip_csum_delta = csum_delta32(pkt->ip_csum_delta, old, new);
+    pkt->ip_csum_ofs = csum_ofs(pkt, &pkt->handle_std->proto->ipv4->ip_csum);
+    pkt->csum_dirty = true;
+}
+
+/* Records the change of a 16 bit field covered by the L4 checksum.  Nothing
+ * is owed if the checksum is left to the output device. */
+static void
+l4_csum_update16(struct packet *pkt, uint16_t old, uint16_t new) {
+    if (!l4_csum_offloaded(pkt)) {
+        pkt->l4_csum_delta = csum_delta16(pkt->l4_csum_delta, old, new);
+        l4_csum_locate(pkt);
+        pkt->csum_dirty = true;
+    }
+}
+
+/* Records the change of a 32 bit field covered by the L4 checksum. */
+static void
+l4_csum_update32(struct packet *pkt, uint32_t old, uint32_t new) {
+    if (!l4_csum_offloaded(pkt)) {
+        pkt->l4_csum_delta = csum_delta32(pkt->l4_csum_delta, old, new);
+        l4_csum_locate(pkt);
+        pkt->csum_dirty = true;
+    }
+}
+
+/* Records the change of a 128 bit field covered by the L4 checksum. */
+static void
+l4_csum_update128(struct packet *pkt, uint8_t const old[16],
+                  uint8_t const new[16]) {
+    if (!l4_csum_offloaded(pkt)) {
+        pkt->l4_csum_delta = csum_delta128(pkt->l4_csum_delta, old, new);
+        l4_csum_locate(pkt);
+        pkt->csum_dirty = true;
+    }
+}
+
+/* Records the change of a 32 bit pseudo-header field from 'old' to 'new'.
+ * The pseudo-header is part of an offloaded checksum too. */
+static void
+l4_pseudo_update32(struct packet *pkt, uint32_t old, uint32_t new) {
+    pkt->l4_csum_delta = csum_delta32(pkt->l4_csum_delta, old, new);
+    l4_csum_locate(pkt);
+    pkt->csum_dirty = true;
+}
+
+/* Records the change of a 128 bit pseudo-header field. */
+static void
+l4_pseudo_update128(struct packet *pkt, uint8_t const old[16],
+                    uint8_t const new[16]) {
+    pkt->l4_csum_delta = csum_delta128(pkt->l4_csum_delta, old, new);
+    l4_csum_locate(pkt);
+    pkt->csum_dirty = true;
+}
+
 /* Executes a set field action.
 TODO: if we use the the index structure to the packet fields
 revalidation is not needed  */
@@ -81,7 +186,6 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
     {
         /*Field existence is guaranteed by the
         field pre-requisite on matching */
-        fprintf(stderr, "Header %d\n", OXM_FIELD(act->field->header));
         switch(act->field->header){
             case OXM_OF_ETH_DST:{
                 memcpy(pkt->handle_std->proto->eth->eth_dst,
@@ -123,7 +227,7 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                                    (*act->field->value << 2);
                     uint16_t old_val = htons((ipv4->ip_ihl_ver << 8) + ipv4->ip_tos);
                     uint16_t new_val = htons((ipv4->ip_ihl_ver << 8) + tos);
-                    ipv4->ip_csum = recalc_csum16(ipv4->ip_csum, old_val, new_val);
+                    ip_csum_update16(pkt, old_val, new_val);
                     ipv4->ip_tos = tos;
                 }
                 else if (pkt->handle_std->proto->ipv6){
@@ -141,7 +245,7 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                                (*act->field->value & IP_ECN_MASK);
                     uint16_t old_val = htons((ipv4->ip_ihl_ver << 8) + ipv4->ip_tos);
                     uint16_t new_val = htons((ipv4->ip_ihl_ver << 8) + tos);
-                    ipv4->ip_csum = recalc_csum16(ipv4->ip_csum, old_val, new_val);
+                    ip_csum_update16(pkt, old_val, new_val);
                     ipv4->ip_tos = tos;
                 }
                 else if (pkt->handle_std->proto->ipv6){
@@ -158,7 +262,7 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                 uint8_t proto = *act->field->value;
                 old_val = htons((ipv4->ip_ttl << 8) + ipv4->ip_proto);
                 new_val =  htons((ipv4->ip_ttl << 8) + proto);
-                ipv4->ip_csum = recalc_csum16(ipv4->ip_csum, old_val, new_val);
+                ip_csum_update16(pkt, old_val, new_val);
                 ipv4->ip_proto = proto;
                 break;
             }
@@ -166,18 +270,13 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                 struct ip_header *ipv4 = pkt->handle_std->proto->ipv4;
 
                 /*Reconstruct TCP or UDP checksum*/
-                if (pkt->handle_std->proto->tcp != NULL) {
-                    struct tcp_header *tcp = pkt->handle_std->proto->tcp;
-                    tcp->tcp_csum = recalc_csum32(tcp->tcp_csum,
-                        ipv4->ip_src, *((uint32_t*) act->field->value));
-                } else if (pkt->handle_std->proto->udp != NULL) {
-                    struct udp_header *udp = pkt->handle_std->proto->udp;
-                    udp->udp_csum = recalc_csum32(udp->udp_csum,
-                        ipv4->ip_src, *((uint32_t*) act->field->value));
+                if (pkt->handle_std->proto->tcp != NULL ||
+                    pkt->handle_std->proto->udp != NULL) {
+                    l4_pseudo_update32(pkt, ipv4->ip_src,
+                                       *((uint32_t*) act->field->value));
                 }
-
-                ipv4->ip_csum = recalc_csum32(ipv4->ip_csum, ipv4->ip_src,
-                                     *((uint32_t*) act->field->value));
+                ip_csum_update32(pkt, ipv4->ip_src,
+                                 *((uint32_t*) act->field->value));
 
                 ipv4->ip_src = *((uint32_t*) act->field->value);
                 break;
@@ -186,18 +285,13 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                 struct ip_header *ipv4 = pkt->handle_std->proto->ipv4;
 
                 /*Reconstruct TCP or UDP checksum*/
-                if (pkt->handle_std->proto->tcp != NULL) {
-                    struct tcp_header *tcp = pkt->handle_std->proto->tcp;
-                    tcp->tcp_csum = recalc_csum32(tcp->tcp_csum,
-                        ipv4->ip_dst, *((uint32_t*) act->field->value));
-                } else if (pkt->handle_std->proto->udp != NULL) {
-                    struct udp_header *udp = pkt->handle_std->proto->udp;
-                    udp->udp_csum = recalc_csum32(udp->udp_csum,
-                        ipv4->ip_dst, *((uint32_t*) act->field->value));
+                if (pkt->handle_std->proto->tcp != NULL ||
+                    pkt->handle_std->proto->udp != NULL) {
+                    l4_pseudo_update32(pkt, ipv4->ip_dst,
+                                       *((uint32_t*) act->field->value));
                 }
-
-                ipv4->ip_csum = recalc_csum32(ipv4->ip_csum, ipv4->ip_dst,
-                                    *((uint32_t*) act->field->value));
+                ip_csum_update32(pkt, ipv4->ip_dst,
+                                 *((uint32_t*) act->field->value));
 
                 ipv4->ip_dst = *((uint32_t*) act->field->value);
                 break;
@@ -205,56 +299,45 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
             case OXM_OF_TCP_SRC:{
                 struct tcp_header *tcp = pkt->handle_std->proto->tcp;
                 uint16_t v = htons(*(uint16_t*) act->field->value);
-                tcp->tcp_csum = recalc_csum16(tcp->tcp_csum, tcp->tcp_src, v);
+                l4_csum_update16(pkt, tcp->tcp_src, v);
                 tcp->tcp_src = v;
                 break;
             }
             case OXM_OF_TCP_DST:{
                 struct tcp_header *tcp = pkt->handle_std->proto->tcp;
                 uint16_t v = htons(*(uint16_t*) act->field->value);
-                tcp->tcp_csum = recalc_csum16(tcp->tcp_csum, tcp->tcp_dst, v);
+                l4_csum_update16(pkt, tcp->tcp_dst, v);
                 tcp->tcp_dst = v;
                 break;
             }
             case OXM_OF_UDP_SRC:{
                 struct udp_header *udp = pkt->handle_std->proto->udp;
                 uint16_t v = htons(*(uint16_t*) act->field->value);
-                udp->udp_csum = recalc_csum16(udp->udp_csum, udp->udp_src, v);
+                l4_csum_update16(pkt, udp->udp_src, v);
                 udp->udp_src = v;
                 break;
             }
             case OXM_OF_UDP_DST:{
                 struct udp_header *udp = pkt->handle_std->proto->udp;
                 uint16_t v = htons(*(uint16_t*) act->field->value);
-                udp->udp_csum = recalc_csum16(udp->udp_csum, udp->udp_dst, v);
+                l4_csum_update16(pkt, udp->udp_dst, v);
                 udp->udp_dst = v;
                 break;
             }
-            /*TODO recalculate SCTP checksum*/
             case OXM_OF_SCTP_SRC:{
-                crc_t crc;
-                struct sctp_header *sctp = pkt->handle_std->proto->sctp;                
-                size_t len = ((uint8_t*) ofpbuf_tail(pkt->handle_std->pkt->buffer)) - (uint8_t *) sctp;
-                uint16_t v = htons(*(uint16_t*) act->field->value);
-                sctp->sctp_csum = 0;
-                sctp->sctp_src = v;
-                crc = crc_init();
-                crc = crc_update(crc, (unsigned char*)sctp, len);                            
-                crc = crc_finalize(crc);
-                sctp->sctp_csum = crc;
+                struct sctp_header *sctp = pkt->handle_std->proto->sctp;
+                sctp->sctp_src = htons(*(uint16_t*) act->field->value);
+                pkt->sctp_dirty = true;
+                pkt->sctp_ofs = csum_ofs(pkt, sctp);
+                pkt->csum_dirty = true;
                 break;                                        
             }
             case OXM_OF_SCTP_DST:{
-                crc_t crc;
-                struct sctp_header *sctp = pkt->handle_std->proto->sctp;                
-                size_t len = ((uint8_t*) ofpbuf_tail(pkt->handle_std->pkt->buffer)) - (uint8_t *) sctp;
-                uint16_t v = htons(*(uint16_t*) act->field->value);
-                sctp->sctp_csum = 0;
-                sctp->sctp_dst = v;
-                crc = crc_init();
-                crc = crc_update(crc, (unsigned char*)sctp, len);                            
-                crc = crc_finalize(crc);
-                sctp->sctp_csum = crc;
+                struct sctp_header *sctp = pkt->handle_std->proto->sctp;
+                sctp->sctp_dst = htons(*(uint16_t*) act->field->value);
+                pkt->sctp_dirty = true;
+                pkt->sctp_ofs = csum_ofs(pkt, sctp);
+                pkt->csum_dirty = true;
                 break;        
             }
             case OXM_OF_ICMPV4_TYPE:
@@ -264,7 +347,7 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                     uint8_t icmp_type = *act->field->value;
                     old_val = htons((icmp_header->icmp_type << 8) + icmp_header->icmp_code);
                     new_val =  htons((icmp_type << 8) + icmp_header->icmp_code);
-                    icmp_header->icmp_csum = recalc_csum16(icmp_header->icmp_csum , old_val, new_val);
+                    l4_csum_update16(pkt, old_val, new_val);
                     icmp_header->icmp_type = *act->field->value;
                 break;
             }
@@ -275,7 +358,7 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                     uint8_t icmp_code = *act->field->value;
                     old_val = htons((icmp_header->icmp_type << 8) + icmp_header->icmp_code);
                     new_val =  htons((icmp_header->icmp_type << 8) + icmp_code);
-                    icmp_header->icmp_csum = recalc_csum16(icmp_header->icmp_csum , old_val, new_val);
+                    l4_csum_update16(pkt, old_val, new_val);
                     icmp_header->icmp_code = *act->field->value;
                 break;
             }
@@ -305,15 +388,12 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
             }
             case OXM_OF_IPV6_SRC:{
                 struct ipv6_header *ipv6 = pkt->handle_std->proto->ipv6;
-                 /*Reconstruct TCP or UDP checksum*/
-                if (pkt->handle_std->proto->tcp != NULL) {
-                    struct tcp_header *tcp = pkt->handle_std->proto->tcp;
-                    tcp->tcp_csum = recalc_csum128(tcp->tcp_csum,
-                        ipv6->ipv6_src.s6_addr,  act->field->value);
-                } else if (pkt->handle_std->proto->udp != NULL) {
-                    struct udp_header *udp = pkt->handle_std->proto->udp;
-                    udp->udp_csum = recalc_csum128(udp->udp_csum,
-                        ipv6->ipv6_src.s6_addr, act->field->value);
+                /*Reconstruct TCP, UDP or ICMPv6 checksum*/
+                if (pkt->handle_std->proto->tcp != NULL ||
+                    pkt->handle_std->proto->udp != NULL ||
+                    pkt->handle_std->proto->icmp != NULL) {
+                    l4_pseudo_update128(pkt, ipv6->ipv6_src.s6_addr,
+                                        act->field->value);
                 }
                 memcpy(&pkt->handle_std->proto->ipv6->ipv6_src,
                         act->field->value, OXM_LENGTH(act->field->header));
@@ -321,15 +401,12 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
             }
             case OXM_OF_IPV6_DST:{
                 struct ipv6_header *ipv6 = pkt->handle_std->proto->ipv6;
-                 /*Reconstruct TCP or UDP checksum*/
-                if (pkt->handle_std->proto->tcp != NULL) {
-                    struct tcp_header *tcp = pkt->handle_std->proto->tcp;
-                    tcp->tcp_csum = recalc_csum128(tcp->tcp_csum,
-                        ipv6->ipv6_dst.s6_addr,  act->field->value);
-                } else if (pkt->handle_std->proto->udp != NULL) {
-                    struct udp_header *udp = pkt->handle_std->proto->udp;
-                    udp->udp_csum = recalc_csum128(udp->udp_csum,
-                        ipv6->ipv6_dst.s6_addr, act->field->value);
+                /*Reconstruct TCP, UDP or ICMPv6 checksum*/
+                if (pkt->handle_std->proto->tcp != NULL ||
+                    pkt->handle_std->proto->udp != NULL ||
+                    pkt->handle_std->proto->icmp != NULL) {
+                    l4_pseudo_update128(pkt, ipv6->ipv6_dst.s6_addr,
+                                        act->field->value);
                 }
                 memcpy(&pkt->handle_std->proto->ipv6->ipv6_dst,
                         act->field->value, OXM_LENGTH(act->field->header));
@@ -355,8 +432,7 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                 memcpy(old_value, data + offset, OXM_LENGTH(act->field->header));
                 memcpy(data + offset, act->field->value,
                                             OXM_LENGTH(act->field->header));
-                icmp->icmp_csum = recalc_csum128(icmp->icmp_csum,
-                           old_value, act->field->value);
+                l4_csum_update128(pkt, old_value, act->field->value);
                 break;
             }
             case OXM_OF_IPV6_ND_SLL:
@@ -381,8 +457,8 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                                     OXM_LENGTH(act->field->header));
                     new_val16 = *((uint16_t*) (act->field->value));
                     new_val32 = *((uint32_t*) (act->field->value + sizeof(uint16_t)));
-                    icmp->icmp_csum = recalc_csum16(icmp->icmp_csum, old_val16, new_val16);
-                    icmp->icmp_csum = recalc_csum32(icmp->icmp_csum, old_val32, new_val32);
+                    l4_csum_update16(pkt, old_val16, new_val16);
+                    l4_csum_update32(pkt, old_val32, new_val32);
                 }                                
                 break;
             }
@@ -904,7 +980,7 @@ set_nw_ttl(struct packet *pkt, struct ofl_action_set_nw_ttl *act) {
 
         uint16_t old_val = htons((ipv4->ip_proto) + (ipv4->ip_ttl<<8));
         uint16_t new_val = htons((ipv4->ip_proto) + (act->nw_ttl<<8));
-        ipv4->ip_csum = recalc_csum16(ipv4->ip_csum, old_val, new_val);
+        ip_csum_update16(pkt, old_val, new_val);
         ipv4->ip_ttl = act->nw_ttl;
     } else if (pkt->handle_std->proto->ipv6 != NULL){
        struct ipv6_header *ipv6 = pkt->handle_std->proto->ipv6;
@@ -928,7 +1004,7 @@ dec_nw_ttl(struct packet *pkt, struct ofl_action_header *act UNUSED) {
             uint8_t new_ttl = ipv4->ip_ttl - 1;
             uint16_t old_val = htons((ipv4->ip_proto) + (ipv4->ip_ttl<<8));
             uint16_t new_val = htons((ipv4->ip_proto) + (new_ttl<<8));
-            ipv4->ip_csum = recalc_csum16(ipv4->ip_csum, old_val, new_val);
+            ip_csum_update16(pkt, old_val, new_val);
             ipv4->ip_ttl = new_ttl;
         }
     } else if (pkt->handle_std->proto->ipv6 != NULL){
@@ -946,6 +1022,7 @@ dec_nw_ttl(struct packet *pkt, struct ofl_action_header *act UNUSED) {
 void
 dp_execute_action(struct packet *pkt,
                struct ofl_action_header *action) {
+    size_t size = pkt->buffer->size;
 
     if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
         char *a = ofl_action_to_string(action, pkt->dp->exp);
@@ -987,6 +1064,8 @@ dp_execute_action(struct packet *pkt,
             break;
         }
         case (OFPAT_PUSH_MPLS): {
+            /* The IP header is no longer parsed once hidden by the tag. */
+            packet_csum_flush(pkt);
             push_mpls(pkt, (struct ofl_action_push *)action);
             break;
         }
@@ -1011,6 +1090,7 @@ dp_execute_action(struct packet *pkt,
             break;
         }
         case (OFPAT_PUSH_PBB):{
+            packet_csum_flush(pkt);
             push_pbb(pkt, (struct ofl_action_push*)action);
             break;
         }
@@ -1027,6 +1107,16 @@ dp_execute_action(struct packet *pkt,
             VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to execute unknown action type (%u).", action->type);
         }
     }
+    if (pkt->buffer->size != size) {
+        /* Push and pop actions only add or remove headers in front of the L3
+         * header, so the offsets of the offload state move along. */
+        if (pkt->offload.flags & NETDEV_OFFLOAD_NEEDS_CSUM) {
+            pkt->offload.csum_start += pkt->buffer->size - size;
+        }
+        if (pkt->offload.hdr_len) {
+            pkt->offload.hdr_len += pkt->buffer->size - size;
+        }
+    }
     if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
         char *p = packet_to_string(pkt);
         VLOG_DBG_RL(LOG_MODULE, &rl, "action result: %s", p);
@@ -1078,6 +1168,8 @@ dp_execute_action_list(struct packet *pkt,
 void
 dp_actions_output_port(struct packet *pkt, uint32_t out_port, uint32_t out_queue, uint16_t max_len, uint64_t cookie) {
 
+    packet_csum_flush(pkt);
+
     switch (out_port) {
         case (OFPP_TABLE): {
             if (pkt->packet_out) {
@@ -1093,41 +1185,42 @@ dp_actions_output_port(struct packet *pkt, uint32_t out_port, uint32_t out_queue
             break;
         }
         case (OFPP_IN_PORT): {
-            dp_ports_output(pkt->dp, pkt->buffer, pkt->in_port, 0);
+            dp_ports_output(pkt->dp, pkt->buffer, &pkt->offload,
+                            pkt->in_port, 0);
             break;
         }
         case (OFPP_CONTROLLER): {
             struct ofl_msg_packet_in msg;
-            msg.header.type = OFPT_PACKET_IN;
-            msg.total_len   = pkt->buffer->size;
+
             msg.reason = pkt->handle_std->table_miss? OFPR_NO_MATCH:OFPR_ACTION;
+            if (!dp_pktin_admit(pkt->dp->pktin, msg.reason, pkt->table_id)) {
+                break;
+            }
+
+            /* Controllers expect complete packets.  Super-packets are
+             * segmented by dp_pktin_send(), which completes the checksum of
+             * each segment. */
+            netdev_offload_complete_csum(pkt->buffer, &pkt->offload);
+
             msg.table_id = pkt->table_id;
-            msg.data        = pkt->buffer->data;
             msg.cookie = cookie;
 
-            if (pkt->dp->config.miss_send_len != OFPCML_NO_BUFFER){
-                dp_buffers_save(pkt->dp->buffers, pkt);
-                msg.buffer_id = pkt->buffer_id;
-                msg.data_length = MIN(max_len, pkt->buffer->size);
-            }
-            else {
-                msg.buffer_id = OFP_NO_BUFFER;
-                msg.data_length =  pkt->buffer->size;
-            }
-
             if (!pkt->handle_std->valid){
                 packet_handle_std_validate(pkt->handle_std);
             }
             /* In this implementation the fields in_port and in_phy_port
                 always will be the same, because we are not considering logical
                 ports*/
+            packet_handle_std_put_state(pkt->handle_std);
             msg.match = (struct ofl_match_header*) &pkt->handle_std->match;
-            dp_send_message(pkt->dp, (struct ofl_msg_header *)&msg, NULL);
+            dp_pktin_send(pkt, &msg, max_len);
+            packet_handle_std_remove_state(pkt->handle_std);
             break;
         }
         case (OFPP_FLOOD):
         case (OFPP_ALL): {
-            dp_ports_output_all(pkt->dp, pkt->buffer, pkt->in_port, out_port == OFPP_FLOOD);
+            dp_ports_output_all(pkt->dp, pkt->buffer, &pkt->offload,
+                                pkt->in_port, out_port == OFPP_FLOOD);
             break;
         }
         case (OFPP_NORMAL):
@@ -1138,7 +1231,8 @@ dp_actions_output_port(struct packet *pkt, uint32_t out_port, uint32_t out_queue
                 VLOG_WARN_RL(LOG_MODULE, &rl, "can't directly forward to input port.");
             } else {
                 VLOG_DBG_RL(LOG_MODULE, &rl, "Outputting packet on port %u.", out_port);
-                dp_ports_output(pkt->dp, pkt->buffer, out_port, out_queue);
+                dp_ports_output(pkt->dp, pkt->buffer, &pkt->offload,
+                                out_port, out_queue);
             }
         }
     }
@@ -40,150 +40,266 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "datapath.h"
 #include "dp_buffers.h"
+#include "hmap.h"
+#include "list.h"
 #include "timeval.h"
 #include "packet.h"
+#include "packet_handle_std.h"
+#include "util.h"
 #include "vlog.h"
+#include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow-ext.h"
 
 #define LOG_MODULE VLM_dp_buf
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 
 
-/* Buffers are identified by a 31-bit opaque ID.  We divide the ID
- * into a buffer number (low bits) and a cookie (high bits).  The buffer number
- * is an index into an array of buffers.  The cookie distinguishes between
- * different packets that have occupied a single buffer.  Thus, the more
- * buffers we have, the lower-quality the cookie... */
-#define PKT_BUFFER_BITS 8
-#define PKT_COOKIE_BITS (32 - PKT_BUFFER_BITS)
+/* Buffered packets are identified by a 32-bit ID, handed out in sequence, and
+ * looked up by hashing.  The packets are kept in the order they were saved,
+ * so that the oldest are the first to expire, or to be evicted when the store
+ * runs out of room.  The room is measured in bytes, as packets range from
+ * minimum-sized frames to super-packets. */
 
-#define N_PKT_BUFFERS (1 << PKT_BUFFER_BITS)
-#define PKT_BUFFER_MASK (N_PKT_BUFFERS - 1)
+/* Packets are expired this long after being saved. */
+#define EXPIRE_MSECS  5000
 
-
-#define OVERWRITE_SECS  1
+/* Size of a full-sized frame, for estimating the number of buffers. */
+#define NOMINAL_PKT_BYTES  2048
 
 struct packet_buffer {
-    struct packet *pkt;
-    uint32_t       cookie;
-    time_t         timeout;
+    struct hmap_node  hmap_node; /* In 'buffers', hashed by 'id'. */
+    struct list       lru_node;  /* In 'lru', oldest first. */
+    struct packet    *pkt;
+    uint32_t          id;
+    size_t            size;      /* Bytes accounted for 'pkt'. */
+    long long int     expires;   /* Time of expiration, in ms. */
 };
 
-
-// NOTE: The current implementation assumes that a packet is only saved once
-//       to the buffers. Thus, if two entities save it, and one retrieves it,
-//       the other will receive an invalid buffer response.
-//       In the current implementation this should not happen.
+struct dp_buffers_stats {
+    uint64_t  n_saved;    /* Packets saved. */
+    uint64_t  n_hits;     /* Packets retrieved. */
+    uint64_t  n_misses;   /* Retrievals of unknown or expired buffers. */
+    uint64_t  n_expired;  /* Packets expired before being retrieved. */
+    uint64_t  n_evicted;  /* Packets evicted to make room for others. */
+    uint64_t  n_failed;   /* Packets too large to be saved. */
+};
 
 struct dp_buffers {
-    struct datapath       *dp;
-    size_t                 buffer_idx;
-    size_t                 buffers_num;
-    struct packet_buffer   buffers[N_PKT_BUFFERS];
+    struct datapath          *dp;
+    struct hmap               buffers;
+    struct list               lru;
+    uint32_t                  next_id;
+    size_t                    capacity;  /* Maximum bytes to buffer. */
+    size_t                    bytes;     /* Bytes buffered. */
+    struct dp_buffers_stats   stats;
 };
 
 
 struct dp_buffers *
 dp_buffers_create(struct datapath *dp) {
-    struct dp_buffers *dpb = xmalloc(sizeof(struct dp_buffers));
-    size_t i;
-
-    dpb->dp          = dp;
-    dpb->buffer_idx  = (size_t)-1;
-    dpb->buffers_num = N_PKT_BUFFERS;
+    struct dp_buffers *dpb = xcalloc(1, sizeof(struct dp_buffers));
 
-    for (i=0; i<N_PKT_BUFFERS; i++) {
-        dpb->buffers[i].pkt     = NULL;
-        dpb->buffers[i].cookie  = UINT32_MAX;
-        dpb->buffers[i].timeout = 0;
-    }
+    dpb->dp       = dp;
+    dpb->capacity = DP_BUFFERS_DEFAULT_BYTES;
+    hmap_init(&dpb->buffers);
+    list_init(&dpb->lru);
 
     return dpb;
 }
 
 size_t
 dp_buffers_size(struct dp_buffers *dpb) {
-    return dpb->buffers_num;
+    return dpb->capacity / NOMINAL_PKT_BYTES;
+}
+
+static struct packet_buffer *
+lookup(struct dp_buffers *dpb, uint32_t id) {
+    struct hmap_node *hnode;
+
+    for (hnode = hmap_first_with_hash(&dpb->buffers, id); hnode != NULL;
+         hnode = hmap_next_with_hash(hnode)) {
+        struct packet_buffer *p = CONTAINER_OF(hnode, struct packet_buffer,
+                                               hmap_node);
+        if (p->id == id) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/* Removes 'p' from the store, and destroys its packet if 'destroy' is set. */
+static void
+remove_buffer(struct dp_buffers *dpb, struct packet_buffer *p, bool destroy) {
+    hmap_remove(&dpb->buffers, &p->hmap_node);
+    list_remove(&p->lru_node);
+    dpb->bytes -= p->size;
+
+    p->pkt->buffer_id = NO_BUFFER;
+    if (destroy) {
+        packet_destroy(p->pkt);
+    }
+    free(p);
+}
+
+/* Destroys the packets saved for longer than EXPIRE_MSECS. */
+static void
+expire_buffers(struct dp_buffers *dpb) {
+    long long int now = time_msec();
+
+    while (!list_is_empty(&dpb->lru)) {
+        struct packet_buffer *p = CONTAINER_OF(list_front(&dpb->lru),
+                                               struct packet_buffer, lru_node);
+        if (p->expires > now) {
+            break;
+        }
+        remove_buffer(dpb, p, true);
+        dpb->stats.n_expired++;
+    }
+}
+
+void
+dp_buffers_set_capacity(struct dp_buffers *dpb, size_t bytes) {
+    dpb->capacity = bytes;
+    while (dpb->bytes > dpb->capacity) {
+        remove_buffer(dpb, CONTAINER_OF(list_front(&dpb->lru),
+                                        struct packet_buffer, lru_node), true);
+        dpb->stats.n_evicted++;
+    }
+}
+
+void
+dp_buffers_run(struct dp_buffers *dpb) {
+    expire_buffers(dpb);
+}
+
+/* Releases the tailroom of the packet's buffer, which is sized for the
+ * largest packet a port may receive. */
+static void
+trim_packet(struct packet *pkt) {
+    void *base = pkt->buffer->base;
+
+    ofpbuf_trim(pkt->buffer);
+    if (pkt->buffer->base != base) {
+        pkt->handle_std->valid = false;
+        packet_handle_std_validate(pkt->handle_std);
+    }
 }
 
 uint32_t
 dp_buffers_save(struct dp_buffers *dpb, struct packet *pkt) {
     struct packet_buffer *p;
-    uint32_t id;
+    size_t size;
 
     /* if packet is already in buffer, do not save again */
     if (pkt->buffer_id != NO_BUFFER) {
         if (dp_buffers_is_alive(dpb, pkt->buffer_id)) {
             return pkt->buffer_id;
         }
+        dp_buffers_discard(dpb, pkt->buffer_id, false);
     }
 
-    dpb->buffer_idx = (dpb->buffer_idx + 1) & PKT_BUFFER_MASK;
+    trim_packet(pkt);
+    size = sizeof(struct packet) + pkt->buffer->allocated;
+    if (size > dpb->capacity) {
+        dpb->stats.n_failed++;
+        return NO_BUFFER;
+    }
 
-    p = &dpb->buffers[dpb->buffer_idx];
-    if (p->pkt != NULL) {
-        if (time_now() < p->timeout) {
-            return NO_BUFFER;
-        } else {
-            p->pkt->buffer_id = NO_BUFFER;
-            packet_destroy(p->pkt);
-        }
+    expire_buffers(dpb);
+    while (dpb->bytes + size > dpb->capacity) {
+        remove_buffer(dpb, CONTAINER_OF(list_front(&dpb->lru),
+                                        struct packet_buffer, lru_node), true);
+        dpb->stats.n_evicted++;
     }
-    /* Don't use maximum cookie value since the all-bits-1 id is
-     * special. */
-    if (++p->cookie >= (1u << PKT_COOKIE_BITS) - 1)
-        p->cookie = 0;
-    p->pkt = pkt;
-    p->timeout = time_now() + OVERWRITE_SECS;
-    id = dpb->buffer_idx | (p->cookie << PKT_BUFFER_BITS);
 
-    pkt->buffer_id  = id;
+    /* Skip the all-bits-1 id, which is special, and the ids of packets that
+     * are still buffered after a wrap around. */
+    while (dpb->next_id == NO_BUFFER || lookup(dpb, dpb->next_id) != NULL) {
+        dpb->next_id++;
+    }
+
+    p = xmalloc(sizeof *p);
+    p->pkt     = pkt;
+    p->id      = dpb->next_id++;
+    p->size    = size;
+    p->expires = time_msec() + EXPIRE_MSECS;
+    hmap_insert(&dpb->buffers, &p->hmap_node, p->id);
+    list_push_back(&dpb->lru, &p->lru_node);
+    dpb->bytes += size;
+    dpb->stats.n_saved++;
+
+    pkt->buffer_id = p->id;
 
-    return id;
+    return p->id;
 }
 
 struct packet *
 dp_buffers_retrieve(struct dp_buffers *dpb, uint32_t id) {
-    struct packet *pkt = NULL;
-    struct packet_buffer *p;
-
-    p = &dpb->buffers[id & PKT_BUFFER_MASK];
-    if (p->cookie == id >> PKT_BUFFER_BITS && p->pkt != NULL) {
-        pkt = p->pkt;
-        pkt->buffer_id = NO_BUFFER;
-        pkt->packet_out = false;
+    struct packet_buffer *p = lookup(dpb, id);
+    struct packet *pkt;
 
-        p->pkt = NULL;
-    } else {
-        VLOG_WARN_RL(LOG_MODULE, &rl, "cookie mismatch: %x != %x\n",
-                          id >> PKT_BUFFER_BITS, p->cookie);
+    if (p == NULL) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "unknown buffer: %x", id);
+        dpb->stats.n_misses++;
+        return NULL;
     }
+    if (p->expires <= time_msec()) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "expired buffer: %x", id);
+        remove_buffer(dpb, p, true);
+        dpb->stats.n_expired++;
+        dpb->stats.n_misses++;
+        return NULL;
+    }
+
+    pkt = p->pkt;
+    remove_buffer(dpb, p, false);
+    pkt->packet_out = false;
+    dpb->stats.n_hits++;
 
     return pkt;
 }
 
 bool
 dp_buffers_is_alive(struct dp_buffers *dpb, uint32_t id) {
-    struct packet_buffer *p;
+    struct packet_buffer *p = lookup(dpb, id);
 
-    p = &dpb->buffers[id & PKT_BUFFER_MASK];
-    return ((p->cookie == id >> PKT_BUFFER_BITS) &&
-            (time_now() < p->timeout));
+    return p != NULL && time_msec() < p->expires;
 }
 
 
 void
 dp_buffers_discard(struct dp_buffers *dpb, uint32_t id, bool destroy) {
-    struct packet_buffer *p;
-
-    p = &dpb->buffers[id & PKT_BUFFER_MASK];
+    struct packet_buffer *p = lookup(dpb, id);
 
-    if (p->cookie == id >> PKT_BUFFER_BITS) {
-        if (destroy) {
-            p->pkt->buffer_id = NO_BUFFER;
-            packet_destroy(p->pkt);
-        }
-        p->pkt = NULL;
+    if (p != NULL) {
+        remove_buffer(dpb, p, destroy);
     }
 }
+
+ofl_err
+dp_buffers_handle_stats_request(struct datapath *dp,
+                                struct ofl_exp_openflow_msg_header *msg,
+                                const struct sender *sender) {
+    struct dp_buffers *dpb = dp->buffers;
+    struct ofl_exp_openflow_msg_buffer_stats reply =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFP_EXT_BUFFER_STATS_REPLY},
+             .capacity  = dpb->capacity,
+             .bytes     = dpb->bytes,
+             .n_packets = hmap_count(&dpb->buffers),
+             .n_saved   = dpb->stats.n_saved,
+             .n_hits    = dpb->stats.n_hits,
+             .n_misses  = dpb->stats.n_misses,
+             .n_expired = dpb->stats.n_expired,
+             .n_evicted = dpb->stats.n_evicted,
+             .n_failed  = dpb->stats.n_failed};
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
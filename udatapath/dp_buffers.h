@@ -43,17 +43,23 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "ofpbuf.h"
+#include "oflib/ofl.h"
 
 
 /* Constant for representing "no buffer" */
 #define NO_BUFFER 0xffffffff
 
+/* Default number of bytes to buffer. */
+#define DP_BUFFERS_DEFAULT_BYTES (16 * 1024 * 1024)
+
 /****************************************************************************
  * Datapath buffers for storing packets for packet in messages.
  ****************************************************************************/
 
 struct datapath;
 struct packet;
+struct sender;
+struct ofl_exp_openflow_msg_header;
 
 /* Creates a set of buffers */
 struct dp_buffers *
@@ -63,6 +69,14 @@ dp_buffers_create(struct datapath *dp);
 size_t
 dp_buffers_size(struct dp_buffers *dpb);
 
+/* Sets the number of bytes to buffer, evicting the oldest packets if needed. */
+void
+dp_buffers_set_capacity(struct dp_buffers *dpb, size_t bytes);
+
+/* Expires timed out packets.  Should be called periodically. */
+void
+dp_buffers_run(struct dp_buffers *dpb);
+
 /* Saves the packet into the buffer. Returns the saved buffer ID, or NO_BUFFER
  * if saving was not possible. */
 uint32_t
@@ -81,5 +95,11 @@ dp_buffers_is_alive(struct dp_buffers *dpb, uint32_t id);
 void
 dp_buffers_discard(struct dp_buffers *dpb, uint32_t id, bool destroy);
 
+/* Handles a buffer stats request (openflow experimenter) message */
+ofl_err
+dp_buffers_handle_stats_request(struct datapath *dp,
+                                struct ofl_exp_openflow_msg_header *msg,
+                                const struct sender *sender);
+
 
 #endif /* DP_BUFFERS_H */
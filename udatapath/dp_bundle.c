@@ -0,0 +1,1003 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "datapath.h"
+#include "dp_actions.h"
+#include "dp_bundle.h"
+#include "dp_ports.h"
+#include "flow_entry.h"
+#include "flow_table.h"
+#include "group_table.h"
+#include "hash.h"
+#include "hmap.h"
+#include "list.h"
+#include "match_std.h"
+#include "meter_table.h"
+#include "pipeline.h"
+#include "util.h"
+#include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
+#include "vlog.h"
+
+#define LOG_MODULE VLM_dp_bundle
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
+
+/* Limits on what a remote can have pending in bundles. */
+#define BUNDLES_MAX 16
+#define BUNDLE_MSGS_MAX 65536
+
+struct bundle_msg {
+    struct list             node;   /* In the bundle's 'msgs'. */
+    struct ofl_msg_header  *msg;    /* Decoded and prepared message. */
+    uint8_t                *data;   /* Message as received, quoted in errors. */
+    size_t                  data_length;
+    uint32_t                xid;
+};
+
+struct bundle {
+    struct list   node;       /* In the remote's 'bundles'. */
+    uint32_t      id;
+    uint16_t      flags;      /* OFPBF_EXT_*. */
+    bool          closed;     /* No more messages can be added. */
+    size_t        msgs_num;
+    struct list   msgs;       /* Messages, in the order they were added. */
+};
+
+/* A group or meter, as it would be after the messages of a bundle checked so
+ * far are applied. */
+struct bundle_id {
+    struct hmap_node     node;
+    uint32_t             id;
+    bool                 exists;
+    size_t               parts_num;  /* Buckets or bands. */
+    struct ofl_bucket  **buckets;    /* Of a group, owned by its group mod. */
+};
+
+/* A flow entry added by a message of a bundle checked so far. */
+struct bundle_flow {
+    struct hmap_node          node;     /* In the view's 'flows', by
+                                           flow_hash. */
+    struct ofl_msg_flow_mod  *mod;
+    bool                      deleted;  /* Deleted by a later message. */
+};
+
+/* The parts of the switch state the messages of a bundle depend on, as they
+ * would be after the messages checked so far are applied.  The state the
+ * bundle did not touch is read from the tables. */
+struct bundle_view {
+    struct hmap  groups;          /* Groups added, modified or deleted. */
+    bool         groups_cleared;  /* All groups were deleted. */
+    size_t       groups_num;
+    size_t       buckets_num;
+    struct hmap  meters;          /* Meters added, modified or deleted. */
+    bool         meters_cleared;  /* All meters were deleted. */
+    size_t       meters_num;
+    size_t       bands_num;
+    size_t       flows_num[PIPELINE_TABLES]; /* Upper bound on the entries. */
+    struct hmap  flows;           /* Flow entries added. */
+    struct ofl_msg_flow_mod **flow_dels; /* Flow deletes, in order. */
+    size_t       flow_dels_num;
+    size_t       flow_dels_max;
+};
+
+static struct bundle *
+bundle_find(struct remote *remote, uint32_t id) {
+    struct bundle *b;
+
+    LIST_FOR_EACH (b, struct bundle, node, &remote->bundles) {
+        if (b->id == id) {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+static ofl_err
+bundle_open(struct remote *remote, uint32_t id, uint16_t flags, struct bundle **bundle) {
+    struct bundle *b;
+
+    if (list_size(&remote->bundles) >= BUNDLES_MAX) {
+        return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_OUT_OF_BUNDLES);
+    }
+    if (flags & ~(OFPBF_EXT_ATOMIC | OFPBF_EXT_ORDERED)) {
+        return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_BAD_FLAGS);
+    }
+
+    b = xmalloc(sizeof *b);
+    b->id = id;
+    b->flags = flags;
+    b->closed = false;
+    b->msgs_num = 0;
+    list_init(&b->msgs);
+    list_push_back(&remote->bundles, &b->node);
+
+    *bundle = b;
+    return 0;
+}
+
+static void
+bundle_destroy(struct datapath *dp, struct bundle *b) {
+    struct bundle_msg *bm, *next;
+
+    LIST_FOR_EACH_SAFE (bm, next, struct bundle_msg, node, &b->msgs) {
+        if (bm->msg != NULL) {
+            ofl_msg_free(bm->msg, dp->exp);
+        }
+        free(bm->data);
+        free(bm);
+    }
+    list_remove(&b->node);
+    free(b);
+}
+
+void
+dp_bundle_discard_all(struct datapath *dp, struct remote *remote) {
+    struct bundle *b, *next;
+
+    LIST_FOR_EACH_SAFE (b, next, struct bundle, node, &remote->bundles) {
+        bundle_destroy(dp, b);
+    }
+}
+
+static struct bundle_id *
+view_find(struct hmap *ids, uint32_t id) {
+    struct bundle_id *bid;
+
+    HMAP_FOR_EACH_WITH_HASH (bid, struct bundle_id, node, id, ids) {
+        if (bid->id == id) {
+            return bid;
+        }
+    }
+    return NULL;
+}
+
+static void
+view_set(struct hmap *ids, uint32_t id, bool exists, size_t parts_num,
+         struct ofl_bucket **buckets) {
+    struct bundle_id *bid = view_find(ids, id);
+
+    if (bid == NULL) {
+        bid = xmalloc(sizeof *bid);
+        bid->id = id;
+        hmap_insert(ids, &bid->node, id);
+    }
+    bid->exists = exists;
+    bid->parts_num = parts_num;
+    bid->buckets = buckets;
+}
+
+static void
+view_clear(struct hmap *ids) {
+    struct bundle_id *bid, *next;
+
+    HMAP_FOR_EACH_SAFE (bid, next, struct bundle_id, node, ids) {
+        hmap_remove(ids, &bid->node);
+        free(bid);
+    }
+}
+
+static void
+view_init(struct datapath *dp, struct bundle_view *v) {
+    size_t i;
+
+    hmap_init(&v->groups);
+    v->groups_cleared = false;
+    v->groups_num = dp->groups->entries_num;
+    v->buckets_num = dp->groups->buckets_num;
+    hmap_init(&v->meters);
+    v->meters_cleared = false;
+    v->meters_num = dp->meters->entries_num;
+    v->bands_num = dp->meters->bands_num;
+    for (i = 0; i < PIPELINE_TABLES; i++) {
+        v->flows_num[i] = dp->pipeline->tables[i]->stats->active_count;
+    }
+    hmap_init(&v->flows);
+    v->flow_dels = NULL;
+    v->flow_dels_num = 0;
+    v->flow_dels_max = 0;
+}
+
+static void
+view_destroy(struct bundle_view *v) {
+    struct bundle_flow *bf, *next;
+
+    view_clear(&v->groups);
+    hmap_destroy(&v->groups);
+    view_clear(&v->meters);
+    hmap_destroy(&v->meters);
+    HMAP_FOR_EACH_SAFE (bf, next, struct bundle_flow, node, &v->flows) {
+        hmap_remove(&v->flows, &bf->node);
+        free(bf);
+    }
+    hmap_destroy(&v->flows);
+    free(v->flow_dels);
+}
+
+/* Returns true if the group exists, storing its buckets in 'buckets' and
+ * their number in 'buckets_num'. */
+static bool
+view_group_buckets(struct datapath *dp, struct bundle_view *v, uint32_t group_id,
+                   struct ofl_bucket ***buckets, size_t *buckets_num) {
+    struct bundle_id *bid = view_find(&v->groups, group_id);
+    struct group_entry *entry;
+
+    if (bid != NULL) {
+        *buckets = bid->buckets;
+        *buckets_num = bid->parts_num;
+        return bid->exists;
+    }
+    entry = v->groups_cleared ? NULL : group_table_find(dp->groups, group_id);
+    *buckets = entry != NULL ? entry->desc->buckets : NULL;
+    *buckets_num = entry != NULL ? entry->desc->buckets_num : 0;
+    return entry != NULL;
+}
+
+/* Returns true if the group exists, storing its number of buckets in
+ * 'buckets_num'. */
+static bool
+view_group(struct datapath *dp, struct bundle_view *v, uint32_t group_id, size_t *buckets_num) {
+    struct ofl_bucket **buckets;
+
+    return view_group_buckets(dp, v, group_id, &buckets, buckets_num);
+}
+
+static bool
+buckets_have_out_group(struct ofl_bucket **buckets, size_t buckets_num, uint32_t group_id) {
+    size_t i;
+
+    for (i = 0; i < buckets_num; i++) {
+        if (dp_actions_list_has_out_group(buckets[i]->actions_num, buckets[i]->actions, group_id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Returns true if the group would be reachable from 'buckets', following
+ * the groups as they are in the view.  Like is_loop_free in group_table.c,
+ * this assumes that the groups are loop free to begin with. */
+static bool
+view_group_reachable(struct datapath *dp, struct bundle_view *v, uint32_t group_id,
+                     struct ofl_bucket **buckets, size_t buckets_num) {
+    uint32_t *ids = NULL;
+    size_t ids_num = 0, ids_max = 0;
+    bool found = false;
+    size_t i, ib, ia;
+
+    /* 'ids' holds the groups found so far; those from 'i' on are still to be
+     * followed. */
+    for (i = 0; !found; i++) {
+        for (ib = 0; ib < buckets_num && !found; ib++) {
+            for (ia = 0; ia < buckets[ib]->actions_num; ia++) {
+                struct ofl_action_group *ag;
+                size_t j;
+
+                if (buckets[ib]->actions[ia]->type != OFPAT_GROUP) {
+                    continue;
+                }
+                ag = (struct ofl_action_group *)buckets[ib]->actions[ia];
+                if (ag->group_id == group_id) {
+                    found = true;
+                    break;
+                }
+                for (j = 0; j < ids_num; j++) {
+                    if (ids[j] == ag->group_id) {
+                        break;
+                    }
+                }
+                if (j == ids_num) {
+                    if (ids_num == ids_max) {
+                        ids_max = ids_max ? ids_max * 2 : 8;
+                        ids = xrealloc(ids, ids_max * sizeof *ids);
+                    }
+                    ids[ids_num++] = ag->group_id;
+                }
+            }
+        }
+        if (found || i == ids_num) {
+            break;
+        }
+        if (!view_group_buckets(dp, v, ids[i], &buckets, &buckets_num)) {
+            buckets_num = 0;
+        }
+    }
+    free(ids);
+    return found;
+}
+
+/* Returns true if a group in the view has a bucket sending to the group. */
+static bool
+view_group_referenced(struct datapath *dp, struct bundle_view *v, uint32_t group_id) {
+    struct group_entry *entry;
+    struct bundle_id *bid;
+
+    HMAP_FOR_EACH (bid, struct bundle_id, node, &v->groups) {
+        if (bid->exists && buckets_have_out_group(bid->buckets, bid->parts_num, group_id)) {
+            return true;
+        }
+    }
+    if (!v->groups_cleared) {
+        HMAP_FOR_EACH (entry, struct group_entry, node, &dp->groups->entries) {
+            if (view_find(&v->groups, entry->stats->group_id) == NULL &&
+                group_entry_has_out_group(entry, group_id)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Returns true if the meter exists, storing its number of bands in
+ * 'bands_num'. */
+static bool
+view_meter(struct datapath *dp, struct bundle_view *v, uint32_t meter_id, size_t *bands_num) {
+    struct bundle_id *bid = view_find(&v->meters, meter_id);
+    struct meter_entry *entry;
+
+    if (bid != NULL) {
+        *bands_num = bid->parts_num;
+        return bid->exists;
+    }
+    entry = v->meters_cleared ? NULL : meter_table_find(dp->meters, meter_id);
+    *bands_num = entry != NULL ? entry->stats->meter_bands_num : 0;
+    return entry != NULL;
+}
+
+/* Same checks as dp_actions_validate, against the view. */
+static ofl_err
+check_actions(struct datapath *dp, struct bundle_view *v,
+              size_t actions_num, struct ofl_action_header **actions) {
+    size_t i, n;
+
+    for (i = 0; i < actions_num; i++) {
+        if (actions[i]->type == OFPAT_OUTPUT) {
+            struct ofl_action_output *ao = (struct ofl_action_output *)actions[i];
+
+            if (ao->port <= OFPP_MAX && dp_ports_lookup(dp, ao->port) == NULL) {
+                return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_OUT_PORT);
+            }
+        }
+        if (actions[i]->type == OFPAT_GROUP) {
+            struct ofl_action_group *ag = (struct ofl_action_group *)actions[i];
+
+            if (ag->group_id <= OFPG_MAX && !view_group(dp, v, ag->group_id, &n)) {
+                return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_OUT_GROUP);
+            }
+        }
+    }
+    return 0;
+}
+
+/* Returns true if the flow mod deletes every entry of the tables it
+ * targets. */
+static bool
+flow_mod_deletes_all(struct ofl_msg_flow_mod *mod) {
+    struct ofl_match *m = (struct ofl_match *)mod->match;
+
+    return (mod->command == OFPFC_DELETE &&
+            mod->cookie_mask == 0 &&
+            mod->out_port == OFPP_ANY &&
+            mod->out_group == OFPG_ANY &&
+            m->header.type == OFPMT_OXM &&
+            hmap_count(&m->match_fields) == 0);
+}
+
+/* Hashes the rules that overlap_possible may find overlapping the same. */
+static uint32_t
+flow_hash(struct ofl_msg_flow_mod *mod) {
+    return hash_2words(mod->table_id, mod->priority);
+}
+
+/* Returns true if 'a' and 'b' may overlap.  Unlike flow_entry_overlaps, this
+ * leaves out the output port and group of 'b', since the instructions they
+ * are looked up in may change before 'b' is applied. */
+static bool
+overlap_possible(uint16_t priority, struct ofl_match_header *a,
+                 struct ofl_msg_flow_mod *b, struct ofl_exp *exp) {
+    return (priority == b->priority &&
+            match_std_overlap((struct ofl_match *)a, (struct ofl_match *)b->match, exp));
+}
+
+/* Returns true if the flow delete 'del' removes every entry it matches, no
+ * matter what their instructions are by then. */
+static bool
+deletes_by_match(struct ofl_msg_flow_mod *del, uint8_t table_id) {
+    return ((del->table_id == 0xff || del->table_id == table_id) &&
+            del->out_port == OFPP_ANY &&
+            del->out_group == OFPG_ANY);
+}
+
+/* Returns true if an earlier flow delete of the bundle removes 'entry'. */
+static bool
+view_flow_entry_deleted(struct datapath *dp, struct bundle_view *v, struct flow_entry *entry) {
+    size_t i;
+
+    for (i = 0; i < v->flow_dels_num; i++) {
+        struct ofl_msg_flow_mod *del = v->flow_dels[i];
+
+        if (deletes_by_match(del, entry->stats->table_id) &&
+            flow_entry_matches(entry, del, del->command == OFPFC_DELETE_STRICT,
+                               true/*check_cookie*/, dp->exp)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Marks the flow entries added by the bundle which 'del' removes. */
+static void
+view_delete_flows(struct datapath *dp, struct bundle_view *v, struct ofl_msg_flow_mod *del) {
+    bool strict = del->command == OFPFC_DELETE_STRICT;
+    struct bundle_flow *bf;
+
+    HMAP_FOR_EACH (bf, struct bundle_flow, node, &v->flows) {
+        struct ofl_msg_flow_mod *add = bf->mod;
+
+        if (bf->deleted || !deletes_by_match(del, add->table_id) ||
+            (add->cookie & del->cookie_mask) != (del->cookie & del->cookie_mask)) {
+            continue;
+        }
+        if (strict ? (add->priority == del->priority &&
+                      match_std_strict((struct ofl_match *)del->match,
+                                       (struct ofl_match *)add->match, dp->exp))
+                   : match_std_nonstrict((struct ofl_match *)del->match,
+                                         (struct ofl_match *)add->match, dp->exp)) {
+            bf->deleted = true;
+        }
+    }
+
+    if (v->flow_dels_num == v->flow_dels_max) {
+        v->flow_dels_max = v->flow_dels_max ? v->flow_dels_max * 2 : 8;
+        v->flow_dels = xrealloc(v->flow_dels, v->flow_dels_max * sizeof *v->flow_dels);
+    }
+    v->flow_dels[v->flow_dels_num++] = del;
+}
+
+/* Returns true if the flow add would overlap an entry of its table, as the
+ * table would be after the messages checked so far are applied. */
+static bool
+view_flow_overlaps(struct datapath *dp, struct bundle_view *v, struct ofl_msg_flow_mod *mod) {
+    struct flow_table *table = dp->pipeline->tables[mod->table_id];
+    struct flow_entry *entry;
+    struct bundle_flow *bf;
+
+    LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
+        if (entry->stats->priority < mod->priority) {
+            break;
+        }
+        if (overlap_possible(entry->stats->priority, entry->stats->match, mod, dp->exp) &&
+            !view_flow_entry_deleted(dp, v, entry)) {
+            return true;
+        }
+    }
+    HMAP_FOR_EACH_WITH_HASH (bf, struct bundle_flow, node, flow_hash(mod), &v->flows) {
+        if (!bf->deleted && bf->mod->table_id == mod->table_id &&
+            overlap_possible(bf->mod->priority, bf->mod->match, mod, dp->exp)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static ofl_err
+check_flow_mod(struct datapath *dp, struct bundle_view *v, struct ofl_msg_flow_mod *mod) {
+    ofl_err error;
+    size_t i;
+
+    for (i = 0; i < mod->instructions_num; i++) {
+        if (mod->instructions[i]->type == OFPIT_APPLY_ACTIONS ||
+            mod->instructions[i]->type == OFPIT_WRITE_ACTIONS) {
+            struct ofl_instruction_actions *ia = (struct ofl_instruction_actions *)mod->instructions[i];
+
+            error = check_actions(dp, v, ia->actions_num, ia->actions);
+            if (error) {
+                return error;
+            }
+        }
+    }
+
+    switch (mod->command) {
+        case (OFPFC_ADD): {
+            struct bundle_flow *bf;
+
+            /* Entries of the table and flows added by the bundle are both
+             * looked at, leaving out those the bundle deletes first. */
+            if ((mod->flags & OFPFF_CHECK_OVERLAP) && view_flow_overlaps(dp, v, mod)) {
+                return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_OVERLAP);
+            }
+            /* Counting every add as a new entry errs on the side of refusing
+             * a bundle which replaces entries in a nearly full table. */
+            if (v->flows_num[mod->table_id] >= FLOW_TABLE_MAX_ENTRIES) {
+                return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_TABLE_FULL);
+            }
+            v->flows_num[mod->table_id]++;
+
+            bf = xmalloc(sizeof *bf);
+            bf->mod = mod;
+            bf->deleted = false;
+            hmap_insert(&v->flows, &bf->node, flow_hash(mod));
+            return 0;
+        }
+        case (OFPFC_MODIFY):
+        case (OFPFC_MODIFY_STRICT): {
+            return 0;
+        }
+        case (OFPFC_DELETE):
+        case (OFPFC_DELETE_STRICT): {
+            if (flow_mod_deletes_all(mod)) {
+                for (i = 0; i < PIPELINE_TABLES; i++) {
+                    if (mod->table_id == 0xff || mod->table_id == i) {
+                        v->flows_num[i] = 0;
+                    }
+                }
+            }
+            view_delete_flows(dp, v, mod);
+            return 0;
+        }
+        default: {
+            return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_BAD_COMMAND);
+        }
+    }
+}
+
+static ofl_err
+check_group_mod(struct datapath *dp, struct bundle_view *v, struct ofl_msg_group_mod *mod) {
+    size_t buckets_num;
+    ofl_err error;
+    bool exists;
+    size_t i;
+
+    for (i = 0; i < mod->buckets_num; i++) {
+        error = check_actions(dp, v, mod->buckets[i]->actions_num, mod->buckets[i]->actions);
+        if (error) {
+            return error;
+        }
+    }
+
+    exists = view_group(dp, v, mod->group_id, &buckets_num);
+    switch (mod->command) {
+        case (OFPGC_ADD): {
+            if (exists) {
+                return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_GROUP_EXISTS);
+            }
+            if (v->groups_num == GROUP_TABLE_MAX_ENTRIES) {
+                return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_OUT_OF_GROUPS);
+            }
+            if (v->buckets_num + mod->buckets_num > GROUP_TABLE_MAX_BUCKETS) {
+                return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_OUT_OF_BUCKETS);
+            }
+            v->groups_num++;
+            v->buckets_num += mod->buckets_num;
+            view_set(&v->groups, mod->group_id, true, mod->buckets_num, mod->buckets);
+            return 0;
+        }
+        case (OFPGC_MODIFY): {
+            if (!exists) {
+                return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_UNKNOWN_GROUP);
+            }
+            if (v->buckets_num - buckets_num + mod->buckets_num > GROUP_TABLE_MAX_BUCKETS) {
+                return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_OUT_OF_BUCKETS);
+            }
+            if (view_group_reachable(dp, v, mod->group_id, mod->buckets, mod->buckets_num)) {
+                return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_LOOP);
+            }
+            v->buckets_num = v->buckets_num - buckets_num + mod->buckets_num;
+            view_set(&v->groups, mod->group_id, true, mod->buckets_num, mod->buckets);
+            return 0;
+        }
+        case (OFPGC_DELETE): {
+            if (mod->group_id == OFPG_ALL) {
+                view_clear(&v->groups);
+                v->groups_cleared = true;
+                v->groups_num = 0;
+                v->buckets_num = 0;
+            } else if (exists) {
+                /* Like group_table_delete, refuse to delete a group other
+                 * groups send to. */
+                if (view_group_referenced(dp, v, mod->group_id)) {
+                    return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_CHAINING_UNSUPPORTED);
+                }
+                v->groups_num--;
+                v->buckets_num -= buckets_num;
+                view_set(&v->groups, mod->group_id, false, 0, NULL);
+            }
+            return 0;
+        }
+        default: {
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TYPE);
+        }
+    }
+}
+
+static ofl_err
+check_meter_mod(struct datapath *dp, struct bundle_view *v, struct ofl_msg_meter_mod *mod) {
+    size_t bands_num;
+    bool exists;
+
+    exists = view_meter(dp, v, mod->meter_id, &bands_num);
+    switch (mod->command) {
+        case (OFPMC_ADD): {
+            if (exists) {
+                return ofl_error(OFPET_METER_MOD_FAILED, OFPMMFC_METER_EXISTS);
+            }
+            if (v->meters_num == DEFAULT_MAX_METER) {
+                return ofl_error(OFPET_METER_MOD_FAILED, OFPMMFC_OUT_OF_METERS);
+            }
+            if (v->bands_num + mod->meter_bands_num > METER_TABLE_MAX_BANDS) {
+                return ofl_error(OFPET_METER_MOD_FAILED, OFPMMFC_OUT_OF_BANDS);
+            }
+            v->meters_num++;
+            v->bands_num += mod->meter_bands_num;
+            view_set(&v->meters, mod->meter_id, true, mod->meter_bands_num, NULL);
+            return 0;
+        }
+        case (OFPMC_MODIFY): {
+            if (!exists) {
+                return ofl_error(OFPET_METER_MOD_FAILED, OFPMMFC_UNKNOWN_METER);
+            }
+            if (v->bands_num - bands_num + mod->meter_bands_num > METER_TABLE_MAX_BANDS) {
+                return ofl_error(OFPET_METER_MOD_FAILED, OFPMMFC_OUT_OF_BANDS);
+            }
+            v->bands_num = v->bands_num - bands_num + mod->meter_bands_num;
+            view_set(&v->meters, mod->meter_id, true, mod->meter_bands_num, NULL);
+            return 0;
+        }
+        case (OFPMC_DELETE): {
+            if (mod->meter_id == OFPM_ALL) {
+                view_clear(&v->meters);
+                v->meters_cleared = true;
+                v->meters_num = 0;
+                v->bands_num = 0;
+            } else if (exists) {
+                v->meters_num--;
+                v->bands_num -= bands_num;
+                view_set(&v->meters, mod->meter_id, false, 0, NULL);
+            }
+            return 0;
+        }
+        default: {
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TYPE);
+        }
+    }
+}
+
+static ofl_err
+check_msg(struct datapath *dp, struct bundle_view *v, struct ofl_msg_header *msg) {
+    switch (msg->type) {
+        case (OFPT_FLOW_MOD): {
+            return check_flow_mod(dp, v, (struct ofl_msg_flow_mod *)msg);
+        }
+        case (OFPT_GROUP_MOD): {
+            return check_group_mod(dp, v, (struct ofl_msg_group_mod *)msg);
+        }
+        case (OFPT_METER_MOD): {
+            return check_meter_mod(dp, v, (struct ofl_msg_meter_mod *)msg);
+        }
+        default: {
+            return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_MSG_UNSUP);
+        }
+    }
+}
+
+/* Applies 'msg', storing in 'buffer_id' the buffered packet it releases, or
+ * NO_BUFFER. */
+static ofl_err
+apply_msg(struct datapath *dp, struct ofl_msg_header *msg, const struct sender *sender,
+          uint32_t *buffer_id) {
+    *buffer_id = NO_BUFFER;
+    switch (msg->type) {
+        case (OFPT_FLOW_MOD): {
+            return pipeline_apply_flow_mod(dp->pipeline, (struct ofl_msg_flow_mod *)msg, buffer_id);
+        }
+        case (OFPT_GROUP_MOD): {
+            return group_table_handle_group_mod(dp->groups, (struct ofl_msg_group_mod *)msg, sender);
+        }
+        case (OFPT_METER_MOD): {
+            return meter_table_handle_meter_mod(dp->meters, (struct ofl_msg_meter_mod *)msg, sender);
+        }
+        default: {
+            return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_MSG_UNSUP);
+        }
+    }
+}
+
+/* Returns true if the message is a flow mod that can be applied along with
+ * the ones around it, by flow_table_add_batch. */
+static bool
+is_batched(struct ofl_msg_header *msg) {
+    struct ofl_msg_flow_mod *mod = (struct ofl_msg_flow_mod *)msg;
+
+    return (msg->type == OFPT_FLOW_MOD &&
+            mod->command == OFPFC_ADD &&
+            (mod->flags & OFPFF_CHECK_OVERLAP) == 0 &&
+            mod->buffer_id == NO_BUFFER);
+}
+
+/* Applies the flow mods adding entries to the same table from 'first' on,
+ * in a single pass over the table. */
+static ofl_err
+apply_flow_adds(struct datapath *dp, struct bundle *b, struct bundle_msg *first) {
+    uint8_t table_id = ((struct ofl_msg_flow_mod *)first->msg)->table_id;
+    struct ofl_msg_flow_mod **mods;
+    struct bundle_msg *bm;
+    size_t mods_num = 0;
+    ofl_err error;
+    size_t i;
+
+    mods = xmalloc(b->msgs_num * sizeof *mods);
+    for (bm = first; &bm->node != &b->msgs;
+         bm = CONTAINER_OF(bm->node.next, struct bundle_msg, node)) {
+        if (!is_batched(bm->msg) ||
+            ((struct ofl_msg_flow_mod *)bm->msg)->table_id != table_id) {
+            break;
+        }
+        mods[mods_num++] = (struct ofl_msg_flow_mod *)bm->msg;
+    }
+
+    error = flow_table_add_batch(dp->pipeline->tables[table_id], mods, mods_num, dp->exp);
+    if (!error) {
+        for (bm = first, i = 0; i < mods_num; i++) {
+            ofl_msg_free(bm->msg, dp->exp);
+            bm->msg = NULL;
+            bm = CONTAINER_OF(bm->node.next, struct bundle_msg, node);
+        }
+    }
+    free(mods);
+    return error;
+}
+
+/* Reports the failure of a message of a bundle, as if it had been sent on
+ * its own. */
+static void
+bundle_msg_error(struct datapath *dp, struct bundle_msg *bm, ofl_err error,
+                 const struct sender *sender) {
+    struct sender s = *sender;
+
+    s.xid = bm->xid;
+    dp_send_error(dp, error, bm->msg, bm->data, bm->data_length, &s);
+}
+
+/* Commits a bundle.  All the messages are checked, in order, against the
+ * tables as the messages before them leave them, and only then applied.  The
+ * checks cover every error applying a message can report, so a bundle that
+ * passes them is applied whole.  This runs as a single step of the
+ * forwarding side, so no packet goes through the pipeline while the bundle
+ * is partly applied; the packets buffered for the flow mods are only run
+ * through it once the whole bundle is.  Consecutive flow adds to a table are
+ * merged into it at once, rather than each looking through the whole
+ * table. */
+static ofl_err
+bundle_commit(struct datapath *dp, struct bundle *b, const struct sender *sender) {
+    struct bundle_view view;
+    struct bundle_msg *bm;
+    uint32_t *buffer_ids;
+    size_t buffer_ids_num = 0;
+    ofl_err error = 0;
+    size_t i;
+
+    view_init(dp, &view);
+    LIST_FOR_EACH (bm, struct bundle_msg, node, &b->msgs) {
+        error = check_msg(dp, &view, bm->msg);
+        if (error) {
+            break;
+        }
+    }
+    view_destroy(&view);
+    if (error) {
+        bundle_msg_error(dp, bm, error, sender);
+        return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_MSG_FAILED);
+    }
+
+    buffer_ids = xmalloc(b->msgs_num * sizeof *buffer_ids);
+    LIST_FOR_EACH (bm, struct bundle_msg, node, &b->msgs) {
+        uint32_t buffer_id = NO_BUFFER;
+
+        if (bm->msg == NULL) {
+            /* Applied along with the flow mods before it. */
+            continue;
+        }
+        error = is_batched(bm->msg) ? apply_flow_adds(dp, b, bm)
+                                    : apply_msg(dp, bm->msg, sender, &buffer_id);
+        if (error) {
+            /* Should not happen, as the checks above missed the error. */
+            VLOG_ERR_RL(LOG_MODULE, &rl, "Bundle %u failed after being partly applied.", b->id);
+            bundle_msg_error(dp, bm, error, sender);
+            free(buffer_ids);
+            return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_MSG_FAILED);
+        }
+        /* Applying the message took it over. */
+        bm->msg = NULL;
+        if (buffer_id != NO_BUFFER) {
+            buffer_ids[buffer_ids_num++] = buffer_id;
+        }
+    }
+
+    for (i = 0; i < buffer_ids_num; i++) {
+        pipeline_process_buffered(dp->pipeline, buffer_ids[i]);
+    }
+    free(buffer_ids);
+    return 0;
+}
+
+ofl_err
+dp_bundle_handle_control(struct datapath *dp,
+                         struct ofl_exp_openflow_msg_bundle_ctrl *msg,
+                         const struct sender *sender) {
+    struct remote *remote = sender->remote;
+    struct bundle *b;
+    ofl_err error;
+
+    if (remote->role == OFPCR_ROLE_SLAVE) {
+        return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_EPERM);
+    }
+
+    b = bundle_find(remote, msg->bundle_id);
+    switch (msg->type) {
+        case (OFPBCT_EXT_OPEN_REQUEST): {
+            if (b != NULL) {
+                return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_BUNDLE_EXIST);
+            }
+            error = bundle_open(remote, msg->bundle_id, msg->flags, &b);
+            if (error) {
+                return error;
+            }
+            break;
+        }
+        case (OFPBCT_EXT_CLOSE_REQUEST): {
+            if (b == NULL) {
+                return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_BAD_ID);
+            }
+            if (b->closed) {
+                return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_BUNDLE_CLOSED);
+            }
+            b->closed = true;
+            break;
+        }
+        case (OFPBCT_EXT_COMMIT_REQUEST): {
+            if (b == NULL) {
+                return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_BAD_ID);
+            }
+            /* The bundle is gone whether or not the commit succeeds. */
+            error = bundle_commit(dp, b, sender);
+            bundle_destroy(dp, b);
+            if (error) {
+                return error;
+            }
+            break;
+        }
+        case (OFPBCT_EXT_DISCARD_REQUEST): {
+            if (b == NULL) {
+                return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_BAD_ID);
+            }
+            bundle_destroy(dp, b);
+            break;
+        }
+        default: {
+            return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_BAD_TYPE);
+        }
+    }
+
+    {
+        struct ofl_exp_openflow_msg_bundle_ctrl reply =
+                {{{{.type = OFPT_EXPERIMENTER},
+                   .experimenter_id = OPENFLOW_VENDOR_ID},
+                  .type = OFP_EXT_BUNDLE_CONTROL},
+                 .bundle_id = msg->bundle_id,
+                 .type = msg->type + 1,
+                 .flags = msg->flags};
+
+        dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+    }
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
+ofl_err
+dp_bundle_handle_add(struct datapath *dp,
+                     struct ofl_exp_openflow_msg_bundle_add *msg,
+                     const struct sender *sender) {
+    struct ofp_header *oh = (struct ofp_header *)msg->data;
+    struct remote *remote = sender->remote;
+    struct ofl_msg_header *inner;
+    struct bundle_msg *bm;
+    struct bundle *b;
+    uint32_t xid;
+    ofl_err error;
+
+    if (remote->role == OFPCR_ROLE_SLAVE) {
+        return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_EPERM);
+    }
+    if (ntohl(oh->xid) != sender->xid) {
+        return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_MSG_BAD_XID);
+    }
+    if (oh->type != OFPT_FLOW_MOD && oh->type != OFPT_GROUP_MOD &&
+        oh->type != OFPT_METER_MOD) {
+        return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_MSG_UNSUP);
+    }
+
+    b = bundle_find(remote, msg->bundle_id);
+    if (b == NULL) {
+        error = bundle_open(remote, msg->bundle_id, msg->flags, &b);
+        if (error) {
+            return error;
+        }
+    } else if (b->closed) {
+        return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_BUNDLE_CLOSED);
+    } else if (b->flags != msg->flags) {
+        return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_BAD_FLAGS);
+    }
+    if (b->msgs_num == BUNDLE_MSGS_MAX) {
+        return ofl_error(OFPET_EXPERIMENTER, OFPBFC_EXT_MSG_TOO_MANY);
+    }
+
+    /* Flow mods are decoded and checked once, here, so that committing
+     * them only has to look at the state of the switch. */
+    if (oh->type == OFPT_FLOW_MOD) {
+        error = ofl_msg_unpack_arena(msg->data, msg->data_length, &inner, &xid, dp->exp);
+        if (!error) {
+            struct ofl_msg_flow_mod *mod = (struct ofl_msg_flow_mod *)inner;
+
+            error = pipeline_prepare_flow_mod(mod);
+            if (!error && mod->command != OFPFC_DELETE &&
+                mod->command != OFPFC_DELETE_STRICT) {
+                /* Entries copy the rule of the flow mod.  Trying it here
+                 * keeps the commit from failing on it. */
+                error = flow_entry_check_rule(dp, mod);
+            }
+            if (error) {
+                ofl_msg_free(inner, dp->exp);
+            }
+        }
+    } else {
+        error = ofl_msg_unpack(msg->data, msg->data_length, &inner, &xid, dp->exp);
+    }
+    if (error) {
+        return error;
+    }
+
+    bm = xmalloc(sizeof *bm);
+    bm->msg = inner;
+    bm->data = msg->data;
+    bm->data_length = msg->data_length;
+    bm->xid = xid;
+    list_push_back(&b->msgs, &bm->node);
+    b->msgs_num++;
+
+    /* The bundle keeps the message as received. */
+    msg->data = NULL;
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
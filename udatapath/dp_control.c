@@ -42,6 +42,7 @@
 #include "oflib/ofl.h"
 #include "oflib/ofl-messages.h"
 #include "oflib/ofl-log.h"
+#include "oflib-exp/ofl-exp-openstate.h"
 #include "openflow/openflow.h"
 
 #include "vlog.h"
@@ -54,8 +55,9 @@ static ofl_err
 handle_control_barrier_request(struct datapath *dp,
            struct ofl_msg_header *msg, const struct sender *sender) {
 
-    /* Note: the implementation is single-threaded,
-       so a barrier request can simply be replied. */
+    /* Note: messages are handled one at a time, and the requests deferred
+       to the control side are served in order with the replies, so a
+       barrier request can simply be replied. */
     struct ofl_msg_header reply =
             {.type = OFPT_BARRIER_REPLY};
 
@@ -182,11 +184,38 @@ handle_control_stats_request_desc(struct datapath *dp,
     return 0;
 }
 
-/* Dispatches statistic request messages to the appropriate handler functions. */
-static ofl_err
+/* Returns true if 'msg' walks the flow or state tables, which may take long
+ * enough to stall forwarding. */
+static bool
+stats_request_walks_tables(struct ofl_msg_multipart_request_header *msg) {
+    switch (msg->type) {
+        case (OFPMP_FLOW):
+        case (OFPMP_AGGREGATE): {
+            return true;
+        }
+        case (OFPMP_EXPERIMENTER): {
+            struct ofl_msg_multipart_request_experimenter *exp =
+                    (struct ofl_msg_multipart_request_experimenter *)msg;
+
+            return exp->experimenter_id == OPENSTATE_VENDOR_ID
+                   && ((struct ofl_exp_openstate_msg_multipart_request *)msg)->type
+                      == OFPMP_EXP_STATE_STATS;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+ofl_err
 handle_control_stats_request(struct datapath *dp,
                                   struct ofl_msg_multipart_request_header *msg,
                                                 const struct sender *sender) {
+    if (stats_request_walks_tables(msg)
+        && dp_defer_stats_request(dp, msg, sender)) {
+        return 0;
+    }
+
     switch (msg->type) {
         case (OFPMP_DESC): {
             return handle_control_stats_request_desc(dp, msg, sender);
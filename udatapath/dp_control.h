@@ -49,5 +49,13 @@ ofl_err
 handle_control_msg(struct datapath *dp, struct ofl_msg_header *msg,
                    const struct sender *sender);
 
+/* Dispatches statistic request messages to the appropriate handler functions.
+ * Those that walk the flow or state tables are deferred to the control side,
+ * which calls this again to serve them. */
+ofl_err
+handle_control_stats_request(struct datapath *dp,
+                             struct ofl_msg_multipart_request_header *msg,
+                             const struct sender *sender);
+
 
 #endif /* DP_CONTROL_H */
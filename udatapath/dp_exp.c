@@ -32,7 +32,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include "datapath.h"
+#include "dp_buffers.h"
+#include "dp_bundle.h"
 #include "dp_exp.h"
+#include "dp_flow_delta.h"
+#include "dp_flow_monitor.h"
+#include "dp_pktin.h"
 #include "packet.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-actions.h"
@@ -52,6 +57,26 @@
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 
+/* Maximum number of state entries in one multipart reply message; larger
+ * replies are split with OFPMPF_REPLY_MORE. */
+#define STATE_STATS_PER_REPLY ((UINT16_MAX - sizeof(struct ofp_multipart_reply)        \
+                                - sizeof(struct ofp_experimenter_stats_header)) \
+                               / sizeof(struct ofp_exp_state_stats))
+
+/* Executes the register action 'action' on the state table of stage
+ * 'table_id', if the stage is stateful. */
+static void
+dp_exp_state_reg_action(struct packet *pkt, uint8_t table_id, struct ofl_exp_openstate_act_header *action) {
+    struct state_table *st = pkt->dp->pipeline->tables[table_id]->state_table;
+
+    if (state_table_is_stateful(st) && state_table_is_configured(st)) {
+        VLOG_DBG_RL(LOG_MODULE, &rl, "executing action STATE REG at stage %u", table_id);
+        state_table_reg_action(st, pkt, action);
+    } else {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "ERROR STATE REG at stage %u: stage not stateful", table_id);
+    }
+}
+
 void
 dp_exp_action(struct packet *pkt, struct ofl_action_experimenter *act) {
     if(act->experimenter_id == OPENSTATE_VENDOR_ID)
@@ -84,6 +109,15 @@ dp_exp_action(struct packet *pkt, struct ofl_action_experimenter *act) {
                 pkt->dp->global_state = global_state;
                 break;
             }
+            case (OFPAT_EXP_INC_STATE_REG):
+                dp_exp_state_reg_action(pkt, ((struct ofl_exp_action_inc_state_reg *)action)->table_id, action);
+                break;
+            case (OFPAT_EXP_SET_STATE_REG):
+                dp_exp_state_reg_action(pkt, ((struct ofl_exp_action_set_state_reg *)action)->table_id, action);
+                break;
+            case (OFPAT_EXP_CMP_SET_STATE):
+                dp_exp_state_reg_action(pkt, ((struct ofl_exp_action_cmp_set_state *)action)->table_id, action);
+                break;
             default:
                 VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to execute unknown experimenter action (%u).", htonl(act->experimenter_id));
                 break;
@@ -119,15 +153,48 @@ ofl_err
 dp_exp_stats(struct datapath *dp UNUSED, struct ofl_msg_multipart_request_experimenter *msg, const struct sender *sender UNUSED) {
     ofl_err err;
     switch (msg->experimenter_id) {
+        case (OPENFLOW_VENDOR_ID): {
+            struct ofl_exp_openflow_msg_multipart_request *exp = (struct ofl_exp_openflow_msg_multipart_request *)msg;
+
+            switch(exp->type) {
+                case (OFPMP_EXT_FLOW_DELTA): {
+                    return dp_flow_delta_handle_request(dp, (struct ofl_exp_openflow_msg_multipart_request_flow_delta *)msg, sender);
+                }
+                case (OFPMP_EXT_FLOW_MONITOR): {
+                    return dp_flow_monitor_handle_request(dp, (struct ofl_exp_openflow_msg_multipart_request_flow_monitor *)msg, sender);
+                }
+                default: {
+                    VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to handle unknown experimenter type (%u).", exp->type);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXP_TYPE);
+                }
+            }
+        }
         case (OPENSTATE_VENDOR_ID): {
             struct ofl_exp_openstate_msg_multipart_request *exp = (struct ofl_exp_openstate_msg_multipart_request *)msg;
 
             switch(exp->type) {
                 case (OFPMP_EXP_STATE_STATS): {
                     struct ofl_exp_msg_multipart_reply_state reply;
+                    struct ofl_exp_state_stats **stats;
+                    size_t i, num;
+
                     err = handle_stats_request_state(dp->pipeline, (struct ofl_exp_msg_multipart_request_state *)msg, sender, &reply);
+                    stats = reply.stats;
+                    num = reply.stats_num;
+                    for (i = 0; i + STATE_STATS_PER_REPLY < num; i += STATE_STATS_PER_REPLY) {
+                        reply.header.header.header.flags = OFPMPF_REPLY_MORE;
+                        reply.stats = stats + i;
+                        reply.stats_num = STATE_STATS_PER_REPLY;
+                        dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+                    }
+                    reply.header.header.header.flags = 0;
+                    reply.stats = stats + i;
+                    reply.stats_num = num - i;
                     dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
-                    free(reply.stats);
+                    for (i = 0; i < num; i++) {
+                        free(stats[i]);
+                    }
+                    free(stats);
                     ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
                     return err;
                 }
@@ -140,6 +207,13 @@ dp_exp_stats(struct datapath *dp UNUSED, struct ofl_msg_multipart_request_experi
                     }
                     return err;
                 }
+                case (OFPMP_EXP_STATE_TABLE_STATS): {
+                    struct ofl_exp_msg_multipart_reply_state_table reply;
+                    err = handle_stats_request_state_table(dp->pipeline, (struct ofl_exp_msg_multipart_request_state_table *)msg, sender, &reply);
+                    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+                    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+                    return err;
+                }
                 case (OFPMP_EXP_GLOBAL_STATE_STATS): {
                     struct ofl_exp_msg_multipart_reply_global_state reply;
                     err = handle_stats_request_global_state(dp->pipeline, sender, &reply);
@@ -178,6 +252,21 @@ dp_exp_message(struct datapath *dp, struct ofl_msg_experimenter *msg, const stru
                 case (OFP_EXT_SET_DESC): {
                     return dp_handle_set_desc(dp, (struct ofl_exp_openflow_msg_set_dp_desc *)msg, sender);
                 }
+                case (OFP_EXT_SET_PKTIN_LIMIT): {
+                    return dp_pktin_handle_set_limit(dp, (struct ofl_exp_openflow_msg_pktin_limit *)msg, sender);
+                }
+                case (OFP_EXT_PKTIN_LIMIT_REQUEST): {
+                    return dp_pktin_handle_limit_request(dp, exp, sender);
+                }
+                case (OFP_EXT_BUFFER_STATS_REQUEST): {
+                    return dp_buffers_handle_stats_request(dp, exp, sender);
+                }
+                case (OFP_EXT_BUNDLE_CONTROL): {
+                    return dp_bundle_handle_control(dp, (struct ofl_exp_openflow_msg_bundle_ctrl *)msg, sender);
+                }
+                case (OFP_EXT_BUNDLE_ADD): {
+                    return dp_bundle_handle_add(dp, (struct ofl_exp_openflow_msg_bundle_add *)msg, sender);
+                }
                 default: {
                 	VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to handle unknown experimenter type (%u).", exp->type);
                     return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
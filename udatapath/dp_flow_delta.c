@@ -0,0 +1,211 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "datapath.h"
+#include "dp_flow_delta.h"
+#include "flow_entry.h"
+#include "flow_table.h"
+#include "hash.h"
+#include "hmap.h"
+#include "list.h"
+#include "pipeline.h"
+#include "timeval.h"
+#include "util.h"
+#include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
+
+/* Records carried by one multipart reply message at most. */
+#define DELTAS_PER_REPLY ((UINT16_MAX - sizeof(struct ofp_multipart_reply)       \
+                           - sizeof(struct ofp_experimenter_stats_header))       \
+                          / sizeof(struct openflow_ext_flow_delta))
+
+/* What a remote was last told about a flow entry. */
+struct flow_delta_seen {
+    struct hmap_node                    node;  /* In 'seen', by entry id. */
+    struct ofl_exp_openflow_flow_delta  last;  /* Record last reported. */
+    uint64_t                            poll;  /* Last request that found
+                                                  the entry in its table. */
+};
+
+struct flow_deltas {
+    struct hmap  seen;
+    uint64_t     poll;      /* Requests handled so far. */
+};
+
+/* Records of a reply, before it is split in messages. */
+struct flow_delta_records {
+    struct ofl_exp_openflow_flow_delta  *recs;
+    size_t                               size;
+    size_t                               num;
+};
+
+static uint32_t
+hash_entry_id(uint64_t id) {
+    return hash_int((uint32_t)id ^ (uint32_t)(id >> 32), 0);
+}
+
+static struct flow_delta_seen *
+seen_find(struct flow_deltas *deltas, uint64_t id, uint32_t hash) {
+    struct flow_delta_seen *seen;
+
+    HMAP_FOR_EACH_WITH_HASH(seen, struct flow_delta_seen, node, hash, &deltas->seen) {
+        if (seen->last.entry_id == id) {
+            return seen;
+        }
+    }
+    return NULL;
+}
+
+static void
+records_push(struct flow_delta_records *r, struct ofl_exp_openflow_flow_delta *rec) {
+    if (r->num == r->size) {
+        r->recs = x2nrealloc(r->recs, &r->size, sizeof(struct ofl_exp_openflow_flow_delta));
+    }
+    r->recs[r->num++] = *rec;
+}
+
+/* Reports the entries of 'table' whose counters differ from what was last
+ * reported, or that were never reported. */
+static void
+table_deltas(struct flow_deltas *deltas, struct flow_table *table,
+             uint64_t now, struct flow_delta_records *r) {
+    struct flow_entry *entry;
+
+    LIST_FOR_EACH(entry, struct flow_entry, match_node, &table->match_entries) {
+        uint32_t hash = hash_entry_id(entry->id);
+        struct flow_delta_seen *seen = seen_find(deltas, entry->id, hash);
+
+        if (seen == NULL) {
+            seen = xmalloc(sizeof(struct flow_delta_seen));
+            seen->last.entry_id = entry->id;
+            seen->last.table_id = entry->stats->table_id;
+            seen->last.priority = entry->stats->priority;
+            seen->last.flags    = OFPFDF_EXT_NEW;
+            hmap_insert(&deltas->seen, &seen->node, hash);
+        } else if (seen->last.packet_count == entry->stats->packet_count &&
+                   seen->last.byte_count == entry->stats->byte_count) {
+            seen->poll = deltas->poll;
+            continue;
+        } else {
+            seen->last.flags = 0;
+        }
+        seen->last.cookie       = entry->stats->cookie;
+        seen->last.packet_count = entry->stats->packet_count;
+        seen->last.byte_count   = entry->stats->byte_count;
+        seen->last.duration_sec = (now - entry->created) / 1000;
+        seen->poll = deltas->poll;
+        records_push(r, &seen->last);
+    }
+}
+
+ofl_err
+dp_flow_delta_handle_request(struct datapath *dp,
+                             struct ofl_exp_openflow_msg_multipart_request_flow_delta *msg,
+                             const struct sender *sender) {
+    struct flow_deltas *deltas = sender->remote->flow_deltas;
+    struct flow_delta_records r = {NULL, 0, 0};
+    struct flow_delta_seen *seen, *next;
+    uint64_t now = time_msec();
+
+    if (deltas == NULL) {
+        deltas = xmalloc(sizeof(struct flow_deltas));
+        hmap_init(&deltas->seen);
+        deltas->poll = 0;
+        sender->remote->flow_deltas = deltas;
+    }
+    deltas->poll++;
+
+    if (msg->table_id == OFPTT_ALL) {
+        size_t i;
+        for (i = 0; i < PIPELINE_TABLES; i++) {
+            table_deltas(deltas, dp->pipeline->tables[i], now, &r);
+        }
+    } else {
+        table_deltas(deltas, dp->pipeline->tables[msg->table_id], now, &r);
+    }
+
+    /* Entries of the tables asked for that were not found are gone. */
+    HMAP_FOR_EACH_SAFE(seen, next, struct flow_delta_seen, node, &deltas->seen) {
+        if ((msg->table_id == OFPTT_ALL || seen->last.table_id == msg->table_id) &&
+            seen->poll != deltas->poll) {
+            seen->last.flags = OFPFDF_EXT_REMOVED;
+            records_push(&r, &seen->last);
+            hmap_remove(&deltas->seen, &seen->node);
+            free(seen);
+        }
+    }
+
+    {
+        struct ofl_exp_openflow_msg_multipart_reply_flow_delta reply =
+                {{{{{.type = OFPT_MULTIPART_REPLY},
+                    .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+                   .experimenter_id = OPENFLOW_VENDOR_ID},
+                  .type = OFPMP_EXT_FLOW_DELTA},
+                 .deltas_num = 0,
+                 .deltas     = r.recs};
+        size_t i;
+
+        /* Split the reply in segments that fit the 16 bit message length. */
+        for (i = 0; i + DELTAS_PER_REPLY < r.num; i += DELTAS_PER_REPLY) {
+            reply.header.header.header.flags = OFPMPF_REPLY_MORE;
+            reply.deltas     = r.recs + i;
+            reply.deltas_num = DELTAS_PER_REPLY;
+            dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+        }
+        reply.header.header.header.flags = 0x0000;
+        reply.deltas     = r.recs + i;
+        reply.deltas_num = r.num - i;
+        dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+    }
+
+    free(r.recs);
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
+void
+dp_flow_delta_destroy(struct flow_deltas *deltas) {
+    struct flow_delta_seen *seen, *next;
+
+    if (deltas == NULL) {
+        return;
+    }
+    HMAP_FOR_EACH_SAFE(seen, next, struct flow_delta_seen, node, &deltas->seen) {
+        hmap_remove(&deltas->seen, &seen->node);
+        free(seen);
+    }
+    hmap_destroy(&deltas->seen);
+    free(deltas);
+}
@@ -0,0 +1,58 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef DP_FLOW_DELTA_H
+#define DP_FLOW_DELTA_H 1
+
+#include "oflib/ofl.h"
+
+
+/****************************************************************************
+ * Flow counters changed since a remote last asked for them.
+ ****************************************************************************/
+
+struct datapath;
+struct flow_deltas;
+struct sender;
+struct ofl_exp_openflow_msg_multipart_request_flow_delta;
+
+/* Handles a flow delta stats (openflow experimenter) request: replies with
+ * the entries whose counters changed since the previous request of the same
+ * remote, and with those removed in between. */
+ofl_err
+dp_flow_delta_handle_request(struct datapath *dp,
+                             struct ofl_exp_openflow_msg_multipart_request_flow_delta *msg,
+                             const struct sender *sender);
+
+/* Frees what a remote was last told; 'deltas' may be NULL. */
+void
+dp_flow_delta_destroy(struct flow_deltas *deltas);
+
+
+#endif /* DP_FLOW_DELTA_H */
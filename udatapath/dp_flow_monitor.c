@@ -0,0 +1,370 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <netinet/in.h>
+
+#include "datapath.h"
+#include "dp_flow_monitor.h"
+#include "flow_entry.h"
+#include "flow_table.h"
+#include "list.h"
+#include "match_std.h"
+#include "ofpbuf.h"
+#include "pipeline.h"
+#include "util.h"
+#include "oflib/ofl-messages.h"
+#include "oflib/ofl-structs.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
+
+/* Monitors a remote may set at most. */
+#define FLOW_MONITORS_MAX 64
+
+/* Update bytes carried by one multipart reply message at most. */
+#define UPDATES_PER_REPLY (UINT16_MAX - sizeof(struct ofp_multipart_reply)      \
+                           - sizeof(struct ofp_experimenter_stats_header))
+
+/* The updates to a remote stop once it has PAUSE_TXQ messages queued for tx,
+ * short of the TXQ_LIMIT where they would be dropped, and resume once it is
+ * down to RESUME_TXQ. */
+#define PAUSE_TXQ  (TXQ_LIMIT * 3 / 4)
+#define RESUME_TXQ (TXQ_LIMIT / 4)
+
+#define FLOW_MONITOR_FLAGS (OFPFMF_EXT_INITIAL | OFPFMF_EXT_ADD | OFPFMF_EXT_REMOVED | \
+                            OFPFMF_EXT_MODIFY | OFPFMF_EXT_INSTRUCTIONS)
+
+struct flow_monitor {
+    struct list               node;      /* In the remote's 'flow_monitors'. */
+    uint32_t                  id;
+    uint32_t                  out_port;
+    uint32_t                  out_group;
+    uint16_t                  flags;     /* OFPFMF_EXT_*. */
+    uint8_t                   table_id;  /* Table or OFPTT_ALL. */
+    struct ofl_match_header  *match;
+};
+
+static struct flow_monitor *
+monitor_find(struct remote *remote, uint32_t id) {
+    struct flow_monitor *m;
+
+    LIST_FOR_EACH(m, struct flow_monitor, node, &remote->flow_monitors) {
+        if (m->id == id) {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+static void
+monitor_destroy(struct datapath *dp, struct flow_monitor *m) {
+    list_remove(&m->node);
+    ofl_structs_free_match(m->match, dp->exp);
+    free(m);
+    dp->flow_monitors_num--;
+}
+
+/* Returns true if 'entry' passes the filter of monitor 'm'. */
+static bool
+monitor_passes(struct datapath *dp, struct flow_monitor *m, struct flow_entry *entry) {
+    return (m->table_id == OFPTT_ALL || m->table_id == entry->stats->table_id) &&
+           (m->out_port == OFPP_ANY || flow_entry_has_out_port(entry, m->out_port)) &&
+           (m->out_group == OFPG_ANY || flow_entry_has_out_group(entry, m->out_group)) &&
+           match_std_nonstrict((struct ofl_match *)m->match,
+                               (struct ofl_match *)entry->stats->match, dp->exp);
+}
+
+/* Returns true if 'entry' passes a monitor of 'remote' asking for 'event'
+ * (an OFPFMF_EXT_* flag, or 0 for any monitor), and stores the flags of
+ * those monitors in '*flags'. */
+static bool
+remote_passes(struct datapath *dp, struct remote *remote, struct flow_entry *entry,
+              uint16_t event, uint16_t *flags) {
+    struct flow_monitor *m;
+    bool passes = false;
+
+    *flags = 0;
+    LIST_FOR_EACH(m, struct flow_monitor, node, &remote->flow_monitors) {
+        if ((event == 0 || (m->flags & event)) && monitor_passes(dp, m, entry)) {
+            *flags |= m->flags;
+            passes = true;
+        }
+    }
+    return passes;
+}
+
+static uint16_t
+event_flag(uint16_t event) {
+    switch (event) {
+        case (OFPFME_EXT_ADDED):    return OFPFMF_EXT_ADD;
+        case (OFPFME_EXT_REMOVED):  return OFPFMF_EXT_REMOVED;
+        case (OFPFME_EXT_MODIFIED): return OFPFMF_EXT_MODIFY;
+        default:                    return OFPFMF_EXT_INITIAL;
+    }
+}
+
+/* Number of messages queued for tx to 'remote'; it is counted by the control
+ * side, so this is only a hint. */
+static int
+remote_txq(struct remote *remote) {
+    return __atomic_load_n(&remote->n_txq_shared, __ATOMIC_RELAXED);
+}
+
+/* Sends the 'len' bytes of updates at 'data' to 'sender', in as many replies
+ * as it takes to fit the 16 bit message length; the replies are split
+ * between updates. */
+static void
+send_updates(struct datapath *dp, uint8_t *data, size_t len, const struct sender *sender) {
+    struct ofl_exp_openflow_msg_multipart_reply_flow_monitor reply =
+            {{{{{.type = OFPT_MULTIPART_REPLY},
+                .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFPMP_EXT_FLOW_MONITOR},
+             .data_length = 0,
+             .data        = data};
+
+    do {
+        size_t seg = 0;
+
+        while (seg < len) {
+            struct openflow_ext_flow_update_paused *u = (struct openflow_ext_flow_update_paused *)(data + seg);
+
+            if (seg > 0 && seg + ntohs(u->length) > UPDATES_PER_REPLY) {
+                break;
+            }
+            seg += ntohs(u->length);
+        }
+        reply.header.header.header.flags = seg < len ? OFPMPF_REPLY_MORE : 0x0000;
+        reply.data        = data;
+        reply.data_length = seg;
+        dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+        data += seg;
+        len  -= seg;
+    } while (len > 0);
+}
+
+/* Appends an update to those held back for 'remote', which are sent as soon
+ * as they fill a message. */
+static void
+put_update(struct datapath *dp, struct remote *remote, struct flow_entry *entry,
+           uint16_t event, uint8_t reason, bool instructions) {
+    if (remote->flow_updates == NULL) {
+        remote->flow_updates = ofpbuf_new(4096);
+    }
+    ofl_exp_openflow_flow_update_put(event, reason, entry == NULL ? NULL : entry->stats,
+                                     instructions, remote->flow_updates, dp->exp);
+    if (remote->flow_updates->size >= UPDATES_PER_REPLY) {
+        dp_flow_monitor_flush(dp, remote);
+    }
+}
+
+/* Stops the updates to 'remote'.  Those held back are dropped, as resuming
+ * lists the entries again anyway. */
+static void
+pause_updates(struct datapath *dp, struct remote *remote) {
+    if (remote->flow_updates != NULL) {
+        ofpbuf_clear(remote->flow_updates);
+    }
+    put_update(dp, remote, NULL, OFPFME_EXT_PAUSED, 0, false);
+    dp_flow_monitor_flush(dp, remote);
+    remote->flow_updates_paused = true;
+}
+
+/* Restarts the updates to 'remote', listing the entries passing any of its
+ * monitors first, as the changes missed in between are not known. */
+static void
+resume_updates(struct datapath *dp, struct remote *remote) {
+    size_t i;
+
+    for (i = 0; i < PIPELINE_TABLES; i++) {
+        struct flow_entry *entry;
+
+        LIST_FOR_EACH(entry, struct flow_entry, match_node, &dp->pipeline->tables[i]->match_entries) {
+            uint16_t flags;
+
+            if (remote_passes(dp, remote, entry, 0, &flags)) {
+                put_update(dp, remote, entry, OFPFME_EXT_INITIAL, 0, flags & OFPFMF_EXT_INSTRUCTIONS);
+            }
+        }
+    }
+    put_update(dp, remote, NULL, OFPFME_EXT_RESUMED, 0, false);
+    dp_flow_monitor_flush(dp, remote);
+    remote->flow_updates_paused = false;
+}
+
+ofl_err
+dp_flow_monitor_handle_request(struct datapath *dp,
+                               struct ofl_exp_openflow_msg_multipart_request_flow_monitor *msg,
+                               const struct sender *sender) {
+    struct remote *remote = sender->remote;
+    struct flow_monitor *m = monitor_find(remote, msg->monitor_id);
+    struct ofpbuf updates;
+
+    if (msg->flags & ~FLOW_MONITOR_FLAGS) {
+        return ofl_error(OFPET_EXPERIMENTER, OFPMOFC_EXT_BAD_FLAGS);
+    }
+
+    switch (msg->command) {
+        case (OFPFMC_EXT_ADD): {
+            if (m != NULL) {
+                return ofl_error(OFPET_EXPERIMENTER, OFPMOFC_EXT_MONITOR_EXISTS);
+            }
+            if (list_size(&remote->flow_monitors) >= FLOW_MONITORS_MAX) {
+                return ofl_error(OFPET_EXPERIMENTER, OFPMOFC_EXT_INVALID_MONITOR);
+            }
+            m = xmalloc(sizeof(struct flow_monitor));
+            m->id = msg->monitor_id;
+            list_push_back(&remote->flow_monitors, &m->node);
+            dp->flow_monitors_num++;
+            break;
+        }
+        case (OFPFMC_EXT_MODIFY): {
+            if (m == NULL) {
+                return ofl_error(OFPET_EXPERIMENTER, OFPMOFC_EXT_UNKNOWN_MONITOR);
+            }
+            ofl_structs_free_match(m->match, dp->exp);
+            break;
+        }
+        case (OFPFMC_EXT_DELETE): {
+            if (m == NULL) {
+                return ofl_error(OFPET_EXPERIMENTER, OFPMOFC_EXT_UNKNOWN_MONITOR);
+            }
+            monitor_destroy(dp, m);
+            if (list_is_empty(&remote->flow_monitors)) {
+                /* Nothing left to resume. */
+                remote->flow_updates_paused = false;
+            }
+            m = NULL;
+            break;
+        }
+        default: {
+            return ofl_error(OFPET_EXPERIMENTER, OFPMOFC_EXT_BAD_COMMAND);
+        }
+    }
+
+    ofpbuf_init(&updates, 0);
+    if (m != NULL) {
+        m->out_port  = msg->out_port;
+        m->out_group = msg->out_group;
+        m->flags     = msg->flags;
+        m->table_id  = msg->table_id;
+        m->match     = msg->match;
+        msg->match   = NULL;
+
+        if (m->flags & OFPFMF_EXT_INITIAL) {
+            size_t i;
+
+            for (i = 0; i < PIPELINE_TABLES; i++) {
+                struct flow_entry *entry;
+
+                if (m->table_id != OFPTT_ALL && m->table_id != i) {
+                    continue;
+                }
+                LIST_FOR_EACH(entry, struct flow_entry, match_node, &dp->pipeline->tables[i]->match_entries) {
+                    if (monitor_passes(dp, m, entry)) {
+                        ofl_exp_openflow_flow_update_put(OFPFME_EXT_INITIAL, 0, entry->stats,
+                                                         m->flags & OFPFMF_EXT_INSTRUCTIONS, &updates, dp->exp);
+                    }
+                }
+            }
+        }
+    }
+    send_updates(dp, updates.data, updates.size, sender);
+
+    ofpbuf_uninit(&updates);
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
+void
+dp_flow_monitor_event(struct flow_entry *entry, uint16_t event, uint8_t reason) {
+    struct datapath *dp = entry->dp;
+    struct remote *r;
+
+    if (dp->flow_monitors_num == 0) {
+        return;
+    }
+    LIST_FOR_EACH(r, struct remote, node, &dp->remotes) {
+        uint16_t flags;
+
+        if (r->flow_updates_paused ||
+            !remote_passes(dp, r, entry, event_flag(event), &flags)) {
+            continue;
+        }
+        if (remote_txq(r) >= PAUSE_TXQ) {
+            pause_updates(dp, r);
+            continue;
+        }
+        put_update(dp, r, entry, event, reason, flags & OFPFMF_EXT_INSTRUCTIONS);
+    }
+}
+
+void
+dp_flow_monitor_run(struct datapath *dp) {
+    struct remote *r;
+
+    if (dp->flow_monitors_num == 0) {
+        return;
+    }
+    LIST_FOR_EACH(r, struct remote, node, &dp->remotes) {
+        if (r->flow_updates_paused && remote_txq(r) <= RESUME_TXQ) {
+            resume_updates(dp, r);
+        }
+    }
+}
+
+void
+dp_flow_monitor_flush(struct datapath *dp, struct remote *remote) {
+    struct ofpbuf *updates = remote->flow_updates;
+    struct sender sender = {.remote = remote, .conn_id = MAIN_CONNECTION, .xid = 0};
+
+    if (updates == NULL || updates->size == 0) {
+        return;
+    }
+    /* Sending the updates flushes them again, which must find none. */
+    remote->flow_updates = NULL;
+    send_updates(dp, updates->data, updates->size, &sender);
+    ofpbuf_clear(updates);
+    remote->flow_updates = updates;
+}
+
+void
+dp_flow_monitor_remove_all(struct datapath *dp, struct remote *remote) {
+    struct flow_monitor *m, *next;
+
+    LIST_FOR_EACH_SAFE(m, next, struct flow_monitor, node, &remote->flow_monitors) {
+        monitor_destroy(dp, m);
+    }
+    ofpbuf_delete(remote->flow_updates);
+    remote->flow_updates = NULL;
+    remote->flow_updates_paused = false;
+}
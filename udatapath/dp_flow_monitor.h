@@ -0,0 +1,75 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef DP_FLOW_MONITOR_H
+#define DP_FLOW_MONITOR_H 1
+
+#include <stdint.h>
+#include "oflib/ofl.h"
+
+
+/****************************************************************************
+ * Flow monitors: remotes told of the flow entries added, modified and
+ * removed, rather than dumping the tables.
+ ****************************************************************************/
+
+struct datapath;
+struct flow_entry;
+struct remote;
+struct sender;
+struct ofl_exp_openflow_msg_multipart_request_flow_monitor;
+
+/* Handles a flow monitor stats (openflow experimenter) request: adds,
+ * modifies or deletes a monitor of the remote, and replies with the entries
+ * passing it if asked for. */
+ofl_err
+dp_flow_monitor_handle_request(struct datapath *dp,
+                               struct ofl_exp_openflow_msg_multipart_request_flow_monitor *msg,
+                               const struct sender *sender);
+
+/* Tells the remotes monitoring 'entry' of an OFPFME_EXT_* 'event'; 'reason'
+ * is the OFPRR_* of a removal.  The entry must still be valid. */
+void
+dp_flow_monitor_event(struct flow_entry *entry, uint16_t event, uint8_t reason);
+
+/* Pauses the updates to the remotes falling behind, and resumes them once
+ * the remotes caught up. */
+void
+dp_flow_monitor_run(struct datapath *dp);
+
+/* Hands the updates held back for 'remote' over to be sent. */
+void
+dp_flow_monitor_flush(struct datapath *dp, struct remote *remote);
+
+/* Deletes the monitors of a remote let go of, and its pending updates. */
+void
+dp_flow_monitor_remove_all(struct datapath *dp, struct remote *remote);
+
+
+#endif /* DP_FLOW_MONITOR_H */
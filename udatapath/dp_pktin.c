@@ -0,0 +1,262 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "datapath.h"
+#include "dp_buffers.h"
+#include "dp_pktin.h"
+#include "netdev.h"
+#include "ofpbuf.h"
+#include "packet.h"
+#include "pipeline.h"
+#include "timeval.h"
+#include "util.h"
+#include "vlog.h"
+#include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
+
+
+#define LOG_MODULE VLM_dp_pktin
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
+
+/* Reasons are OFPR_NO_MATCH, OFPR_ACTION and OFPR_INVALID_TTL. */
+#define PKTIN_REASONS (OFPR_INVALID_TTL + 1)
+
+/* Buckets are refilled with 'rate' tokens every microsecond, so that it takes
+ * a million of them to send a single packet-in. */
+#define TOKENS_PER_PKTIN 1000000
+
+struct pktin_bucket {
+    uint32_t       rate;      /* Packets per second, 0 for no limit. */
+    uint32_t       burst;     /* Bucket size, in packets. */
+    uint64_t       tokens;    /* Current number of tokens. */
+    long long int  last_fill; /* Time tokens were last added, in us. */
+    uint32_t       sample;    /* Let 1 in 'sample' through over the limit. */
+    uint32_t       n_over;    /* Packet-ins over the limit since the last
+                                 one sampled. */
+    uint64_t       n_sent;    /* Packet-ins let through within the limit. */
+    uint64_t       n_dropped; /* Packet-ins dropped over the limit. */
+    uint64_t       n_sampled; /* Packet-ins let through over the limit. */
+};
+
+struct dp_pktin {
+    struct datapath      *dp;
+    struct pktin_bucket   buckets[PKTIN_REASONS][PIPELINE_TABLES];
+};
+
+
+struct dp_pktin *
+dp_pktin_create(struct datapath *dp) {
+    struct dp_pktin *pin = xcalloc(1, sizeof(struct dp_pktin));
+
+    pin->dp = dp;
+    return pin;
+}
+
+/* Adds the tokens earned since the last refill, up to the bucket size. */
+static void
+refill_bucket(struct pktin_bucket *b) {
+    long long int now = time_usec();
+    uint64_t max = (uint64_t)b->burst * TOKENS_PER_PKTIN;
+
+    if (b->tokens < max) {
+        uint64_t elapsed = MIN(now - b->last_fill,
+                               (max - b->tokens) / b->rate + 1);
+        b->tokens = MIN(b->tokens + elapsed * b->rate, max);
+    }
+    b->last_fill = now;
+}
+
+bool
+dp_pktin_admit(struct dp_pktin *pin, uint8_t reason, uint8_t table_id) {
+    struct pktin_bucket *b;
+
+    if (reason >= PKTIN_REASONS || table_id >= PIPELINE_TABLES) {
+        return true;
+    }
+    b = &pin->buckets[reason][table_id];
+
+    if (b->rate != 0) {
+        refill_bucket(b);
+        if (b->tokens < TOKENS_PER_PKTIN) {
+            if (b->sample != 0 && ++b->n_over >= b->sample) {
+                b->n_over = 0;
+                b->n_sampled++;
+                return true;
+            }
+            b->n_dropped++;
+            return false;
+        }
+        b->tokens -= TOKENS_PER_PKTIN;
+    }
+    b->n_sent++;
+    return true;
+}
+
+struct pktin_segment_aux {
+    struct datapath           *dp;
+    struct ofl_msg_packet_in  *msg;
+};
+
+static int
+send_segment(const struct ofpbuf *segment, void *aux_) {
+    struct pktin_segment_aux *aux = aux_;
+
+    aux->msg->total_len   = segment->size;
+    aux->msg->data        = segment->data;
+    aux->msg->data_length = segment->size;
+    aux->msg->buffer_id   = OFP_NO_BUFFER;
+    dp_send_message(aux->dp, (struct ofl_msg_header *)aux->msg, NULL);
+    return 0;
+}
+
+void
+dp_pktin_send(struct packet *pkt, struct ofl_msg_packet_in *msg,
+              uint16_t max_len) {
+    struct datapath *dp = pkt->dp;
+
+    msg->header.type = OFPT_PACKET_IN;
+
+    /* A super-packet may not fit in a message, nor its length in
+     * 'total_len', so the controller gets the packets it stands for. */
+    if (pkt->offload.gso_type != NETDEV_GSO_NONE) {
+        struct pktin_segment_aux aux = { dp, msg };
+
+        if (netdev_offload_segment(pkt->buffer, &pkt->offload,
+                                   send_segment, &aux)) {
+            VLOG_WARN_RL(LOG_MODULE, &rl, "dropping packet-in of a "
+                         "super-packet that cannot be segmented");
+        }
+        return;
+    }
+
+    /* A miss_send_len of OFPCML_NO_BUFFER means that the complete packet
+     * should be sent, and it should not be buffered.  The complete packet is
+     * also sent if it could not be buffered, as the controller would have no
+     * way to get the rest of it. */
+    msg->buffer_id = OFP_NO_BUFFER;
+    if (dp->config.miss_send_len != OFPCML_NO_BUFFER) {
+        msg->buffer_id = dp_buffers_save(dp->buffers, pkt);
+    }
+    if (msg->buffer_id != OFP_NO_BUFFER) {
+        msg->data_length = MIN(max_len, pkt->buffer->size);
+    } else {
+        msg->data_length = pkt->buffer->size;
+    }
+    /* Saving trims the packet, which may move its data. */
+    msg->total_len = pkt->buffer->size;
+    msg->data      = pkt->buffer->data;
+    dp_send_message(dp, (struct ofl_msg_header *)msg, NULL);
+}
+
+ofl_err
+dp_pktin_handle_set_limit(struct datapath *dp,
+                          struct ofl_exp_openflow_msg_pktin_limit *msg,
+                          const struct sender *sender UNUSED) {
+    struct dp_pktin *pin = dp->pktin;
+    size_t reason, table_id;
+
+    if (msg->reason >= PKTIN_REASONS && msg->reason != OFPR_EXT_ALL) {
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXP_TYPE);
+    }
+    if (msg->table_id >= PIPELINE_TABLES && msg->table_id != OFPTT_ALL) {
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
+    }
+
+    for (reason = 0; reason < PKTIN_REASONS; reason++) {
+        if (msg->reason != OFPR_EXT_ALL && msg->reason != reason) {
+            continue;
+        }
+        for (table_id = 0; table_id < PIPELINE_TABLES; table_id++) {
+            struct pktin_bucket *b;
+
+            if (msg->table_id != OFPTT_ALL && msg->table_id != table_id) {
+                continue;
+            }
+            b = &pin->buckets[reason][table_id];
+            b->rate = msg->rate;
+            b->burst = MAX(msg->burst, 1);
+            b->sample = msg->rate ? msg->sample : 0;
+            b->n_over = 0;
+            b->tokens = (uint64_t)b->burst * TOKENS_PER_PKTIN;
+            b->last_fill = time_usec();
+        }
+    }
+
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
+ofl_err
+dp_pktin_handle_limit_request(struct datapath *dp,
+                              struct ofl_exp_openflow_msg_header *msg,
+                              const struct sender *sender) {
+    struct dp_pktin *pin = dp->pktin;
+    struct ofl_exp_openflow_msg_pktin_stats reply =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFP_EXT_PKTIN_LIMIT_REPLY},
+             .stats_num = 0,
+             .stats = NULL};
+    size_t reason, table_id;
+
+    reply.stats = xmalloc(sizeof(struct ofl_exp_openflow_pktin_stats)
+                          * PKTIN_REASONS * PIPELINE_TABLES);
+    for (reason = 0; reason < PKTIN_REASONS; reason++) {
+        for (table_id = 0; table_id < PIPELINE_TABLES; table_id++) {
+            struct pktin_bucket *b = &pin->buckets[reason][table_id];
+            struct ofl_exp_openflow_pktin_stats *s;
+
+            if (b->rate == 0 && b->n_sent == 0 && b->n_dropped == 0
+                && b->n_sampled == 0) {
+                continue;
+            }
+            s = &reply.stats[reply.stats_num++];
+            s->reason    = reason;
+            s->table_id  = table_id;
+            s->rate      = b->rate;
+            s->burst     = b->rate ? b->burst : 0;
+            s->n_sent    = b->n_sent;
+            s->n_dropped = b->n_dropped;
+            s->sample    = b->sample;
+            s->n_sampled = b->n_sampled;
+        }
+    }
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+    free(reply.stats);
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
@@ -0,0 +1,79 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef DP_PKTIN_H
+#define DP_PKTIN_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "oflib/ofl.h"
+
+
+/****************************************************************************
+ * Rate limiting of packet-in messages, per reason and table.
+ ****************************************************************************/
+
+struct datapath;
+struct packet;
+struct sender;
+struct ofl_msg_packet_in;
+struct ofl_exp_openflow_msg_header;
+struct ofl_exp_openflow_msg_pktin_limit;
+
+/* Creates the packet-in limiter of a datapath, with no limits set. */
+struct dp_pktin *
+dp_pktin_create(struct datapath *dp);
+
+/* Accounts for a packet-in about to be sent for the given reason from the
+ * given table.  Returns false if it is over the limit and must be dropped. */
+bool
+dp_pktin_admit(struct dp_pktin *pin, uint8_t reason, uint8_t table_id);
+
+/* Sends 'pkt' to the controllers in the packet-in 'msg', whose reason, table,
+ * cookie and match are already set.  The packet is buffered, and at most
+ * 'max_len' bytes of it sent, unless buffering is disabled.  Super-packets
+ * are segmented and each segment is sent whole, without buffering. */
+void
+dp_pktin_send(struct packet *pkt, struct ofl_msg_packet_in *msg,
+              uint16_t max_len);
+
+/* Handles a set packet-in limit (openflow experimenter) message */
+ofl_err
+dp_pktin_handle_set_limit(struct datapath *dp,
+                          struct ofl_exp_openflow_msg_pktin_limit *msg,
+                          const struct sender *sender);
+
+/* Handles a packet-in limit request (openflow experimenter) message */
+ofl_err
+dp_pktin_handle_limit_request(struct datapath *dp,
+                              struct ofl_exp_openflow_msg_header *msg,
+                              const struct sender *sender);
+
+
+#endif /* DP_PKTIN_H */
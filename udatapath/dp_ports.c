@@ -153,7 +153,7 @@ hw_packet_in(of_port_t port_no, of_packet_t *packet, int reason,
         /* TODO increment error counter */
         return -1;
     }
-    port = &dp->ports[port_no];
+    port = dp_ports_lookup(dp, port_no);
     if (!PORT_IN_USE(port)) {
         VLOG_WARN(LOG_MODULE, "Receive port not active: %d\n", port_no);
         return -1;
@@ -212,7 +212,8 @@ dp_hw_drv_init(struct datapath *dp)
 
 /* Runs a datapath packet through the pipeline, if the port is not set to down. */
 static void
-process_buffer(struct datapath *dp, struct sw_port *p, struct ofpbuf *buffer) {
+process_buffer(struct datapath *dp, struct sw_port *p, struct ofpbuf *buffer,
+               const struct netdev_offload *offload) {
     struct packet *pkt;
 
     if (p->conf->config & ((OFPPC_NO_RECV | OFPPC_PORT_DOWN) != 0)) {
@@ -221,15 +222,116 @@ process_buffer(struct datapath *dp, struct sw_port *p, struct ofpbuf *buffer) {
     }
 
     // packet takes ownership of ofpbuf buffer
-    pkt = packet_create(dp, p->stats->port_no, buffer, false);
+    pkt = packet_create(dp, p->port_no, buffer, false);
+    pkt->offload = *offload;
     pipeline_process_packet(dp->pipeline, pkt);
 }
 
+/* Refreshes the OFPPS_LINK_DOWN bit of the port using the given netdev, and
+ * updates its liveness if the link state changed. */
+static void
+port_link_changed(struct datapath *dp, const char *netdev_name)
+{
+    enum netdev_flags flags;
+    struct sw_port *p;
+    uint32_t link_down;
+
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        if (IS_HW_PORT(p) || strcmp(netdev_get_name(p->netdev), netdev_name)) {
+            continue;
+        }
+        if (netdev_get_flags(p->netdev, &flags)) {
+            return;
+        }
+        link_down = flags & NETDEV_UP ? 0 : OFPPS_LINK_DOWN;
+        if ((p->conf->state & OFPPS_LINK_DOWN) != link_down) {
+            struct ofl_msg_port_status msg =
+                    {{.type = OFPT_PORT_STATUS},
+                     .reason = OFPPR_MODIFY, .desc = p->conf};
+
+            p->conf->state = (p->conf->state & ~OFPPS_LINK_DOWN) | link_down;
+            dp_port_live_update(p);
+
+            /* Notify the controllers that the port state has changed */
+            dp_send_message(dp, (struct ofl_msg_header *)&msg, NULL/*sender*/);
+        }
+        return;
+    }
+}
+
+/* Dispatches the link state changes reported by the shared rtnetlink
+ * monitor to the affected ports. */
+static void
+dp_ports_check_link_state(struct datapath *dp)
+{
+    const char *netdev_name;
+
+    if (dp->port_monitor == NULL) {
+        return;
+    }
+    netdev_monitor_run(dp->port_monitor);
+    while ((netdev_name = netdev_monitor_poll(dp->port_monitor)) != NULL) {
+        port_link_changed(dp, netdev_name);
+    }
+}
+
+/* Makes the link state monitor of the datapath track the network devices of
+ * all software ports. */
+static void
+dp_ports_update_monitor(struct datapath *dp)
+{
+    struct sw_port *p;
+    char **netdevs;
+    size_t n = 0;
+
+    if (dp->port_monitor == NULL) {
+        int error = netdev_monitor_create(&dp->port_monitor);
+        if (error) {
+            VLOG_WARN(LOG_MODULE, "link state of ports will not be tracked: %s",
+                      strerror(error));
+            return;
+        }
+    }
+
+    netdevs = xmalloc(sizeof *netdevs * dp->ports_num);
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        if (!IS_HW_PORT(p)) {
+            netdevs[n++] = (char *) netdev_get_name(p->netdev);
+        }
+    }
+    netdev_monitor_set_devices(dp->port_monitor, netdevs, n);
+    free(netdevs);
+}
+
+/* Rebuilds the sets of ports a packet is sent to on OFPP_ALL and OFPP_FLOOD,
+ * so that flooding does not have to filter the port list for each packet.
+ * Must be called whenever a port is added or its configuration changes. */
+static void
+dp_ports_update_output_sets(struct datapath *dp)
+{
+    struct sw_port *p;
+
+    dp->all_ports = xrealloc(dp->all_ports,
+                             sizeof *dp->all_ports * dp->ports_num);
+    dp->flood_ports = xrealloc(dp->flood_ports,
+                               sizeof *dp->flood_ports * dp->ports_num);
+    dp->all_ports_num = 0;
+    dp->flood_ports_num = 0;
+
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        dp->all_ports[dp->all_ports_num++] = p;
+        if (!(p->conf->config & OFPPC_NO_FWD)) {
+            dp->flood_ports[dp->flood_ports_num++] = p;
+        }
+    }
+}
+
 void
 dp_ports_run(struct datapath *dp) {
     // static, so an unused buffer can be reused at the dp_ports_run call
     static struct ofpbuf *buffer = NULL;
     int max_mtu = 0;
+    size_t max_len;
 
     struct sw_port *p, *pn;
 
@@ -255,23 +357,19 @@ dp_ports_run(struct datapath *dp) {
 	int mtu;
         if (IS_HW_PORT(p))
             continue;
+        /* Super-packets of ports with offloading are grown past the MTU by
+         * netdev_recv_offload() itself. */
         mtu = netdev_get_mtu(p->netdev);
         if (mtu > max_mtu)
             max_mtu = mtu;
     }
+    max_len = VLAN_ETH_HEADER_LEN + max_mtu;
+
+    dp_ports_check_link_state(dp);
 
     LIST_FOR_EACH_SAFE (p, pn, struct sw_port, node, &dp->port_list) {
+        struct netdev_offload offload;
         int error;
-        /* Check for interface state change */
-        enum netdev_link_state link_state = netdev_link_state(p->netdev);
-        if (link_state == NETDEV_LINK_UP){
-            p->conf->state &= ~OFPPS_LINK_DOWN;
-            dp_port_live_update(p);
-        }
-        else if (link_state == NETDEV_LINK_DOWN){
-            p->conf->state |= OFPPS_LINK_DOWN;
-            dp_port_live_update(p);
-        }
 
         if (IS_HW_PORT(p)) {
             continue;
@@ -281,14 +379,14 @@ dp_ports_run(struct datapath *dp) {
              * to the controller or adding a vlan tag, plus an extra 2 bytes to
              * allow IP headers to be aligned on a 4-byte boundary.  */
             const int headroom = 128 + 2;
-            buffer = ofpbuf_new_with_headroom(VLAN_ETH_HEADER_LEN + max_mtu, headroom);
+            buffer = ofpbuf_new_with_headroom(max_len, headroom);
         }
-        error = netdev_recv(p->netdev, buffer, VLAN_ETH_HEADER_LEN + max_mtu);
+        error = netdev_recv_offload(p->netdev, buffer, max_len, &offload);
         if (!error) {
             p->stats->rx_packets++;
             p->stats->rx_bytes += buffer->size;
             // process_buffer takes ownership of ofpbuf buffer
-            process_buffer(dp, p, buffer);
+            process_buffer(dp, p, buffer, &offload);
             buffer = NULL;
         } else if (error != EAGAIN) {
             VLOG_ERR_RL(LOG_MODULE, &rl, "error receiving data from %s: %s",
@@ -351,6 +449,13 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
         netdev_close(netdev);
         return error;
     }
+    if (dp->offload) {
+        error = netdev_enable_offload(netdev);
+        if (error) {
+            VLOG_WARN(LOG_MODULE, "segmentation offloading not available on "
+                      "%s device: %s", netdev_name, strerror(error));
+        }
+    }
     if (netdev_get_in4(netdev, &in4)) {
         VLOG_ERR(LOG_MODULE, "%s device has assigned IP address %s",
                  netdev_name, inet_ntoa(in4));
@@ -374,7 +479,7 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
         }
     }
 
-    /* NOTE: port struct is already allocated in struct dp */
+    /* NOTE: port struct is already allocated by the caller */
     memset(port, '\0', sizeof *port);
 
     port->dp = dp;
@@ -432,6 +537,7 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
     port->stats->duration_sec = 0;
     port->stats->duration_nsec = 0;
     port->flags |= SWP_USED;
+    port->port_no = port_no;
     port->netdev = netdev;
     port->max_queues = max_queues;
     port->num_queues = 0;
@@ -440,7 +546,10 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
     memset(port->queues, 0x00, sizeof(port->queues));
 
     list_push_back(&dp->port_list, &port->node);
+    hmap_insert(&dp->ports, &port->hmap_node, port_no);
     dp->ports_num++;
+    dp_ports_update_monitor(dp);
+    dp_ports_update_output_sets(dp);
 
     {
     /* Notify the controllers that this port has been added */
@@ -467,8 +576,7 @@ dp_ports_add(struct datapath *dp, const char *port_name)
     if (dp->hw_drv && dp->hw_drv->port_add) {
         port_no = dp->hw_drv->port_add(dp->hw_drv, -1, port_name);
         if (port_no >= 0) {
-            port = &dp->ports[port_no];
-            if (port->flags & SWP_USED) {
+            if (dp_ports_lookup(dp, port_no) != NULL) {
                 VLOG_ERR(LOG_MODULE, "HW port %s (%d) already created\n",
                           port_name, port_no);
                 rc = -1;
@@ -476,6 +584,7 @@ dp_ports_add(struct datapath *dp, const char *port_name)
                 fprintf(stderr, "Adding HW port %s as OF port number %d\n",
                        port_name, port_no);
                 /* FIXME: Determine and record HW addr, etc */
+                port = xcalloc(1, sizeof *port);
                 port->flags |= SWP_USED | SWP_HW_DRV_PORT;
                 port->dp = dp;
                 port->port_no = port_no;
@@ -484,6 +593,8 @@ dp_ports_add(struct datapath *dp, const char *port_name)
                 port->num_queues = 0;
                 strncpy(port->hw_name, port_name, sizeof(port->hw_name));
                 list_push_back(&dp->port_list, &port->node);
+                hmap_insert(&dp->ports, &port->hmap_node, port_no);
+                dp_ports_update_output_sets(dp);
 
                 struct ofl_msg_port_status msg =
                         {{.type = OFPT_PORT_STATUS},
@@ -509,10 +620,15 @@ int
 dp_ports_add(struct datapath *dp, const char *netdev)
 {
     uint32_t port_no;
-    for (port_no = 1; port_no < DP_MAX_PORTS; port_no++) {
-        struct sw_port *port = &dp->ports[port_no];
-        if (port->netdev == NULL) {
-            return new_port(dp, port, port_no, netdev, NULL, dp->max_queues);
+    for (port_no = 1; port_no <= DP_MAX_PORTS; port_no++) {
+        if (dp_ports_lookup(dp, port_no) == NULL) {
+            struct sw_port *port = xcalloc(1, sizeof *port);
+            int error = new_port(dp, port, port_no, netdev, NULL,
+                                 dp->max_queues);
+            if (error) {
+                free(port);
+            }
+            return error;
         }
     }
     return EXFULL;
@@ -544,19 +660,20 @@ dp_ports_add_local(struct datapath *dp, const char *netdev)
 
 struct sw_port *
 dp_ports_lookup(struct datapath *dp, uint32_t port_no) {
-
-    // exclude local port from ports_num
-    uint32_t ports_num = dp->local_port ? dp->ports_num -1 : dp->ports_num;
+    struct hmap_node *hnode;
 
     if (port_no == OFPP_LOCAL) {
         return dp->local_port;
     }
-    /* Local port already checked, so dp->ports -1 */
-    if (port_no < 1 || port_no > ports_num) {
-        return NULL;
-    }
 
-    return &dp->ports[port_no];
+    for (hnode = hmap_first_with_hash(&dp->ports, port_no); hnode != NULL;
+         hnode = hmap_next_with_hash(hnode)) {
+        struct sw_port *p = CONTAINER_OF(hnode, struct sw_port, hmap_node);
+        if (p->port_no == port_no) {
+            return p;
+        }
+    }
+    return NULL;
 }
 
 struct sw_queue *
@@ -575,15 +692,14 @@ dp_ports_lookup_queue(struct sw_port *p, uint32_t queue_id)
     return NULL;
 }
 
-void
-dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
-              uint32_t queue_id)
+/* Outputs a datapath packet on the given port. */
+static void
+port_output(struct datapath *dp UNUSED, struct sw_port *p,
+            struct ofpbuf *buffer, const struct netdev_offload *offload,
+            uint32_t out_port, uint32_t queue_id)
 {
     uint16_t class_id;
     struct sw_queue * q;
-    struct sw_port *p;
-
-    p = dp_ports_lookup(dp, out_port);
 
     /* FIXME:  Needs update for queuing */
     #if defined(OF_HW_PLAT) && !defined(USE_NETDEV)
@@ -627,7 +743,7 @@ dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
                 }
             }
 
-            if (!netdev_send(p->netdev, buffer, class_id)) {
+            if (!netdev_send_offload(p->netdev, buffer, class_id, offload)) {
                 p->stats->tx_packets++;
                 p->stats->tx_bytes += buffer->size;
                 if (q != NULL) {
@@ -648,19 +764,30 @@ dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
                 queue_id);
 }
 
+void
+dp_ports_output(struct datapath *dp, struct ofpbuf *buffer,
+                const struct netdev_offload *offload, uint32_t out_port,
+                uint32_t queue_id)
+{
+    port_output(dp, dp_ports_lookup(dp, out_port), buffer, offload, out_port,
+                queue_id);
+}
+
 int
-dp_ports_output_all(struct datapath *dp, struct ofpbuf *buffer, int in_port, bool flood)
+dp_ports_output_all(struct datapath *dp, struct ofpbuf *buffer,
+                    const struct netdev_offload *offload, int in_port,
+                    bool flood)
 {
-    struct sw_port *p;
+    struct sw_port **ports = flood ? dp->flood_ports : dp->all_ports;
+    size_t ports_num = flood ? dp->flood_ports_num : dp->all_ports_num;
+    size_t i;
 
-    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
-        if (p->stats->port_no == in_port) {
-            continue;
-        }
-        if (flood && p->conf->config & OFPPC_NO_FWD) {
-            continue;
+    for (i = 0; i < ports_num; i++) {
+        struct sw_port *p = ports[i];
+
+        if (p->port_no != in_port) {
+            port_output(dp, p, buffer, offload, p->port_no, 0);
         }
-        dp_ports_output(dp, buffer, p->stats->port_no, 0);
     }
 
     return 0;
@@ -692,6 +819,7 @@ dp_ports_handle_port_mod(struct datapath *dp, struct ofl_msg_port_mod *msg, cons
         p->conf->config &= ~msg->mask;
         p->conf->config |= msg->config & msg->mask;
         dp_port_live_update(p);
+        dp_ports_update_output_sets(dp);
     }
 
     /*Notify all controllers that the port status has changed*/
@@ -725,6 +853,53 @@ dp_port_live_update(struct sw_port *p) {
   }
 }
 
+/* Port stats and descriptions carried by one multipart reply message at
+ * most. */
+#define PORT_STATS_PER_REPLY ((UINT16_MAX - sizeof(struct ofp_multipart_reply)) \
+                              / sizeof(struct ofp_port_stats))
+#define PORT_DESC_PER_REPLY ((UINT16_MAX - sizeof(struct ofp_multipart_reply)) \
+                             / sizeof(struct ofp_port))
+
+/* Sends the port stats of 'reply', split in segments that fit the 16 bit
+ * message length. */
+static void
+dp_ports_send_port_stats(struct datapath *dp, struct ofl_msg_multipart_reply_port *reply,
+                         const struct sender *sender) {
+    struct ofl_msg_multipart_reply_port part = *reply;
+
+    while (part.stats_num > PORT_STATS_PER_REPLY) {
+        size_t left = part.stats_num - PORT_STATS_PER_REPLY;
+
+        part.header.flags = OFPMPF_REPLY_MORE;
+        part.stats_num = PORT_STATS_PER_REPLY;
+        dp_send_message(dp, (struct ofl_msg_header *)&part, sender);
+        part.stats += PORT_STATS_PER_REPLY;
+        part.stats_num = left;
+    }
+    part.header.flags = 0x0000;
+    dp_send_message(dp, (struct ofl_msg_header *)&part, sender);
+}
+
+/* Sends the port descriptions of 'reply', split in segments that fit the 16
+ * bit message length. */
+static void
+dp_ports_send_port_desc(struct datapath *dp, struct ofl_msg_multipart_reply_port_desc *reply,
+                        const struct sender *sender) {
+    struct ofl_msg_multipart_reply_port_desc part = *reply;
+
+    while (part.stats_num > PORT_DESC_PER_REPLY) {
+        size_t left = part.stats_num - PORT_DESC_PER_REPLY;
+
+        part.header.flags = OFPMPF_REPLY_MORE;
+        part.stats_num = PORT_DESC_PER_REPLY;
+        dp_send_message(dp, (struct ofl_msg_header *)&part, sender);
+        part.stats += PORT_DESC_PER_REPLY;
+        part.stats_num = left;
+    }
+    part.header.flags = 0x0000;
+    dp_send_message(dp, (struct ofl_msg_header *)&part, sender);
+}
+
 ofl_err
 dp_ports_handle_stats_request_port(struct datapath *dp,
                                   struct ofl_msg_multipart_request_port *msg,
@@ -760,7 +935,7 @@ dp_ports_handle_stats_request_port(struct datapath *dp,
         }
     }
 
-    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+    dp_ports_send_port_stats(dp, &reply, sender);
 
     free(reply.stats);
     ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
@@ -790,7 +965,7 @@ dp_ports_handle_port_desc_request(struct datapath *dp,
         i++;
     }
 
-    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+    dp_ports_send_port_desc(dp, &reply, sender);
 
     free(reply.stats);
     ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
@@ -924,7 +1099,7 @@ dp_ports_handle_queue_get_config_request(struct datapath *dp,
     } else {
         p = dp_ports_lookup(dp, msg->port);
 
-        if (p == NULL || (p->stats->port_no != msg->port)) {
+        if (p == NULL || (p->port_no != msg->port)) {
             free(reply.queues);
             ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
             return ofl_error(OFPET_QUEUE_OP_FAILED, OFPQOFC_BAD_PORT);
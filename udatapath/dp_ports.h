@@ -40,6 +40,7 @@
 #ifndef DP_PORTS_H
 #define DP_PORTS_H 1
 
+#include "hmap.h"
 #include "list.h"
 #include "netdev.h"
 #include "dp_exp.h"
@@ -85,9 +86,12 @@ enum sw_port_flags {
 #define PORT_IN_USE(p) (((p) != NULL) && (p)->flags & SWP_USED)
 
 struct sw_port {
-    struct list node; /* Element in datapath.ports. */
+    struct list node; /* Element in datapath.port_list. */
+    struct hmap_node hmap_node; /* Element in datapath.ports. */
 
     uint32_t flags;             /* SWP_* flags above */
+    uint32_t port_no;           /* Key in datapath.ports; HW driver ports
+                                   have no 'conf' nor 'stats'. */
     struct datapath *dp;
     struct netdev *netdev;
     struct ofl_port *conf;
@@ -109,7 +113,9 @@ struct hw_pkt_q_entry {
 };
 #endif
 
-#define DP_MAX_PORTS 255
+/* Ports are allocated on demand and kept in a hash map, so the only limit on
+ * their number is the range of valid OpenFlow port numbers. */
+#define DP_MAX_PORTS OFPP_MAX
 BUILD_ASSERT_DECL(DP_MAX_PORTS <= OFPP_MAX);
 
 
@@ -134,15 +140,18 @@ dp_ports_lookup(struct datapath *, uint32_t);
 struct sw_queue *
 dp_ports_lookup_queue(struct sw_port *, uint32_t);
 
-/* Outputs a datapath packet on the port. */
+/* Outputs a datapath packet with the given offload state on the port. */
 void
-dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
-              uint32_t queue_id);
+dp_ports_output(struct datapath *dp, struct ofpbuf *buffer,
+                const struct netdev_offload *offload, uint32_t out_port,
+                uint32_t queue_id);
 
 /* Outputs a datapath packet on all ports except for in_port. If flood is set,
  * packet is not sent out on ports with flooding disabled. */
 int
-dp_ports_output_all(struct datapath *dp, struct ofpbuf *buffer, int in_port, bool flood);
+dp_ports_output_all(struct datapath *dp, struct ofpbuf *buffer,
+                    const struct netdev_offload *offload, int in_port,
+                    bool flood);
 
 /* Handles a port mod message. */
 ofl_err
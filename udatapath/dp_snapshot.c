@@ -0,0 +1,353 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "datapath.h"
+#include "dp_snapshot.h"
+#include "ofpbuf.h"
+#include "pipeline.h"
+#include "poll-loop.h"
+#include "signals.h"
+#include "timeval.h"
+#include "util.h"
+#include "oflib-exp/ofl-exp-openstate.h"
+
+#include "vlog.h"
+#define LOG_MODULE VLM_dp_snapshot
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
+
+/* "OSSNAP" and a version, which changes with the layout of the records. */
+#define SNAPSHOT_MAGIC   0x4f53534e4150ULL
+#define SNAPSHOT_VERSION 2
+
+/* Starts a snapshot file, followed by the state_table_snapshot of each
+ * stateful stage. */
+struct snapshot_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t global_state;
+    uint32_t n_tables;
+    uint32_t pad;
+};
+
+struct dp_snapshot {
+    char *file;
+    char *tmp_file;             /* Written, then renamed to 'file'. */
+    char *dir;                  /* Directory of 'file', synced after renames. */
+    unsigned int interval;      /* Seconds between snapshots, 0 for none. */
+    time_t next;                /* Time of the next snapshot. */
+    struct signal *signal;      /* SIGUSR1, to save right away. */
+    bool pending;               /* Due, but the previous one is being written. */
+    bool writing;               /* A writer thread is running; accessed
+                                 * atomically. */
+};
+
+/* A snapshot copied out of the stages, for a writer thread to write to disk
+ * without holding up the forwarding. */
+struct snapshot_write {
+    struct dp_snapshot *s;
+    struct ofpbuf buf;
+    uint32_t n_tables;
+};
+
+/* Polling interval while a due snapshot waits for the previous one. */
+#define SNAPSHOT_PENDING_MS 100
+
+void
+dp_snapshot_set(struct datapath *dp, char const *file, unsigned int interval) {
+    struct dp_snapshot *s = xmalloc(sizeof *s);
+    char const *slash;
+
+    s->file = xstrdup(file);
+    s->tmp_file = xasprintf("%s.tmp", file);
+    slash = strrchr(file, '/');
+    s->dir = (slash == NULL ? xstrdup(".")
+              : slash == file ? xstrdup("/")
+              : xmemdup0(file, slash - file));
+    s->interval = interval;
+    s->next = time_now() + interval;
+    s->signal = signal_register(SIGUSR1);
+    s->pending = false;
+    s->writing = false;
+    dp->snapshot = s;
+}
+
+int
+dp_snapshot_restore(struct datapath *dp) {
+    struct dp_snapshot *s = dp->snapshot;
+    struct snapshot_header const *h;
+    uint8_t const *data;
+    size_t entries = 0;
+    size_t off, len;
+    struct stat st;
+    uint32_t n_tables, i;
+    int fd;
+
+    fd = open(s->file, O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        VLOG_WARN(LOG_MODULE, "%s: open failed (%s)", s->file, strerror(errno));
+        return errno;
+    }
+    if (fstat(fd, &st) < 0) {
+        VLOG_WARN(LOG_MODULE, "%s: stat failed (%s)", s->file, strerror(errno));
+        close(fd);
+        return errno;
+    }
+    len = st.st_size;
+    if (len < sizeof *h) {
+        VLOG_WARN(LOG_MODULE, "%s: not a snapshot", s->file);
+        close(fd);
+        return EINVAL;
+    }
+    /* The entries are copied straight out of the mapping. */
+    data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        VLOG_WARN(LOG_MODULE, "%s: mmap failed (%s)", s->file, strerror(errno));
+        return errno;
+    }
+    madvise((void *)data, len, MADV_SEQUENTIAL);
+
+    h = (struct snapshot_header const *)data;
+    if (h->magic != SNAPSHOT_MAGIC || h->version != SNAPSHOT_VERSION) {
+        VLOG_WARN(LOG_MODULE, "%s: not a snapshot of this datapath version", s->file);
+        munmap((void *)data, len);
+        return EINVAL;
+    }
+
+    dp->global_state = h->global_state;
+    n_tables = h->n_tables;
+    off = sizeof *h;
+    for (i = 0; i < n_tables; i++) {
+        struct state_table_snapshot const *ts = (struct state_table_snapshot const *)(data + off);
+        struct state_table *table;
+        size_t n;
+
+        if (len - off < sizeof *ts || ts->table_id >= PIPELINE_TABLES) {
+            break;
+        }
+        table = dp->pipeline->tables[ts->table_id]->state_table;
+        n = state_table_restore(table, ts, len - off);
+        if (n == 0) {
+            break;
+        }
+        entries += table->n_entries;
+        off += n;
+    }
+    munmap((void *)data, len);
+
+    if (i < n_tables) {
+        VLOG_WARN(LOG_MODULE, "%s: stage %u of %u is invalid, the rest is skipped",
+                  s->file, i + 1, n_tables);
+        return EINVAL;
+    }
+    VLOG_INFO(LOG_MODULE, "restored %u stages and %zu state entries from %s",
+              n_tables, entries, s->file);
+    return 0;
+}
+
+/* Writes the 'len' bytes at 'data' to 'fd'. */
+static int
+write_fully(int fd, uint8_t const *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Writes 'w' to the temporary file, syncs it and renames it over the
+ * snapshot, so that neither a killed datapath nor a crashed host leaves a
+ * partial snapshot.  Frees 'w'. */
+static int
+snapshot_write(struct snapshot_write *w) {
+    struct dp_snapshot *s = w->s;
+    int error;
+    int fd;
+
+    fd = open(s->tmp_file, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        error = errno;
+    } else {
+        error = write_fully(fd, w->buf.data, w->buf.size);
+        if (!error && fsync(fd) < 0) {
+            error = errno;
+        }
+        if (close(fd) < 0 && !error) {
+            error = errno;
+        }
+        if (!error && rename(s->tmp_file, s->file) < 0) {
+            error = errno;
+        }
+        if (error) {
+            unlink(s->tmp_file);
+        }
+    }
+    if (!error) {
+        /* Makes the rename itself durable. */
+        fd = open(s->dir, O_RDONLY);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+    if (error) {
+        VLOG_WARN(LOG_MODULE, "%s: snapshot failed (%s)", s->file, strerror(error));
+    } else {
+        VLOG_DBG(LOG_MODULE, "saved %u stages, %zu bytes, to %s",
+                 w->n_tables, w->buf.size, s->file);
+    }
+    ofpbuf_uninit(&w->buf);
+    free(w);
+    return error;
+}
+
+static void *
+snapshot_writer(void *w_) {
+    struct snapshot_write *w = w_;
+    struct dp_snapshot *s = w->s;
+
+    snapshot_write(w);
+    __atomic_store_n(&s->writing, false, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Copies the stages of 'dp' into a new snapshot_write.  Each stage is locked
+ * only while it is copied. */
+static struct snapshot_write *
+snapshot_copy(struct datapath *dp) {
+    struct snapshot_write *w = xmalloc(sizeof *w);
+    struct snapshot_header *h;
+    int i;
+
+    w->s = dp->snapshot;
+    w->n_tables = 0;
+    ofpbuf_init(&w->buf, 0);
+    ofpbuf_put_zeros(&w->buf, sizeof *h);
+    for (i = 0; i < PIPELINE_TABLES; i++) {
+        size_t size = w->buf.size;
+
+        state_table_save(dp->pipeline->tables[i]->state_table, i, &w->buf);
+        if (w->buf.size != size) {
+            w->n_tables++;
+        }
+    }
+    h = w->buf.data;
+    h->magic = SNAPSHOT_MAGIC;
+    h->version = SNAPSHOT_VERSION;
+    h->global_state = dp->global_state;
+    h->n_tables = w->n_tables;
+    return w;
+}
+
+int
+dp_snapshot_save(struct datapath *dp) {
+    struct dp_snapshot *s = dp->snapshot;
+    struct snapshot_write *w;
+    pthread_attr_t attr;
+    pthread_t thread;
+    int error;
+
+    if (__atomic_load_n(&s->writing, __ATOMIC_ACQUIRE)) {
+        return EBUSY;
+    }
+    w = snapshot_copy(dp);
+
+    /* The copy is written to disk by a thread of its own, which may take a
+     * while for large stages. */
+    __atomic_store_n(&s->writing, true, __ATOMIC_RELAXED);
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    error = pthread_create(&thread, &attr, snapshot_writer, w);
+    pthread_attr_destroy(&attr);
+    if (error) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "failed to start the snapshot writer (%s), "
+                     "writing in place", strerror(error));
+        error = snapshot_write(w);
+        __atomic_store_n(&s->writing, false, __ATOMIC_RELAXED);
+    }
+    return error;
+}
+
+void
+dp_snapshot_run(struct datapath *dp) {
+    struct dp_snapshot *s = dp->snapshot;
+    time_t now;
+
+    if (s == NULL) {
+        return;
+    }
+    now = time_now();
+    if (signal_poll(s->signal) || (s->interval && now >= s->next)) {
+        s->pending = true;
+        s->next = now + s->interval;
+    }
+    if (s->pending && dp_snapshot_save(dp) != EBUSY) {
+        s->pending = false;
+    }
+}
+
+void
+dp_snapshot_wait(struct datapath *dp) {
+    struct dp_snapshot *s = dp->snapshot;
+
+    if (s == NULL) {
+        return;
+    }
+    signal_wait(s->signal);
+    if (s->pending) {
+        poll_timer_wait(SNAPSHOT_PENDING_MS);
+    } else if (s->interval) {
+        time_t now = time_now();
+
+        poll_timer_wait(s->next > now ? (s->next - now) * 1000 : 0);
+    }
+}
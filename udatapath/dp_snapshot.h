@@ -0,0 +1,70 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef DP_SNAPSHOT_H
+#define DP_SNAPSHOT_H 1
+
+
+/****************************************************************************
+ * Snapshots of the OpenState stages, for a restarted datapath to resume with
+ * the states it had.
+ ****************************************************************************/
+
+struct datapath;
+
+/* Default number of seconds between two snapshots. */
+#define DP_SNAPSHOT_DEFAULT_INTERVAL 60
+
+/* Makes 'dp' save the configuration and entries of its stateful stages and
+ * its global state to 'file' every 'interval' seconds, unless 0, and on
+ * SIGUSR1. */
+void
+dp_snapshot_set(struct datapath *dp, char const *file, unsigned int interval);
+
+/* Restores the stateful stages and global state of 'dp' from its snapshot
+ * file, if there is one.  The timeouts of the entries resume from where they
+ * were when saved.  Returns 0 if successful, otherwise an errno value. */
+int
+dp_snapshot_restore(struct datapath *dp);
+
+/* Copies the stateful stages of 'dp' right away and writes the copy to its
+ * snapshot file in the background.  Returns EBUSY if the previous snapshot is
+ * still being written, otherwise 0 or an errno value. */
+int
+dp_snapshot_save(struct datapath *dp);
+
+/* Saves the snapshot of 'dp' when due. */
+void
+dp_snapshot_run(struct datapath *dp);
+
+void
+dp_snapshot_wait(struct datapath *dp);
+
+
+#endif /* DP_SNAPSHOT_H */
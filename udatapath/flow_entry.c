@@ -32,16 +32,20 @@
 #include <stdlib.h>
 #include "datapath.h"
 #include "dp_actions.h"
+#include "dp_flow_monitor.h"
 #include "flow_table.h"
 #include "flow_entry.h"
 #include "group_table.h"
 #include "group_entry.h"
 #include "meter_table.h"
 #include "meter_entry.h"
+#include "oflib/ofl-arena.h"
 #include "oflib/ofl-messages.h"
 #include "oflib/ofl-structs.h"
 #include "oflib/ofl-actions.h"
 #include "oflib/ofl-utils.h"
+#include "openflow/openflow-ext.h"
+#include "ofpbuf.h"
 #include "packets.h"
 #include "timeval.h"
 #include "util.h"
@@ -133,21 +137,119 @@ flow_entry_overlaps(struct flow_entry *entry, struct ofl_msg_flow_mod *mod, stru
 }
 
 
-void
+/* Copies 'match' and 'instructions' into a new arena, which then holds the
+ * copy in a single block.  The wire format serves as the intermediate form,
+ * so experimenter actions are copied through their callbacks, and the flow
+ * mod they came from can always be freed whole. */
+static ofl_err
+copy_rule(struct ofl_exp *exp, struct ofl_match_header *match,
+          size_t instructions_num,
+          struct ofl_instruction_header **instructions,
+          struct ofl_arena **arena_, struct ofl_match_header **match_,
+          struct ofl_instruction_header ***instructions_) {
+    struct ofl_instruction_header **insts;
+    struct ofl_match_header *m;
+    struct ofl_arena *arena, *prev;
+    struct ofpbuf buf;
+    size_t match_len, len, i;
+    uint8_t *p;
+    ofl_err error = 0;
+
+    ofpbuf_init(&buf, 256);
+    match_len = ofl_structs_match_put(match, &buf, exp);
+    for (i = 0; i < instructions_num; i++) {
+        len = ofl_structs_instructions_ofp_len(instructions[i], exp);
+        ofl_structs_instructions_pack(instructions[i],
+                                      ofpbuf_put_uninit(&buf, len), exp);
+    }
+
+    arena = ofl_arena_create(buf.size * 4 + 128);
+    prev = ofl_arena_swap(arena);
+    len = buf.size;
+    insts = NULL;
+    error = ofl_structs_match_unpack(buf.data, (uint8_t *)buf.data + 4, &len,
+                                     &m, false, exp);
+    if (!error) {
+        insts = ofl_malloc(MAX(instructions_num, 1) * sizeof *insts);
+        p = (uint8_t *)buf.data + match_len;
+        for (i = 0; i < instructions_num; i++) {
+            struct ofp_instruction *inst = (struct ofp_instruction *)p;
+
+            error = ofl_structs_instructions_unpack(inst, &len, &insts[i],
+                                                    exp);
+            if (error) {
+                break;
+            }
+            p += ntohs(inst->len);
+        }
+    }
+    ofl_arena_swap(prev);
+    ofpbuf_uninit(&buf);
+
+    if (error) {
+        VLOG_ERR_RL(LOG_MODULE, &rl, "Failed to copy the rule of a flow entry.");
+        ofl_arena_destroy(arena);
+        return error;
+    }
+    *arena_ = arena;
+    *match_ = m;
+    *instructions_ = insts;
+    return 0;
+}
+
+/* Copies 'match' and 'instructions' into a new arena, which from then on holds
+ * the entry's rule, and releases the previous one.  On error the entry keeps
+ * its previous rule. */
+static ofl_err
+flow_entry_set_rule(struct flow_entry *entry, struct ofl_match_header *match,
+                    size_t instructions_num,
+                    struct ofl_instruction_header **instructions) {
+    struct ofl_instruction_header **insts;
+    struct ofl_match_header *m;
+    struct ofl_arena *arena;
+    ofl_err error;
+
+    error = copy_rule(entry->dp->exp, match, instructions_num, instructions,
+                      &arena, &m, &insts);
+    if (error) {
+        return error;
+    }
+
+    ofl_arena_destroy(entry->arena);
+    entry->arena = arena;
+    entry->match = entry->stats->match = m;
+    entry->stats->instructions_num = instructions_num;
+    entry->stats->instructions     = insts;
+    return 0;
+}
+
+ofl_err
+flow_entry_check_rule(struct datapath *dp, struct ofl_msg_flow_mod *mod) {
+    struct ofl_instruction_header **insts;
+    struct ofl_match_header *m;
+    struct ofl_arena *arena;
+    ofl_err error;
+
+    error = copy_rule(dp->exp, mod->match, mod->instructions_num,
+                      mod->instructions, &arena, &m, &insts);
+    if (!error) {
+        ofl_arena_destroy(arena);
+    }
+    return error;
+}
+
+ofl_err
 flow_entry_replace_instructions(struct flow_entry *entry,
                                       size_t instructions_num,
                                       struct ofl_instruction_header **instructions) {
+    ofl_err error;
 
     /* TODO Zoltan: could be done more efficiently, but... */
     del_group_refs(entry);
-
-    OFL_UTILS_FREE_ARR_FUN2(entry->stats->instructions, entry->stats->instructions_num,
-                            ofl_structs_free_instruction, entry->dp->exp);
-
-    entry->stats->instructions_num = instructions_num;
-    entry->stats->instructions     = instructions;
-
+    error = flow_entry_set_rule(entry, entry->stats->match,
+                                instructions_num, instructions);
     init_group_refs(entry);
+    return error;
 }
 
 void
@@ -324,16 +426,19 @@ del_meter_refs(struct flow_entry *entry) {
 }
 
 
-struct flow_entry *
-flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_flow_mod *mod) {
+ofl_err
+flow_entry_create(struct datapath *dp, struct flow_table *table,
+                  struct ofl_msg_flow_mod *mod, struct flow_entry **entry_) {
     struct flow_entry *entry;
     uint64_t now;
+    ofl_err error;
 
     now = time_msec();
 
     entry = xmalloc(sizeof(struct flow_entry));
     entry->dp    = dp;
     entry->table = table;
+    entry->id    = ++dp->flow_entry_ids;
 
     entry->stats = xmalloc(sizeof(struct ofl_flow_stats));
 
@@ -356,11 +461,14 @@ flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_
     else
         entry->stats->byte_count       = 0;
 
-    entry->stats->match            = mod->match;
-    entry->stats->instructions_num = mod->instructions_num;
-    entry->stats->instructions     = mod->instructions;
-
-    entry->match = mod->match; /* TODO: MOD MATCH? */
+    entry->arena = NULL;
+    error = flow_entry_set_rule(entry, mod->match,
+                                mod->instructions_num, mod->instructions);
+    if (error) {
+        free(entry->stats);
+        free(entry);
+        return error;
+    }
 
     entry->created      = now;
     entry->remove_at    = mod->hard_timeout == 0 ? 0 : now + mod->hard_timeout * 1000;
@@ -376,7 +484,8 @@ flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_
     list_init(&entry->meter_refs);
     init_meter_refs(entry);
 
-    return entry;
+    *entry_ = entry;
+    return 0;
 }
 
 void
@@ -385,9 +494,8 @@ flow_entry_destroy(struct flow_entry *entry) {
     //       flow; but it won't be a problem.
     del_group_refs(entry);
     del_meter_refs(entry);
-    ofl_structs_free_flow_stats(entry->stats, entry->dp->exp);
-    // assumes it is a standard match
-    //free(entry->match);
+    ofl_arena_destroy(entry->arena);
+    free(entry->stats);
     free(entry);
 }
 
@@ -404,6 +512,7 @@ flow_entry_remove(struct flow_entry *entry, uint8_t reason) {
             dp_send_message(entry->dp, (struct ofl_msg_header *)&msg, NULL);
         }
     }
+    dp_flow_monitor_event(entry, OFPFME_EXT_REMOVED, reason);
 
     list_remove(&entry->match_node);
     list_remove(&entry->hard_node);
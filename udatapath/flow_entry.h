@@ -51,10 +51,12 @@ struct flow_entry {
 
     struct datapath         *dp;
     struct flow_table       *table;
+    uint64_t                 id;    /* Unique in the datapath, never reused. */
     struct ofl_flow_stats   *stats;
     struct ofl_match_header *match; /* Original match structure is stored in stats;
                                        this one is a modified version, which reflects
                                        1.2 matching rules. */
+    struct ofl_arena        *arena; /* Holds the match and the instructions. */
     uint64_t                 created;  /* time the entry was created at. */
     uint64_t                 remove_at; /* time the entry should be removed at
                                            due to its hard timeout. */
@@ -78,8 +80,10 @@ flow_entry_matches(struct flow_entry *entry, struct ofl_msg_flow_mod *mod, bool
 bool
 flow_entry_overlaps(struct flow_entry *entry, struct ofl_msg_flow_mod *mod, struct ofl_exp *exp);
 
-/* Replaces the current instructions of the entry with the given ones. */
-void
+/* Replaces the current instructions of the entry with copies of the given
+ * ones; the caller keeps ownership of 'instructions'.  On error the entry is
+ * left unchanged. */
+ofl_err
 flow_entry_replace_instructions(struct flow_entry *entry,
                                       size_t instructions_num,
                                       struct ofl_instruction_header **instructions);
@@ -110,9 +114,16 @@ flow_entry_has_out_group(struct flow_entry *entry, uint32_t group);
 void
 flow_entry_update(struct flow_entry *entry);
 
-/* Creates a flow entry. */
-struct flow_entry *
-flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_flow_mod *mod);
+/* Returns the error flow_entry_create() would report for copying the rule of
+ * 'mod', if any. */
+ofl_err
+flow_entry_check_rule(struct datapath *dp, struct ofl_msg_flow_mod *mod);
+
+/* Creates a flow entry holding its own copy of the match and instructions
+ * of 'mod', which the caller still has to free, and stores it in '*entry'. */
+ofl_err
+flow_entry_create(struct datapath *dp, struct flow_table *table,
+                  struct ofl_msg_flow_mod *mod, struct flow_entry **entry);
 
 /* Destroys a flow entry. */
 void
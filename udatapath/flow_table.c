@@ -32,10 +32,15 @@
 #include <string.h>
 #include "dynamic-string.h"
 #include "datapath.h"
+#include "hash.h"
+#include "hmap.h"
 #include "flow_table.h"
 #include "flow_entry.h"
+#include "dp_flow_monitor.h"
+#include "match_std.h"
 #include "oflib/ofl.h"
 #include "oflib/oxm-match.h"
+#include "openflow/openflow-ext.h"
 #include "time.h"
 #include "dp_capabilities.h"
 //#include "packet_handle_std.h"
@@ -106,18 +111,21 @@ add_to_timeout_lists(struct flow_table *table, struct flow_entry *entry) {
 
 /* Handles flow mod messages with ADD command. */
 static ofl_err
-flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool check_overlap, bool *match_kept, bool *insts_kept, struct ofl_exp *exp) {
+flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool check_overlap, struct ofl_exp *exp) {
     // Note: new entries will be placed behind those with equal priority
     struct flow_entry *entry, *new_entry;
+    ofl_err error;
+
     LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
         if (check_overlap && flow_entry_overlaps(entry, mod, exp)) {
             return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_OVERLAP);
         }
         /* if the entry equals, replace the old one */
         if (flow_entry_matches(entry, mod, true/*strict*/, false/*check_cookie*/, exp)) {
-            new_entry = flow_entry_create(table->dp, table, mod);
-            *match_kept = true;
-            *insts_kept = true;
+            error = flow_entry_create(table->dp, table, mod, &new_entry);
+            if (error) {
+                return error;
+            }
 
             /* NOTE: no flow removed message should be generated according to spec. */
             list_replace(&new_entry->match_node, &entry->match_node);
@@ -125,6 +133,7 @@ flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool chec
             list_remove(&entry->idle_node);
             flow_entry_destroy(entry);
             add_to_timeout_lists(table, new_entry);
+            dp_flow_monitor_event(new_entry, OFPFME_EXT_MODIFIED, 0);
             return 0;
         }
 
@@ -136,14 +145,15 @@ flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool chec
     if (table->stats->active_count == FLOW_TABLE_MAX_ENTRIES) {
         return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_TABLE_FULL);
     }
+    error = flow_entry_create(table->dp, table, mod, &new_entry);
+    if (error) {
+        return error;
+    }
     table->stats->active_count++;
 
-    new_entry = flow_entry_create(table->dp, table, mod);
-    *match_kept = true;
-    *insts_kept = true;
-
     list_insert(&entry->match_node, &new_entry->match_node);
     add_to_timeout_lists(table, new_entry);
+    dp_flow_monitor_event(new_entry, OFPFME_EXT_ADDED, 0);
 
     return 0;
 }
@@ -151,14 +161,18 @@ flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool chec
 /* Handles flow mod messages with MODIFY command. 
     If the flow doesn't exists don't do nothing*/
 static ofl_err
-flow_table_modify(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool strict, bool *insts_kept, struct ofl_exp *exp) {
+flow_table_modify(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool strict, struct ofl_exp *exp) {
     struct flow_entry *entry;
+    ofl_err error;
 
     LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
         if (flow_entry_matches(entry, mod, strict, true/*check_cookie*/, exp)) {
-            flow_entry_replace_instructions(entry, mod->instructions_num, mod->instructions);
+            error = flow_entry_replace_instructions(entry, mod->instructions_num, mod->instructions);
+            if (error) {
+                return error;
+            }
 	    flow_entry_modify_stats(entry, mod);
-            *insts_kept = true;
+            dp_flow_monitor_event(entry, OFPFME_EXT_MODIFIED, 0);
         }
     }
 
@@ -183,17 +197,17 @@ flow_table_delete(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool s
 
 
 ofl_err
-flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool *match_kept, bool *insts_kept, struct ofl_exp *exp) {
+flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, struct ofl_exp *exp) {
     switch (mod->command) {
         case (OFPFC_ADD): {
             bool overlap = ((mod->flags & OFPFF_CHECK_OVERLAP) != 0);
-            return flow_table_add(table, mod, overlap, match_kept, insts_kept, exp);
+            return flow_table_add(table, mod, overlap, exp);
         }
         case (OFPFC_MODIFY): {
-            return flow_table_modify(table, mod, false, insts_kept, exp);
+            return flow_table_modify(table, mod, false, exp);
         }
         case (OFPFC_MODIFY_STRICT): {
-            return flow_table_modify(table, mod, true, insts_kept, exp);
+            return flow_table_modify(table, mod, true, exp);
         }
         case (OFPFC_DELETE): {
             return flow_table_delete(table, mod, false, exp);
@@ -207,6 +221,159 @@ flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool
     }
 }
 
+/* A rule added by flow_table_add_batch. */
+struct batch_rule {
+    struct hmap_node          node;   /* In the batch's rules, by rule_hash. */
+    struct ofl_msg_flow_mod  *mod;    /* Last flow mod adding the rule. */
+    size_t                    order;  /* Position of the first one. */
+    bool                      done;   /* Replaced an entry of the table. */
+};
+
+/* Hashes a priority and a match, so that matches match_std_strict finds
+ * equal hash the same.  Only unmasked standard fields contribute their
+ * value, as other fields may compare equal with different bytes. */
+static uint32_t
+rule_hash(uint16_t priority, struct ofl_match *m) {
+    struct ofl_match_tlv *f;
+    uint32_t hash = 0;
+
+    /* Summed, as the order of the fields does not matter. */
+    HMAP_FOR_EACH(f, struct ofl_match_tlv, hmap_node, &m->match_fields) {
+        if (OXM_VENDOR(f->header) == OFPXMC_OPENFLOW_BASIC && !OXM_HASMASK(f->header)) {
+            hash += hash_bytes(f->value, OXM_LENGTH(f->header), f->header);
+        } else {
+            hash += hash_int(f->header, 0);
+        }
+    }
+    return hash_int(priority, hash);
+}
+
+/* Orders rules by decreasing priority, then as they were added. */
+static int
+batch_rule_compare(const void *a_, const void *b_) {
+    struct batch_rule *a = *(struct batch_rule **)a_;
+    struct batch_rule *b = *(struct batch_rule **)b_;
+
+    if (a->mod->priority != b->mod->priority) {
+        return a->mod->priority > b->mod->priority ? -1 : 1;
+    }
+    return a->order < b->order ? -1 : a->order > b->order;
+}
+
+/* Returns the rule of the batch with the priority and the match of 'mod'. */
+static struct batch_rule *
+batch_find(struct hmap *index, uint32_t hash, struct ofl_msg_flow_mod *mod,
+           struct ofl_exp *exp) {
+    struct batch_rule *r;
+
+    HMAP_FOR_EACH_WITH_HASH (r, struct batch_rule, node, hash, index) {
+        if (r->mod->priority == mod->priority &&
+            match_std_strict((struct ofl_match *)mod->match,
+                             (struct ofl_match *)r->mod->match, exp)) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+ofl_err
+flow_table_add_batch(struct flow_table *table, struct ofl_msg_flow_mod **mods,
+                     size_t mods_num, struct ofl_exp *exp) {
+    struct batch_rule *rules, **added;
+    struct flow_entry *entry, *next, *new_entry;
+    size_t rules_num = 0, added_num = 0;
+    struct hmap index;
+    ofl_err error = 0;
+    size_t i;
+
+    rules = xmalloc(mods_num * sizeof *rules);
+    added = xmalloc(mods_num * sizeof *added);
+    hmap_init(&index);
+
+    /* A rule added twice is only kept the last time, in the place of the
+     * first, as if the second add replaced the entry of the first. */
+    for (i = 0; i < mods_num; i++) {
+        uint32_t hash = rule_hash(mods[i]->priority, (struct ofl_match *)mods[i]->match);
+        struct batch_rule *r = batch_find(&index, hash, mods[i], exp);
+
+        if (r != NULL) {
+            r->mod = mods[i];
+        } else {
+            r = &rules[rules_num++];
+            r->mod = mods[i];
+            r->order = i;
+            r->done = false;
+            hmap_insert(&index, &r->node, hash);
+        }
+    }
+
+    /* Rules already in the table replace their entry in place. */
+    LIST_FOR_EACH_SAFE (entry, next, struct flow_entry, match_node, &table->match_entries) {
+        uint32_t hash = rule_hash(entry->stats->priority, (struct ofl_match *)entry->stats->match);
+        struct batch_rule *r;
+
+        if (hmap_first_with_hash(&index, hash) == NULL) {
+            continue;
+        }
+        HMAP_FOR_EACH_WITH_HASH (r, struct batch_rule, node, hash, &index) {
+            if (!r->done && flow_entry_matches(entry, r->mod, true/*strict*/, false/*check_cookie*/, exp)) {
+                r->done = true;
+                error = flow_entry_create(table->dp, table, r->mod, &new_entry);
+                if (error) {
+                    break;
+                }
+
+                /* NOTE: no flow removed message should be generated according to spec. */
+                list_replace(&new_entry->match_node, &entry->match_node);
+                list_remove(&entry->hard_node);
+                list_remove(&entry->idle_node);
+                flow_entry_destroy(entry);
+                add_to_timeout_lists(table, new_entry);
+                dp_flow_monitor_event(new_entry, OFPFME_EXT_MODIFIED, 0);
+                break;
+            }
+        }
+        if (error) {
+            break;
+        }
+    }
+
+    /* The others are merged into the table in a single pass, each behind the
+     * entries of equal priority, like flow_table_add places them. */
+    for (i = 0; i < rules_num; i++) {
+        if (!rules[i].done) {
+            added[added_num++] = &rules[i];
+        }
+    }
+    qsort(added, added_num, sizeof *added, batch_rule_compare);
+
+    entry = CONTAINER_OF(table->match_entries.next, struct flow_entry, match_node);
+    for (i = 0; !error && i < added_num; i++) {
+        struct ofl_msg_flow_mod *mod = added[i]->mod;
+
+        while (&entry->match_node != &table->match_entries &&
+               entry->stats->priority >= mod->priority) {
+            entry = CONTAINER_OF(entry->match_node.next, struct flow_entry, match_node);
+        }
+        if (table->stats->active_count == FLOW_TABLE_MAX_ENTRIES) {
+            error = ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_TABLE_FULL);
+            break;
+        }
+        error = flow_entry_create(table->dp, table, mod, &new_entry);
+        if (error) {
+            break;
+        }
+        table->stats->active_count++;
+        list_insert(&entry->match_node, &new_entry->match_node);
+        add_to_timeout_lists(table, new_entry);
+        dp_flow_monitor_event(new_entry, OFPFME_EXT_ADDED, 0);
+    }
+
+    hmap_destroy(&index);
+    free(added);
+    free(rules);
+    return error;
+}
 
 struct flow_entry *
 flow_table_lookup(struct flow_table *table, struct packet *pkt, struct ofl_exp *exp) {
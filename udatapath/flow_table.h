@@ -68,9 +68,17 @@ extern uint32_t wildcarded[];
 extern struct ofl_instruction_header instructions[];
 
 extern struct ofl_action_header actions[];
-/* Handles a flow mod message. */
+/* Handles a flow mod message. Entries copy what they keep of 'mod', so the
+ * message is left for the caller to free. */
 ofl_err
-flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool *match_kept, bool *insts_kept, struct ofl_exp *exp);
+flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, struct ofl_exp *exp);
+
+/* Handles flow mods with ADD command and without OFPFF_CHECK_OVERLAP, with
+ * the same outcome as one at a time, in a single pass over the table.  The
+ * messages are left for the caller to free. */
+ofl_err
+flow_table_add_batch(struct flow_table *table, struct ofl_msg_flow_mod **mods,
+                     size_t mods_num, struct ofl_exp *exp);
 
 /* Finds the flow entry with the highest priority, which matches the packet. */
 struct flow_entry *
@@ -34,6 +34,7 @@
 #include "lib/hash.h"
 #include "oflib/oxm-match.h"
 #include "match_std.h"
+#include "packet.h"
 
 
 #include "vlog.h"
@@ -147,8 +148,10 @@ match_mask128(uint8_t *a, uint8_t *am, uint8_t *b) {
 
 /* Returns true if the fields in *packet matches the flow entry in *flow_match */
 bool
-packet_match(struct ofl_match *flow_match, struct ofl_match *packet, struct ofl_exp *exp){
+packet_match(struct ofl_match *flow_match, struct packet_handle_std *handle, struct ofl_exp *exp){
 
+    struct ofl_match *packet = &handle->match;
+    struct packet *pkt = handle->pkt;
     struct ofl_match_tlv *f;
     struct ofl_match_tlv *packet_f;
     bool has_mask;
@@ -192,7 +195,22 @@ packet_match(struct ofl_match *flow_match, struct ofl_match *packet, struct ofl_
             default:
                 break;
         }
-        
+
+        /* The OpenState fields are kept in the packet, not in its match */
+        if (packet_header == OXM_EXP_STATE || packet_header == OXM_EXP_GLOBAL_STATE) {
+            if (packet_header == OXM_EXP_STATE) {
+                if (!pkt->has_state)
+                    return false;
+                packet_val = (uint8_t *) &pkt->state;
+            } else {
+                packet_val = (uint8_t *) &pkt->global_state;
+            }
+            if (has_mask ? !match_mask32(flow_val, flow_mask, packet_val)
+                         : !match_32(flow_val, packet_val))
+                return false;
+            continue;
+        }
+
         /* Lookup the packet header */
         packet_f = oxm_match_lookup(packet_header, packet);
         if (!packet_f) {
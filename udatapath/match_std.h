@@ -36,6 +36,8 @@
 #include "oflib/ofl-structs.h"
 #include "openflow/openstate-ext.h"
 
+struct packet_handle_std;
+
 /****************************************************************************
  * Functions for comparing two extended match structures.
  ******************************************************
@@ -43,8 +45,9 @@
 bool
 match_std_overlap(struct ofl_match *a, struct ofl_match *b, struct ofl_exp *exp);
 
-bool 
-packet_match(struct ofl_match *a, struct ofl_match *b, struct ofl_exp *exp);
+/* Returns true if the packet of 'handle' matches match a. */
+bool
+packet_match(struct ofl_match *a, struct packet_handle_std *handle, struct ofl_exp *exp);
 
 /* Returns true if match a matches match b, in a strict manner. */
 bool
@@ -37,6 +37,8 @@
 #include "packet.h"
 #include "packets.h"
 #include "action_set.h"
+#include "crc32.h"
+#include "csum.h"
 #include "ofpbuf.h"
 #include "oflib/ofl-structs.h"
 #include "oflib/ofl-print.h"
@@ -62,6 +64,17 @@ packet_create(struct datapath *dp, uint32_t in_port,
     pkt->out_queue        = 0;
     pkt->buffer_id        = NO_BUFFER;
     pkt->table_id         = 0;
+    pkt->state            = 0;
+    pkt->has_state        = false;
+    pkt->global_state     = dp->global_state;
+    memset(&pkt->offload, 0, sizeof pkt->offload);
+    pkt->csum_dirty       = false;
+    pkt->sctp_dirty       = false;
+    pkt->ip_csum_delta    = 0;
+    pkt->l4_csum_delta    = 0;
+    pkt->ip_csum_ofs      = 0;
+    pkt->l4_csum_ofs      = 0;
+    pkt->sctp_ofs         = 0;
 
     pkt->handle_std = packet_handle_std_create(pkt);
     return pkt;
@@ -91,6 +104,17 @@ packet_clone(struct packet *pkt) {
                                          // but this buffer is a copy of that,
                                          // and might be altered later
     clone->table_id         = pkt->table_id;
+    clone->state            = pkt->state;
+    clone->has_state        = pkt->has_state;
+    clone->global_state     = pkt->global_state;
+    clone->offload          = pkt->offload;
+    clone->csum_dirty       = pkt->csum_dirty;
+    clone->sctp_dirty       = pkt->sctp_dirty;
+    clone->ip_csum_delta    = pkt->ip_csum_delta;
+    clone->l4_csum_delta    = pkt->l4_csum_delta;
+    clone->ip_csum_ofs      = pkt->ip_csum_ofs;
+    clone->l4_csum_ofs      = pkt->l4_csum_ofs;
+    clone->sctp_ofs         = pkt->sctp_ofs;
 
     clone->handle_std = packet_handle_std_clone(clone, pkt->handle_std);
 
@@ -116,6 +140,49 @@ packet_destroy(struct packet *pkt) {
     free(pkt);
 }
 
+void
+packet_csum_flush(struct packet *pkt) {
+    uint8_t *tail;
+
+    if (!pkt->csum_dirty) {
+        return;
+    }
+    /* The fields are found where the rewrites noted them, without parsing
+     * the packet again. */
+    tail = ofpbuf_tail(pkt->buffer);
+
+    if (pkt->ip_csum_delta != 0 && pkt->ip_csum_ofs != 0) {
+        uint16_t *csum = (uint16_t *) (tail - pkt->ip_csum_ofs);
+
+        *csum = recalc_csum_delta(*csum, pkt->ip_csum_delta);
+    }
+    if (pkt->l4_csum_delta != 0 && pkt->l4_csum_ofs != 0) {
+        uint16_t *csum = (uint16_t *) (tail - pkt->l4_csum_ofs);
+
+        if (pkt->offload.flags & NETDEV_OFFLOAD_NEEDS_CSUM) {
+            /* The field holds the uncomplemented pseudo-header sum. */
+            *csum = ~recalc_csum_delta(~*csum, pkt->l4_csum_delta);
+        } else {
+            *csum = recalc_csum_delta(*csum, pkt->l4_csum_delta);
+        }
+    }
+    if (pkt->sctp_dirty && pkt->sctp_ofs != 0) {
+        struct sctp_header *sctp = (struct sctp_header *) (tail - pkt->sctp_ofs);
+        crc_t crc;
+
+        sctp->sctp_csum = 0;
+        crc = crc_init();
+        crc = crc_update(crc, (unsigned char *) sctp, pkt->sctp_ofs);
+        crc = crc_finalize(crc);
+        sctp->sctp_csum = crc;
+    }
+
+    pkt->csum_dirty    = false;
+    pkt->sctp_dirty    = false;
+    pkt->ip_csum_delta = 0;
+    pkt->l4_csum_delta = 0;
+}
+
 char *
 packet_to_string(struct packet *pkt) {
     char *str;
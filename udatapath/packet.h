@@ -36,6 +36,7 @@
 #include <stdbool.h>
 #include "action_set.h"
 #include "datapath.h"
+#include "netdev.h"
 #include "packet_handle_std.h"
 #include "ofpbuf.h"
 #include "oflib/ofl-structs.h"
@@ -63,7 +64,29 @@ struct packet {
     uint32_t            buffer_id; /* if packet is stored in buffer, buffer_id;
                                       otherwise 0xffffffff */
 
+    /* OpenState fields, matched as OXM_EXP_STATE and OXM_EXP_GLOBAL_STATE;
+     * they are set by the pipeline for each table, and only put in the
+     * match fields for packet-ins. */
+    uint32_t            state;        /* state of the packet's flow */
+    bool                has_state;    /* false if the table is stateless */
+    uint32_t            global_state; /* global state of the datapath */
+
     struct packet_handle_std  *handle_std; /* handler for standard match structure */
+
+    struct netdev_offload offload; /* segmentation and checksum offload state;
+                                      the buffer may hold a super-packet */
+
+    /* Checksum updates owed by header rewrites, applied by
+     * packet_csum_flush().  The rewrites also note where the checksums are,
+     * as offsets back from the end of the buffer, which headers pushed or
+     * popped in front of them leave unchanged; 0 if there is none. */
+    bool                csum_dirty;    /* true if any of the below is pending */
+    bool                sctp_dirty;    /* SCTP checksum must be recomputed */
+    uint32_t            ip_csum_delta; /* accumulated with csum_delta16() */
+    uint32_t            l4_csum_delta; /* likewise, for TCP, UDP or ICMP */
+    uint32_t            ip_csum_ofs;   /* IPv4 header checksum */
+    uint32_t            l4_csum_ofs;   /* TCP, UDP or ICMP checksum */
+    uint32_t            sctp_ofs;      /* SCTP header */
 };
 
 /* Creates a packet. */
@@ -82,4 +105,10 @@ packet_destroy(struct packet *pkt);
 struct packet *
 packet_clone(struct packet *pkt);
 
+/* Brings the checksums of the packet up to date with the header rewrites done
+ * so far.  Must be called before the packet leaves the pipeline, or before its
+ * headers are moved or hidden from the parser. */
+void
+packet_csum_flush(struct packet *pkt);
+
 #endif /* PACKET_H */
@@ -391,9 +391,6 @@ packet_handle_std_validate(struct packet_handle_std *handle) {
     struct ofl_match_tlv * iter, *next, *f;
     uint64_t metadata = 0;
     uint64_t tunnel_id = 0;
-    uint32_t state = 0;
-    bool has_state = false;
-    uint32_t current_global_state = OFP_GLOBAL_STATE_DEFAULT;
 
     if(handle->valid)
         return;
@@ -408,17 +405,6 @@ packet_handle_std_validate(struct packet_handle_std *handle) {
         tunnel_id = *(uint64_t *)(f->value);
     }
 
-    HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv, hmap_node,
-        hash_int(OXM_EXP_STATE,0), & handle->match.match_fields){
-        state = *(uint32_t *)(f->value + EXP_ID_LEN);
-        has_state = true;
-    }
-
-    HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-	hmap_node, hash_int(OXM_EXP_GLOBAL_STATE,0), &handle->match.match_fields){
-        current_global_state = *((uint32_t*) (f->value + EXP_ID_LEN));
-    }
-
     HMAP_FOR_EACH_SAFE(iter, next, struct ofl_match_tlv, hmap_node, &handle->match.match_fields)
     {
         free(iter->value);
@@ -426,6 +412,7 @@ packet_handle_std_validate(struct packet_handle_std *handle) {
     }
 
     ofl_structs_match_init(&handle->match);
+    handle->state_table = NULL;
 
     if (packet_parse(handle->pkt, &handle->match, handle->proto) < 0)
         return;
@@ -435,19 +422,45 @@ packet_handle_std_validate(struct packet_handle_std *handle) {
     /* Add in_port value to the hash_map */
     ofl_structs_match_put32(&handle->match, OXM_OF_IN_PORT, handle->pkt->in_port);
 
-    /* Add global register value to the hash_map */
-    ofl_structs_match_exp_put32(&handle->match, OXM_EXP_GLOBAL_STATE, 0xBEBABEBA, current_global_state);
-
-    if(has_state)
-    {
-        ofl_structs_match_exp_put32(&handle->match, OXM_EXP_STATE, 0xBEBABEBA, state);
-    }
-
     /*Add metadata  and tunnel_id value to the hash_map */
     ofl_structs_match_put64(&handle->match,  OXM_OF_METADATA, metadata);
     ofl_structs_match_put64(&handle->match,  OXM_OF_TUNNEL_ID, tunnel_id);
 }
 
+void
+packet_handle_std_put_state(struct packet_handle_std *handle) {
+    struct packet *pkt = handle->pkt;
+
+    ofl_structs_match_exp_put32(&handle->match, OXM_EXP_GLOBAL_STATE, 0xBEBABEBA, pkt->global_state);
+    if (pkt->has_state) {
+        ofl_structs_match_exp_put32(&handle->match, OXM_EXP_STATE, 0xBEBABEBA, pkt->state);
+    }
+}
+
+static void
+remove_exp_field(struct ofl_match *match, uint32_t header) {
+    struct hmap_node *node, *next;
+
+    for (node = hmap_first_with_hash(&match->match_fields, hash_int(header, 0));
+         node != NULL; node = next) {
+        struct ofl_match_tlv *f = CONTAINER_OF(node, struct ofl_match_tlv, hmap_node);
+
+        next = hmap_next_with_hash(node);
+        if (f->header == header) {
+            hmap_remove(&match->match_fields, node);
+            match->header.length -= 4 + OXM_LENGTH(header);
+            free(f->value);
+            free(f);
+        }
+    }
+}
+
+void
+packet_handle_std_remove_state(struct packet_handle_std *handle) {
+    remove_exp_field(&handle->match, OXM_EXP_GLOBAL_STATE);
+    remove_exp_field(&handle->match, OXM_EXP_STATE);
+}
+
 struct packet_handle_std *
 packet_handle_std_create(struct packet *pkt) {
 	struct packet_handle_std *handle = xmalloc(sizeof(struct packet_handle_std));
@@ -526,7 +539,7 @@ packet_handle_std_match(struct packet_handle_std *handle, struct ofl_match *matc
             return false;
         }
     }
-    return packet_match(match ,&handle->match, exp);
+    return packet_match(match, handle, exp);
 }
 
 
@@ -37,6 +37,9 @@
 #include "packets.h"
 #include "match_std.h"
 #include "oflib/ofl-structs.h"
+#include "openflow/openstate-ext.h"
+
+struct state_table;
 
 /****************************************************************************
  * A handler processing a datapath packet for standard matches.
@@ -54,6 +57,10 @@ struct packet_handle_std {
                                            executing any methods. */
    bool			       table_miss; /*Packet was matched
    					     against table miss flow*/
+   /* Key of the packet in 'state_table', kept by its lookup for a SET_STATE
+    * action of the same stage; reset when the packet is parsed again. */
+   struct state_table const   *state_table;
+   uint8_t                     state_key[OFPSC_MAX_KEY_LEN];
 };
 
 /* Creates a handler */
@@ -91,5 +98,14 @@ packet_handle_std_clone(struct packet *pkt, struct packet_handle_std *handle);
 void
 packet_handle_std_validate(struct packet_handle_std *handle);
 
+/* Puts the OpenState fields of the packet in its match, for a packet-in;
+ * they are matched from the packet itself otherwise. */
+void
+packet_handle_std_put_state(struct packet_handle_std *handle);
+
+/* Takes the fields put by packet_handle_std_put_state() out of the match. */
+void
+packet_handle_std_remove_state(struct packet_handle_std *handle);
+
 
 #endif /* PACKET_HANDLE_STD_H */
@@ -36,6 +36,7 @@
 #include "compiler.h"
 #include "dp_actions.h"
 #include "dp_buffers.h"
+#include "dp_pktin.h"
 #include "dp_exp.h"
 #include "dp_ports.h"
 #include "datapath.h"
@@ -48,6 +49,8 @@
 #include "oflib/ofl-structs.h"
 #include "util.h"
 #include "hash.h"
+#include "poll-loop.h"
+#include "timeval.h"
 #include "oflib/oxm-match.h"
 #include "vlog.h"
 #include "dp_capabilities.h"
@@ -55,6 +58,9 @@
 
 #define LOG_MODULE VLM_pipeline
 
+/* Flow stats carried by one multipart reply message at most. */
+#define MAX_FLOW_STATS_BYTES (UINT16_MAX - sizeof(struct ofp_multipart_reply))
+
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 
 static void
@@ -89,31 +95,25 @@ send_packet_to_controller(struct pipeline *pl, struct packet *pkt, uint8_t table
 
     struct ofl_msg_packet_in msg;
     struct ofl_match *m;
-    msg.header.type = OFPT_PACKET_IN;
-    msg.total_len   = pkt->buffer->size;
+
+    if (!dp_pktin_admit(pl->dp->pktin, reason, table_id)) {
+        return;
+    }
+
+    /* Earlier tables may have rewritten headers. */
+    packet_csum_flush(pkt);
+
     msg.reason      = reason;
     msg.table_id    = table_id;
     msg.cookie      = 0xffffffffffffffff;
-    msg.data = pkt->buffer->data;
-
-
-    /* A max_len of OFPCML_NO_BUFFER means that the complete
-        packet should be sent, and it should not be buffered.*/
-    if (pl->dp->config.miss_send_len != OFPCML_NO_BUFFER){
-        dp_buffers_save(pl->dp->buffers, pkt);
-        msg.buffer_id   = pkt->buffer_id;
-        msg.data_length = MIN(pl->dp->config.miss_send_len, pkt->buffer->size);
-    }else {
-        msg.buffer_id   = OFP_NO_BUFFER;
-        msg.data_length = pkt->buffer->size;
-    }
 
+    packet_handle_std_put_state(pkt->handle_std);
     m = &pkt->handle_std->match;
     /* In this implementation the fields in_port and in_phy_port
         always will be the same, because we are not considering logical
         ports                                 */
     msg.match = (struct ofl_match_header*)m;
-    dp_send_message(pl->dp, (struct ofl_msg_header *)&msg, NULL);
+    dp_pktin_send(pkt, &msg, pl->dp->config.miss_send_len);
     ofl_structs_free_match((struct ofl_match_header* ) m, NULL);
 }
 
@@ -122,7 +122,6 @@ send_packet_to_controller(struct pipeline *pl, struct packet *pkt, uint8_t table
 void
 pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
     struct flow_table *table, *next_table;
-    struct ofl_match_tlv *f;
 
     //printf("here is pipeline processing packet\n");
     if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
@@ -146,7 +145,6 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
     next_table = pl->tables[0];
     while (next_table != NULL) {
         struct flow_entry *entry;
-	struct state_entry *state_entry;
 
         VLOG_DBG_RL(LOG_MODULE, &rl, "trying table %u.", next_table->stats->table_id);
 
@@ -155,31 +153,13 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
         next_table    = NULL;
 		
 		
-        //removes eventual old 'state' virtual header field
-        
-        HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                    hmap_node, hash_int(OXM_EXP_STATE,0), &pkt->handle_std->match.match_fields){
-                        hmap_remove_and_shrink(&pkt->handle_std->match.match_fields,&f->hmap_node);
-        }
-
-
+        /* The state is that of this table; a stateless table, or a packet
+         * without the lookup key fields, matches no OXM_EXP_STATE. */
+        pkt->has_state = false;
 		if (state_table_is_stateful(table->state_table) && state_table_is_configured(table->state_table)) {
-            state_entry = state_table_lookup(table->state_table, pkt);
-            if(state_entry!=NULL){
-
-        		ofl_structs_match_exp_put32(&pkt->handle_std->match, OXM_EXP_STATE, 0xBEBABEBA, 0x00000000);
-                state_table_write_state(state_entry, pkt);
-            }
+            state_table_lookup(table->state_table, pkt);
 		}
-        
-        //set 'flags' virtual header field value
-
-
-        HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv, 
-            hmap_node, hash_int(OXM_EXP_GLOBAL_STATE,0), &pkt->handle_std->match.match_fields){
-                    uint32_t *flags = (uint32_t*) (f->value + EXP_ID_LEN);
-                    *flags = (*flags & 0x00000000 ) | (pkt->dp->global_state);
-        }
+        pkt->global_state = pkt->dp->global_state;
 
 		if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
 			char *m = ofl_structs_match_to_string((struct ofl_match_header*)&(pkt->handle_std->match), pkt->dp->exp);
@@ -233,35 +213,19 @@ int inst_compare(const void *inst1, const void *inst2){
 }
 
 ofl_err
-pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
-                                                const struct sender *sender) {
-    /* Note: the result of using table_id = 0xff is undefined in the spec.
-     *       for now it is accepted for delete commands, meaning to delete
-     *       from all tables */
+pipeline_prepare_flow_mod(struct ofl_msg_flow_mod *msg) {
     ofl_err error;
     size_t i;
-    bool match_kept,insts_kept;
-
-    if(sender->remote->role == OFPCR_ROLE_SLAVE)
-        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_IS_SLAVE);
-
-    match_kept = false;
-    insts_kept = false;
 
     /*Sort by execution oder*/
     qsort(msg->instructions, msg->instructions_num,
         sizeof(struct ofl_instruction_header *), inst_compare);
 
-    // Validate actions in flow_mod
     for (i=0; i< msg->instructions_num; i++) {
         if (msg->instructions[i]->type == OFPIT_APPLY_ACTIONS ||
             msg->instructions[i]->type == OFPIT_WRITE_ACTIONS) {
             struct ofl_instruction_actions *ia = (struct ofl_instruction_actions *)msg->instructions[i];
 
-            error = dp_actions_validate(pl->dp, ia->actions_num, ia->actions);
-            if (error) {
-                return error;
-            }
             error = dp_actions_check_set_field_req(msg, ia->actions_num, ia->actions);
             if (error) {
                 return error;
@@ -273,49 +237,103 @@ pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
 	  return ofl_error(OFPET_BAD_INSTRUCTION, OFPBIC_UNSUP_INST);
     }
 
+    if (msg->table_id == 0xff &&
+        msg->command != OFPFC_DELETE && msg->command != OFPFC_DELETE_STRICT) {
+        return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_BAD_TABLE_ID);
+    }
+    return 0;
+}
+
+ofl_err
+pipeline_apply_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg, uint32_t *buffer_id) {
+    /* Note: the result of using table_id = 0xff is undefined in the spec.
+     *       for now it is accepted for delete commands, meaning to delete
+     *       from all tables */
+    ofl_err error;
+
+    *buffer_id = NO_BUFFER;
     if (msg->table_id == 0xff) {
-        if (msg->command == OFPFC_DELETE || msg->command == OFPFC_DELETE_STRICT) {
-            size_t i;
-
-            error = 0;
-            for (i=0; i < PIPELINE_TABLES; i++) {
-                error = flow_table_flow_mod(pl->tables[i], msg, &match_kept, &insts_kept, pl->dp->exp);
-                if (error) {
-                    break;
-                }
-            }
+        size_t i;
+
+        error = 0;
+        for (i=0; i < PIPELINE_TABLES; i++) {
+            error = flow_table_flow_mod(pl->tables[i], msg, pl->dp->exp);
             if (error) {
-                return error;
-            } else {
-                ofl_msg_free_flow_mod(msg, !match_kept, !insts_kept, pl->dp->exp);
-                return 0;
+                break;
             }
+        }
+        if (error) {
+            return error;
         } else {
-            return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_BAD_TABLE_ID);
+            ofl_msg_free((struct ofl_msg_header *)msg, pl->dp->exp);
+            return 0;
         }
     } else {
-        error = flow_table_flow_mod(pl->tables[msg->table_id], msg, &match_kept, &insts_kept, pl->dp->exp);
+        error = flow_table_flow_mod(pl->tables[msg->table_id], msg, pl->dp->exp);
         if (error) {
             return error;
         }
-        if ((msg->command == OFPFC_ADD || msg->command == OFPFC_MODIFY || msg->command == OFPFC_MODIFY_STRICT) &&
-                            msg->buffer_id != NO_BUFFER) {
-            /* run buffered message through pipeline */
-            struct packet *pkt;
-
-            pkt = dp_buffers_retrieve(pl->dp->buffers, msg->buffer_id);
-            if (pkt != NULL) {
-		      pipeline_process_packet(pl, pkt);
-            } else {
-                VLOG_WARN_RL(LOG_MODULE, &rl, "The buffer flow_mod referred to was empty (%u).", msg->buffer_id);
-            }
+        if (msg->command == OFPFC_ADD || msg->command == OFPFC_MODIFY || msg->command == OFPFC_MODIFY_STRICT) {
+            *buffer_id = msg->buffer_id;
         }
 
-        ofl_msg_free_flow_mod(msg, !match_kept, !insts_kept, pl->dp->exp);
+        ofl_msg_free((struct ofl_msg_header *)msg, pl->dp->exp);
         return 0;
     }
 }
 
+void
+pipeline_process_buffered(struct pipeline *pl, uint32_t buffer_id) {
+    struct packet *pkt;
+
+    if (buffer_id == NO_BUFFER) {
+        return;
+    }
+    pkt = dp_buffers_retrieve(pl->dp->buffers, buffer_id);
+    if (pkt != NULL) {
+        pipeline_process_packet(pl, pkt);
+    } else {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "The buffer flow_mod referred to was empty (%u).", buffer_id);
+    }
+}
+
+ofl_err
+pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
+                                                const struct sender *sender) {
+    uint32_t buffer_id;
+    ofl_err error;
+    size_t i;
+
+    if(sender->remote->role == OFPCR_ROLE_SLAVE)
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_IS_SLAVE);
+
+    error = pipeline_prepare_flow_mod(msg);
+    if (error) {
+        return error;
+    }
+
+    // Validate actions in flow_mod
+    for (i=0; i< msg->instructions_num; i++) {
+        if (msg->instructions[i]->type == OFPIT_APPLY_ACTIONS ||
+            msg->instructions[i]->type == OFPIT_WRITE_ACTIONS) {
+            struct ofl_instruction_actions *ia = (struct ofl_instruction_actions *)msg->instructions[i];
+
+            error = dp_actions_validate(pl->dp, ia->actions_num, ia->actions);
+            if (error) {
+                return error;
+            }
+        }
+    }
+
+    error = pipeline_apply_flow_mod(pl, msg, &buffer_id);
+    if (error) {
+        return error;
+    }
+    /* run buffered message through pipeline */
+    pipeline_process_buffered(pl, buffer_id);
+    return 0;
+}
+
 ofl_err
 pipeline_handle_table_mod(struct pipeline *pl,
                           struct ofl_msg_table_mod *msg,
@@ -361,9 +379,25 @@ pipeline_handle_stats_request_flow(struct pipeline *pl,
                 {{{.type = OFPT_MULTIPART_REPLY},
                   .type = OFPMP_FLOW, .flags = 0x0000},
                  .stats     = stats,
-                 .stats_num = stats_num
+                 .stats_num = 0
                 };
-
+        size_t i, len = 0;
+
+        /* Split the reply in segments that fit the 16 bit message length. */
+        for (i = 0; i < stats_num; i++) {
+            size_t stat_len = ofl_structs_flow_stats_ofp_len(stats[i], pl->dp->exp);
+
+            if (reply.stats_num > 0 && len + stat_len > MAX_FLOW_STATS_BYTES) {
+                reply.header.flags = OFPMPF_REPLY_MORE;
+                dp_send_message(pl->dp, (struct ofl_msg_header *)&reply, sender);
+                reply.stats += reply.stats_num;
+                reply.stats_num = 0;
+                len = 0;
+            }
+            len += stat_len;
+            reply.stats_num++;
+        }
+        reply.header.flags = 0x0000;
         dp_send_message(pl->dp, (struct ofl_msg_header *)&reply, sender);
     }
 
@@ -470,6 +504,7 @@ pipeline_handle_stats_request_table_features_request(struct pipeline *pl,
 	/* Create a buffer the do reassembly. */
 	saved_msg = (struct ofl_msg_multipart_request_table_features*) malloc(sizeof(struct ofl_msg_multipart_request_table_features));
 	saved_msg->header.header.type = OFPT_MULTIPART_REQUEST;
+	saved_msg->header.header.arena = NULL;
 	saved_msg->header.type = OFPMP_TABLE_FEATURES;
 	saved_msg->header.flags = 0;
 	saved_msg->tables_num = 0;
@@ -627,8 +662,32 @@ pipeline_timeout(struct pipeline *pl) {
 
     for (i = 0; i < PIPELINE_TABLES; i++) {
         flow_table_timeout(pl->tables[i]);
-        if (state_table_is_stateful(pl->tables[i]->state_table) && state_table_is_configured(pl->tables[i]->state_table))
-            state_table_timeout(pl->tables[i]->state_table);
+    }
+}
+
+void
+pipeline_state_timeout(struct pipeline *pl) {
+    uint64_t now = time_usec();
+    int i;
+
+    /* Every table keeps its clock, which the state entries read, current. */
+    for (i = 0; i < PIPELINE_TABLES; i++) {
+        state_table_timeout(pl->tables[i]->state_table, now);
+    }
+}
+
+void
+pipeline_state_timeout_wait(struct pipeline *pl) {
+    uint64_t next = UINT64_MAX;
+    uint64_t now;
+    int i;
+
+    for (i = 0; i < PIPELINE_TABLES; i++) {
+        next = MIN(next, state_table_next_timeout(pl->tables[i]->state_table));
+    }
+    if (next != UINT64_MAX) {
+        now = time_usec();
+        poll_timer_wait(next > now ? (next - now + 999) / 1000 : 0);
     }
 }
 
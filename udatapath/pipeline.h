@@ -62,6 +62,22 @@ void
 pipeline_process_packet(struct pipeline *pl, struct packet *pkt);
 
 
+/* Sorts the instructions of a flow_mod message and runs the checks which do
+ * not depend on the state of the switch. */
+ofl_err
+pipeline_prepare_flow_mod(struct ofl_msg_flow_mod *msg);
+
+/* Applies a prepared flow_mod message to the flow tables, freeing it on
+ * success.  Stores in 'buffer_id' the buffered packet to run through the
+ * pipeline once the change is in place, or NO_BUFFER. */
+ofl_err
+pipeline_apply_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg, uint32_t *buffer_id);
+
+/* Runs the packet buffered as 'buffer_id', unless NO_BUFFER, through the
+ * pipeline. */
+void
+pipeline_process_buffered(struct pipeline *pl, uint32_t buffer_id);
+
 /* Handles a flow_mod message. */
 ofl_err
 pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
@@ -102,6 +118,14 @@ pipeline_handle_stats_request_aggregate(struct pipeline *pl,
 void
 pipeline_timeout(struct pipeline *pl);
 
+/* Runs the timeouts of the state tables that are due. */
+void
+pipeline_state_timeout(struct pipeline *pl);
+
+/* Arranges for the poll loop to wake up when a state table timeout is due. */
+void
+pipeline_state_timeout_wait(struct pipeline *pl);
+
 /* Detroys the pipeline. */
 void
 pipeline_destroy(struct pipeline *pl);
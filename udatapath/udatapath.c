@@ -45,10 +45,12 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "command-line.h"
 #include "daemon.h"
 #include "datapath.h"
+#include "dp_snapshot.h"
 #include "fault.h"
 #include "openflow/openflow.h"
 #include "poll-loop.h"
@@ -82,6 +84,11 @@ static void add_ports(struct datapath *dp, char *port_list);
 
 static bool use_multiple_connections = false;
 
+static bool use_control_thread = true;
+
+static char *snapshot_file;
+static unsigned int snapshot_interval = DP_SNAPSHOT_DEFAULT_INTERVAL;
+
 /* Need to treat this more generically */
 #if defined(UDATAPATH_AS_LIB)
 #define OFP_FATAL(_er, _str, args...) do {                \
@@ -118,6 +125,12 @@ udatapath_cmd(int argc, char *argv[])
     parse_options(dp, argc, argv);
     signal(SIGPIPE, SIG_IGN);
 
+    /* The stages are back before any packet or controller is seen. */
+    if (snapshot_file != NULL) {
+        dp_snapshot_set(dp, snapshot_file, snapshot_interval);
+        dp_snapshot_restore(dp);
+    }
+
     if (argc - optind < 1) {
         OFP_FATAL(0, "at least one listener argument is required; "
           "use --help for usage");
@@ -175,6 +188,12 @@ udatapath_cmd(int argc, char *argv[])
     die_if_already_running();
     daemonize();
 
+    /* Threads do not survive daemonize()'s fork.  With a single CPU, the
+     * control thread would only compete with forwarding. */
+    if (use_control_thread && sysconf(_SC_NPROCESSORS_ONLN) > 1) {
+        dp_start_control_thread(dp);
+    }
+
     for (;;) {
         dp_run(dp);
         dp_wait(dp);
@@ -213,7 +232,12 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         OPT_SERIAL_NUM,
         OPT_BOOTSTRAP_CA_CERT,
         OPT_NO_LOCAL_PORT,
-        OPT_NO_SLICING
+        OPT_NO_SLICING,
+        OPT_NO_OFFLOAD,
+        OPT_NO_CONTROL_THREAD,
+        OPT_BUFFER_SIZE,
+        OPT_STATE_SNAPSHOT,
+        OPT_STATE_SNAPSHOT_INTERVAL
     };
 
     static struct option long_options[] = {
@@ -226,6 +250,11 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         {"help",        no_argument, 0, 'h'},
         {"version",     no_argument, 0, 'V'},
         {"no-slicing",  no_argument, 0, OPT_NO_SLICING},
+        {"no-offload",  no_argument, 0, OPT_NO_OFFLOAD},
+        {"no-control-thread", no_argument, 0, OPT_NO_CONTROL_THREAD},
+        {"buffer-size", required_argument, 0, OPT_BUFFER_SIZE},
+        {"state-snapshot", required_argument, 0, OPT_STATE_SNAPSHOT},
+        {"state-snapshot-interval", required_argument, 0, OPT_STATE_SNAPSHOT_INTERVAL},
         {"mfr-desc",    required_argument, 0, OPT_MFR_DESC},
         {"hw-desc",     required_argument, 0, OPT_HW_DESC},
         {"sw-desc",     required_argument, 0, OPT_SW_DESC},
@@ -323,6 +352,50 @@ parse_options(struct datapath *dp, int argc, char *argv[])
             dp_set_max_queues(dp, 0);
             break;
 
+        case OPT_NO_OFFLOAD:
+            dp_set_offload(dp, false);
+            break;
+
+        case OPT_NO_CONTROL_THREAD:
+            use_control_thread = false;
+            break;
+
+        case OPT_BUFFER_SIZE: {
+            char *tail;
+            unsigned long long int size = strtoull(optarg, &tail, 10);
+
+            switch (*tail) {
+            case 'G': case 'g': size <<= 10;
+            /* Fall through. */
+            case 'M': case 'm': size <<= 10;
+            /* Fall through. */
+            case 'K': case 'k': size <<= 10;
+                tail++;
+            }
+            if (tail == optarg || *tail != '\0' || size > SIZE_MAX) {
+                ofp_fatal(0, "argument to --buffer-size must be a number of "
+                          "bytes, optionally followed by K, M or G");
+            }
+            dp_set_buffer_size(dp, size);
+            break;
+        }
+
+        case OPT_STATE_SNAPSHOT:
+            snapshot_file = optarg;
+            break;
+
+        case OPT_STATE_SNAPSHOT_INTERVAL: {
+            char *tail;
+            unsigned long int interval = strtoul(optarg, &tail, 10);
+
+            if (tail == optarg || *tail != '\0' || interval > UINT_MAX / 1000) {
+                ofp_fatal(0, "argument to --state-snapshot-interval must be "
+                          "a number of seconds");
+            }
+            snapshot_interval = interval;
+            break;
+        }
+
         DAEMON_OPTION_HANDLERS
 
 #ifdef HAVE_OPENSSL
@@ -362,6 +435,17 @@ usage(void)
            "  -m, --multiconn         enable multiple connections to the\n"
            "                          same controller.\n"
            "  --no-slicing            disable slicing\n"
+           "  --no-offload            disable segmentation and checksum\n"
+           "                          offloading on ports\n"
+           "  --no-control-thread     serve OpenFlow connections from the\n"
+           "                          forwarding loop\n"
+           "  --buffer-size=BYTES     buffer up to BYTES of packets sent to\n"
+           "                          the controller (default: 16M)\n"
+           "  --state-snapshot=FILE   save the state tables to FILE, and\n"
+           "                          restore them from it at startup\n"
+           "  --state-snapshot-interval=SECS\n"
+           "                          save them every SECS seconds, 0 for\n"
+           "                          only on SIGUSR1 (default: 60)\n"
            "\nOther options:\n"
            "  -D, --detach            run in background as daemon\n"
            "  -P, --pidfile[=FILE]    create pidfile (default: %s/ofdatapath.pid)\n"
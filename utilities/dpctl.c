@@ -31,6 +31,7 @@
 
 #include <config.h>
 #include <arpa/inet.h>
+#include <ctype.h>
 #include <errno.h>
 #include <getopt.h>
 #include <inttypes.h>
@@ -120,9 +121,18 @@ parse_bucket(char *str, struct ofl_bucket *b);
 static void
 parse_state_stat_args(char *str, struct ofl_exp_msg_multipart_request_state *req);
 
+static void
+parse_state_mod_args(char *str, struct ofl_exp_set_flow_state *entry);
+
+static int
+parse_state_key(char *str, uint8_t *key, uint32_t *key_len);
+
 static void
 parse_flow_stat_args(char *str, struct ofl_msg_multipart_request_flow *req);
 
+static void
+parse_flow_monitor_args(char *str, struct ofl_exp_openflow_msg_multipart_request_flow_monitor *req);
+
 static void
 parse_match(char *str, struct ofl_match_header **match);
 
@@ -144,6 +154,9 @@ parse_port_mod(char *str, struct ofl_msg_port_mod *msg);
 static void
 parse_table_mod(char *str, struct ofl_msg_table_mod *msg);
 
+static void
+parse_pktin_limit(char *str, struct ofl_exp_openflow_msg_pktin_limit *msg);
+
 static void
 parse_band(char *str, struct ofl_msg_meter_mod *m, struct ofl_meter_band_header **b);
 
@@ -568,7 +581,7 @@ stats_state(struct vconn *vconn, int argc, char *argv[])
 }
 
 static void
-stats_state_num(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED) {
+stats_state_num(struct vconn *vconn, int argc, char *argv[]) {
     uint8_t table_id=0xff;
 
     struct ofl_exp_msg_multipart_request_state_num req =
@@ -579,6 +592,24 @@ stats_state_num(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED) {
                  .table_id = table_id};
 
     parse8(argv[0], NULL, 0, 0xff, &(req.table_id));
+    if (argc > 1) {
+        parse_state(argv[1], &(req.get_from_state), &(req.state));
+    }
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
+}
+
+static void
+stats_state_table(struct vconn *vconn, int argc UNUSED, char *argv[]) {
+    struct ofl_exp_msg_multipart_request_state_table req =
+             {{{{{.type = OFPT_MULTIPART_REQUEST},
+                  .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+                 .experimenter_id = OPENSTATE_VENDOR_ID},
+                 .type = OFPMP_EXP_STATE_TABLE_STATS},
+                 .table_id = 0};
+
+    if (parse8(argv[0], NULL, 0, PIPELINE_TABLES - 1, &(req.table_id))) {
+        ofp_fatal(0, "Error parsing stats-state-table table: %s.", argv[0]);
+    }
     dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
 }
 
@@ -592,6 +623,181 @@ stats_global_state(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED) {
     dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
 }
 
+/* Largest body of a state mod dpctl sends. */
+#define STATE_MOD_MAX_LEN (UINT16_MAX - offsetof(struct ofp_exp_msg_state_mod, payload))
+
+static FILE *
+open_state_file(char *name)
+{
+    FILE *file = strcmp(name, "-") ? fopen(name, "r") : stdin;
+
+    if (file == NULL) {
+        ofp_fatal(errno, "Error opening state file %s", name);
+    }
+    return file;
+}
+
+/* Reads the next line of a state file into 'entry'.  A line holds a key in
+ * hex, optionally followed by state mod arguments; blank lines and lines
+ * starting with '#' are skipped.  Returns false at the end of 'file'. */
+static bool
+read_state_entry(FILE *file, struct ofl_exp_set_flow_state *entry)
+{
+    char line[1024];
+
+    while (fgets(line, sizeof line, file) != NULL) {
+        char *key, *args, *saveptr = NULL;
+
+        key = strtok_r(line, " \t\r\n", &saveptr);
+        if (key == NULL || key[0] == '#') {
+            continue;
+        }
+        memset(entry, 0, sizeof *entry);
+        entry->state_mask = 0xffffffff;
+        if (parse_state_key(key, entry->key, &entry->key_len)) {
+            ofp_fatal(0, "Error parsing state key: %s.", key);
+        }
+        args = strtok_r(NULL, " \t\r\n", &saveptr);
+        if (args != NULL) {
+            parse_state_mod_args(args, entry);
+        }
+        return true;
+    }
+    return false;
+}
+
+/* Reads the entries of a state file for 'table_id' into 'entries', which
+ * grows as needed, and returns their number.  All the keys must have the
+ * same length, returned in 'key_len'. */
+static size_t
+read_state_file(char *name, uint8_t table_id, struct ofl_exp_set_flow_state **entries, uint32_t *key_len)
+{
+    FILE *file = open_state_file(name);
+    size_t n = 0, allocated = 0;
+
+    *entries = NULL;
+    *key_len = 0;
+    for (;;) {
+        if (n == allocated) {
+            *entries = x2nrealloc(*entries, &allocated, sizeof **entries);
+        }
+        if (!read_state_entry(file, &(*entries)[n])) {
+            break;
+        }
+        if (*key_len && (*entries)[n].key_len != *key_len) {
+            ofp_fatal(0, "State key %zu is %u bytes long, previous ones %u.", n + 1, (*entries)[n].key_len, *key_len);
+        }
+        *key_len = (*entries)[n].key_len;
+        (*entries)[n].table_id = table_id;
+        n++;
+    }
+    if (file != stdin) {
+        fclose(file);
+    }
+    return n;
+}
+
+static void
+set_states(struct vconn *vconn, int argc UNUSED, char *argv[])
+{
+    struct ofl_exp_msg_state_mod msg =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENSTATE_VENDOR_ID},
+              .type = OFPT_EXP_STATE_MOD},
+             .command = OFPSC_EXP_SET_FLOW_STATES};
+    struct ofl_exp_set_flow_states *p = (struct ofl_exp_set_flow_states *)msg.payload;
+    struct ofl_exp_set_flow_state *entries;
+    size_t n, i, batch;
+
+    if (parse8(argv[0], NULL, 0, PIPELINE_TABLES - 1, &p->table_id)) {
+        ofp_fatal(0, "Error parsing set-states table: %s.", argv[0]);
+    }
+    n = read_state_file(argv[1], p->table_id, &entries, &p->key_len);
+
+    /* Each message is applied in one pass; the file may take a few. */
+    batch = (STATE_MOD_MAX_LEN - sizeof(struct ofp_exp_set_flow_states))
+            / ROUND_UP(sizeof(struct ofp_exp_flow_state_entry) + p->key_len, 8);
+    for (i = 0; i < n; i += p->n_entries) {
+        p->n_entries = MIN(batch, n - i);
+        p->entries = entries + i;
+        dpctl_send_and_print(vconn, (struct ofl_msg_header *)&msg);
+    }
+    free(entries);
+}
+
+static void
+del_states(struct vconn *vconn, int argc UNUSED, char *argv[])
+{
+    struct ofl_exp_msg_state_mod msg =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENSTATE_VENDOR_ID},
+              .type = OFPT_EXP_STATE_MOD},
+             .command = OFPSC_EXP_DEL_FLOW_STATES};
+    struct ofl_exp_del_flow_states *p = (struct ofl_exp_del_flow_states *)msg.payload;
+    struct ofl_exp_set_flow_state *entries;
+    uint8_t *keys;
+    size_t n, i, batch;
+
+    if (parse8(argv[0], NULL, 0, PIPELINE_TABLES - 1, &p->table_id)) {
+        ofp_fatal(0, "Error parsing del-states table: %s.", argv[0]);
+    }
+    /* The arguments after the keys, as in a set-states file, are left. */
+    n = read_state_file(argv[1], p->table_id, &entries, &p->key_len);
+    keys = xmalloc(n * p->key_len);
+    for (i = 0; i < n; i++) {
+        memcpy(keys + i * p->key_len, entries[i].key, p->key_len);
+    }
+    free(entries);
+
+    batch = (STATE_MOD_MAX_LEN - sizeof(struct ofp_exp_del_flow_states)) / ROUND_UP(p->key_len, 8);
+    for (i = 0; i < n; i += p->n_keys) {
+        p->n_keys = MIN(batch, n - i);
+        p->keys = keys + i * p->key_len;
+        dpctl_send_and_print(vconn, (struct ofl_msg_header *)&msg);
+    }
+    free(keys);
+}
+
+static void
+del_states_by_state(struct vconn *vconn, int argc UNUSED, char *argv[])
+{
+    struct ofl_exp_msg_state_mod msg =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENSTATE_VENDOR_ID},
+              .type = OFPT_EXP_STATE_MOD},
+             .command = OFPSC_EXP_DEL_FLOW_STATES_BY_STATE};
+    struct ofl_exp_del_flow_states_by_state *p = (struct ofl_exp_del_flow_states_by_state *)msg.payload;
+    char *mask, *saveptr = NULL;
+
+    if (parse8(argv[0], table_names, NUM_ELEMS(table_names), PIPELINE_TABLES - 1, &p->table_id)) {
+        ofp_fatal(0, "Error parsing del-states-by-state table: %s.", argv[0]);
+    }
+    p->state_mask = 0xffffffff;
+    strtok_r(argv[1], MASK_SEP, &saveptr);
+    mask = strtok_r(NULL, MASK_SEP, &saveptr);
+    if (!str_to_uint(argv[1], 0, &p->state)
+        || (mask != NULL && !str_to_uint(mask, 0, &p->state_mask))) {
+        ofp_fatal(0, "Error parsing del-states-by-state state: %s.", argv[1]);
+    }
+    dpctl_send_and_print(vconn, (struct ofl_msg_header *)&msg);
+}
+
+static void
+flush_states(struct vconn *vconn, int argc UNUSED, char *argv[])
+{
+    struct ofl_exp_msg_state_mod msg =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENSTATE_VENDOR_ID},
+              .type = OFPT_EXP_STATE_MOD},
+             .command = OFPSC_EXP_FLUSH_STATE_TABLE};
+    struct ofl_exp_flush_state_table *p = (struct ofl_exp_flush_state_table *)msg.payload;
+
+    if (parse8(argv[0], table_names, NUM_ELEMS(table_names), PIPELINE_TABLES - 1, &p->table_id)) {
+        ofp_fatal(0, "Error parsing flush-states table: %s.", argv[0]);
+    }
+    dpctl_send_and_print(vconn, (struct ofl_msg_header *)&msg);
+}
+
 static void
 stats_aggr(struct vconn *vconn, int argc, char *argv[])
 {
@@ -951,6 +1157,99 @@ set_desc(struct vconn *vconn, int argc UNUSED, char *argv[])
 }
 
 
+static void
+pktin_limit(struct vconn *vconn, int argc UNUSED, char *argv[])
+{
+    struct ofl_exp_openflow_msg_pktin_limit msg =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFP_EXT_SET_PKTIN_LIMIT},
+             .reason = OFPR_EXT_ALL,
+             .table_id = OFPTT_ALL,
+             .rate = 0,
+             .burst = 0,
+             .sample = 0};
+
+    parse_pktin_limit(argv[0], &msg);
+
+    dpctl_send_and_print(vconn, (struct ofl_msg_header *)&msg);
+}
+
+
+static void
+stats_pktin(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED)
+{
+    struct ofl_exp_openflow_msg_header msg =
+            {{{.type = OFPT_EXPERIMENTER},
+              .experimenter_id = OPENFLOW_VENDOR_ID},
+             .type = OFP_EXT_PKTIN_LIMIT_REQUEST};
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&msg, NULL);
+}
+
+
+static void
+stats_buffers(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED)
+{
+    struct ofl_exp_openflow_msg_header msg =
+            {{{.type = OFPT_EXPERIMENTER},
+              .experimenter_id = OPENFLOW_VENDOR_ID},
+             .type = OFP_EXT_BUFFER_STATS_REQUEST};
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&msg, NULL);
+}
+
+
+static void
+stats_flow_delta(struct vconn *vconn, int argc, char *argv[])
+{
+    struct ofl_exp_openflow_msg_multipart_request_flow_delta req =
+            {{{{{.type = OFPT_MULTIPART_REQUEST},
+                 .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+                .experimenter_id = OPENFLOW_VENDOR_ID},
+               .type = OFPMP_EXT_FLOW_DELTA},
+             .table_id = OFPTT_ALL};
+
+    if (argc > 0 && parse8(argv[0], table_names, NUM_ELEMS(table_names), PIPELINE_TABLES - 1, &req.table_id)) {
+        ofp_fatal(0, "Error parsing stats-flow-delta table: %s.", argv[0]);
+    }
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
+}
+
+static void
+flow_monitor(struct vconn *vconn, int argc, char *argv[])
+{
+    struct ofl_exp_openflow_msg_multipart_request_flow_monitor req =
+            {{{{{.type = OFPT_MULTIPART_REQUEST},
+                 .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+                .experimenter_id = OPENFLOW_VENDOR_ID},
+               .type = OFPMP_EXT_FLOW_MONITOR},
+             .monitor_id = 0,
+             .out_port = OFPP_ANY,
+             .out_group = OFPG_ANY,
+             .flags = OFPFMF_EXT_INITIAL | OFPFMF_EXT_ADD | OFPFMF_EXT_REMOVED |
+                      OFPFMF_EXT_MODIFY | OFPFMF_EXT_INSTRUCTIONS,
+             .table_id = OFPTT_ALL,
+             .command = OFPFMC_EXT_ADD,
+             .match = NULL};
+
+    if (argc > 0) {
+        parse_flow_monitor_args(argv[0], &req);
+    }
+    if (argc > 1) {
+        parse_match(argv[1], &(req.match));
+    } else {
+        make_all_match(&(req.match));
+    }
+
+    /* The updates come as replies to the request, for as long as the
+     * connection lasts. */
+    dpctl_send_and_print(vconn, (struct ofl_msg_header *)&req);
+    monitor(vconn, 0, NULL);
+}
+
+
 static void
 queue_mod(struct vconn *vconn, int argc UNUSED, char *argv[])
 {
@@ -1041,8 +1340,13 @@ static struct command all_commands[] = {
     {"stats-desc", 0, 0, stats_desc },
     {"stats-flow", 0, 2, stats_flow},
     {"stats-state", 0, 3, stats_state},
-    {"stats-state-num", 1, 1, stats_state_num},
+    {"stats-state-num", 1, 2, stats_state_num},
+    {"stats-state-table", 1, 1, stats_state_table},
     {"stats-global-state", 0, 0, stats_global_state},
+    {"set-states", 2, 2, set_states},
+    {"del-states", 2, 2, del_states},
+    {"del-states-by-state", 2, 2, del_states_by_state},
+    {"flush-states", 1, 1, flush_states},
     {"stats-aggr", 0, 2, stats_aggr},
     {"stats-table", 0, 0, stats_table },
     {"stats-port", 0, 1, stats_port },
@@ -1061,6 +1365,11 @@ static struct command all_commands[] = {
     {"table-mod", 1, 1, table_mod },
     {"queue-get-config", 1, 1, queue_get_config},
     {"set-desc", 1, 1, set_desc},
+    {"pktin-limit", 1, 1, pktin_limit},
+    {"stats-pktin", 0, 0, stats_pktin},
+    {"stats-buffers", 0, 0, stats_buffers},
+    {"stats-flow-delta", 0, 1, stats_flow_delta},
+    {"flow-monitor", 0, 2, flow_monitor},
     {"set-table-match", 0, 2, set_table_features_match},
 
     {"queue-mod", 3, 3, queue_mod},
@@ -1231,6 +1540,18 @@ usage(void)
             "  SWITCH set-desc DESC                   sets the DP description\n"
             "  SWITCH queue-mod PORT QUEUE BW         adds/modifies queue\n"
             "  SWITCH queue-del PORT QUEUE            deletes queue\n"
+            "  SWITCH pktin-limit ARG                 limits packet-in rate\n"
+            "  SWITCH stats-pktin                     print packet-in limits\n"
+            "  SWITCH stats-buffers                   print packet buffer stats\n"
+            "  SWITCH stats-flow-delta [TABLE]        print flow counters changed\n"
+            "  SWITCH flow-monitor [ARG [MATCH]]      print flow entry changes\n"
+            "  SWITCH stats-state-num TABLE [state=S] print the number of states\n"
+            "  SWITCH stats-state-table TABLE         print state table limits and usage\n"
+            "  SWITCH set-states TABLE FILE           set the states of the keys in FILE\n"
+            "  SWITCH del-states TABLE FILE           delete the states of the keys in FILE\n"
+            "  SWITCH del-states-by-state TABLE STATE[/MASK]\n"
+            "                                         delete the states matching STATE\n"
+            "  SWITCH flush-states TABLE              delete all the states of TABLE\n"
             "\n",
             program_name, program_name);
      vconn_usage(true, false, false);
@@ -2270,6 +2591,85 @@ parse_state(char *str, uint8_t *get_from_state, uint32_t *state)
     }
 }
 
+/* Parses a state key given in hex, its bytes optionally separated by ':'. */
+static int
+parse_state_key(char *str, uint8_t *key, uint32_t *key_len)
+{
+    uint32_t len = 0;
+    int nibble = -1;
+
+    if (strncmp(str, "0x", 2) == 0) {
+        str += 2;
+    }
+    for (; *str != '\0'; str++) {
+        int digit;
+
+        if (*str == ':' && nibble < 0) {
+            continue;
+        }
+        if (!isxdigit((unsigned char) *str) || (nibble < 0 && len == OFPSC_MAX_KEY_LEN)) {
+            return -1;
+        }
+        digit = isdigit((unsigned char) *str) ? *str - '0' : tolower((unsigned char) *str) - 'a' + 10;
+        if (nibble < 0) {
+            nibble = digit;
+        } else {
+            key[len++] = nibble << 4 | digit;
+            nibble = -1;
+        }
+    }
+    if (nibble >= 0 || len == 0) {
+        return -1;
+    }
+    *key_len = len;
+    return 0;
+}
+
+static void
+parse_state_mod_args(char *str, struct ofl_exp_set_flow_state *entry)
+{
+    char *token, *saveptr = NULL;
+
+    for (token = strtok_r(str, KEY_SEP, &saveptr); token != NULL; token = strtok_r(NULL, KEY_SEP, &saveptr)) {
+        if (strncmp(token, STATE_MOD_STATE KEY_VAL, strlen(STATE_MOD_STATE KEY_VAL)) == 0) {
+            char *mask, *state_saveptr = NULL;
+
+            strtok_r(token + strlen(STATE_MOD_STATE KEY_VAL), MASK_SEP, &state_saveptr);
+            mask = strtok_r(NULL, MASK_SEP, &state_saveptr);
+            if (!str_to_uint(token + strlen(STATE_MOD_STATE KEY_VAL), 0, &entry->state)
+                || (mask != NULL && !str_to_uint(mask, 0, &entry->state_mask))) {
+                ofp_fatal(0, "Error parsing state mod state: %s.", token);
+            }
+            continue;
+        }
+        if (strncmp(token, STATE_MOD_IDLE KEY_VAL, strlen(STATE_MOD_IDLE KEY_VAL)) == 0) {
+            if (!str_to_uint(token + strlen(STATE_MOD_IDLE KEY_VAL), 0, &entry->idle_timeout)) {
+                ofp_fatal(0, "Error parsing state mod idle timeout: %s.", token);
+            }
+            continue;
+        }
+        if (strncmp(token, STATE_MOD_HARD KEY_VAL, strlen(STATE_MOD_HARD KEY_VAL)) == 0) {
+            if (!str_to_uint(token + strlen(STATE_MOD_HARD KEY_VAL), 0, &entry->hard_timeout)) {
+                ofp_fatal(0, "Error parsing state mod hard timeout: %s.", token);
+            }
+            continue;
+        }
+        if (strncmp(token, STATE_MOD_IDLE_ROLLBACK KEY_VAL, strlen(STATE_MOD_IDLE_ROLLBACK KEY_VAL)) == 0) {
+            if (!str_to_uint(token + strlen(STATE_MOD_IDLE_ROLLBACK KEY_VAL), 0, &entry->idle_rollback)) {
+                ofp_fatal(0, "Error parsing state mod idle rollback: %s.", token);
+            }
+            continue;
+        }
+        if (strncmp(token, STATE_MOD_HARD_ROLLBACK KEY_VAL, strlen(STATE_MOD_HARD_ROLLBACK KEY_VAL)) == 0) {
+            if (!str_to_uint(token + strlen(STATE_MOD_HARD_ROLLBACK KEY_VAL), 0, &entry->hard_rollback)) {
+                ofp_fatal(0, "Error parsing state mod hard rollback: %s.", token);
+            }
+            continue;
+        }
+        ofp_fatal(0, "Error parsing state mod arg: %s.", token);
+    }
+}
+
 static void
 parse_state_stat_args(char *str, struct ofl_exp_msg_multipart_request_state *req)
 {
@@ -2325,6 +2725,34 @@ parse_flow_stat_args(char *str, struct ofl_msg_multipart_request_flow *req)
     }
 }
 
+static void
+parse_flow_monitor_args(char *str, struct ofl_exp_openflow_msg_multipart_request_flow_monitor *req)
+{
+    char *token, *saveptr = NULL;
+
+    for (token = strtok_r(str, KEY_SEP, &saveptr); token != NULL; token = strtok_r(NULL, KEY_SEP, &saveptr)) {
+        if (strncmp(token, FLOW_MOD_TABLE_ID KEY_VAL, strlen(FLOW_MOD_TABLE_ID KEY_VAL)) == 0) {
+            if (parse8(token + strlen(FLOW_MOD_TABLE_ID KEY_VAL), table_names, NUM_ELEMS(table_names), PIPELINE_TABLES - 1, &req->table_id)) {
+                ofp_fatal(0, "Error parsing flow_monitor table: %s.", token);
+            }
+            continue;
+        }
+        if (strncmp(token, FLOW_MOD_OUT_PORT KEY_VAL, strlen(FLOW_MOD_OUT_PORT KEY_VAL)) == 0) {
+            if (parse_port(token + strlen(FLOW_MOD_OUT_PORT KEY_VAL), &req->out_port)) {
+                ofp_fatal(0, "Error parsing flow_monitor port: %s.", token);
+            }
+            continue;
+        }
+        if (strncmp(token, FLOW_MOD_OUT_GROUP KEY_VAL, strlen(FLOW_MOD_OUT_GROUP KEY_VAL)) == 0) {
+            if (parse_group(token + strlen(FLOW_MOD_OUT_GROUP KEY_VAL), &req->out_group)) {
+                ofp_fatal(0, "Error parsing flow_monitor group: %s.", token);
+            }
+            continue;
+        }
+        ofp_fatal(0, "Error parsing flow_monitor arg: %s.", token);
+    }
+}
+
 
 
 static void
@@ -2681,6 +3109,53 @@ parse_meter(char *str, uint32_t *meter)
     return parse32(str, NULL, 0, OFPM_MAX, meter);
 }
 
+static void
+parse_pktin_limit(char *str, struct ofl_exp_openflow_msg_pktin_limit *msg)
+{
+    char *token, *saveptr = NULL;
+    bool burst = false;
+
+    for (token = strtok_r(str, KEY_SEP, &saveptr); token != NULL; token = strtok_r(NULL, KEY_SEP, &saveptr)) {
+        if (strncmp(token, PKTIN_LIMIT_REASON KEY_VAL, strlen(PKTIN_LIMIT_REASON KEY_VAL)) == 0) {
+            if (parse8(token + strlen(PKTIN_LIMIT_REASON KEY_VAL), pktin_reason_names, NUM_ELEMS(pktin_reason_names), 0, &msg->reason)) {
+                ofp_fatal(0, "Error parsing pktin_limit reason: %s.", token);
+            }
+            continue;
+        }
+        if (strncmp(token, PKTIN_LIMIT_TABLE KEY_VAL, strlen(PKTIN_LIMIT_TABLE KEY_VAL)) == 0) {
+            if (parse_table(token + strlen(PKTIN_LIMIT_TABLE KEY_VAL), &msg->table_id)) {
+                ofp_fatal(0, "Error parsing pktin_limit table: %s.", token);
+            }
+            continue;
+        }
+        if (strncmp(token, PKTIN_LIMIT_RATE KEY_VAL, strlen(PKTIN_LIMIT_RATE KEY_VAL)) == 0) {
+            if (parse32(token + strlen(PKTIN_LIMIT_RATE KEY_VAL), NULL, 0, UINT32_MAX, &msg->rate)) {
+                ofp_fatal(0, "Error parsing pktin_limit rate: %s.", token);
+            }
+            continue;
+        }
+        if (strncmp(token, PKTIN_LIMIT_BURST KEY_VAL, strlen(PKTIN_LIMIT_BURST KEY_VAL)) == 0) {
+            if (parse32(token + strlen(PKTIN_LIMIT_BURST KEY_VAL), NULL, 0, UINT32_MAX, &msg->burst)) {
+                ofp_fatal(0, "Error parsing pktin_limit burst: %s.", token);
+            }
+            burst = true;
+            continue;
+        }
+        if (strncmp(token, PKTIN_LIMIT_SAMPLE KEY_VAL, strlen(PKTIN_LIMIT_SAMPLE KEY_VAL)) == 0) {
+            if (parse32(token + strlen(PKTIN_LIMIT_SAMPLE KEY_VAL), NULL, 0, UINT32_MAX, &msg->sample)) {
+                ofp_fatal(0, "Error parsing pktin_limit sample: %s.", token);
+            }
+            continue;
+        }
+        ofp_fatal(0, "Error parsing pktin_limit arg: %s.", token);
+    }
+
+    /* By default, allow bursts of one second worth of packet-ins. */
+    if (!burst) {
+        msg->burst = msg->rate;
+    }
+}
+
 static int
 parse_table(char *str, uint8_t *table)
 {
@@ -106,6 +106,13 @@ static struct names8 table_names[] = {
         {0xff, "all"}
 };
 
+static struct names8 pktin_reason_names[] = {
+        {OFPR_NO_MATCH,    "no_match"},
+        {OFPR_ACTION,      "action"},
+        {OFPR_INVALID_TTL, "invalid_ttl"},
+        {0xff,             "all"}
+};
+
 static struct names16 inst_names[] = {
         {OFPIT_GOTO_TABLE,     "goto"},
         {OFPIT_WRITE_METADATA, "meta"},
@@ -250,6 +257,18 @@ static struct names16 band_names[] = {
 #define TABLE_MOD_TABLE  "table"
 #define TABLE_MOD_CONFIG "conf"
 
+#define PKTIN_LIMIT_REASON "reason"
+#define PKTIN_LIMIT_TABLE  "table"
+#define PKTIN_LIMIT_RATE   "rate"
+#define PKTIN_LIMIT_BURST  "burst"
+#define PKTIN_LIMIT_SAMPLE "sample"
+
+#define STATE_MOD_STATE         "state"
+#define STATE_MOD_IDLE          "idle"
+#define STATE_MOD_HARD          "hard"
+#define STATE_MOD_IDLE_ROLLBACK "idle_rb"
+#define STATE_MOD_HARD_ROLLBACK "hard_rb"
+
 #define KEY_VAL    "="
 #define KEY_VAL2   ":"
 #define KEY_SEP    ","